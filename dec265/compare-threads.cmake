@@ -0,0 +1,21 @@
+# Decodes INPUT once without threads (-t 0) and once with THREADS worker threads and
+# fails if the two outputs differ. Both runs also check the SEI MD5 hashes (-c).
+#
+# cmake -DDEC265=<dec265> -DINPUT=<stream> -DTHREADS=<n> -DOUTPUT=<prefix> -P compare-threads.cmake
+
+foreach(threads 0 ${THREADS})
+  execute_process(COMMAND ${DEC265} -q -c -t ${threads} -o ${OUTPUT}-t${threads}.yuv ${INPUT}
+                  RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "decoding ${INPUT} with -t ${threads} failed (${result})")
+  endif()
+endforeach()
+
+file(MD5 ${OUTPUT}-t0.yuv md5_reference)
+file(MD5 ${OUTPUT}-t${THREADS}.yuv md5_threads)
+
+file(REMOVE ${OUTPUT}-t0.yuv ${OUTPUT}-t${THREADS}.yuv)
+
+if(NOT md5_reference STREQUAL md5_threads)
+  message(FATAL_ERROR "${INPUT}: -t ${THREADS} output (${md5_threads}) differs from -t 0 (${md5_reference})")
+endif()
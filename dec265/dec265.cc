@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits>
+#include <vector>
 #include <getopt.h>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
@@ -44,6 +45,10 @@
 #include <unistd.h>
 #endif
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 #include "libde265/quality.h"
 
 #if HAVE_VIDEOGFX
@@ -74,6 +79,8 @@ bool write_yuv=false;
 bool output_with_videogfx=false;
 bool logging=true;
 bool no_acceleration=false;
+const char* max_acceleration=NULL;
+const char* autotune_cache=NULL;
 const char *output_filename = "out.yuv";
 uint32_t max_frames=UINT32_MAX;
 bool write_bytestream=false;
@@ -87,6 +94,7 @@ int highestTID = 100;
 int verbosity=0;
 int disable_deblocking=0;
 int disable_sao=0;
+const char* cpu_list=NULL;
 
 static struct option long_options[] = {
   {"quiet",      no_argument,       0, 'q' },
@@ -101,6 +109,8 @@ static struct option long_options[] = {
   {"no-logging", no_argument,       0, 'L' },
   {"help",       no_argument,       0, 'h' },
   {"noaccel",    no_argument,       0, '0' },
+  {"accel",      required_argument, 0, 'A' },
+  {"accel-cache", required_argument, 0, 'K' },
   {"write-bytestream", required_argument,0, 'B' },
   {"measure",     required_argument, 0, 'm' },
   {"ssim",        no_argument,       0, 's' },
@@ -109,6 +119,7 @@ static struct option long_options[] = {
   {"verbose",    no_argument,       0, 'v' },
   {"disable-deblocking", no_argument, &disable_deblocking, 1 },
   {"disable-sao",        no_argument, &disable_sao, 1 },
+  {"cpus",        required_argument, 0, 'C' },
   {0,         0,                 0,  0 }
 };
 
@@ -563,6 +574,56 @@ void (*volatile __malloc_initialize_hook)(void) = init_my_hooks;
 #endif
 
 
+// NAL buffers are passed to the decoder without copying, it gives them back through this
+static void release_NAL_buffer(const void* data, void* userdata)
+{
+  free((void*)data);
+}
+
+
+// largest CPU number that can be given in --cpus
+#ifdef CPU_SETSIZE
+static const long MAX_CPU_INDEX = CPU_SETSIZE-1;
+#else
+static const long MAX_CPU_INDEX = 1023;
+#endif
+
+// parse CPU lists like "0-3,8,10-11"
+static bool parse_cpu_list(const char* list, std::vector<int>& cpus)
+{
+  const char* p = list;
+
+  for (;;) {
+    char* end;
+    long first = strtol(p, &end, 10);
+    if (end==p || first<0) { return false; }
+
+    long last = first;
+    p = end;
+
+    if (*p=='-') {
+      p++;
+      last = strtol(p, &end, 10);
+      if (end==p || last<first) { return false; }
+      p = end;
+    }
+
+    if (last > MAX_CPU_INDEX) {
+      fprintf(stderr, "Error: CPU %ld is out of range (maximum is %ld)\n", last, MAX_CPU_INDEX);
+      return false;
+    }
+
+    for (long cpu=first; cpu<=last; cpu++) {
+      cpus.push_back((int)cpu);
+    }
+
+    if (*p==0) { return true; }
+    if (*p!=',') { return false; }
+    p++;
+  }
+}
+
+
 int main(int argc, char** argv)
 {
   while (1) {
@@ -588,12 +649,15 @@ int main(int argc, char** argv)
     case 'V': output_with_videogfx=true; break;
     case 'L': logging=false; break;
     case '0': no_acceleration=true; break;
+    case 'A': max_acceleration=optarg; break;
+    case 'K': autotune_cache=optarg; break;
     case 'B': write_bytestream=true; bytestream_filename=optarg; break;
     case 'm': measure_quality=true; reference_filename=optarg; break;
     case 's': show_ssim_map=true; break;
     case 'e': show_psnr_map=true; break;
     case 'T': highestTID=atoi(optarg); break;
     case 'v': verbosity++; break;
+    case 'C': cpu_list=optarg; break;
     }
   }
 
@@ -615,6 +679,9 @@ int main(int argc, char** argv)
     fprintf(stderr,"  -V, --videogfx    output with videogfx instead of SDL\n");
 #endif
     fprintf(stderr,"  -0, --noaccel     do not use any accelerated code (SSE)\n");
+    fprintf(stderr,"      --accel LEVEL highest instruction set to use (scalar, sse, avx2, avx512),\n");
+    fprintf(stderr,"                    or 'autotune' to benchmark each function at startup\n");
+    fprintf(stderr,"      --accel-cache FILE  store the autotune results in FILE for later runs\n");
     fprintf(stderr,"  -v, --verbose     increase verbosity level (up to 3 times)\n");
     fprintf(stderr,"  -L, --no-logging  disable logging\n");
     fprintf(stderr,"  -B, --write-bytestream FILENAME  write raw bytestream (from NAL input)\n");
@@ -626,6 +693,7 @@ int main(int argc, char** argv)
     fprintf(stderr,"  -T, --highest-TID select highest temporal sublayer to decode\n");
     fprintf(stderr,"      --disable-deblocking   disable deblocking filter\n");
     fprintf(stderr,"      --disable-sao          disable sample-adaptive offset filter\n");
+    fprintf(stderr,"      --cpus LIST            run worker threads only on these CPUs (e.g. 0-7,16-23)\n");
     fprintf(stderr,"  -h, --help        show help\n");
 
     exit(show_help ? 0 : 5);
@@ -652,6 +720,33 @@ int main(int argc, char** argv)
   if (no_acceleration) {
     de265_set_parameter_int(ctx, DE265_DECODER_PARAM_ACCELERATION_CODE, de265_acceleration_SCALAR);
   }
+  else if (max_acceleration) {
+    if (autotune_cache) {
+      de265_set_acceleration_autotune_cache(autotune_cache);
+    }
+
+    static const struct { const char* name; enum de265_acceleration level; } levels[] = {
+      { "scalar", de265_acceleration_SCALAR },
+      { "sse",    de265_acceleration_SSE4 },
+      { "avx2",   de265_acceleration_AVX2 },
+      { "avx512", de265_acceleration_AVX512 },
+      { "autotune", de265_acceleration_AUTOTUNE }
+    };
+
+    int i;
+    for (i=0; i<5; i++) {
+      if (strcmp(max_acceleration, levels[i].name)==0) {
+        break;
+      }
+    }
+
+    if (i==5) {
+      fprintf(stderr,"unknown acceleration level '%s'\n", max_acceleration);
+      exit(5);
+    }
+
+    de265_set_parameter_int(ctx, DE265_DECODER_PARAM_ACCELERATION_CODE, levels[i].level);
+  }
 
   if (!logging) {
     de265_disable_logging();
@@ -661,6 +756,19 @@ int main(int argc, char** argv)
 
 
   if (argc>=3) {
+    if (cpu_list) {
+      std::vector<int> cpus;
+      if (!parse_cpu_list(cpu_list, cpus)) {
+        fprintf(stderr, "Error: invalid CPU list '%s'\n", cpu_list);
+        exit(10);
+      }
+
+      err = de265_set_worker_cpu_affinity(ctx, cpus.data(), (int)cpus.size());
+      if (err != DE265_OK) {
+        fprintf(stderr, "Warning: %s\n", de265_get_error_text(err));
+      }
+    }
+
     if (nThreads>0) {
       err = de265_start_worker_threads(ctx, nThreads);
     }
@@ -726,7 +834,6 @@ int main(int argc, char** argv)
 	else {
 	  uint8_t* buf = (uint8_t*)malloc(length);
 	  n = fread(buf,1,length,fh);
-	  err = de265_push_NAL(ctx, buf,n,  pos, (void*)1);
 
 	  if (write_bytestream) {
 	    uint8_t sc[3] = { 0,0,1 };
@@ -734,7 +841,12 @@ int main(int argc, char** argv)
 	    fwrite(buf,1,n,bytestream_fh);
 	  }
 
-	  free(buf);
+	  // the decoder frees the buffer when it is done with the NAL
+	  err = de265_push_NAL_zero_copy(ctx, buf,n,  pos, (void*)1, release_NAL_buffer, NULL);
+	  if (err != DE265_OK) {
+	    free(buf);
+	  }
+
 	  pos+=n;
 	}
       }
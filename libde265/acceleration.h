@@ -178,6 +178,17 @@ struct acceleration_functions
   void (*transform_skip_residual)(int32_t *residual, const int16_t *coeffs, int nT,
                                   int tsShift,int bdShift);
 
+  // Cross-component prediction (7.3.8.12): adds the scaled luma residual to a chroma residual.
+  void (*cross_comp_pred)(int32_t *residual, const int32_t *residual_luma, int nT,
+                          int ResScaleVal, int BitDepthY, int BitDepthC);
+
+  // Inverse quantization (8.6.3) of an nT x nT coefficient block, in place.
+  // Only the top-left width x height region (multiples of 4) is scaled, all coefficients
+  // outside of it have to be zero. 'scalingFactor' is the nT x nT scaling matrix m[x][y],
+  // or NULL for flat scaling (m=16). 'qPper' is qP/6, 'levelScale' is levelScale[qP%6].
+  void (*scale_coefficients)(int16_t *coeff, int nT, int width, int height,
+                             const uint8_t* scalingFactor, int levelScale, int qPper, int bdShift);
+
 
   template <class pixel_t> void transform_skip(pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const;
   template <class pixel_t> void transform_skip_rdpcm_v(pixel_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const;
@@ -187,6 +198,85 @@ struct acceleration_functions
 
 
 
+  // --- deblocking ---
+
+  // Filter one 4-line edge segment. 'ptr' points to the first sample of the Q block,
+  // beta and tc are already scaled to the bit depth.
+  // 'v' functions filter across a vertical edge, 'h' functions across a horizontal edge.
+
+  void (*deblock_luma_v_8)(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ);
+  void (*deblock_luma_h_8)(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ);
+  void (*deblock_chroma_v_8)(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ);
+  void (*deblock_chroma_h_8)(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ);
+
+  void (*deblock_luma_v_16)(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth);
+  void (*deblock_luma_h_16)(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth);
+  void (*deblock_chroma_v_16)(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth);
+  void (*deblock_chroma_h_16)(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth);
+
+  template <class pixel_t> void deblock_luma(bool vertical, pixel_t *ptr, ptrdiff_t stride, int beta, int tc,
+                                             bool filterP, bool filterQ, int bit_depth) const;
+  template <class pixel_t> void deblock_chroma(bool vertical, pixel_t *ptr, ptrdiff_t stride, int tc,
+                                               bool filterP, bool filterQ, int bit_depth) const;
+
+
+
+  // --- sample adaptive offset ---
+
+  // Band offset: samples in the four bands starting at 'bandPosition' get offsets[0..3] added.
+  // Edge offset: 'offsets' is indexed with the sum of the two neighbor signs plus 2.
+  // The caller has to exclude samples whose edge offset neighbors are not available.
+  // 'dst' has to contain a copy of 'src', unmodified samples need not be written.
+
+  void (*sao_band_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int bandPosition, const int8_t offsets[4]);
+  void (*sao_edge_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int eoClass, const int8_t offsets[5]);
+
+  void (*sao_band_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth);
+  void (*sao_edge_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int eoClass, const int8_t offsets[5], int bit_depth);
+
+  template <class pixel_t> void sao_band(pixel_t *dst, ptrdiff_t dststride, const pixel_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int bandPosition, const int8_t offsets[4],
+                                         int bit_depth) const;
+  template <class pixel_t> void sao_edge(pixel_t *dst, ptrdiff_t dststride, const pixel_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int eoClass, const int8_t offsets[5],
+                                         int bit_depth) const;
+
+
+
+  // --- intra prediction ---
+
+  // 'border' points to the top-left reference sample, border[1..2nT] is the row above
+  // the block and border[-1..-2nT] the column to its left (see fill_border_samples()).
+
+  void (*intra_filter_border_8)(uint8_t *border, int nT, bool strong); // reference sample smoothing
+  void (*intra_pred_planar_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT);
+  void (*intra_pred_dc_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx);
+  void (*intra_pred_angular_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx,
+                               int intraPredMode, bool disableIntraBoundaryFilter);
+
+  void (*intra_filter_border_16)(uint16_t *border, int nT, bool strong, int bit_depth);
+  void (*intra_pred_planar_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT,
+                               int bit_depth);
+  void (*intra_pred_dc_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                           int bit_depth);
+  void (*intra_pred_angular_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                                int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth);
+
+  template <class pixel_t> void intra_filter_border(pixel_t *border, int nT, bool strong, int bit_depth) const;
+  template <class pixel_t> void intra_pred_planar(pixel_t *dst, ptrdiff_t dststride, const pixel_t *border,
+                                                  int nT, int bit_depth) const;
+  template <class pixel_t> void intra_pred_dc(pixel_t *dst, ptrdiff_t dststride, const pixel_t *border,
+                                              int nT, int cIdx, int bit_depth) const;
+  template <class pixel_t> void intra_pred_angular(pixel_t *dst, ptrdiff_t dststride, const pixel_t *border,
+                                                   int nT, int cIdx, int intraPredMode,
+                                                   bool disableIntraBoundaryFilter, int bit_depth) const;
+
+
+
   // --- forward transforms ---
 
   void (*fwd_transform_4x4_dst_8)(int16_t *coeffs, const int16_t* src, ptrdiff_t stride); // fDST
@@ -198,6 +288,14 @@ struct acceleration_functions
   // forward Hadamard transform (without scaling factor)
   // (4x4,8x8,16x16,32x32) indexed with (log2TbSize-2)
   void (*hadamard_transform_8[4])     (int16_t *coeffs, const int16_t *src, ptrdiff_t stride);
+
+
+
+  // --- byte-stream parsing ---
+
+  // Position of the first pair of zero bytes in data[0..len-1], or len-1 if there is none.
+
+  int (*find_zero_byte_pair)(const uint8_t* data, int len);
 };
 
 
@@ -356,4 +454,44 @@ template <> inline void acceleration_functions::transform_add<uint16_t>(int size
 template <> inline void acceleration_functions::add_residual(uint8_t *dst,  ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_8(dst,stride,r,nT,bit_depth); }
 template <> inline void acceleration_functions::add_residual(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_16(dst,stride,r,nT,bit_depth); }
 
+template <> inline void acceleration_functions::deblock_luma<uint8_t>(bool vertical, uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth) const
+{
+  if (vertical) deblock_luma_v_8(ptr,stride,beta,tc,filterP,filterQ);
+  else          deblock_luma_h_8(ptr,stride,beta,tc,filterP,filterQ);
+}
+template <> inline void acceleration_functions::deblock_luma<uint16_t>(bool vertical, uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth) const
+{
+  if (vertical) deblock_luma_v_16(ptr,stride,beta,tc,filterP,filterQ,bit_depth);
+  else          deblock_luma_h_16(ptr,stride,beta,tc,filterP,filterQ,bit_depth);
+}
+
+template <> inline void acceleration_functions::deblock_chroma<uint8_t>(bool vertical, uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth) const
+{
+  if (vertical) deblock_chroma_v_8(ptr,stride,tc,filterP,filterQ);
+  else          deblock_chroma_h_8(ptr,stride,tc,filterP,filterQ);
+}
+template <> inline void acceleration_functions::deblock_chroma<uint16_t>(bool vertical, uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth) const
+{
+  if (vertical) deblock_chroma_v_16(ptr,stride,tc,filterP,filterQ,bit_depth);
+  else          deblock_chroma_h_16(ptr,stride,tc,filterP,filterQ,bit_depth);
+}
+
+template <> inline void acceleration_functions::sao_band<uint8_t>(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride, int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth) const { sao_band_8(dst,dststride,src,srcstride,width,height,bandPosition,offsets); }
+template <> inline void acceleration_functions::sao_band<uint16_t>(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride, int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth) const { sao_band_16(dst,dststride,src,srcstride,width,height,bandPosition,offsets,bit_depth); }
+
+template <> inline void acceleration_functions::sao_edge<uint8_t>(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride, int width, int height, int eoClass, const int8_t offsets[5], int bit_depth) const { sao_edge_8(dst,dststride,src,srcstride,width,height,eoClass,offsets); }
+template <> inline void acceleration_functions::sao_edge<uint16_t>(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride, int width, int height, int eoClass, const int8_t offsets[5], int bit_depth) const { sao_edge_16(dst,dststride,src,srcstride,width,height,eoClass,offsets,bit_depth); }
+
+template <> inline void acceleration_functions::intra_filter_border<uint8_t>(uint8_t *border, int nT, bool strong, int bit_depth) const { intra_filter_border_8(border,nT,strong); }
+template <> inline void acceleration_functions::intra_filter_border<uint16_t>(uint16_t *border, int nT, bool strong, int bit_depth) const { intra_filter_border_16(border,nT,strong,bit_depth); }
+
+template <> inline void acceleration_functions::intra_pred_planar<uint8_t>(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int bit_depth) const { intra_pred_planar_8(dst,dststride,border,nT); }
+template <> inline void acceleration_functions::intra_pred_planar<uint16_t>(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int bit_depth) const { intra_pred_planar_16(dst,dststride,border,nT,bit_depth); }
+
+template <> inline void acceleration_functions::intra_pred_dc<uint8_t>(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx, int bit_depth) const { intra_pred_dc_8(dst,dststride,border,nT,cIdx); }
+template <> inline void acceleration_functions::intra_pred_dc<uint16_t>(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx, int bit_depth) const { intra_pred_dc_16(dst,dststride,border,nT,cIdx,bit_depth); }
+
+template <> inline void acceleration_functions::intra_pred_angular<uint8_t>(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx, int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth) const { intra_pred_angular_8(dst,dststride,border,nT,cIdx,intraPredMode,disableIntraBoundaryFilter); }
+template <> inline void acceleration_functions::intra_pred_angular<uint16_t>(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx, int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth) const { intra_pred_angular_16(dst,dststride,border,nT,cIdx,intraPredMode,disableIntraBoundaryFilter,bit_depth); }
+
 #endif
@@ -0,0 +1,680 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "autotune.h"
+#include "decctx.h"
+#include "util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_SSE4_1
+#include "x86/sse.h"
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+
+/* Every function pointer in acceleration_functions that is used in the decoder (or
+   encoder) gets a benchmark entry below. The candidates for a function are the
+   distinct pointers in the tables of all acceleration levels. Since the levels are
+   installed on top of each other, and each level checks the CPU itself, a candidate
+   can always be executed on this machine.
+ */
+
+static const struct {
+  const char* name;
+  enum de265_acceleration level;
+} autotune_levels[] = {
+  { "scalar", de265_acceleration_SCALAR },
+  { "sse",    de265_acceleration_SSE4 },
+  { "avx2",   de265_acceleration_AVX2 },
+  { "avx512", de265_acceleration_AVX512 },
+  { "arm",    de265_acceleration_ARM }
+};
+
+static const int nLevels = sizeof(autotune_levels)/sizeof(autotune_levels[0]);
+
+
+// --- synthetic input data ---
+
+#define IMG_SIZE   96  // 64x64 block with a margin of 16 samples for the filter taps
+#define IMG_ORIGIN (16*IMG_SIZE+16)  // block origin is 16-byte aligned, as in the decoder
+
+struct autotune_data
+{
+  // inputs and outputs, compared between the implementations
+  // (aligned like the buffers in the decoder, some kernels rely on that)
+
+  ALIGNED_16(uint8_t  img8 [IMG_SIZE*IMG_SIZE]);
+  ALIGNED_16(uint16_t img16[IMG_SIZE*IMG_SIZE]);
+  ALIGNED_16(uint8_t  out8 [IMG_SIZE*IMG_SIZE]);  // initialized with a copy of img8
+  ALIGNED_16(uint16_t out16[IMG_SIZE*IMG_SIZE]);  // initialized with a copy of img16
+  ALIGNED_16(uint8_t  border8 [4*64+1]);
+  ALIGNED_16(uint16_t border16[4*64+1]);
+  ALIGNED_16(int16_t  pred1[64*64]);
+  ALIGNED_16(int16_t  pred2[64*64]);
+  ALIGNED_16(int16_t  mcout[64*64]);
+  ALIGNED_16(int16_t  coeffs[32*32]);
+  ALIGNED_16(int16_t  diff[32*32]);
+  ALIGNED_16(int32_t  residual[32*32]);
+  ALIGNED_16(int32_t  residual_luma[32*32]);
+
+  // scratch memory, its content differs between implementations
+
+  ALIGNED_16(int16_t  mcbuffer[64*(64+7)]);
+};
+
+static const size_t compared_size = offsetof(autotune_data, mcbuffer);
+
+
+// deterministic pseudo random numbers in [0;range[
+static uint32_t rnd_seed;
+
+static int rnd(int range)
+{
+  rnd_seed = rnd_seed*1103515245 + 12345;
+  return (rnd_seed>>16) % range;
+}
+
+static void fill_synthetic_data(autotune_data* d)
+{
+  memset(d, 0, sizeof(autotune_data));
+
+  rnd_seed = 12345;
+
+  // smooth image content, such that the deblocking filter decisions are positive
+
+  for (int y=0;y<IMG_SIZE;y++)
+    for (int x=0;x<IMG_SIZE;x++) {
+      int v = 40 + x + y + rnd(4);
+      d->img8 [y*IMG_SIZE+x] = v;
+      d->img16[y*IMG_SIZE+x] = 4*v + rnd(4);
+    }
+
+  memcpy(d->out8,  d->img8,  sizeof(d->img8));
+  memcpy(d->out16, d->img16, sizeof(d->img16));
+
+  for (int i=0;i<4*64+1;i++) {
+    d->border8[i]  = 100 + i/4 + rnd(8);
+    d->border16[i] = 4*d->border8[i] + rnd(4);
+  }
+
+  for (int i=0;i<64*64;i++) {
+    d->pred1[i] = (d->img8[i % (IMG_SIZE*IMG_SIZE)] << 6) + rnd(64) - 32;
+    d->pred2[i] = (d->img8[(i+17) % (IMG_SIZE*IMG_SIZE)] << 6) + rnd(64) - 32;
+  }
+
+  // coefficients only in the low frequencies, as in typical blocks
+
+  for (int y=0;y<8;y++)
+    for (int x=0;x<8;x++) {
+      d->coeffs[y*32+x] = rnd(201) - 100;
+    }
+
+  for (int i=0;i<32*32;i++) {
+    d->diff[i]          = rnd(129) - 64;
+    d->residual[i]      = rnd(511) - 255;
+    d->residual_luma[i] = rnd(511) - 255;
+  }
+}
+
+
+// --- benchmark calls ---
+
+/* 'w' is the block width and height for slots that are measured over all
+   block_sizes[] (the MC and weighted prediction functions), 0 otherwise. */
+
+typedef void (*autotune_run)(const acceleration_functions* a, autotune_data* d, int arg, int w);
+
+static const int block_sizes[] = { 4, 8, 16, 32, 64 };
+static const int nBlockSizes = sizeof(block_sizes)/sizeof(block_sizes[0]);
+
+static const int8_t sao_offsets[5] = { 2, 1, 0, -1, -2 };
+
+static void run_weighted_pred_avg_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_pred_avg_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->pred1, d->pred2, 64, w,w); }
+static void run_unweighted_pred_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_unweighted_pred_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->pred1, 64, w,w); }
+static void run_weighted_pred_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_pred_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->pred1, 64, w,w, 37,3,6); }
+static void run_weighted_bipred_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_bipred_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->pred1, d->pred2, 64, w,w, 37,3,-20,1,6); }
+
+static void run_weighted_pred_avg_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_pred_avg_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->pred1, d->pred2, 64, w,w, 10); }
+static void run_unweighted_pred_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_unweighted_pred_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->pred1, 64, w,w, 10); }
+static void run_weighted_pred_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_pred_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->pred1, 64, w,w, 37,3,6, 10); }
+static void run_weighted_bipred_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_weighted_bipred_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->pred1, d->pred2, 64, w,w, 37,3,-20,1,6, 10); }
+
+static void run_epel_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_8(d->mcout, 64, d->img8+IMG_ORIGIN, IMG_SIZE, w,w, 0,0, d->mcbuffer); }
+static void run_epel_h_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_h_8(d->mcout, 64, d->img8+IMG_ORIGIN, IMG_SIZE, w,w, 3,0, d->mcbuffer, 8); }
+static void run_epel_v_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_v_8(d->mcout, 64, d->img8+IMG_ORIGIN, IMG_SIZE, w,w, 0,5, d->mcbuffer, 8); }
+static void run_epel_hv_8(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_hv_8(d->mcout, 64, d->img8+IMG_ORIGIN, IMG_SIZE, w,w, 3,5, d->mcbuffer, 8); }
+static void run_qpel_8(const acceleration_functions* a, autotune_data* d, int xy, int w)
+{ a->put_hevc_qpel_8[xy>>2][xy&3](d->mcout, 64, d->img8+IMG_ORIGIN, IMG_SIZE, w,w, d->mcbuffer); }
+
+static void run_epel_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_16(d->mcout, 64, d->img16+IMG_ORIGIN, IMG_SIZE, w,w, 0,0, d->mcbuffer, 10); }
+static void run_epel_h_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_h_16(d->mcout, 64, d->img16+IMG_ORIGIN, IMG_SIZE, w,w, 3,0, d->mcbuffer, 10); }
+static void run_epel_v_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_v_16(d->mcout, 64, d->img16+IMG_ORIGIN, IMG_SIZE, w,w, 0,5, d->mcbuffer, 10); }
+static void run_epel_hv_16(const acceleration_functions* a, autotune_data* d, int, int w)
+{ a->put_hevc_epel_hv_16(d->mcout, 64, d->img16+IMG_ORIGIN, IMG_SIZE, w,w, 3,5, d->mcbuffer, 10); }
+static void run_qpel_16(const acceleration_functions* a, autotune_data* d, int xy, int w)
+{ a->put_hevc_qpel_16[xy>>2][xy&3](d->mcout, 64, d->img16+IMG_ORIGIN, IMG_SIZE, w,w, d->mcbuffer, 10); }
+
+static void run_scale_coefficients(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->scale_coefficients(d->coeffs, 32, 8,8, NULL, 51, 2, 10); }
+static void run_transform_bypass(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_bypass(d->residual, d->coeffs, 16); }
+static void run_transform_bypass_rdpcm_v(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_bypass_rdpcm_v(d->residual, d->coeffs, 16); }
+static void run_transform_bypass_rdpcm_h(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_bypass_rdpcm_h(d->residual, d->coeffs, 16); }
+static void run_transform_4x4_dst_add_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_4x4_dst_add_8(d->out8+IMG_ORIGIN, d->coeffs, IMG_SIZE); }
+static void run_transform_add_8(const acceleration_functions* a, autotune_data* d, int sizeIdx, int)
+{ a->transform_add_8[sizeIdx](d->out8+IMG_ORIGIN, d->coeffs, IMG_SIZE); }
+static void run_transform_4x4_dst_add_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_4x4_dst_add_16(d->out16+IMG_ORIGIN, d->coeffs, IMG_SIZE, 10); }
+static void run_transform_add_16(const acceleration_functions* a, autotune_data* d, int sizeIdx, int)
+{ a->transform_add_16[sizeIdx](d->out16+IMG_ORIGIN, d->coeffs, IMG_SIZE, 10); }
+static void run_rotate_coefficients(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->rotate_coefficients(d->coeffs, 4); }
+static void run_transform_idst_4x4(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_idst_4x4(d->residual, d->coeffs, 12, 15); }
+static void run_transform_idct(const acceleration_functions* a, autotune_data* d, int sizeIdx, int)
+{
+  switch (sizeIdx) {
+  case 0: a->transform_idct_4x4  (d->residual, d->coeffs, 12, 15); break;
+  case 1: a->transform_idct_8x8  (d->residual, d->coeffs, 12, 15); break;
+  case 2: a->transform_idct_16x16(d->residual, d->coeffs, 12, 15); break;
+  case 3: a->transform_idct_32x32(d->residual, d->coeffs, 12, 15); break;
+  }
+}
+static void run_add_residual_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->add_residual_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->residual, 16, 8); }
+static void run_add_residual_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->add_residual_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->residual, 16, 10); }
+static void run_rdpcm_v(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->rdpcm_v(d->residual, d->coeffs, 16, 9, 12); }
+static void run_rdpcm_h(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->rdpcm_h(d->residual, d->coeffs, 16, 9, 12); }
+static void run_transform_skip_residual(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->transform_skip_residual(d->residual, d->coeffs, 16, 9, 12); }
+static void run_cross_comp_pred(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->cross_comp_pred(d->residual, d->residual_luma, 16, 4, 8, 8); }
+
+static void run_deblock_luma_v_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_luma_v_8(d->out8+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 40, 6, true, true); }
+static void run_deblock_luma_h_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_luma_h_8(d->out8+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 40, 6, true, true); }
+static void run_deblock_chroma_v_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_chroma_v_8(d->out8+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 6, true, true); }
+static void run_deblock_chroma_h_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_chroma_h_8(d->out8+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 6, true, true); }
+static void run_deblock_luma_v_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_luma_v_16(d->out16+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 160, 24, true, true, 10); }
+static void run_deblock_luma_h_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_luma_h_16(d->out16+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 160, 24, true, true, 10); }
+static void run_deblock_chroma_v_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_chroma_v_16(d->out16+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 24, true, true, 10); }
+static void run_deblock_chroma_h_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->deblock_chroma_h_16(d->out16+IMG_ORIGIN+16*IMG_SIZE+16, IMG_SIZE, 24, true, true, 10); }
+
+static void run_sao_band_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->sao_band_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->img8+IMG_ORIGIN, IMG_SIZE, 64,64, 12, sao_offsets); }
+static void run_sao_edge_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->sao_edge_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->img8+IMG_ORIGIN, IMG_SIZE, 64,64, 2, sao_offsets); }
+static void run_sao_band_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->sao_band_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->img16+IMG_ORIGIN, IMG_SIZE, 64,64, 12, sao_offsets, 10); }
+static void run_sao_edge_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->sao_edge_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->img16+IMG_ORIGIN, IMG_SIZE, 64,64, 2, sao_offsets, 10); }
+
+static void run_intra_filter_border_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_filter_border_8(d->border8+2*64, 16, false); }
+static void run_intra_pred_planar_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_pred_planar_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->border8+2*64, 16); }
+static void run_intra_pred_dc_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_pred_dc_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->border8+2*64, 16, 0); }
+static void run_intra_pred_angular_8(const acceleration_functions* a, autotune_data* d, int, int)
+{
+  for (int mode=2; mode<=34; mode+=4) {
+    a->intra_pred_angular_8(d->out8+IMG_ORIGIN, IMG_SIZE, d->border8+2*64, 16, 0, mode, false);
+  }
+}
+static void run_intra_filter_border_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_filter_border_16(d->border16+2*64, 16, false, 10); }
+static void run_intra_pred_planar_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_pred_planar_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->border16+2*64, 16, 10); }
+static void run_intra_pred_dc_16(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->intra_pred_dc_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->border16+2*64, 16, 0, 10); }
+static void run_intra_pred_angular_16(const acceleration_functions* a, autotune_data* d, int, int)
+{
+  for (int mode=2; mode<=34; mode+=4) {
+    a->intra_pred_angular_16(d->out16+IMG_ORIGIN, IMG_SIZE, d->border16+2*64, 16, 0, mode, false, 10);
+  }
+}
+
+static void run_fwd_transform_4x4_dst_8(const acceleration_functions* a, autotune_data* d, int, int)
+{ a->fwd_transform_4x4_dst_8(d->mcout, d->diff, 32); }
+static void run_fwd_transform_8(const acceleration_functions* a, autotune_data* d, int sizeIdx, int)
+{ a->fwd_transform_8[sizeIdx](d->mcout, d->diff, 32); }
+static void run_hadamard_transform_8(const acceleration_functions* a, autotune_data* d, int sizeIdx, int)
+{ a->hadamard_transform_8[sizeIdx](d->mcout, d->diff, 32); }
+
+
+struct autotune_slot
+{
+  const char*  name;
+  size_t       offset;  // position of the function pointer in acceleration_functions
+  autotune_run run;
+  int          arg;
+  bool         all_block_sizes;
+};
+
+#define SLOT(field, run, arg)    { #field, offsetof(acceleration_functions, field), run, arg, false }
+#define SLOT_MC(field, run, arg) { #field, offsetof(acceleration_functions, field), run, arg, true }
+
+static const autotune_slot autotune_slots[] = {
+  SLOT_MC(put_weighted_pred_avg_8, run_weighted_pred_avg_8, 0),
+  SLOT_MC(put_unweighted_pred_8,   run_unweighted_pred_8, 0),
+  SLOT_MC(put_weighted_pred_8,     run_weighted_pred_8, 0),
+  SLOT_MC(put_weighted_bipred_8,   run_weighted_bipred_8, 0),
+  SLOT_MC(put_weighted_pred_avg_16, run_weighted_pred_avg_16, 0),
+  SLOT_MC(put_unweighted_pred_16,   run_unweighted_pred_16, 0),
+  SLOT_MC(put_weighted_pred_16,     run_weighted_pred_16, 0),
+  SLOT_MC(put_weighted_bipred_16,   run_weighted_bipred_16, 0),
+
+  SLOT_MC(put_hevc_epel_8,    run_epel_8, 0),
+  SLOT_MC(put_hevc_epel_h_8,  run_epel_h_8, 0),
+  SLOT_MC(put_hevc_epel_v_8,  run_epel_v_8, 0),
+  SLOT_MC(put_hevc_epel_hv_8, run_epel_hv_8, 0),
+  SLOT_MC(put_hevc_qpel_8[0][0], run_qpel_8, 0), SLOT_MC(put_hevc_qpel_8[0][1], run_qpel_8, 1),
+  SLOT_MC(put_hevc_qpel_8[0][2], run_qpel_8, 2), SLOT_MC(put_hevc_qpel_8[0][3], run_qpel_8, 3),
+  SLOT_MC(put_hevc_qpel_8[1][0], run_qpel_8, 4), SLOT_MC(put_hevc_qpel_8[1][1], run_qpel_8, 5),
+  SLOT_MC(put_hevc_qpel_8[1][2], run_qpel_8, 6), SLOT_MC(put_hevc_qpel_8[1][3], run_qpel_8, 7),
+  SLOT_MC(put_hevc_qpel_8[2][0], run_qpel_8, 8), SLOT_MC(put_hevc_qpel_8[2][1], run_qpel_8, 9),
+  SLOT_MC(put_hevc_qpel_8[2][2], run_qpel_8, 10), SLOT_MC(put_hevc_qpel_8[2][3], run_qpel_8, 11),
+  SLOT_MC(put_hevc_qpel_8[3][0], run_qpel_8, 12), SLOT_MC(put_hevc_qpel_8[3][1], run_qpel_8, 13),
+  SLOT_MC(put_hevc_qpel_8[3][2], run_qpel_8, 14), SLOT_MC(put_hevc_qpel_8[3][3], run_qpel_8, 15),
+
+  SLOT_MC(put_hevc_epel_16,    run_epel_16, 0),
+  SLOT_MC(put_hevc_epel_h_16,  run_epel_h_16, 0),
+  SLOT_MC(put_hevc_epel_v_16,  run_epel_v_16, 0),
+  SLOT_MC(put_hevc_epel_hv_16, run_epel_hv_16, 0),
+  SLOT_MC(put_hevc_qpel_16[0][0], run_qpel_16, 0), SLOT_MC(put_hevc_qpel_16[0][1], run_qpel_16, 1),
+  SLOT_MC(put_hevc_qpel_16[0][2], run_qpel_16, 2), SLOT_MC(put_hevc_qpel_16[0][3], run_qpel_16, 3),
+  SLOT_MC(put_hevc_qpel_16[1][0], run_qpel_16, 4), SLOT_MC(put_hevc_qpel_16[1][1], run_qpel_16, 5),
+  SLOT_MC(put_hevc_qpel_16[1][2], run_qpel_16, 6), SLOT_MC(put_hevc_qpel_16[1][3], run_qpel_16, 7),
+  SLOT_MC(put_hevc_qpel_16[2][0], run_qpel_16, 8), SLOT_MC(put_hevc_qpel_16[2][1], run_qpel_16, 9),
+  SLOT_MC(put_hevc_qpel_16[2][2], run_qpel_16, 10), SLOT_MC(put_hevc_qpel_16[2][3], run_qpel_16, 11),
+  SLOT_MC(put_hevc_qpel_16[3][0], run_qpel_16, 12), SLOT_MC(put_hevc_qpel_16[3][1], run_qpel_16, 13),
+  SLOT_MC(put_hevc_qpel_16[3][2], run_qpel_16, 14), SLOT_MC(put_hevc_qpel_16[3][3], run_qpel_16, 15),
+
+  SLOT(scale_coefficients,       run_scale_coefficients, 0),
+  SLOT(transform_bypass,         run_transform_bypass, 0),
+  SLOT(transform_bypass_rdpcm_v, run_transform_bypass_rdpcm_v, 0),
+  SLOT(transform_bypass_rdpcm_h, run_transform_bypass_rdpcm_h, 0),
+  SLOT(transform_4x4_dst_add_8,  run_transform_4x4_dst_add_8, 0),
+  SLOT(transform_add_8[0], run_transform_add_8, 0),
+  SLOT(transform_add_8[1], run_transform_add_8, 1),
+  SLOT(transform_add_8[2], run_transform_add_8, 2),
+  SLOT(transform_add_8[3], run_transform_add_8, 3),
+  SLOT(transform_4x4_dst_add_16, run_transform_4x4_dst_add_16, 0),
+  SLOT(transform_add_16[0], run_transform_add_16, 0),
+  SLOT(transform_add_16[1], run_transform_add_16, 1),
+  SLOT(transform_add_16[2], run_transform_add_16, 2),
+  SLOT(transform_add_16[3], run_transform_add_16, 3),
+  SLOT(rotate_coefficients,  run_rotate_coefficients, 0),
+  SLOT(transform_idst_4x4,   run_transform_idst_4x4, 0),
+  SLOT(transform_idct_4x4,   run_transform_idct, 0),
+  SLOT(transform_idct_8x8,   run_transform_idct, 1),
+  SLOT(transform_idct_16x16, run_transform_idct, 2),
+  SLOT(transform_idct_32x32, run_transform_idct, 3),
+  SLOT(add_residual_8,  run_add_residual_8, 0),
+  SLOT(add_residual_16, run_add_residual_16, 0),
+  SLOT(rdpcm_v, run_rdpcm_v, 0),
+  SLOT(rdpcm_h, run_rdpcm_h, 0),
+  SLOT(transform_skip_residual, run_transform_skip_residual, 0),
+  SLOT(cross_comp_pred, run_cross_comp_pred, 0),
+
+  SLOT(deblock_luma_v_8,    run_deblock_luma_v_8, 0),
+  SLOT(deblock_luma_h_8,    run_deblock_luma_h_8, 0),
+  SLOT(deblock_chroma_v_8,  run_deblock_chroma_v_8, 0),
+  SLOT(deblock_chroma_h_8,  run_deblock_chroma_h_8, 0),
+  SLOT(deblock_luma_v_16,   run_deblock_luma_v_16, 0),
+  SLOT(deblock_luma_h_16,   run_deblock_luma_h_16, 0),
+  SLOT(deblock_chroma_v_16, run_deblock_chroma_v_16, 0),
+  SLOT(deblock_chroma_h_16, run_deblock_chroma_h_16, 0),
+
+  SLOT(sao_band_8,  run_sao_band_8, 0),
+  SLOT(sao_edge_8,  run_sao_edge_8, 0),
+  SLOT(sao_band_16, run_sao_band_16, 0),
+  SLOT(sao_edge_16, run_sao_edge_16, 0),
+
+  SLOT(intra_filter_border_8,  run_intra_filter_border_8, 0),
+  SLOT(intra_pred_planar_8,    run_intra_pred_planar_8, 0),
+  SLOT(intra_pred_dc_8,        run_intra_pred_dc_8, 0),
+  SLOT(intra_pred_angular_8,   run_intra_pred_angular_8, 0),
+  SLOT(intra_filter_border_16, run_intra_filter_border_16, 0),
+  SLOT(intra_pred_planar_16,   run_intra_pred_planar_16, 0),
+  SLOT(intra_pred_dc_16,       run_intra_pred_dc_16, 0),
+  SLOT(intra_pred_angular_16,  run_intra_pred_angular_16, 0),
+
+  SLOT(fwd_transform_4x4_dst_8, run_fwd_transform_4x4_dst_8, 0),
+  SLOT(fwd_transform_8[0], run_fwd_transform_8, 0),
+  SLOT(fwd_transform_8[1], run_fwd_transform_8, 1),
+  SLOT(fwd_transform_8[2], run_fwd_transform_8, 2),
+  SLOT(fwd_transform_8[3], run_fwd_transform_8, 3),
+  SLOT(hadamard_transform_8[0], run_hadamard_transform_8, 0),
+  SLOT(hadamard_transform_8[1], run_hadamard_transform_8, 1),
+  SLOT(hadamard_transform_8[2], run_hadamard_transform_8, 2),
+  SLOT(hadamard_transform_8[3], run_hadamard_transform_8, 3)
+};
+
+#undef SLOT
+#undef SLOT_MC
+
+static const int nSlots = sizeof(autotune_slots)/sizeof(autotune_slots[0]);
+
+
+typedef void (*generic_func)();
+
+static inline generic_func get_slot(const acceleration_functions* accel, const autotune_slot& slot)
+{
+  generic_func f;
+  memcpy(&f, (const uint8_t*)accel + slot.offset, sizeof(f));
+  return f;
+}
+
+static inline void copy_slot(acceleration_functions* dst, const acceleration_functions* src,
+                             const autotune_slot& slot)
+{
+  memcpy((uint8_t*)dst + slot.offset, (const uint8_t*)src + slot.offset, sizeof(generic_func));
+}
+
+
+// --- benchmark ---
+
+// Minimum time of several rounds, to filter out interruptions.
+static double time_slot(const autotune_slot& slot, const acceleration_functions* accel, int w,
+                        autotune_data* work, const autotune_data* pristine)
+{
+  const int nRounds = 5;
+  const int nCalls  = 16;
+
+  memcpy(work, pristine, sizeof(autotune_data));
+  slot.run(accel, work, slot.arg, w); // warm up caches
+
+  double best = 1e30;
+
+  for (int r=0;r<nRounds;r++) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i=0;i<nCalls;i++) {
+      slot.run(accel, work, slot.arg, w);
+    }
+
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (t < best) { best = t; }
+  }
+
+  return best;
+}
+
+
+/* An implementation has to be bit-exact to the scalar code for all block sizes
+   of the slot. Its score is the sum of the times per sample over these sizes, such
+   that each block size has the same weight. (The AVX-512 MC kernels, for example,
+   only differ from the AVX2 kernels for blocks of 32 samples width or more.) */
+static bool score_slot(const autotune_slot& slot, const acceleration_functions levels[], int l,
+                       autotune_data* ref, autotune_data* work, const autotune_data* pristine,
+                       double* score)
+{
+  const int nSizes = slot.all_block_sizes ? nBlockSizes : 1;
+
+  *score = 0;
+
+  for (int i=0;i<nSizes;i++) {
+    int w = slot.all_block_sizes ? block_sizes[i] : 0;
+
+    memcpy(ref, pristine, sizeof(autotune_data));
+    slot.run(&levels[0], ref, slot.arg, w);
+
+    memcpy(work, pristine, sizeof(autotune_data));
+    slot.run(&levels[l], work, slot.arg, w);
+
+    if (memcmp(work, ref, compared_size) != 0) {
+      loginfo(LogHighlevel, "autotune: %s (%s) is not bit-exact for size %d, skipped\n",
+              slot.name, autotune_levels[l].name, w);
+      return false;
+    }
+
+    double t = time_slot(slot, &levels[l], w, work, pristine);
+    *score += (w ? t/(w*w) : t);
+  }
+
+  return true;
+}
+
+
+/* Selects the implementation for each slot and returns the level it was taken from.
+   The highest level is the default, a lower level has to be faster by some margin
+   to be chosen, so that measurement noise does not decide. */
+static void run_benchmarks(const acceleration_functions levels[], int selected[])
+{
+  autotune_data* pristine = new autotune_data;
+  autotune_data* ref  = new autotune_data;
+  autotune_data* work = new autotune_data;
+
+  fill_synthetic_data(pristine);
+
+  for (int s=0;s<nSlots;s++) {
+    const autotune_slot& slot = autotune_slots[s];
+
+    int    best = 0;
+    double bestTime = 1e30;
+
+    for (int l=nLevels-1; l>=0; l--) {
+      generic_func f = get_slot(&levels[l], slot);
+
+      // only test each implementation once, at the lowest level that has it
+
+      if (l>0 && get_slot(&levels[l-1], slot) == f) {
+        continue;
+      }
+
+      double t;
+      if (!score_slot(slot, levels, l, ref, work, pristine, &t)) {
+        continue;
+      }
+
+      if (t < bestTime*0.95) {
+        best = l;
+        bestTime = t;
+      }
+    }
+
+    selected[s] = best;
+
+    loginfo(LogHighlevel, "autotune: %s -> %s\n", slot.name, autotune_levels[best].name);
+  }
+
+  delete pristine;
+  delete ref;
+  delete work;
+}
+
+
+// --- cache file ---
+
+static std::string get_cpu_name()
+{
+#ifdef HAVE_SSE4_1
+  char brand[49];
+  get_cpu_brand_string(brand);
+
+  const char* p = brand;
+  while (*p==' ') p++;
+  return p;
+#else
+  return "unknown";
+#endif
+}
+
+
+static bool read_cache(const char* filename, int selected[])
+{
+  FILE* fh = fopen(filename, "r");
+  if (fh==NULL) {
+    return false;
+  }
+
+  const std::string expected_version = std::string("version ") + LIBDE265_VERSION + "\n";
+  const std::string expected_cpu     = "cpu " + get_cpu_name() + "\n";
+
+  char line[256];
+  bool ok = (fgets(line, sizeof(line), fh) && expected_version == line &&
+             fgets(line, sizeof(line), fh) && expected_cpu == line);
+
+  for (int s=0;s<nSlots;s++) {
+    selected[s] = -1;
+  }
+
+  while (ok && fgets(line, sizeof(line), fh)) {
+    char name[100], level[20];
+    if (sscanf(line, "%99s %19s", name, level) != 2) {
+      ok = false;
+      break;
+    }
+
+    int s, l;
+    for (s=0; s<nSlots && strcmp(autotune_slots[s].name, name)!=0; s++) { }
+    for (l=0; l<nLevels && strcmp(autotune_levels[l].name, level)!=0; l++) { }
+
+    if (s==nSlots || l==nLevels) {
+      ok = false;
+    }
+    else {
+      selected[s] = l;
+    }
+  }
+
+  fclose(fh);
+
+  // the file has to be complete, otherwise we benchmark again
+
+  for (int s=0; ok && s<nSlots; s++) {
+    if (selected[s]<0) {
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+
+static void write_cache(const char* filename, const int selected[])
+{
+  FILE* fh = fopen(filename, "w");
+  if (fh==NULL) {
+    loginfo(LogHighlevel, "autotune: cannot write cache file %s\n", filename);
+    return;
+  }
+
+  fprintf(fh, "version %s\n", LIBDE265_VERSION);
+  fprintf(fh, "cpu %s\n", get_cpu_name().c_str());
+
+  for (int s=0;s<nSlots;s++) {
+    fprintf(fh, "%s %s\n", autotune_slots[s].name, autotune_levels[selected[s]].name);
+  }
+
+  fclose(fh);
+}
+
+
+// --- process wide selection ---
+
+static std::mutex   autotune_mutex;
+static std::string  autotune_cache_file;
+static bool         autotune_done = false;
+static acceleration_functions autotune_result;
+
+
+void autotune_set_cache_file(const char* filename)
+{
+  std::lock_guard<std::mutex> lock(autotune_mutex);
+
+  autotune_cache_file = (filename ? filename : "");
+}
+
+
+void autotune_acceleration_functions(struct acceleration_functions* accel)
+{
+  std::lock_guard<std::mutex> lock(autotune_mutex);
+
+  if (!autotune_done) {
+    acceleration_functions levels[nLevels];
+    for (int l=0;l<nLevels;l++) {
+      init_acceleration_functions(&levels[l], autotune_levels[l].level);
+    }
+
+    int selected[nSlots];
+
+    const char* cache = autotune_cache_file.empty() ? NULL : autotune_cache_file.c_str();
+
+    if (cache==NULL || !read_cache(cache, selected)) {
+      run_benchmarks(levels, selected);
+
+      if (cache) {
+        write_cache(cache, selected);
+      }
+    }
+
+    // functions without a benchmark (unused or deprecated) are taken from the highest level
+
+    autotune_result = levels[nLevels-1];
+
+    for (int s=0;s<nSlots;s++) {
+      copy_slot(&autotune_result, &levels[selected[s]], autotune_slots[s]);
+    }
+
+    autotune_done = true;
+  }
+
+  *accel = autotune_result;
+}
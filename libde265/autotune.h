@@ -0,0 +1,37 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DE265_AUTOTUNE_H
+#define DE265_AUTOTUNE_H
+
+#include "acceleration.h"
+
+
+/* Fills 'accel' with the fastest implementation of each function, selected by running
+   all implementations supported by the CPU on synthetic data. Only implementations
+   that give the same result as the fallback are considered.
+   The benchmark runs once per process. If a cache file is set, the selection is
+   read from there, or written to it after benchmarking. */
+void autotune_acceleration_functions(struct acceleration_functions* accel);
+
+void autotune_set_cache_file(const char* filename);
+
+#endif
@@ -35,11 +35,67 @@ void bitreader_init(bitreader* br, unsigned char* buffer, int len)
   br->nextbits=0;
   br->nextbits_cnt=0;
 
+  br->emulation_prevention = 0;
+  br->zero_run = 0;
+  br->epb_mask = 0;
+
+  bitreader_refill(br);
+}
+
+void bitreader_init_escaped(bitreader* br, unsigned char* buffer, int len)
+{
+  bitreader_init(br, NULL, 0);
+
+  br->data = buffer;
+  br->bytes_remaining = len;
+  br->emulation_prevention = 1;
+
   bitreader_refill(br);
 }
 
+static void bitreader_refill_escaped(bitreader* br)
+{
+  int shift = 64-br->nextbits_cnt;
+
+  while (shift >= 8 && br->bytes_remaining) {
+    int epb = 0;
+
+    if (br->zero_run==2 && *br->data==3) {
+      if (br->bytes_remaining==1) {
+        // trailing emulation prevention byte (cabac_zero_word), leave 'data' in front of it
+        br->bytes_remaining = 0;
+        break;
+      }
+
+      br->data++;
+      br->bytes_remaining--;
+      br->zero_run = 0;
+      epb = 1;
+    }
+
+    uint64_t newval = *br->data++;
+    br->bytes_remaining--;
+
+    if (newval==0) { if (br->zero_run<2) br->zero_run++; }
+    else           { br->zero_run=0; }
+
+    br->epb_mask = (br->epb_mask<<1) | epb;
+
+    shift -= 8;
+    newval <<= shift;
+    br->nextbits |= newval;
+  }
+
+  br->nextbits_cnt = 64-shift;
+}
+
 void bitreader_refill(bitreader* br)
 {
+  if (br->emulation_prevention) {
+    bitreader_refill_escaped(br);
+    return;
+  }
+
   int shift = 64-br->nextbits_cnt;
 
   while (shift >= 8 && br->bytes_remaining) {
@@ -123,8 +179,30 @@ void prepare_for_CABAC(bitreader* br)
   skip_to_byte_boundary(br);
 
   int rewind = br->nextbits_cnt/8;
-  br->data -= rewind;
-  br->bytes_remaining += rewind;
+
+  if (br->emulation_prevention) {
+    // also step back over the emulation prevention bytes in front of the unread bytes
+
+    for (int i=0;i<rewind;i++) {
+      int n = 1 + ((br->epb_mask>>i) & 1);
+      br->data -= n;
+      br->bytes_remaining += n;
+    }
+
+    // At least the NAL header has been read, hence the two previous bytes are valid.
+
+    br->zero_run = 0;
+    if (br->data[-1]==0) {
+      br->zero_run = (br->data[-2]==0 ? 2 : 1);
+    }
+
+    br->epb_mask = 0;
+  }
+  else {
+    br->data -= rewind;
+    br->bytes_remaining += rewind;
+  }
+
   br->nextbits = 0;
   br->nextbits_cnt = 0;
 }
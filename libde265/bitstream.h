@@ -39,9 +39,16 @@ typedef struct {
 
   uint64_t nextbits; // left-aligned bits
   int nextbits_cnt;
+
+  // When reading NAL data that still contains the emulation prevention bytes (0x000003),
+  // they are skipped while refilling.
+  int emulation_prevention;
+  int zero_run;        // number of zero bytes directly before 'data' (0-2)
+  uint32_t epb_mask;   // bit i: an emulation prevention byte preceded the i-th last byte in 'nextbits'
 } bitreader;
 
 void bitreader_init(bitreader*, unsigned char* buffer, int len);
+void bitreader_init_escaped(bitreader*, unsigned char* buffer, int len); // with emulation prevention bytes
 void bitreader_refill(bitreader*); // refill to at least 56+1 bits
 int  next_bit(bitreader*);
 int  next_bit_norefill(bitreader*);
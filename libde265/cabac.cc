@@ -133,13 +133,51 @@ static const uint8_t next_state_LPS[64] =
 int logcnt=1;
 #endif
 
-void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length)
+// Returns the next input byte, or 0 when reading past the end of the bitstream.
+static inline uint32_t read_CABAC_byte(CABAC_decoder* decoder)
+{
+  if (unlikely(decoder->emulation_prevention)) {
+    if (decoder->zero_run==2 &&
+        decoder->bitstream_curr < decoder->bitstream_end &&
+        *decoder->bitstream_curr==3) {
+      decoder->bitstream_curr++;
+      decoder->zero_run = 0;
+    }
+
+    if (decoder->bitstream_curr >= decoder->bitstream_end) {
+      return 0;
+    }
+
+    uint32_t byte = *decoder->bitstream_curr++;
+    if (byte==0) { if (decoder->zero_run<2) decoder->zero_run++; }
+    else         { decoder->zero_run=0; }
+
+    return byte;
+  }
+
+  if (decoder->bitstream_curr >= decoder->bitstream_end) {
+    return 0;
+  }
+
+  return *decoder->bitstream_curr++;
+}
+
+
+void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length,
+                        bool emulation_prevention)
 {
   assert(length >= 0);
 
   decoder->bitstream_start = bitstream;
   decoder->bitstream_curr  = bitstream;
   decoder->bitstream_end   = bitstream+length;
+
+  decoder->emulation_prevention = emulation_prevention;
+  decoder->zero_run = 0;
+
+  if (emulation_prevention && bitstream[-1]==0) {
+    decoder->zero_run = (bitstream[-2]==0 ? 2 : 1);
+  }
 }
 
 void init_CABAC_decoder_2(CABAC_decoder* decoder)
@@ -151,8 +189,8 @@ void init_CABAC_decoder_2(CABAC_decoder* decoder)
 
   decoder->value = 0;
 
-  if (length>0) { decoder->value  = (*decoder->bitstream_curr++) << 8;  decoder->bits_needed-=8; }
-  if (length>1) { decoder->value |= (*decoder->bitstream_curr++);       decoder->bits_needed-=8; }
+  if (length>0) { decoder->value  = read_CABAC_byte(decoder) << 8;  decoder->bits_needed-=8; }
+  if (length>1) { decoder->value |= read_CABAC_byte(decoder);       decoder->bits_needed-=8; }
 
   logtrace(LogCABAC,"[%3d] init_CABAC_decode_2 r:%x v:%x\n", logcnt, decoder->range, decoder->value);
 }
@@ -190,8 +228,7 @@ int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model)
           if (decoder->bits_needed == 0)
             {
               decoder->bits_needed = -8;
-              if (decoder->bitstream_curr < decoder->bitstream_end)
-                { decoder->value |= *decoder->bitstream_curr++; }
+              decoder->value |= read_CABAC_byte(decoder);
             }
         }
     }
@@ -223,8 +260,7 @@ int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model)
       if (decoder->bits_needed >= 0)
         {
           logtrace(LogCABAC,"bits_needed: %d\n", decoder->bits_needed);
-          if (decoder->bitstream_curr < decoder->bitstream_end)
-            { decoder->value |= (*decoder->bitstream_curr++) << decoder->bits_needed; }
+          decoder->value |= read_CABAC_byte(decoder) << decoder->bits_needed;
 
           decoder->bits_needed -= 8;
         }
@@ -262,10 +298,7 @@ int  decode_CABAC_term_bit(CABAC_decoder* decoder)
           if (decoder->bits_needed==0)
             {
               decoder->bits_needed = -8;
-
-              if (decoder->bitstream_curr < decoder->bitstream_end) {
-                decoder->value += (*decoder->bitstream_curr++);
-              }
+              decoder->value += read_CABAC_byte(decoder);
             }
         }
 
@@ -285,14 +318,9 @@ int  decode_CABAC_bypass(CABAC_decoder* decoder)
 
   if (decoder->bits_needed >= 0)
     {
-      if (decoder->bitstream_end > decoder->bitstream_curr) {
-        decoder->bits_needed = -8;
-        decoder->value |= *decoder->bitstream_curr++;
-      }
-      else {
-        // we read past the end of the bitstream, fill with 0
-        decoder->bits_needed = -8;
-      }
+      // when we read past the end of the bitstream, this fills with 0
+      decoder->bits_needed = -8;
+      decoder->value |= read_CABAC_byte(decoder);
     }
 
   int bit;
@@ -352,7 +380,7 @@ int  decode_CABAC_FL_bypass_parallel(CABAC_decoder* decoder, int nBits)
   if (decoder->bits_needed >= 0)
     {
       if (decoder->bitstream_end > decoder->bitstream_curr) {
-        int input = *decoder->bitstream_curr++;
+        int input = read_CABAC_byte(decoder);
         input <<= decoder->bits_needed;
 
         decoder->bits_needed -= 8;
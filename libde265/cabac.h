@@ -33,10 +33,17 @@ typedef struct {
   uint32_t range;
   uint32_t value;
   int16_t  bits_needed;
+
+  // the bitstream still contains emulation prevention bytes, which are skipped while reading
+  int16_t  emulation_prevention;
+  int16_t  zero_run;  // number of zero bytes directly before bitstream_curr (0-2)
 } CABAC_decoder;
 
 
-void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length);
+/* With 'emulation_prevention', the two bytes before 'bitstream' have to be readable
+   (they are part of the same NAL unit). */
+void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length,
+                        bool emulation_prevention=false);
 void init_CABAC_decoder_2(CABAC_decoder* decoder);
 int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model);
 int  decode_CABAC_TU(CABAC_decoder* decoder, int cMax, context_model* model);
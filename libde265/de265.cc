@@ -27,6 +27,7 @@
 #include "scan.h"
 #include "image.h"
 #include "sei.h"
+#include "autotune.h"
 
 #include <assert.h>
 #include <string.h>
@@ -107,6 +108,10 @@ LIBDE265_API const char* de265_get_error_text(de265_error err)
     return "premature end of slice data";
   case DE265_ERROR_UNSPECIFIED_DECODING_ERROR:
     return "unspecified decoding error";
+  case DE265_ERROR_CANNOT_SET_CPU_AFFINITY:
+    return "cannot set CPU affinity of decoding threads";
+  case DE265_ERROR_THREAD_POOL_STOPPED:
+    return "thread pool has already been stopped";
 
   case DE265_WARNING_NO_WPP_CANNOT_USE_MULTITHREADING:
     return "Cannot run decoder multi-threaded because stream does not support WPP";
@@ -273,10 +278,6 @@ LIBDE265_API de265_error de265_start_worker_threads(de265_decoder_context* de265
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
 
-  if (number_of_threads > MAX_THREADS) {
-    number_of_threads = MAX_THREADS;
-  }
-
   if (number_of_threads>0) {
     de265_error err = ctx->start_thread_pool(number_of_threads);
     if (de265_isOK(err)) {
@@ -290,6 +291,62 @@ LIBDE265_API de265_error de265_start_worker_threads(de265_decoder_context* de265
 }
 
 
+LIBDE265_API de265_error de265_set_worker_cpu_affinity(de265_decoder_context* de265ctx,
+                                                       const int* cpus, int num_cpus)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  return ctx->set_cpu_affinity(std::vector<int>(cpus, cpus+num_cpus));
+}
+
+
+LIBDE265_API de265_thread_pool* de265_new_thread_pool(int number_of_threads)
+{
+  if (number_of_threads <= 0) {
+    return NULL;
+  }
+
+  thread_pool* pool = new thread_pool;
+
+  de265_error err = start_thread_pool(pool, number_of_threads);
+  if (!de265_isOK(err)) {
+    stop_thread_pool(pool);
+    delete pool;
+    return NULL;
+  }
+
+  return (de265_thread_pool*)pool;
+}
+
+
+LIBDE265_API void de265_free_thread_pool(de265_thread_pool* de265pool)
+{
+  thread_pool* pool = (thread_pool*)de265pool;
+
+  stop_thread_pool(pool);
+
+  delete pool;
+}
+
+
+LIBDE265_API de265_error de265_set_thread_pool_cpu_affinity(de265_thread_pool* de265pool,
+                                                            const int* cpus, int num_cpus)
+{
+  thread_pool* pool = (thread_pool*)de265pool;
+
+  return set_thread_pool_cpu_affinity(pool, std::vector<int>(cpus, cpus+num_cpus));
+}
+
+
+LIBDE265_API de265_error de265_attach_thread_pool(de265_decoder_context* de265ctx,
+                                                  de265_thread_pool* de265pool)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  return ctx->attach_thread_pool((thread_pool*)de265pool);
+}
+
+
 #ifndef LIBDE265_DISABLE_DEPRECATED
 LIBDE265_API de265_error de265_decode_data(de265_decoder_context* de265ctx,
                                            const void* data8, int len)
@@ -362,6 +419,19 @@ LIBDE265_API de265_error de265_push_NAL(de265_decoder_context* de265ctx,
 }
 
 
+LIBDE265_API de265_error de265_push_NAL_zero_copy(de265_decoder_context* de265ctx,
+                                                  const void* data, int len,
+                                                  de265_PTS pts, void* user_data,
+                                                  de265_release_NAL_func release_func,
+                                                  void* release_userdata)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  return ctx->nal_parser.push_NAL_zero_copy((const unsigned char*)data,len,pts,user_data,
+                                            release_func, release_userdata);
+}
+
+
 LIBDE265_API de265_error de265_decode(de265_decoder_context* de265ctx, int* more)
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
@@ -533,6 +603,10 @@ LIBDE265_API void de265_set_parameter_bool(de265_decoder_context* de265ctx, enum
       ctx->param_disable_sao = !!value;
       break;
 
+    case DE265_DECODER_PARAM_PIPELINED_RECONSTRUCTION:
+      ctx->param_pipelined_reconstruction = !!value;
+      break;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       ctx->param_disable_mc_residual_idct = !!value;
@@ -550,6 +624,12 @@ LIBDE265_API void de265_set_parameter_bool(de265_decoder_context* de265ctx, enum
 }
 
 
+LIBDE265_API void de265_set_acceleration_autotune_cache(const char* filename)
+{
+  autotune_set_cache_file(filename);
+}
+
+
 LIBDE265_API void de265_set_parameter_int(de265_decoder_context* de265ctx, enum de265_param param, int value)
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
@@ -603,6 +683,9 @@ LIBDE265_API int de265_get_parameter_bool(de265_decoder_context* de265ctx, enum
     case DE265_DECODER_PARAM_DISABLE_SAO:
       return ctx->param_disable_sao;
 
+    case DE265_DECODER_PARAM_PIPELINED_RECONSTRUCTION:
+      return ctx->param_pipelined_reconstruction;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       return ctx->param_disable_mc_residual_idct;
@@ -108,6 +108,8 @@ typedef enum {
   DE265_ERROR_NO_INITIAL_SLICE_HEADER=16,
   DE265_ERROR_PREMATURE_END_OF_SLICE=17,
   DE265_ERROR_UNSPECIFIED_DECODING_ERROR=18,
+  DE265_ERROR_CANNOT_SET_CPU_AFFINITY=19,
+  DE265_ERROR_THREAD_POOL_STOPPED=20,
 
   // --- errors that should become obsolete in later libde265 versions ---
 
@@ -221,9 +223,41 @@ LIBDE265_API de265_decoder_context* de265_new_decoder(void);
    all decoding is done in the main thread (no multi-threading). */
 LIBDE265_API de265_error de265_start_worker_threads(de265_decoder_context*, int number_of_threads);
 
+/* Restrict the decoder's own worker threads to the given CPUs (num_cpus=0: no restriction).
+   May be called before or after de265_start_worker_threads(). If all CPUs belong to the
+   same NUMA node, the decoded pictures are allocated on that node. */
+LIBDE265_API de265_error de265_set_worker_cpu_affinity(de265_decoder_context*,
+                                                       const int* cpus, int num_cpus);
+
 /* Free decoder context. May only be called once on a context. */
 LIBDE265_API de265_error de265_free_decoder(de265_decoder_context*);
 
+
+/* === shared thread pool === */
+
+typedef void de265_thread_pool; // private structure
+
+/* Create a pool of worker threads that can be shared by several decoders.
+   The number of threads is limited to 256.
+   Returns NULL if number_of_threads is not positive or if the threads cannot be started. */
+LIBDE265_API de265_thread_pool* de265_new_thread_pool(int number_of_threads);
+
+/* Restrict the threads of a shared pool to the given CPUs (num_cpus=0: no restriction).
+   Pictures of the attached decoders are allocated on the NUMA node of these CPUs. */
+LIBDE265_API de265_error de265_set_thread_pool_cpu_affinity(de265_thread_pool*,
+                                                            const int* cpus, int num_cpus);
+
+/* Free the thread pool. All decoders using it must have been detached or freed before. */
+LIBDE265_API void de265_free_thread_pool(de265_thread_pool*);
+
+/* Let the decoder use the threads of a shared pool instead of its own worker threads
+   (which are stopped). The decoder can join or leave (pool=NULL) a pool at any time
+   between calls to de265_decode(). Tasks are scheduled fairly across all decoders
+   of the pool, pictures that started decoding earlier are preferred.
+   Returns DE265_ERROR_THREAD_POOL_STOPPED if the pool is being freed, the decoder
+   keeps its current threads in that case. */
+LIBDE265_API de265_error de265_attach_thread_pool(de265_decoder_context*, de265_thread_pool*);
+
 #ifndef LIBDE265_DISABLE_DEPRECATED
 /* Push more data into the decoder, must be raw h265.
    All complete images in the data will be decoded, hence, do not push
@@ -266,6 +300,19 @@ LIBDE265_API void        de265_push_end_of_frame(de265_decoder_context*);
 LIBDE265_API de265_error de265_push_NAL(de265_decoder_context*, const void* data, int length,
                                         de265_PTS pts, void* user_data);
 
+typedef void (*de265_release_NAL_func)(const void* data, void* release_userdata);
+
+/* Like de265_push_NAL, but the NAL data is not copied. The decoder reads it directly
+   from the caller's buffer and skips the stuffing-bytes while decoding.
+   The buffer must stay valid until the decoder calls release_func(data, release_userdata),
+   which happens from within de265_decode, de265_reset or de265_free_decoder after the
+   NAL has been processed. When an error is returned, the buffer is not referenced.
+*/
+LIBDE265_API de265_error de265_push_NAL_zero_copy(de265_decoder_context*, const void* data, int length,
+                                                  de265_PTS pts, void* user_data,
+                                                  de265_release_NAL_func release_func,
+                                                  void* release_userdata);
+
 /* Indicate the end-of-stream. All data pending at the decoder input will be
    pushed into the decoder and the decoded picture queue will be completely emptied.
  */
@@ -403,9 +450,13 @@ enum de265_param {
   DE265_DECODER_PARAM_SUPPRESS_FAULTY_PICTURES=6, // (bool)  do not output frames with decoding errors, default: no (output all images)
 
   DE265_DECODER_PARAM_DISABLE_DEBLOCKING=7,   // (bool)  disable deblocking
-  DE265_DECODER_PARAM_DISABLE_SAO=8           // (bool)  disable SAO filter
+  DE265_DECODER_PARAM_DISABLE_SAO=8,          // (bool)  disable SAO filter
   //DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT=9,     // (bool)  disable decoding of IDCT residuals in MC blocks
   //DE265_DECODER_PARAM_DISABLE_INTRA_RESIDUAL_IDCT=10  // (bool)  disable decoding of IDCT residuals in MC blocks
+
+  DE265_DECODER_PARAM_PIPELINED_RECONSTRUCTION=11 // (bool)  parse the syntax and reconstruct the CTBs in separate
+                                                  //         threads (pictures without WPP and tiles, at least
+                                                  //         two worker threads), default: yes
 };
 
 /* --- callback --- */
@@ -430,12 +481,19 @@ enum de265_acceleration {
   de265_acceleration_SSE2 = 30,
   de265_acceleration_SSE4 = 40,
   de265_acceleration_AVX  = 50,    // not implemented yet
-  de265_acceleration_AVX2 = 60,    // not implemented yet
+  de265_acceleration_AVX2 = 60,
+  de265_acceleration_AVX512 = 65,
   de265_acceleration_ARM  = 70,
   de265_acceleration_NEON = 80,
-  de265_acceleration_AUTO = 10000
+  de265_acceleration_AUTO = 10000,
+  de265_acceleration_AUTOTUNE = 10001 // benchmark all implementations at startup, use the fastest one
 };
 
+/* File in which the de265_acceleration_AUTOTUNE benchmark results are stored. Later
+   processes on the same CPU read the selection from there instead of benchmarking
+   again. Default: no cache file. */
+LIBDE265_API void de265_set_acceleration_autotune_cache(const char* filename);
+
 
 /* Set decoding parameters. */
 LIBDE265_API void de265_set_parameter_bool(de265_decoder_context*, enum de265_param param, int value);
@@ -431,6 +431,8 @@ void edge_filtering_luma_internal(de265_image* img, bool vertical,
 
   int bitDepth_Y = sps.BitDepth_Y;
 
+  const acceleration_functions& accel = img->decctx->acceleration;
+
   xEnd = libde265_min(xEnd,img->get_deblk_width());
   yEnd = libde265_min(yEnd,img->get_deblk_height());
 
@@ -484,39 +486,6 @@ void edge_filtering_luma_internal(de265_image* img, bool vertical,
 
         pixel_t* ptr = img->get_image_plane_at_pos_NEW<pixel_t>(0, xDi,yDi);
 
-        pixel_t q[4][4], p[4][4];
-        for (int k=0;k<4;k++)
-          for (int i=0;i<4;i++)
-            {
-              if (vertical) {
-                q[k][i] = ptr[ i  +k*stride];
-                p[k][i] = ptr[-i-1+k*stride];
-              }
-              else {
-                q[k][i] = ptr[k + i   *stride];
-                p[k][i] = ptr[k -(i+1)*stride];
-              }
-            }
-
-#if 0
-        for (int k=0;k<4;k++)
-          {
-            for (int i=0;i<4;i++)
-              {
-                printf("%02x ", p[k][3-i]);
-              }
-
-            printf("| ");
-
-            for (int i=0;i<4;i++)
-              {
-                printf("%02x ", q[k][i]);
-              }
-            printf("\n");
-          }
-#endif
-
-
         int QP_Q = img->get_QPY(xDi,yDi);
         int QP_P = (vertical ?
                     img->get_QPY(xDi-1,yDi) :
@@ -539,176 +508,31 @@ void edge_filtering_luma_internal(de265_image* img, bool vertical,
 
         logtrace(LogDeblock,"beta: %d (%d)  tc: %d (%d)\n",beta,beta_offset, tc,tc_offset);
 
-        int dE=0, dEp=0, dEq=0;
-
-        if (vertical || !vertical) {
-          int dp0 = abs_value(p[0][2] - 2*p[0][1] + p[0][0]);
-          int dp3 = abs_value(p[3][2] - 2*p[3][1] + p[3][0]);
-          int dq0 = abs_value(q[0][2] - 2*q[0][1] + q[0][0]);
-          int dq3 = abs_value(q[3][2] - 2*q[3][1] + q[3][0]);
+        // with beta==0, the decision d<beta can never be true
 
-          int dpq0 = dp0 + dq0;
-          int dpq3 = dp3 + dq3;
-
-          int dp = dp0 + dp3;
-          int dq = dq0 + dq3;
-          int d  = dpq0+ dpq3;
+        if (beta==0) {
+          continue;
+        }
 
-          if (d<beta) {
-            //int dpq = 2*dpq0;
-            bool dSam0 = (2*dpq0 < (beta>>2) &&
-                          abs_value(p[0][3]-p[0][0])+abs_value(q[0][0]-q[0][3]) < (beta>>3) &&
-                          abs_value(p[0][0]-q[0][0]) < ((5*tc+1)>>1));
+        bool filterP = true;
+        bool filterQ = true;
 
-            bool dSam3 = (2*dpq3 < (beta>>2) &&
-                          abs_value(p[3][3]-p[3][0])+abs_value(q[3][0]-q[3][3]) < (beta>>3) &&
-                          abs_value(p[3][0]-q[3][0]) < ((5*tc+1)>>1));
+        int xP = vertical ? xDi-1 : xDi;
+        int yP = vertical ? yDi   : yDi-1;
 
-            if (dSam0 && dSam3) {
-              dE=2;
-            }
-            else {
-              dE=1;
-            }
+        if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xP,yP)) filterP=false;
+        if (img->get_cu_transquant_bypass(xP,yP)) filterP=false;
 
-            if (dp < ((beta + (beta>>1))>>3)) { dEp=1; }
-            if (dq < ((beta + (beta>>1))>>3)) { dEq=1; }
+        if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) filterQ=false;
+        if (img->get_cu_transquant_bypass(xDi,yDi)) filterQ=false;
 
-            logtrace(LogDeblock,"dE:%d dEp:%d dEq:%d\n",dE,dEp,dEq);
-          }
-        }
-        else {
-          // TODO
-          assert(0);
+        if (!filterP && !filterQ) {
+          continue;
         }
 
-
         // 8.7.2.4.4
 
-        if (dE != 0) {
-          bool filterP = true;
-          bool filterQ = true;
-
-          if (vertical) {
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi-1,yDi)) filterP=false;
-            if (img->get_cu_transquant_bypass(xDi-1,yDi)) filterP=false;
-
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi)) filterQ=false;
-          }
-          else {
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi-1)) filterP=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi-1)) filterP=false;
-
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi)) filterQ=false;
-          }
-
-          for (int k=0;k<4;k++) {
-            //int nDp,nDq;
-
-            logtrace(LogDeblock,"line:%d\n",k);
-
-            const pixel_t p0 = p[k][0];
-            const pixel_t p1 = p[k][1];
-            const pixel_t p2 = p[k][2];
-            const pixel_t p3 = p[k][3];
-            const pixel_t q0 = q[k][0];
-            const pixel_t q1 = q[k][1];
-            const pixel_t q2 = q[k][2];
-            const pixel_t q3 = q[k][3];
-
-            if (dE==2) {
-              // strong filtering
-
-              //nDp=nDq=3;
-
-              pixel_t pnew[3],qnew[3];
-              pnew[0] = Clip3(p0-2*tc,p0+2*tc, (p2 + 2*p1 + 2*p0 + 2*q0 + q1 +4)>>3);
-              pnew[1] = Clip3(p1-2*tc,p1+2*tc, (p2 + p1 + p0 + q0+2)>>2);
-              pnew[2] = Clip3(p2-2*tc,p2+2*tc, (2*p3 + 3*p2 + p1 + p0 + q0 + 4)>>3);
-              qnew[0] = Clip3(q0-2*tc,q0+2*tc, (p1+2*p0+2*q0+2*q1+q2+4)>>3);
-              qnew[1] = Clip3(q1-2*tc,q1+2*tc, (p0+q0+q1+q2+2)>>2);
-              qnew[2] = Clip3(q2-2*tc,q2+2*tc, (p0+q0+q1+3*q2+2*q3+4)>>3);
-
-              logtrace(LogDeblock,"strong filtering\n");
-
-              if (vertical) {
-                for (int i=0;i<3;i++) {
-                  if (filterP) { ptr[-i-1+k*stride] = pnew[i]; }
-                  if (filterQ) { ptr[ i + k*stride] = qnew[i]; }
-                }
-
-                // ptr[-1+k*stride] = ptr[ 0+k*stride] = 200;
-              }
-              else {
-                for (int i=0;i<3;i++) {
-                  if (filterP) { ptr[ k -(i+1)*stride] = pnew[i]; }
-                  if (filterQ) { ptr[ k + i   *stride] = qnew[i]; }
-                }
-              }
-            }
-            else {
-              // weak filtering
-
-              //nDp=nDq=0;
-
-              int delta = (9*(q0-p0) - 3*(q1-p1) + 8)>>4;
-              logtrace(LogDeblock,"delta=%d, tc=%d\n",delta,tc);
-
-              if (abs_value(delta) < tc*10) {
-
-                delta = Clip3(-tc,tc,delta);
-                logtrace(LogDeblock," deblk + %d;%d [%02x->%02x]  - %d;%d [%02x->%02x] delta:%d\n",
-                         vertical ? xDi-1 : xDi+k,
-                         vertical ? yDi+k : yDi-1, p0,Clip_BitDepth(p0+delta, bitDepth_Y),
-                         vertical ? xDi   : xDi+k,
-                         vertical ? yDi+k : yDi,   q0,Clip_BitDepth(q0-delta, bitDepth_Y),
-                         delta);
-
-                if (vertical) {
-                  if (filterP) { ptr[-0-1+k*stride] = Clip_BitDepth(p0+delta, bitDepth_Y); }
-                  if (filterQ) { ptr[ 0  +k*stride] = Clip_BitDepth(q0-delta, bitDepth_Y); }
-                }
-                else {
-                  if (filterP) { ptr[ k -1*stride] = Clip_BitDepth(p0+delta, bitDepth_Y); }
-                  if (filterQ) { ptr[ k +0*stride] = Clip_BitDepth(q0-delta, bitDepth_Y); }
-                }
-
-                //ptr[ 0+k*stride] = 200;
-
-                if (dEp==1 && filterP) {
-                  int delta_p = Clip3(-(tc>>1), tc>>1, (((p2+p0+1)>>1)-p1+delta)>>1);
-
-                  logtrace(LogDeblock," deblk dEp %d;%d delta:%d\n",
-                           vertical ? xDi-2 : xDi+k,
-                           vertical ? yDi+k : yDi-2,
-                           delta_p);
-
-                  if (vertical) { ptr[-1-1+k*stride] = Clip_BitDepth(p1+delta_p, bitDepth_Y); }
-                  else          { ptr[ k  -2*stride] = Clip_BitDepth(p1+delta_p, bitDepth_Y); }
-                }
-
-                if (dEq==1 && filterQ) {
-                  int delta_q = Clip3(-(tc>>1), tc>>1, (((q2+q0+1)>>1)-q1-delta)>>1);
-
-                  logtrace(LogDeblock," delkb dEq %d;%d delta:%d\n",
-                           vertical ? xDi+1 : xDi+k,
-                           vertical ? yDi+k : yDi+1,
-                           delta_q);
-
-                  if (vertical) { ptr[ 1  +k*stride] = Clip_BitDepth(q1+delta_q, bitDepth_Y); }
-                  else          { ptr[ k  +1*stride] = Clip_BitDepth(q1+delta_q, bitDepth_Y); }
-                }
-
-                //nDp = dEp+1;
-                //nDq = dEq+1;
-
-                //logtrace(LogDeblock,"weak filtering (%d:%d)\n",nDp,nDq);
-              }
-            }
-          }
-        }
+        accel.deblock_luma(vertical, ptr, stride, beta, tc, filterP, filterQ, bitDepth_Y);
       }
     }
 }
@@ -766,6 +590,8 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
 
   int bitDepth_C = sps.BitDepth_C;
 
+  const acceleration_functions& accel = img->decctx->acceleration;
+
   for (int y=yStart;y<yEnd;y+=yIncr)
     for (int x=xStart;x<xEnd;x+=xIncr) {
       int xDi = x << (3-SubWidthC);
@@ -785,42 +611,8 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
 
           pixel_t* ptr = img->get_image_plane_at_pos_NEW<pixel_t>(cplane+1, xDi,yDi);
 
-          pixel_t p[2][4];
-          pixel_t q[2][4];
-
           logtrace(LogDeblock,"-%s- %d %d\n",cplane==0 ? "Cb" : "Cr",xDi,yDi);
 
-          for (int i=0;i<2;i++)
-            for (int k=0;k<4;k++)
-              {
-                if (vertical) {
-                  q[i][k] = ptr[ i  +k*stride];
-                  p[i][k] = ptr[-i-1+k*stride];
-                }
-                else {
-                  q[i][k] = ptr[k + i   *stride];
-                  p[i][k] = ptr[k -(i+1)*stride];
-                }
-              }
-
-#if 0
-          for (int k=0;k<4;k++)
-            {
-              for (int i=0;i<2;i++)
-                {
-                  printf("%02x ", p[1-i][k]);
-                }
-
-              printf("| ");
-
-              for (int i=0;i<2;i++)
-                {
-                  printf("%02x ", q[i][k]);
-                }
-              printf("\n");
-            }
-#endif
-
           int QP_Q = img->get_QPY(SubWidthC*xDi,SubHeightC*yDi);
           int QP_P = (vertical ?
                       img->get_QPY(SubWidthC*xDi-1,SubHeightC*yDi) :
@@ -848,38 +640,22 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
 
           logtrace(LogDeblock,"tc_offset=%d Q=%d tc'=%d tc=%d\n",tc_offset,Q,tcPrime,tc);
 
-          if (vertical) {
-            bool filterP = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi-1,SubHeightC*yDi)) filterP=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi-1,SubHeightC*yDi)) filterP=false;
+          if (tc==0) {
+            continue;
+          }
+
+          int xP = SubWidthC*xDi  - (vertical ? 1 : 0);
+          int yP = SubHeightC*yDi - (vertical ? 0 : 1);
 
-            bool filterQ = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
+          bool filterP = true;
+          if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xP,yP)) filterP=false;
+          if (img->get_cu_transquant_bypass(xP,yP)) filterP=false;
 
+          bool filterQ = true;
+          if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
+          if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
 
-            for (int k=0;k<4;k++) {
-              int delta = Clip3(-tc,tc, ((((q[0][k]-p[0][k])*4)+p[1][k]-q[1][k]+4)>>3)); // standard says <<2 in eq. (8-356), but the value can also be negative
-              logtrace(LogDeblock,"delta=%d\n",delta);
-              if (filterP) { ptr[-1+k*stride] = Clip_BitDepth(p[0][k]+delta, bitDepth_C); }
-              if (filterQ) { ptr[ 0+k*stride] = Clip_BitDepth(q[0][k]-delta, bitDepth_C); }
-            }
-          }
-          else {
-            bool filterP = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi-1)) filterP=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi-1)) filterP=false;
-
-            bool filterQ = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-
-            for (int k=0;k<4;k++) {
-              int delta = Clip3(-tc,tc, ((((q[0][k]-p[0][k])*4)+p[1][k]-q[1][k]+4)>>3)); // standard says <<2, but the value can also be negative
-              if (filterP) { ptr[ k-1*stride] = Clip_BitDepth(p[0][k]+delta, bitDepth_C); }
-              if (filterQ) { ptr[ k+0*stride] = Clip_BitDepth(q[0][k]-delta, bitDepth_C); }
-            }
-          }
+          accel.deblock_chroma(vertical, ptr, stride, tc, filterP, filterQ, bitDepth_C);
         }
       }
     }
@@ -926,11 +702,8 @@ public:
 };
 
 
-void thread_task_deblock_CTBRow::work()
+void apply_deblocking_filter_CTBRow(de265_image* img, int ctb_y, bool vertical)
 {
-  state = Running;
-  img->thread_run(this);
-
   int xStart=0;
   int xEnd = img->get_deblk_width();
 
@@ -943,31 +716,6 @@ void thread_task_deblock_CTBRow::work()
     last = img->get_deblk_height();
   }
 
-  int finalProgress = CTB_PROGRESS_DEBLK_V;
-  if (!vertical) finalProgress = CTB_PROGRESS_DEBLK_H;
-
-  int rightCtb = img->get_sps().PicWidthInCtbsY-1;
-
-  if (vertical) {
-    // pass 1: vertical
-
-    int CtbRow = std::min(ctb_y+1 , img->get_sps().PicHeightInCtbsY-1);
-    img->wait_for_progress(this, rightCtb,CtbRow, CTB_PROGRESS_PREFILTER);
-  }
-  else {
-    // pass 2: horizontal
-
-    if (ctb_y>0) {
-      img->wait_for_progress(this, rightCtb,ctb_y-1, CTB_PROGRESS_DEBLK_V);
-    }
-
-    img->wait_for_progress(this, rightCtb,ctb_y,  CTB_PROGRESS_DEBLK_V);
-
-    if (ctb_y+1<img->get_sps().PicHeightInCtbsY) {
-      img->wait_for_progress(this, rightCtb,ctb_y+1, CTB_PROGRESS_DEBLK_V);
-    }
-  }
-
   //printf("deblock %d to %d orientation: %d\n",first,last,vertical);
 
   bool deblocking_enabled;
@@ -993,6 +741,40 @@ void thread_task_deblock_CTBRow::work()
       edge_filtering_chroma(img, vertical, first,last, xStart,xEnd);
     }
   }
+}
+
+
+void thread_task_deblock_CTBRow::work()
+{
+  state = Running;
+  img->thread_run(this);
+
+  int finalProgress = CTB_PROGRESS_DEBLK_V;
+  if (!vertical) finalProgress = CTB_PROGRESS_DEBLK_H;
+
+  int rightCtb = img->get_sps().PicWidthInCtbsY-1;
+
+  if (vertical) {
+    // pass 1: vertical
+
+    int CtbRow = std::min(ctb_y+1 , img->get_sps().PicHeightInCtbsY-1);
+    img->wait_for_progress(this, rightCtb,CtbRow, CTB_PROGRESS_PREFILTER);
+  }
+  else {
+    // pass 2: horizontal
+
+    if (ctb_y>0) {
+      img->wait_for_progress(this, rightCtb,ctb_y-1, CTB_PROGRESS_DEBLK_V);
+    }
+
+    img->wait_for_progress(this, rightCtb,ctb_y,  CTB_PROGRESS_DEBLK_V);
+
+    if (ctb_y+1<img->get_sps().PicHeightInCtbsY) {
+      img->wait_for_progress(this, rightCtb,ctb_y+1, CTB_PROGRESS_DEBLK_V);
+    }
+  }
+
+  apply_deblocking_filter_CTBRow(img, ctb_y, vertical);
 
   for (int x=0;x<=rightCtb;x++) {
     const int CtbWidth = img->get_sps().PicWidthInCtbsY;
@@ -1004,30 +786,30 @@ void thread_task_deblock_CTBRow::work()
 }
 
 
-void add_deblocking_tasks(image_unit* imgunit)
+void add_deblocking_tasks(image_unit* imgunit, bool vertical, int firstCtbRow, int endCtbRow)
 {
   de265_image* img = imgunit->img;
   decoder_context* ctx = img->decctx;
 
-  int nRows = img->get_sps().PicHeightInCtbsY;
+  if (endCtbRow <= firstCtbRow) {
+    return;
+  }
 
-  int n=0;
-  img->thread_start(nRows*2);
+  img->thread_start(endCtbRow-firstCtbRow);
 
-  for (int pass=0;pass<2;pass++)
+  for (int y=firstCtbRow;y<endCtbRow;y++)
     {
-      for (int y=0;y<img->get_sps().PicHeightInCtbsY;y++)
-        {
-          thread_task_deblock_CTBRow* task = new thread_task_deblock_CTBRow;
+      thread_task_deblock_CTBRow* task = new thread_task_deblock_CTBRow;
 
-          task->img   = img;
-          task->ctb_y = y;
-          task->vertical = (pass==0);
+      task->img   = img;
+      task->ctb_y = y;
+      task->vertical = vertical;
+      task->set_priority(img->get_ID(),
+                         vertical ? thread_task::StageDeblockVertical :
+                                    thread_task::StageDeblockHorizontal, y);
 
-          imgunit->tasks.push_back(task);
-          add_task(&ctx->thread_pool_, task);
-          n++;
-        }
+      imgunit->tasks.push_back(task);
+      ctx->add_task_to_thread_pool(task);
     }
 }
 
@@ -23,7 +23,12 @@
 
 #include "libde265/decctx.h"
 
-void add_deblocking_tasks(image_unit* imgunit);
+/* Add the tasks for one deblocking pass over the CTB rows [firstCtbRow;endCtbRow). */
+void add_deblocking_tasks(image_unit* imgunit, bool vertical, int firstCtbRow, int endCtbRow);
 void apply_deblocking_filter(de265_image* img); //decoder_context* ctx);
 
+/* Filter the vertical or the horizontal edges of a single CTB row.
+   The vertical pass has to be run before the horizontal pass. */
+void apply_deblocking_filter_CTBRow(de265_image* img, int ctb_y, bool vertical);
+
 #endif
@@ -31,6 +31,7 @@
 #include <math.h>
 
 #include "fallback.h"
+#include "autotune.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -54,6 +55,68 @@ extern void thread_decode_CTB_row(void* d);
 extern void thread_decode_slice_segment(void* d);
 
 
+void ctb_reconstruction_data::add_prediction_unit(int xC,int yC, int xB,int yB,
+                                                  int nCS, int nPbW,int nPbH,
+                                                  const PBMotion& motion)
+{
+  prediction_unit pu;
+  pu.xC = xC;  pu.yC = yC;
+  pu.xB = xB;  pu.yB = yB;
+  pu.nCS = nCS;
+  pu.nPbW = nPbW;
+  pu.nPbH = nPbH;
+  pu.motion = motion;
+
+  prediction_units.push_back(pu);
+}
+
+
+void ctb_reconstruction_data::add_transform_unit(const thread_context* tctx,
+                                                 int x0,int y0, int xCUBase,int yCUBase,
+                                                 int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
+{
+  transform_unit tu;
+  tu.x0 = x0;  tu.y0 = y0;
+  tu.xCUBase = xCUBase;
+  tu.yCUBase = yCUBase;
+  tu.nT = nT;
+  tu.cIdx = cIdx;
+  tu.cuPredMode = cuPredMode;
+  tu.cbf = cbf;
+
+  switch (cIdx) {
+  case 0:  tu.qP = tctx->qPYPrime;  break;
+  case 1:  tu.qP = tctx->qPCbPrime; break;
+  default: tu.qP = tctx->qPCrPrime; break;
+  }
+
+  tu.cu_transquant_bypass_flag = tctx->cu_transquant_bypass_flag;
+  tu.transform_skip_flag = tctx->transform_skip_flag[cIdx];
+  tu.explicit_rdpcm_flag = tctx->explicit_rdpcm_flag;
+  tu.explicit_rdpcm_dir  = tctx->explicit_rdpcm_dir;
+  tu.ResScaleVal = tctx->ResScaleVal;
+
+  // coefficients are only used when the CBF is set
+
+  tu.nCoeff = (cbf ? tctx->nCoeff[cIdx] : 0);
+  tu.firstCoeff = coeffValue.size();
+
+  coeffValue.insert(coeffValue.end(), tctx->coeffList[cIdx], tctx->coeffList[cIdx] + tu.nCoeff);
+  coeffPos  .insert(coeffPos.end(),   tctx->coeffPos[cIdx],  tctx->coeffPos[cIdx]  + tu.nCoeff);
+
+  transform_units.push_back(tu);
+}
+
+
+void ctb_reconstruction_data::release()
+{
+  std::vector<prediction_unit>().swap(prediction_units);
+  std::vector<transform_unit>().swap(transform_units);
+  std::vector<int16_t>().swap(coeffValue);
+  std::vector<int16_t>().swap(coeffPos);
+}
+
+
 thread_context::thread_context()
 {
   /*
@@ -120,6 +183,8 @@ thread_context::thread_context()
 
   imgunit = NULL;
   sliceunit = NULL;
+  task = NULL;
+  recon = NULL;
 
 
   //memset(this,0,sizeof(thread_context));
@@ -146,6 +211,7 @@ slice_unit::slice_unit(decoder_context* decctx)
   : nal(NULL),
     shdr(NULL),
     imgunit(NULL),
+    prev_slice_segment(NULL),
     flush_reorder_buffer(false),
     nThreads(0),
     first_decoded_CTB_RS(-1),
@@ -181,6 +247,20 @@ image_unit::image_unit()
   img=NULL;
   role=Invalid;
   state=Unprocessed;
+
+  pipelined_filters=false;
+  nRowsDecoded=0;
+  nRowsDeblockedV=0;
+  nRowsDeblockedH=0;
+  nRowsSAO=0;
+  apply_sao=true;
+
+  frame_parallel=false;
+  pipelined_reconstruction=false;
+  nRowsReconstructionQueued=0;
+  nSlicesDecoding=0;
+  all_slices_started_flag=false;
+  de265_mutex_init(&slice_decoding_mutex);
 }
 
 
@@ -193,6 +273,63 @@ image_unit::~image_unit()
   for (size_t i=0;i<tasks.size();i++) {
     delete tasks[i];
   }
+
+  de265_mutex_destroy(&slice_decoding_mutex);
+}
+
+
+void image_unit::slice_decoding_started()
+{
+  de265_mutex_lock(&slice_decoding_mutex);
+  nSlicesDecoding++;
+  de265_mutex_unlock(&slice_decoding_mutex);
+}
+
+
+void image_unit::slice_decoding_finished()
+{
+  de265_mutex_lock(&slice_decoding_mutex);
+  nSlicesDecoding--;
+  bool complete = (nSlicesDecoding==0 && all_slices_started_flag);
+  de265_mutex_unlock(&slice_decoding_mutex);
+
+  if (complete) {
+    mark_missing_CTBs_as_decoded();
+  }
+}
+
+
+void image_unit::all_slices_started()
+{
+  de265_mutex_lock(&slice_decoding_mutex);
+  all_slices_started_flag = true;
+  bool complete = (nSlicesDecoding==0);
+  de265_mutex_unlock(&slice_decoding_mutex);
+
+  if (complete) {
+    mark_missing_CTBs_as_decoded();
+  }
+}
+
+
+void image_unit::mark_missing_CTBs_as_decoded()
+{
+  /* All slices have been decoded. Hence, all CTBs that still were not parsed are not
+     covered by any slice. Mark them to unblock the in-loop filters.
+     (Parsed CTBs may still be reconstructed by the reconstruction tasks.) */
+
+  int nMissing = 0;
+
+  for (int i=0;i<img->number_of_ctbs();i++) {
+    if (img->ctb_progress[i].get_progress() < CTB_PROGRESS_PARSED) {
+      img->ctb_progress[i].set_progress(CTB_PROGRESS_PREFILTER);
+      nMissing++;
+    }
+  }
+
+  if (nMissing>0) {
+    img->integrity = INTEGRITY_DECODING_ERRORS;
+  }
 }
 
 
@@ -214,6 +351,7 @@ decoder_context::decoder_context()
 
   param_disable_deblocking = false;
   param_disable_sao = false;
+  param_pipelined_reconstruction = true;
   //param_disable_mc_residual_idct = false;
   //param_disable_intra_residual_idct = false;
 
@@ -227,6 +365,8 @@ decoder_context::decoder_context()
   param_image_allocation_functions = de265_image::default_image_allocation;
   param_image_allocation_userdata  = NULL;
 
+  nal_parser.set_acceleration_functions(&acceleration);
+
   /*
   memset(&vps, 0, sizeof(video_parameter_set)*DE265_MAX_VPS_SETS);
   memset(&sps, 0, sizeof(seq_parameter_set)  *DE265_MAX_SPS_SETS);
@@ -238,7 +378,8 @@ decoder_context::decoder_context()
   current_sps = NULL;
   current_pps = NULL;
 
-  //memset(&thread_pool,0,sizeof(struct thread_pool));
+  thread_pool_ = NULL;
+  own_thread_pool = false;
   num_worker_threads = 0;
 
 
@@ -320,6 +461,8 @@ decoder_context::decoder_context()
 
 decoder_context::~decoder_context()
 {
+  stop_thread_pool();
+
   while (!image_units.empty()) {
     delete image_units.back();
     image_units.pop_back();
@@ -345,30 +488,77 @@ void decoder_context::set_image_allocation_functions(de265_image_allocation* all
 
 de265_error decoder_context::start_thread_pool(int nThreads)
 {
-  ::start_thread_pool(&thread_pool_, nThreads);
+  stop_thread_pool();
 
-  num_worker_threads = nThreads;
+  thread_pool* pool = new thread_pool;
 
-  return DE265_OK;
+  de265_error err = ::start_thread_pool(pool, nThreads, cpu_affinity);
+
+  thread_pool_ = pool;
+  own_thread_pool = true;
+  num_worker_threads = pool->num_threads;
+
+  return err;
 }
 
 
 void decoder_context::stop_thread_pool()
 {
-  if (get_num_worker_threads()>0) {
-    //flush_thread_pool(&ctx->thread_pool);
-    ::stop_thread_pool(&thread_pool_);
+  if (thread_pool_ != NULL) {
+    // All our tasks have to be finished before we can leave the pool.
+    wait_for_background_tasks();
+
+    if (own_thread_pool) {
+      ::stop_thread_pool(thread_pool_);
+      delete thread_pool_;
+    }
+
+    thread_pool_ = NULL;
+    own_thread_pool = false;
+    num_worker_threads = 0;
   }
 }
 
 
-void decoder_context::reset()
+de265_error decoder_context::set_cpu_affinity(const std::vector<int>& cpus)
+{
+  cpu_affinity = cpus;
+
+  // a shared pool is configured by its owner
+
+  if (thread_pool_ != NULL && own_thread_pool) {
+    return set_thread_pool_cpu_affinity(thread_pool_, cpus);
+  }
+
+  return DE265_OK;
+}
+
+
+de265_error decoder_context::attach_thread_pool(thread_pool* pool)
 {
-  if (num_worker_threads>0) {
-    //flush_thread_pool(&ctx->thread_pool);
-    ::stop_thread_pool(&thread_pool_);
+  if (pool != NULL && pool->stopped) {
+    return DE265_ERROR_THREAD_POOL_STOPPED;
   }
 
+  stop_thread_pool();
+
+  if (pool != NULL) {
+    thread_pool_ = pool;
+    own_thread_pool = false;
+    num_worker_threads = pool->num_threads;
+  }
+
+  return DE265_OK;
+}
+
+
+void decoder_context::reset()
+{
+  // Pictures in decoding can still have tasks in the thread pool.
+  // These have to be finished before we can remove the image units.
+
+  wait_for_background_tasks();
+
   // --------------------------------------------------
 
 #if 0
@@ -423,37 +613,51 @@ void decoder_context::reset()
     delete image_units.back();
     image_units.pop_back();
   }
-
-  // --- start threads again ---
-
-  if (num_worker_threads>0) {
-    // TODO: need error checking
-    start_thread_pool(num_worker_threads);
-  }
 }
 
-void base_context::set_acceleration_functions(enum de265_acceleration l)
+void init_acceleration_functions(struct acceleration_functions* accel, enum de265_acceleration l)
 {
   // fill scalar functions first (so that function table is completely filled)
 
-  init_acceleration_functions_fallback(&acceleration);
+  init_acceleration_functions_fallback(accel);
 
 
   // override functions with optimized variants
 
 #ifdef HAVE_SSE4_1
   if (l>=de265_acceleration_SSE) {
-    init_acceleration_functions_sse(&acceleration);
+    init_acceleration_functions_sse(accel);
+  }
+#endif
+#ifdef HAVE_AVX2
+  if (l>=de265_acceleration_AVX2) {
+    init_acceleration_functions_avx2(accel);
+  }
+#endif
+#ifdef HAVE_AVX512
+  if (l>=de265_acceleration_AVX512) {
+    init_acceleration_functions_avx512(accel);
   }
 #endif
 #ifdef HAVE_ARM
   if (l>=de265_acceleration_ARM) {
-    init_acceleration_functions_arm(&acceleration);
+    init_acceleration_functions_arm(accel);
   }
 #endif
 }
 
 
+void base_context::set_acceleration_functions(enum de265_acceleration l)
+{
+  if (l==de265_acceleration_AUTOTUNE) {
+    autotune_acceleration_functions(&acceleration);
+  }
+  else {
+    init_acceleration_functions(&acceleration, l);
+  }
+}
+
+
 void decoder_context::init_thread_context(thread_context* tctx)
 {
   // zero scrap memory for coefficient blocks
@@ -462,51 +666,26 @@ void decoder_context::init_thread_context(thread_context* tctx)
   tctx->currentQG_x = -1;
   tctx->currentQG_y = -1;
 
-
-
-  // --- find QPY that was active at the end of the previous slice ---
-
-  // find the previous CTB in TS order
-
-  const pic_parameter_set& pps = tctx->img->get_pps();
-  const seq_parameter_set& sps = tctx->img->get_sps();
-
-
-  if (tctx->shdr->slice_segment_address > 0) {
-    int prevCtb = pps.CtbAddrTStoRS[ pps.CtbAddrRStoTS[tctx->shdr->slice_segment_address] -1 ];
-
-    int ctbX = prevCtb % sps.PicWidthInCtbsY;
-    int ctbY = prevCtb / sps.PicWidthInCtbsY;
-
-
-    // take the pixel at the bottom right corner (but consider that the image size might be smaller)
-
-    int x = ((ctbX+1) << sps.Log2CtbSizeY)-1;
-    int y = ((ctbY+1) << sps.Log2CtbSizeY)-1;
-
-    x = std::min(x,sps.pic_width_in_luma_samples-1);
-    y = std::min(y,sps.pic_height_in_luma_samples-1);
-
-    //printf("READ QPY: %d %d -> %d (should %d)\n",x,y,imgunit->img->get_QPY(x,y), tc.currentQPY);
-
-    //if (tctx->shdr->dependent_slice_segment_flag) {  // TODO: do we need this condition ?
-    tctx->currentQPY = tctx->img->get_QPY(x,y);
-      //}
-  }
+  /* Note: the QPY at the end of the previous slice is only needed for dependent slice
+     segments. It is read in initialize_CABAC_at_slice_segment_start(), after the
+     previous slice segment has been decoded. */
 }
 
 
 void decoder_context::add_task_decode_CTB_row(thread_context* tctx,
                                               bool firstSliceSubstream,
+                                              bool lastSliceSubstream,
                                               int ctbRow)
 {
   thread_task_ctb_row* task = new thread_task_ctb_row;
   task->firstSliceSubstream = firstSliceSubstream;
+  task->lastSliceSubstream  = lastSliceSubstream;
   task->tctx = tctx;
   task->debug_startCtbRow = ctbRow;
+  task->set_priority(tctx->img->get_ID(), thread_task::StageDecode, ctbRow);
   tctx->task = task;
 
-  add_task(&thread_pool_, task);
+  add_task_to_thread_pool(task);
 
   tctx->imgunit->tasks.push_back(task);
 }
@@ -520,9 +699,10 @@ void decoder_context::add_task_decode_slice_segment(thread_context* tctx, bool f
   task->tctx = tctx;
   task->debug_startCtbX = ctbx;
   task->debug_startCtbY = ctby;
+  task->set_priority(tctx->img->get_ID(), thread_task::StageDecode, ctby);
   tctx->task = task;
 
-  add_task(&thread_pool_, task);
+  add_task_to_thread_pool(task);
 
   tctx->imgunit->tasks.push_back(task);
 }
@@ -641,6 +821,24 @@ de265_error decoder_context::read_eos_NAL(bitreader& reader)
   return DE265_OK;
 }
 
+void decoder_context::mark_current_picture_as_not_decoded()
+{
+  if (img==NULL) {
+    return;
+  }
+
+  img->integrity = INTEGRITY_NOT_DECODED;
+
+  /* If the picture was rejected at its first slice header, no slice of it will ever be
+     decoded. It can still be referenced by the following pictures, which would wait
+     forever for its CTB progress. */
+
+  if (img->slices.empty()) {
+    img->mark_all_CTB_progress(CTB_PROGRESS_SAO);
+  }
+}
+
+
 de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, nal_header& nal_hdr)
 {
   logdebug(LogHeaders,"---> read slice segment header\n");
@@ -652,7 +850,7 @@ de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, na
   bool continueDecoding;
   de265_error err = shdr->read(&reader,this, &continueDecoding);
   if (!continueDecoding) {
-    if (img) { img->integrity = INTEGRITY_NOT_DECODED; }
+    mark_current_picture_as_not_decoded();
     nal_parser.free_NAL_unit(nal);
     delete shdr;
     return err;
@@ -666,12 +864,22 @@ de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, na
 
   if (process_slice_segment_header(shdr, &err, nal->pts, &nal_hdr, nal->user_data) == false)
     {
-      if (img!=NULL) img->integrity = INTEGRITY_NOT_DECODED;
+      mark_current_picture_as_not_decoded();
       nal_parser.free_NAL_unit(nal);
       delete shdr;
       return err;
     }
 
+  // There cannot be more slice segments than CTBs (the slice header list must not grow beyond this).
+
+  if (this->img->slices.size() >= (size_t)this->img->number_of_ctbs()) {
+    add_warning(DE265_WARNING_SLICEHEADER_INVALID, false);
+    this->img->integrity = INTEGRITY_DECODING_ERRORS;
+    nal_parser.free_NAL_unit(nal);
+    delete shdr;
+    return DE265_OK;
+  }
+
   this->img->add_slice_segment_header(shdr);
 
   skip_bits(&reader,1); // TODO: why?
@@ -679,11 +887,14 @@ de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, na
 
 
   // modify entry_point_offsets
+  // (not when the emulation prevention bytes are still in the data, they are counted in the offsets)
 
-  int headerLength = reader.data - nal->data();
-  for (int i=0;i<shdr->num_entry_point_offsets;i++) {
-    shdr->entry_point_offset[i] -= nal->num_skipped_bytes_before(shdr->entry_point_offset[i],
-                                                                 headerLength);
+  if (!reader.emulation_prevention) {
+    int headerLength = reader.data - nal->data();
+    for (int i=0;i<shdr->num_entry_point_offsets;i++) {
+      shdr->entry_point_offset[i] -= nal->num_skipped_bytes_before(shdr->entry_point_offset[i],
+                                                                   headerLength);
+    }
   }
 
 
@@ -708,8 +919,12 @@ de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, na
 
     sliceunit->flush_reorder_buffer = flush_reorder_buffer_at_this_frame;
 
+    image_unit* imgunit = image_units.back();
+    if (!imgunit->slice_units.empty()) {
+      sliceunit->prev_slice_segment = imgunit->slice_units.back();
+    }
 
-    image_units.back()->slice_units.push_back(sliceunit);
+    imgunit->slice_units.push_back(sliceunit);
   }
   else {
     nal_parser.free_NAL_unit(nal);
@@ -731,6 +946,38 @@ template <class T> void pop_front(std::vector<T>& vec)
 }
 
 
+slice_unit* decoder_context::get_next_slice_unit_to_decode(size_t* out_unitIdx) const
+{
+  /* Pictures that are decoded in the background (frame-parallel decoding) do not have
+     to be finished before we can start the next picture. */
+
+  size_t unitIdx = 0;
+  slice_unit* sliceunit = image_units[0]->get_next_unprocessed_slice_segment();
+
+  while (sliceunit == NULL &&
+         image_units[unitIdx]->frame_parallel &&
+         unitIdx+1 < image_units.size()) {
+    unitIdx++;
+    sliceunit = image_units[unitIdx]->get_next_unprocessed_slice_segment();
+  }
+
+  if (sliceunit != NULL && unitIdx > 0) {
+    // A later picture can only be started if it is also decoded in the background,
+    // if it does not require the output of the previous pictures, and if we do not
+    // have more pictures in flight than worker threads.
+
+    if (!use_frame_parallel_decoding(image_units[unitIdx]) ||
+        sliceunit->flush_reorder_buffer ||
+        unitIdx >= (size_t)num_worker_threads) {
+      return NULL;
+    }
+  }
+
+  *out_unitIdx = unitIdx;
+  return sliceunit;
+}
+
+
 de265_error decoder_context::decode_some(bool* did_work)
 {
   de265_error err = DE265_OK;
@@ -739,87 +986,143 @@ de265_error decoder_context::decode_some(bool* did_work)
 
   if (image_units.empty()) { return DE265_OK; }  // nothing to do
 
+  size_t unitIdx = 0;
+  slice_unit* sliceunit = get_next_slice_unit_to_decode(&unitIdx);
 
-  // decode something if there is work to do
 
-  if ( ! image_units.empty() ) { // && ! image_units[0]->slice_units.empty() ) {
+  // if we decoded all slices of the current image and there will not
+  // be added any more slices to the image, output the image
+
+  if ( ( image_units.size()>=2 && image_units[0]->all_slice_segments_processed()) ||
+       ( image_units.size()>=1 && image_units[0]->all_slice_segments_processed() &&
+         nal_parser.number_of_NAL_units_pending()==0 &&
+         (nal_parser.is_end_of_stream() || nal_parser.is_end_of_frame()) )) {
 
     image_unit* imgunit = image_units[0];
-    slice_unit* sliceunit = imgunit->get_next_unprocessed_slice_segment();
+    bool finished = true;
 
-    if (sliceunit != NULL) {
+    if (imgunit->frame_parallel) {
+      if (!imgunit->is_all_slices_started()) {
+        run_postprocessing_filters_pipelined(imgunit);
+      }
 
-      //pop_front(imgunit->slice_units);
+      // If we can start decoding another slice, do not block until the picture is finished.
 
-      if (sliceunit->flush_reorder_buffer) {
-        dpb.flush_reorder_buffer();
+      if (sliceunit != NULL && !imgunit->img->is_completed()) {
+        finished = false;
       }
+      else {
+        imgunit->img->wait_for_completion();
+      }
+    }
+    else {
+      // Faulty input streams could miss part of the picture.
+      // Mark the CTBs that were not decoded so that the filters can process them.
 
-      *did_work = true;
+      imgunit->all_slices_started();
 
-      //err = decode_slice_unit_sequential(imgunit, sliceunit);
-      err = decode_slice_unit_parallel(imgunit, sliceunit);
-      if (err) {
-        return err;
+
+      // run post-processing filters (deblocking & SAO)
+
+      if (imgunit->pipelined_filters || num_worker_threads) {
+        // add the tasks for the remaining CTB rows and wait until all rows are filtered
+
+        add_postprocessing_filter_tasks(imgunit);
+
+        imgunit->img->wait_for_completion();
+
+        if (imgunit->apply_sao && imgunit->nRowsSAO>0) {
+          imgunit->img->exchange_pixel_data_with(imgunit->sao_output);
+        }
+      }
+      else {
+        run_postprocessing_filters_sequential(imgunit->img);
       }
 
-      //delete sliceunit;
+      // the picture is final now (pictures decoded in the background wait for this)
+
+      imgunit->img->pad_border();
+      imgunit->img->mark_all_CTB_progress(CTB_PROGRESS_SAO);
     }
-  }
 
 
+    if (finished) {
+      *did_work=true;
 
-  // if we decoded all slices of the current image and there will not
-  // be added any more slices to the image, output the image
+      // process suffix SEIs
 
-  if ( ( image_units.size()>=2 && image_units[0]->all_slice_segments_processed()) ||
-       ( image_units.size()>=1 && image_units[0]->all_slice_segments_processed() &&
-         nal_parser.number_of_NAL_units_pending()==0 &&
-         (nal_parser.is_end_of_stream() || nal_parser.is_end_of_frame()) )) {
+      for (size_t i=0;i<imgunit->suffix_SEIs.size();i++) {
+        const sei_message& sei = imgunit->suffix_SEIs[i];
 
-    image_unit* imgunit = image_units[0];
+        err = process_sei(&sei, imgunit->img);
+        if (err != DE265_OK)
+          break;
+      }
 
-    *did_work=true;
+      if (cbb != NULL && cbb->get_image != NULL) {
+        cbb->get_image(imgunit->img);
+      }
 
+      push_picture_to_output_queue(imgunit);
 
-    // mark all CTBs as decoded even if they are not, because faulty input
-    // streams could miss part of the picture
-    // TODO: this will not work when slice decoding is parallel to post-filtering,
-    // so we will have to replace this with keeping track of which CTB should have
-    // been decoded (but aren't because of the input stream being faulty)
+      // remove just decoded image unit from queue
 
-    imgunit->img->mark_all_CTB_progress(CTB_PROGRESS_PREFILTER);
+      delete imgunit;
 
+      pop_front(image_units);
 
 
-    // run post-processing filters (deblocking & SAO)
+      // The next picture may already be in decoding. Now that all previous pictures
+      // are finished, we can remove the images that it does not reference anymore.
 
-    if (img->decctx->num_worker_threads)
-      run_postprocessing_filters_parallel(imgunit);
-    else
-      run_postprocessing_filters_sequential(imgunit->img);
+      if (!image_units.empty()) {
+        const image_unit* nextunit = image_units[0];
 
-    // process suffix SEIs
+        for (size_t i=0;i<nextunit->slice_units.size();i++) {
+          const slice_unit* s = nextunit->slice_units[i];
+          if (s->state != slice_unit::Unprocessed) {
+            remove_images_from_dpb(s->shdr->RemoveReferencesList);
+          }
+        }
+      }
 
-    for (size_t i=0;i<imgunit->suffix_SEIs.size();i++) {
-      const sei_message& sei = imgunit->suffix_SEIs[i];
+      if (err != DE265_OK || image_units.empty()) {
+        return err;
+      }
 
-      err = process_sei(&sei, imgunit->img);
-      if (err != DE265_OK)
-        break;
+      sliceunit = get_next_slice_unit_to_decode(&unitIdx);
     }
+  }
 
-    if (cbb != NULL && cbb->get_image != NULL) {
-      cbb->get_image(imgunit->img);
+
+  // decode something if there is work to do
+
+  if (sliceunit != NULL) {
+    image_unit* imgunit = image_units[unitIdx];
+
+    // all slices of the previous pictures have been started -> start their in-loop filters
+
+    for (size_t i=0;i<unitIdx;i++) {
+      if (!image_units[i]->is_all_slices_started()) {
+        run_postprocessing_filters_pipelined(image_units[i]);
+      }
     }
 
-    push_picture_to_output_queue(imgunit);
+    // Images can only be removed from the DPB when all previous pictures are finished.
+    // For later pictures, this is done when they move to the front of the queue.
 
-    // remove just decoded image unit from queue
+    if (unitIdx == 0) {
+      remove_images_from_dpb(sliceunit->shdr->RemoveReferencesList);
+    }
+
+    if (sliceunit->flush_reorder_buffer) {
+      dpb.flush_reorder_buffer();
+    }
 
-    delete imgunit;
+    *did_work = true;
 
-    pop_front(image_units);
+    //err = decode_slice_unit_sequential(imgunit, sliceunit);
+    err = decode_slice_unit_parallel(imgunit, sliceunit);
   }
 
   return err;
@@ -838,8 +1141,6 @@ de265_error decoder_context::decode_slice_unit_sequential(image_unit* imgunit,
          imgunit->img);
   */
 
-  remove_images_from_dpb(sliceunit->shdr->RemoveReferencesList);
-
   if (sliceunit->shdr->slice_segment_address >= imgunit->img->get_pps().CtbAddrRStoTS.size()) {
     return DE265_ERROR_CTB_OUTSIDE_IMAGE_AREA;
   }
@@ -863,13 +1164,16 @@ de265_error decoder_context::decode_slice_unit_sequential(image_unit* imgunit,
 
   init_CABAC_decoder(&tctx.cabac_decoder,
                      sliceunit->reader.data,
-                     sliceunit->reader.bytes_remaining);
+                     sliceunit->reader.bytes_remaining,
+                     sliceunit->reader.emulation_prevention);
 
   // alloc CABAC-model array if entropy_coding_sync is enabled
 
   if (imgunit->img->get_pps().entropy_coding_sync_enabled_flag &&
       sliceunit->shdr->first_slice_segment_in_pic_flag) {
-    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) ); //* CONTEXT_MODEL_TABLE_LENGTH );
+    // one model for each CTB row of each tile column
+    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) *
+                                imgunit->img->get_pps().num_tile_columns );
   }
 
   sliceunit->nThreads=1;
@@ -917,8 +1221,6 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
 {
   de265_error err = DE265_OK;
 
-  remove_images_from_dpb(sliceunit->shdr->RemoveReferencesList);
-
   /*
   printf("-------- decode --------\n");
   printf("IMAGE UNIT %p\n",imgunit);
@@ -937,13 +1239,20 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
   bool use_tiles = (img->decctx->num_worker_threads > 0 &&
                     pps.tiles_enabled_flag);
 
+  bool use_frame_parallel = use_frame_parallel_decoding(imgunit);
 
-  // TODO: remove this warning later when we do frame-parallel decoding
-  if (img->decctx->num_worker_threads > 0 &&
-      pps.entropy_coding_sync_enabled_flag == false &&
-      pps.tiles_enabled_flag == false) {
+  if (imgunit->is_first_slice_segment(sliceunit)) {
+    imgunit->frame_parallel = use_frame_parallel;
+
+    // separating parsing and reconstruction only pays off with at least two threads
+
+    imgunit->pipelined_reconstruction = (use_frame_parallel &&
+                                         param_pipelined_reconstruction &&
+                                         num_worker_threads >= 2);
 
-    img->decctx->add_warning(DE265_WARNING_NO_WPP_CANNOT_USE_MULTITHREADING, true);
+    if (imgunit->pipelined_reconstruction) {
+      imgunit->reconstruction_data.resize(img->number_of_ctbs());
+    }
   }
 
 
@@ -972,8 +1281,10 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
   }
 
 
-  // TODO: even though we cannot split this into several tasks, we should run it
-  // as a background thread
+  if (imgunit->frame_parallel) {
+    return decode_slice_unit_frame_parallel(imgunit, sliceunit);
+  }
+
   if (!use_WPP && !use_tiles) {
     //printf("SEQ\n");
     err = decode_slice_unit_sequential(imgunit, sliceunit);
@@ -983,18 +1294,14 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
   }
 
 
-  if (use_WPP && use_tiles) {
-    // TODO: this is not allowed ... output some warning or error
-
-    return DE265_WARNING_PPS_HEADER_INVALID;
-  }
-
+  // With both WPP and tiles, the CTB rows of each tile are decoded as WPP rows.
 
   if (use_WPP) {
     //printf("WPP\n");
     err = decode_slice_unit_WPP(imgunit, sliceunit);
     sliceunit->state = slice_unit::Decoded;
     mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
+    add_postprocessing_filter_tasks(imgunit);
     return err;
   }
   else if (use_tiles) {
@@ -1002,6 +1309,7 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
     err = decode_slice_unit_tiles(imgunit, sliceunit);
     sliceunit->state = slice_unit::Decoded;
     mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
+    add_postprocessing_filter_tasks(imgunit);
     return err;
   }
 
@@ -1023,31 +1331,49 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
   int ctbsWidth = img->get_sps().PicWidthInCtbsY;
 
 
-  assert(img->num_threads_active() == 0);
-
-
   // reserve space to store entropy coding context models for each CTB row
 
   if (shdr->first_slice_segment_in_pic_flag) {
-    // reserve space for nRows-1 because we don't need to save the CABAC model in the last CTB row
-    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) ); //* CONTEXT_MODEL_TABLE_LENGTH );
+    // reserve space for nRows-1 because we don't need to save the CABAC model in the last CTB row,
+    // there is one model for each CTB row of each tile column
+    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) * pps.num_tile_columns );
   }
 
 
   sliceunit->allocate_thread_contexts(nRows);
 
 
-  // first CTB in this slice
+  // First CTB in this slice. When tiles are also enabled, each CTB row in each
+  // tile is a separate substream and the WPP dependencies apply within the tile.
+
   int ctbAddrRS = shdr->slice_segment_address;
   int ctbRow    = ctbAddrRS / ctbsWidth;
+  int tileID    = pps.TileIdRS[ctbAddrRS];
 
   for (int entryPt=0;entryPt<nRows;entryPt++) {
-    // entry points other than the first start at CTB rows
+    int tileColumn = tileID % pps.num_tile_columns;
+    int tileRow    = tileID / pps.num_tile_columns;
+
+    // entry points other than the first start at CTB rows of the tile or at the next tile
     if (entryPt>0) {
       ctbRow++;
-      ctbAddrRS = ctbRow * ctbsWidth;
+
+      if (ctbRow >= pps.rowBd[tileRow+1]) {
+        tileID++;
+
+        if (tileID >= pps.num_tile_columns * pps.num_tile_rows) {
+          err = DE265_WARNING_SLICEHEADER_INVALID;
+          break;
+        }
+
+        tileColumn = tileID % pps.num_tile_columns;
+        tileRow    = tileID / pps.num_tile_columns;
+        ctbRow     = pps.rowBd[tileRow];
+      }
+
+      ctbAddrRS = ctbRow * ctbsWidth + pps.colBd[tileColumn];
     }
-    else if (nRows>1 && (ctbAddrRS % ctbsWidth) != 0) {
+    else if (nRows>1 && (ctbAddrRS % ctbsWidth) != pps.colBd[tileColumn]) {
       // If slice segment consists of several WPP rows, each of them
       // has to start at a row.
 
@@ -1091,14 +1417,15 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
 
     init_CABAC_decoder(&tctx->cabac_decoder,
                        &sliceunit->reader.data[dataStartIndex],
-                       dataEnd-dataStartIndex);
+                       dataEnd-dataStartIndex,
+                       sliceunit->reader.emulation_prevention);
 
     // add task
 
     //printf("start task for ctb-row: %d\n",ctbRow);
     img->thread_start(1);
     sliceunit->nThreads++;
-    add_task_decode_CTB_row(tctx, entryPt==0, ctbRow);
+    add_task_decode_CTB_row(tctx, entryPt==0, entryPt==nRows-1, ctbRow);
   }
 
 #if 0
@@ -1115,11 +1442,8 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
   }
 #endif
 
-  img->wait_for_completion();
-
-  for (size_t i=0;i<imgunit->tasks.size();i++)
-    delete imgunit->tasks[i];
-  imgunit->tasks.clear();
+  // The in-loop filter tasks of the picture may still be running, wait only for our slice.
+  sliceunit->finished_threads.wait_for_progress(sliceunit->nThreads);
 
   return DE265_OK;
 }
@@ -1136,9 +1460,6 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
   int nTiles = shdr->num_entry_point_offsets +1;
   int ctbsWidth = img->get_sps().PicWidthInCtbsY;
 
-
-  assert(img->num_threads_active() == 0);
-
   sliceunit->allocate_thread_contexts(nTiles);
 
 
@@ -1193,7 +1514,8 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
 
     init_CABAC_decoder(&tctx->cabac_decoder,
                        &sliceunit->reader.data[dataStartIndex],
-                       dataEnd-dataStartIndex);
+                       dataEnd-dataStartIndex,
+                       sliceunit->reader.emulation_prevention);
 
     // add task
 
@@ -1205,16 +1527,107 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
                                   ctbAddrRS / ctbsWidth);
   }
 
-  img->wait_for_completion();
-
-  for (size_t i=0;i<imgunit->tasks.size();i++)
-    delete imgunit->tasks[i];
-  imgunit->tasks.clear();
+  // The in-loop filter tasks of the picture may still be running, wait only for our slice.
+  sliceunit->finished_threads.wait_for_progress(sliceunit->nThreads);
 
   return err;
 }
 
 
+de265_error decoder_context::decode_slice_unit_frame_parallel(image_unit* imgunit,
+                                                              slice_unit* sliceunit)
+{
+  de265_image* img = imgunit->img;
+  slice_segment_header* shdr = sliceunit->shdr;
+  const pic_parameter_set& pps = img->get_pps();
+
+  if (shdr->slice_segment_address >= pps.CtbAddrRStoTS.size()) {
+    return DE265_ERROR_CTB_OUTSIDE_IMAGE_AREA;
+  }
+
+  if (sliceunit->reader.bytes_remaining <= 0) {
+    return DE265_ERROR_PREMATURE_END_OF_SLICE;
+  }
+
+  sliceunit->allocate_thread_contexts(1);
+
+
+  // All CTB rows above this slice segment are covered by the previous slice segments.
+
+  if (imgunit->pipelined_reconstruction) {
+    add_reconstruction_tasks(imgunit, shdr->slice_segment_address / img->get_sps().PicWidthInCtbsY);
+  }
+
+
+  // prepare thread context
+
+  thread_context* tctx = sliceunit->get_thread_context(0);
+
+  tctx->shdr    = shdr;
+  tctx->decctx  = this;
+  tctx->img     = img;
+  tctx->imgunit = imgunit;
+  tctx->sliceunit= sliceunit;
+  tctx->CtbAddrInTS = pps.CtbAddrRStoTS[shdr->slice_segment_address];
+
+  init_thread_context(tctx);
+
+  init_CABAC_decoder(&tctx->cabac_decoder,
+                     sliceunit->reader.data,
+                     sliceunit->reader.bytes_remaining,
+                     sliceunit->reader.emulation_prevention);
+
+
+  // add task
+
+  thread_task_slice_segment_data* task = new thread_task_slice_segment_data;
+  task->tctx = tctx;
+  task->set_priority(img->get_ID(), thread_task::StageDecode,
+                     shdr->slice_segment_address / img->get_sps().PicWidthInCtbsY);
+  tctx->task = task;
+
+  sliceunit->nThreads = 1;
+  imgunit->slice_decoding_started();
+  img->thread_start(1);
+
+  imgunit->tasks.push_back(task);
+
+  add_task_to_thread_pool(task);
+
+  return DE265_OK;
+}
+
+
+bool decoder_context::use_frame_parallel_decoding(const image_unit* imgunit) const
+{
+  const pic_parameter_set& pps = imgunit->img->get_pps();
+
+  return (num_worker_threads > 0 &&
+          pps.entropy_coding_sync_enabled_flag == false &&
+          pps.tiles_enabled_flag == false);
+}
+
+
+void decoder_context::wait_for_background_tasks()
+{
+  for (size_t i=0;i<image_units.size();i++) {
+    image_units[i]->img->wait_for_completion();
+  }
+}
+
+
+void decoder_context::add_task_to_thread_pool(thread_task* task)
+{
+  if (thread_pool_ != NULL) {
+    add_task(thread_pool_, task);
+  }
+  else {
+    // All previous tasks have been finished when we left the pool, hence this cannot block.
+    task->work();
+  }
+}
+
+
 de265_error decoder_context::decode_NAL(NAL_unit* nal)
 {
   //return decode_NAL_OLD(nal);
@@ -1224,7 +1637,12 @@ de265_error decoder_context::decode_NAL(NAL_unit* nal)
   de265_error err = DE265_OK;
 
   bitreader reader;
-  bitreader_init(&reader, nal->data(), nal->size());
+  if (nal->has_emulation_prevention_bytes()) {
+    bitreader_init_escaped(&reader, nal->data(), nal->size());
+  }
+  else {
+    bitreader_init(&reader, nal->data(), nal->size());
+  }
 
   nal_header nal_hdr;
   nal_hdr.read(&reader);
@@ -1336,6 +1754,19 @@ de265_error decoder_context::decode(int* more)
   // -> output stalled
 
   if (!ctx->dpb.has_free_dpb_picture(false)) {
+
+    // Pictures that are still decoded in the background also occupy DPB slots.
+    // Finish them before pausing.
+
+    if (!ctx->image_units.empty() && ctx->image_units[0]->frame_parallel) {
+      bool did_work = false;
+      de265_error err = decode_some(&did_work);
+      if (did_work) {
+        if (more) { *more = (err==DE265_OK); }
+        return err;
+      }
+    }
+
     if (more) *more = 1;
     return DE265_ERROR_IMAGE_BUFFER_FULL;
   }
@@ -1468,6 +1899,9 @@ int decoder_context::generate_unavailable_reference_picture(const seq_parameter_
   img->PicState = (longTerm ? UsedForLongTermReference : UsedForShortTermReference);
   img->integrity = INTEGRITY_UNAVAILABLE_REFERENCE;
 
+  img->pad_border();
+  img->mark_all_CTB_progress(CTB_PROGRESS_SAO);
+
   return idx;
 }
 
@@ -1945,26 +2379,247 @@ void decoder_context::run_postprocessing_filters_sequential(de265_image* img)
 }
 
 
-void decoder_context::run_postprocessing_filters_parallel(image_unit* imgunit)
+/* Number of CTB rows that a filter stage can process when its input is available
+   in the top 'nInputRows' rows. Each stage also needs the input row below. */
+static int filterable_rows(int nInputRows, int nRows)
+{
+  if (nInputRows==nRows) {
+    return nRows;
+  }
+
+  return std::max(nInputRows-1, 0);
+}
+
+
+void decoder_context::add_postprocessing_filter_tasks(image_unit* imgunit)
 {
   de265_image* img = imgunit->img;
+  const seq_parameter_set& sps = img->get_sps();
 
-  int saoWaitsForProgress = CTB_PROGRESS_PREFILTER;
-  bool waitForCompletion = false;
+  const int nRows = sps.PicHeightInCtbsY;
+  const int ctbW  = sps.PicWidthInCtbsY;
 
-  if (!img->decctx->param_disable_deblocking) {
-    add_deblocking_tasks(imgunit);
-    saoWaitsForProgress = CTB_PROGRESS_DEBLK_H;
+  imgunit->pipelined_filters = true;
+
+
+  // find the CTB rows that are completely decoded
+
+  while (imgunit->nRowsDecoded < nRows) {
+    const int y = imgunit->nRowsDecoded;
+
+    bool rowDecoded = true;
+    for (int x=0;x<ctbW;x++) {
+      if (img->ctb_progress[x+y*ctbW].get_progress() < CTB_PROGRESS_PREFILTER) {
+        rowDecoded = false;
+        break;
+      }
+    }
+
+    if (!rowDecoded) {
+      break;
+    }
+
+    imgunit->nRowsDecoded++;
+  }
+
+
+  // Add the tasks of each stage for the rows whose input rows are available now.
+  // The input rows are decoded or processed by tasks that have been added before,
+  // hence the tasks never wait for slices that are not decoded yet.
+
+  int saoInputRows     = imgunit->nRowsDecoded;
+  int saoInputProgress = CTB_PROGRESS_PREFILTER;
+
+  if (!param_disable_deblocking) {
+    int endV = filterable_rows(imgunit->nRowsDecoded, nRows);
+    add_deblocking_tasks(imgunit, true, imgunit->nRowsDeblockedV, endV);
+    imgunit->nRowsDeblockedV = std::max(imgunit->nRowsDeblockedV, endV);
+
+    int endH = filterable_rows(imgunit->nRowsDeblockedV, nRows);
+    add_deblocking_tasks(imgunit, false, imgunit->nRowsDeblockedH, endH);
+    imgunit->nRowsDeblockedH = std::max(imgunit->nRowsDeblockedH, endH);
+
+    saoInputRows     = imgunit->nRowsDeblockedH;
+    saoInputProgress = CTB_PROGRESS_DEBLK_H;
+  }
+
+  if (!param_disable_sao && imgunit->apply_sao) {
+    int endSAO = filterable_rows(saoInputRows, nRows);
+    if (endSAO > imgunit->nRowsSAO) {
+      if (add_sao_tasks(imgunit, saoInputProgress, imgunit->nRowsSAO, endSAO)) {
+        imgunit->nRowsSAO = endSAO;
+      }
+      else {
+        imgunit->apply_sao = false;
+      }
+    }
+  }
+  else {
+    imgunit->apply_sao = false;
+  }
+}
+
+
+/* Applies the in-loop filters to a picture that is decoded in the background.
+   The filters follow the slice decoding row by row, each stage one CTB row behind
+   the previous one:
+   - vertical deblocking of row y waits until row y+1 is decoded (intra prediction
+     in row y+1 needs the unfiltered samples),
+   - horizontal deblocking of row y needs the vertical edges of row y+1 filtered,
+   - SAO of row y needs the completely deblocked rows y-1 to y+1.
+   Finished rows are padded into the picture border and marked with CTB_PROGRESS_SAO,
+   so that pictures referencing this one can already start their motion compensation.
+ */
+class thread_task_postfilters : public thread_task
+{
+public:
+  de265_image* img;
+  de265_image* saoInput;  // copy of the deblocked image for SAO input, NULL if SAO is not applied
+  bool deblocking;
+
+  virtual void work();
+  virtual std::string name() const { return "postfilters"; }
+
+private:
+  void mark_row_as_final(int ctb_y);
+};
+
+
+void thread_task_postfilters::mark_row_as_final(int ctb_y)
+{
+  const int ctbW = img->get_sps().PicWidthInCtbsY;
+  const int ctbSize = (1<<img->get_sps().Log2CtbSizeY);
+
+  img->pad_border_lines(ctb_y*ctbSize, (ctb_y+1)*ctbSize);
+
+  for (int x=0;x<ctbW;x++) {
+    img->ctb_progress[x+ctb_y*ctbW].set_progress(CTB_PROGRESS_SAO);
+  }
+}
+
+
+void thread_task_postfilters::work()
+{
+  state = Running;
+  img->thread_run(this);
+
+  const seq_parameter_set& sps = img->get_sps();
+
+  const int nRows    = sps.PicHeightInCtbsY;
+  const int ctbSize  = (1<<sps.Log2CtbSizeY);
+
+  for (int step=0; step<nRows+3; step++) {
+
+    // vertical deblocking of current row
+
+    int y = step;
+    if (y < nRows) {
+      // Independent slices are decoded concurrently, hence all CTBs of the rows have to be checked.
+
+      img->wait_for_CTB_row_progress(this, y, CTB_PROGRESS_PREFILTER);
+      img->wait_for_CTB_row_progress(this, std::min(y+1,nRows-1), CTB_PROGRESS_PREFILTER);
+
+      if (deblocking) {
+        apply_deblocking_filter_CTBRow(img, y, true);
+      }
+    }
+
+    // horizontal deblocking of the row above
+
+    y = step-1;
+    if (deblocking && y>=0 && y<nRows) {
+      apply_deblocking_filter_CTBRow(img, y, false);
+    }
+
+    // the row two rows above is completely deblocked now
+
+    y = step-2;
+    if (y>=0 && y<nRows) {
+      if (saoInput) {
+        saoInput->copy_lines_from(img, y*ctbSize, (y+1)*ctbSize);
+      }
+      else {
+        mark_row_as_final(y);
+      }
+    }
+
+    // SAO, with all input rows available
+
+    y = step-3;
+    if (saoInput && y>=0 && y<nRows) {
+      apply_sample_adaptive_offset_CTBRow(img, y, saoInput, img);
+      mark_row_as_final(y);
+    }
   }
 
-  if (!img->decctx->param_disable_sao) {
-    waitForCompletion |= add_sao_tasks(imgunit, saoWaitsForProgress);
-    //apply_sample_adaptive_offset(img);
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
+void decoder_context::run_postprocessing_filters_pipelined(image_unit* imgunit)
+{
+  de265_image* img = imgunit->img;
+
+  // no more slices will be added, CTBs of missing slices will be marked as decoded
+
+  imgunit->all_slices_started();
+
+  if (imgunit->pipelined_reconstruction) {
+    add_reconstruction_tasks(imgunit, img->get_sps().PicHeightInCtbsY);
+  }
+
+  thread_task_postfilters* task = new thread_task_postfilters;
+  task->img = img;
+  task->deblocking = !param_disable_deblocking;
+  task->saoInput = NULL;
+  task->set_priority(img->get_ID(), thread_task::StageDeblockVertical, 0);
+
+  if (!param_disable_sao &&
+      img->get_sps().sample_adaptive_offset_enabled_flag) {
+    de265_error err = imgunit->sao_output.alloc_image(img->get_width(), img->get_height(),
+                                                      img->get_chroma_format(),
+                                                      img->get_shared_sps(),
+                                                      false,
+                                                      img->decctx,
+                                                      img->pts, img->user_data, true);
+    if (err != DE265_OK) {
+      add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
+    }
+    else {
+      task->saoInput = &imgunit->sao_output;
+    }
   }
 
-  img->wait_for_completion();
+  img->thread_start(1);
+
+  imgunit->tasks.push_back(task);
+
+  add_task_to_thread_pool(task);
 }
 
+
+void decoder_context::add_reconstruction_tasks(image_unit* imgunit, int endCtbRow)
+{
+  de265_image* img = imgunit->img;
+
+  for (int y=imgunit->nRowsReconstructionQueued; y<endCtbRow; y++) {
+    thread_task_reconstruct_CTB_row* task = new thread_task_reconstruct_CTB_row;
+    task->imgunit = imgunit;
+    task->ctb_row = y;
+    task->set_priority(img->get_ID(), thread_task::StageReconstruct, y);
+
+    img->thread_start(1);
+
+    imgunit->tasks.push_back(task);
+
+    add_task_to_thread_pool(task);
+  }
+
+  imgunit->nRowsReconstructionQueued = std::max(imgunit->nRowsReconstructionQueued, endCtbRow);
+}
+
+
 /*
 void decoder_context::push_current_picture_to_output_queue()
 {
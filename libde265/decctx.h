@@ -48,6 +48,58 @@ class slice_segment_header;
 class image_unit;
 class slice_unit;
 class decoder_context;
+class thread_context;
+
+
+/* With pipelined reconstruction, the slice decoding tasks only parse the syntax and
+   store the data required for the reconstruction of each CTB here. Everything else
+   (prediction modes, motion, QP) is stored in the image metadata as usual.
+   The CTB is reconstructed later by a thread_task_reconstruct_CTB_row. */
+class ctb_reconstruction_data
+{
+public:
+  struct prediction_unit {
+    int16_t  xC,yC, xB,yB;
+    int16_t  nCS, nPbW,nPbH;
+    PBMotion motion;
+  };
+
+  struct transform_unit {
+    int16_t  x0,y0;           // position of TU (chroma adapted)
+    int16_t  xCUBase,yCUBase; // position of CU (chroma adapted)
+    uint8_t  nT, cIdx;
+    uint8_t  cuPredMode;
+    uint8_t  cbf;
+    uint8_t  qP;
+    uint8_t  cu_transquant_bypass_flag;
+    uint8_t  transform_skip_flag;
+    uint8_t  explicit_rdpcm_flag;
+    uint8_t  explicit_rdpcm_dir;
+    int8_t   ResScaleVal;
+    uint16_t nCoeff;
+    uint32_t firstCoeff;      // index into coeffValue / coeffPos
+  };
+
+  ctb_reconstruction_data() : shdr(NULL) { }
+
+  slice_segment_header* shdr;
+
+  /* The inter prediction of all PUs is done first. This is equivalent to the decoding
+     order because the TUs of a CU only depend on the PUs of the same CU and on the
+     reconstruction of previous CUs. */
+  std::vector<prediction_unit> prediction_units;
+  std::vector<transform_unit>  transform_units;  // in decoding order
+
+  std::vector<int16_t> coeffValue;
+  std::vector<int16_t> coeffPos;
+
+  void add_prediction_unit(int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+                           const PBMotion& motion);
+  void add_transform_unit(const thread_context* tctx, int x0,int y0, int xCUBase,int yCUBase,
+                          int nT, int cIdx, enum PredMode cuPredMode, bool cbf);
+
+  void release(); // free the memory after reconstruction
+};
 
 
 class thread_context
@@ -117,6 +169,10 @@ public:
   slice_unit* sliceunit;
   thread_task* task; // executing thread_task or NULL if not multi-threaded
 
+  /* With pipelined reconstruction, the reconstruction data of the current CTB is stored
+     here instead of reconstructing it directly. NULL otherwise. */
+  ctb_reconstruction_data* recon;
+
 private:
   thread_context(const thread_context&); // not allowed
   const thread_context& operator=(const thread_context&); // not allowed
@@ -152,6 +208,7 @@ public:
   bitreader reader;
 
   image_unit* imgunit;
+  slice_unit* prev_slice_segment; // previous slice segment in the same picture (or NULL)
 
   bool flush_reorder_buffer;
 
@@ -267,9 +324,62 @@ public:
      There is one saved model for the initialization of each CTB row.
      The array is unused for non-WPP streams. */
   std::vector<context_model_table> ctx_models;  // TODO: move this into image ?
+
+
+  // --- in-loop filtering in parallel to WPP / tiles decoding ---
+
+  /* The deblocking and SAO tasks are added while the picture is still decoding,
+     as soon as their input CTB rows are available. These count the CTB rows
+     (from the top) that are completely decoded, and for which the tasks of each
+     filter stage have been added. */
+  bool pipelined_filters; // whether any filter tasks have been added
+  int  nRowsDecoded;
+  int  nRowsDeblockedV;
+  int  nRowsDeblockedH;
+  int  nRowsSAO;
+  bool apply_sao;         // SAO is applied with tasks writing into 'sao_output'
+
+
+  // --- frame-parallel decoding ---
+
+  /* Whether this picture is decoded in background tasks, in parallel to other pictures.
+     Each slice segment is decoded by one task and the in-loop filters are applied
+     by another task that follows the decoding progress row by row. */
+  bool frame_parallel;
+
+  /* With pipelined reconstruction (only for frame-parallel pictures), the slice tasks only
+     parse the CTBs into 'reconstruction_data' (one entry per CTB, in raster scan order) and
+     one task per CTB row reconstructs them. A row task is added as soon as all slice segments
+     covering the row have been added, i.e. for the rows above the next slice segment. */
+  bool pipelined_reconstruction;
+  int  nRowsReconstructionQueued;
+  std::vector<ctb_reconstruction_data> reconstruction_data;
+
+  void slice_decoding_started();
+  void slice_decoding_finished();
+
+  /* Called when there will be no more slice segments for this picture.
+     As soon as all slice decoding tasks finished, all CTBs are marked as decoded.
+     In faulty streams, this includes CTBs of missing slices. */
+  void all_slices_started();
+  bool is_all_slices_started() const { return all_slices_started_flag; }
+
+private:
+  de265_mutex slice_decoding_mutex;
+  int  nSlicesDecoding;
+  bool all_slices_started_flag;
+
+  void mark_missing_CTBs_as_decoded();
+
+  image_unit(const image_unit&); // not allowed
+  const image_unit& operator=(const image_unit&); // not allowed
 };
 
 
+// Fills 'accel' with the fallback functions and overrides them with the optimized variants up to level 'l'.
+void init_acceleration_functions(struct acceleration_functions* accel, enum de265_acceleration l);
+
+
 class base_context : public error_queue
 {
  public:
@@ -296,6 +406,15 @@ class decoder_context : public base_context {
   de265_error start_thread_pool(int nThreads);
   void        stop_thread_pool();
 
+  // Use a thread pool that is shared with other decoders (NULL to detach).
+  de265_error attach_thread_pool(thread_pool* pool);
+
+  // CPUs for our own worker threads (empty: no restriction)
+  de265_error set_cpu_affinity(const std::vector<int>& cpus);
+
+  // NUMA node on which pictures should be allocated, -1 if unknown
+  int         get_numa_node() const { return thread_pool_ ? (int)thread_pool_->numa_node : -1; }
+
   void reset();
 
   bool has_sps(int id) const { return (bool)sps[id]; }
@@ -327,6 +446,7 @@ class decoder_context : public base_context {
   de265_error decode_slice_unit_parallel(image_unit* imgunit, slice_unit* sliceunit);
   de265_error decode_slice_unit_WPP(image_unit* imgunit, slice_unit* sliceunit);
   de265_error decode_slice_unit_tiles(image_unit* imgunit, slice_unit* sliceunit);
+  de265_error decode_slice_unit_frame_parallel(image_unit* imgunit, slice_unit* sliceunit);
 
 
   void process_nal_hdr(nal_header*);
@@ -352,6 +472,7 @@ class decoder_context : public base_context {
 
   bool param_disable_deblocking;
   bool param_disable_sao;
+  bool param_pipelined_reconstruction;
   //bool param_disable_mc_residual_idct;  // not implemented yet
   //bool param_disable_intra_residual_idct;  // not implemented yet
 
@@ -360,6 +481,10 @@ class decoder_context : public base_context {
   de265_image_allocation param_image_allocation_functions;
   void*                  param_image_allocation_userdata;
 
+  // Pixel memory of released pictures, reused by the default image allocator.
+  // Declared before the DPB, such that it outlives all pictures.
+  image_buffer_pool image_pool;
+
 
   // --- input stream data ---
 
@@ -368,6 +493,10 @@ class decoder_context : public base_context {
 
   int get_num_worker_threads() const { return num_worker_threads; }
 
+  /* Queue a task of a picture in decoding. If we left the thread pool while the
+     picture was in decoding, the task is run immediately. */
+  void add_task_to_thread_pool(thread_task* task);
+
   /* */ de265_image* get_image(int dpb_index)       { return dpb.get_image(dpb_index); }
   const de265_image* get_image(int dpb_index) const { return dpb.get_image(dpb_index); }
 
@@ -397,10 +526,12 @@ class decoder_context : public base_context {
   std::shared_ptr<pic_parameter_set>    current_pps;
 
  public:
-  thread_pool thread_pool_;
+  thread_pool* thread_pool_;  // NULL if we do not use worker threads
 
  private:
+  bool own_thread_pool;  // false if the pool is shared with other decoders
   int num_worker_threads;
+  std::vector<int> cpu_affinity;
 
 
  public:
@@ -511,7 +642,8 @@ class decoder_context : public base_context {
 
  private:
   void init_thread_context(thread_context* tctx);
-  void add_task_decode_CTB_row(thread_context* tctx, bool firstSliceSubstream, int ctbRow);
+  void add_task_decode_CTB_row(thread_context* tctx, bool firstSliceSubstream,
+                               bool lastSliceSubstream, int ctbRow);
   void add_task_decode_slice_segment(thread_context* tctx, bool firstSliceSubstream,
                                      int ctbX,int ctbY);
 
@@ -521,6 +653,9 @@ class decoder_context : public base_context {
 
   void process_picture_order_count(slice_segment_header* hdr);
 
+  // The current picture could not be decoded because of a rejected slice header.
+  void mark_current_picture_as_not_decoded();
+
   /*
   If there is no space for a new image, returns the negative value of an de265_error.
   I.e. you can check for error by return_value<0, which is error (-return_value);
@@ -533,7 +668,29 @@ class decoder_context : public base_context {
 
   void remove_images_from_dpb(const std::vector<int>& removeImageList);
   void run_postprocessing_filters_sequential(struct de265_image* img);
-  void run_postprocessing_filters_parallel(image_unit* img);
+
+  /* Add the deblocking and SAO tasks for all CTB rows whose input is available now.
+     Called after each slice segment, the remaining rows are added when the picture is complete. */
+  void add_postprocessing_filter_tasks(image_unit* imgunit);
+
+  void run_postprocessing_filters_pipelined(image_unit* img);
+
+  // add the reconstruction tasks for the CTB rows up to (excluding) 'endCtbRow'
+  void add_reconstruction_tasks(image_unit* imgunit, int endCtbRow);
+
+
+  // --- frame-parallel decoding ---
+
+  /* Whether the picture can be decoded in parallel to other pictures.
+     This is the case for multi-threaded decoding when the picture uses neither WPP nor tiles. */
+  bool use_frame_parallel_decoding(const image_unit* imgunit) const;
+
+  /* Get the next slice segment that can be started and the index of its image unit.
+     Returns NULL if nothing can be started before the first image unit is finished. */
+  slice_unit* get_next_slice_unit_to_decode(size_t* out_unitIdx) const;
+
+  /* Block until all tasks of the pictures in decoding are finished. */
+  void wait_for_background_tasks();
 };
 
 
@@ -26,11 +26,19 @@
 
 #define DPB_DEFAULT_MAX_IMAGES  30
 
+/* Hard limit for the DPB size, including the slots for generated unavailable reference
+   pictures. The image list is allocated once with this size so that worker threads of
+   pictures decoded in the background can access the reference images while new images
+   are added. */
+#define DPB_MAX_IMAGES  (DPB_DEFAULT_MAX_IMAGES + 2*MAX_NUM_REF_PICS)
+
 
 decoded_picture_buffer::decoded_picture_buffer()
 {
   max_images_in_DPB  = DPB_DEFAULT_MAX_IMAGES;
   norm_images_in_DPB = DPB_DEFAULT_MAX_IMAGES;
+
+  dpb.reserve(DPB_MAX_IMAGES);
 }
 
 
@@ -237,7 +245,8 @@ int decoded_picture_buffer::new_image(std::shared_ptr<const seq_parameter_set> s
 
   // create a new image slot if no empty slot remaining
 
-  if (free_image_buffer_idx == -DE265_ERROR_IMAGE_BUFFER_FULL) {
+  if (free_image_buffer_idx == -DE265_ERROR_IMAGE_BUFFER_FULL &&
+      dpb.size() < DPB_MAX_IMAGES) {
     free_image_buffer_idx = dpb.size();
     dpb.push_back(new de265_image);
   }
@@ -90,6 +90,33 @@ void transform_skip_residual_fallback(int32_t *residual, const int16_t *coeffs,
 }
 
 
+/* The (qP/6) left shift is merged into the final right shift. Since m*levelScale
+   is at most 255*72, the product with the coefficient always fits into 32 bit,
+   so no 64 bit arithmetic is needed, even with scaling lists. When the shift
+   turns into a left shift, the value is clipped first to avoid an overflow. */
+void scale_coefficients_fallback(int16_t *coeff, int nT, int width, int height,
+                                 const uint8_t* scalingFactor, int levelScale, int qPper, int bdShift)
+{
+  const int shift = bdShift - qPper;
+
+  for (int y=0;y<height;y++)
+    for (int x=0;x<width;x++) {
+      int m = (scalingFactor ? scalingFactor[x+y*nT] : 16);
+
+      int32_t c = coeff[x+y*nT] * m * levelScale;
+
+      if (shift>0) {
+        c = (c + (1<<(shift-1))) >> shift;
+      }
+      else {
+        c = Clip3(-32768,32767, c) << -shift;
+      }
+
+      coeff[x+y*nT] = Clip3(-32768,32767, c);
+    }
+}
+
+
 void transform_skip_rdpcm_v_8_fallback(uint8_t *dst, const int16_t *coeffs, int log2nT, ptrdiff_t stride)
 {
   int bitDepth = 8;
@@ -213,6 +240,23 @@ void rdpcm_h_fallback(int32_t* residual, const int16_t* coeffs, int nT,int tsShi
 }
 
 
+void cross_comp_pred_fallback(int32_t *residual, const int32_t *residual_luma, int nT,
+                              int ResScaleVal, int BitDepthY, int BitDepthC)
+{
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x++) {
+      /* TODO: the most usual case is definitely BitDepthY == BitDepthC, in which case
+         we could just omit two shifts. The second most common case is probably
+         BitDepthY>BitDepthC, for which we could also eliminate one shift. The remaining
+         case is also one shift only.
+      */
+
+      residual[y*nT+x] += (ResScaleVal *
+                           ((residual_luma[y*nT+x] << BitDepthC ) >> BitDepthY ) ) >> 3;
+    }
+}
+
+
 void transform_bypass_fallback(int32_t *dst, const int16_t *coeffs, int nT)
 {
   for (int y=0;y<nT;y++)
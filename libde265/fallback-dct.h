@@ -79,6 +79,12 @@ void rdpcm_h_fallback(int32_t* residual, const int16_t* coeffs, int nT, int tsSh
 void transform_skip_residual_fallback(int32_t *residual, const int16_t *coeffs, int nT,
                                       int tsShift,int bdShift);
 
+void cross_comp_pred_fallback(int32_t *residual, const int32_t *residual_luma, int nT,
+                              int ResScaleVal, int BitDepthY, int BitDepthC);
+
+void scale_coefficients_fallback(int16_t *coeff, int nT, int width, int height,
+                                 const uint8_t* scalingFactor, int levelScale, int qPper, int bdShift);
+
 
 // --- encoding ---
 
@@ -0,0 +1,202 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fallback-deblock.h"
+#include "util.h"
+
+
+// 8.7.2.4.3 / 8.7.2.4.4
+// 'xstride' steps across the edge, 'ystride' along the edge.
+
+template <class pixel_t>
+static void deblock_luma_fallback(pixel_t* ptr, ptrdiff_t xstride, ptrdiff_t ystride,
+                                  int beta, int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  pixel_t q[4][4], p[4][4];
+  for (int k=0;k<4;k++)
+    for (int i=0;i<4;i++)
+      {
+        q[k][i] = ptr[ i   *xstride + k*ystride];
+        p[k][i] = ptr[-(i+1)*xstride + k*ystride];
+      }
+
+  int dE=0, dEp=0, dEq=0;
+
+  int dp0 = abs_value(p[0][2] - 2*p[0][1] + p[0][0]);
+  int dp3 = abs_value(p[3][2] - 2*p[3][1] + p[3][0]);
+  int dq0 = abs_value(q[0][2] - 2*q[0][1] + q[0][0]);
+  int dq3 = abs_value(q[3][2] - 2*q[3][1] + q[3][0]);
+
+  int dpq0 = dp0 + dq0;
+  int dpq3 = dp3 + dq3;
+
+  int dp = dp0 + dp3;
+  int dq = dq0 + dq3;
+  int d  = dpq0+ dpq3;
+
+  if (d<beta) {
+    bool dSam0 = (2*dpq0 < (beta>>2) &&
+                  abs_value(p[0][3]-p[0][0])+abs_value(q[0][0]-q[0][3]) < (beta>>3) &&
+                  abs_value(p[0][0]-q[0][0]) < ((5*tc+1)>>1));
+
+    bool dSam3 = (2*dpq3 < (beta>>2) &&
+                  abs_value(p[3][3]-p[3][0])+abs_value(q[3][0]-q[3][3]) < (beta>>3) &&
+                  abs_value(p[3][0]-q[3][0]) < ((5*tc+1)>>1));
+
+    if (dSam0 && dSam3) {
+      dE=2;
+    }
+    else {
+      dE=1;
+    }
+
+    if (dp < ((beta + (beta>>1))>>3)) { dEp=1; }
+    if (dq < ((beta + (beta>>1))>>3)) { dEq=1; }
+  }
+
+  if (dE==0) {
+    return;
+  }
+
+  for (int k=0;k<4;k++) {
+    pixel_t* line = ptr + k*ystride;
+
+    const pixel_t p0 = p[k][0];
+    const pixel_t p1 = p[k][1];
+    const pixel_t p2 = p[k][2];
+    const pixel_t p3 = p[k][3];
+    const pixel_t q0 = q[k][0];
+    const pixel_t q1 = q[k][1];
+    const pixel_t q2 = q[k][2];
+    const pixel_t q3 = q[k][3];
+
+    if (dE==2) {
+      // strong filtering
+
+      pixel_t pnew[3],qnew[3];
+      pnew[0] = Clip3(p0-2*tc,p0+2*tc, (p2 + 2*p1 + 2*p0 + 2*q0 + q1 +4)>>3);
+      pnew[1] = Clip3(p1-2*tc,p1+2*tc, (p2 + p1 + p0 + q0+2)>>2);
+      pnew[2] = Clip3(p2-2*tc,p2+2*tc, (2*p3 + 3*p2 + p1 + p0 + q0 + 4)>>3);
+      qnew[0] = Clip3(q0-2*tc,q0+2*tc, (p1+2*p0+2*q0+2*q1+q2+4)>>3);
+      qnew[1] = Clip3(q1-2*tc,q1+2*tc, (p0+q0+q1+q2+2)>>2);
+      qnew[2] = Clip3(q2-2*tc,q2+2*tc, (p0+q0+q1+3*q2+2*q3+4)>>3);
+
+      for (int i=0;i<3;i++) {
+        if (filterP) { line[-(i+1)*xstride] = pnew[i]; }
+        if (filterQ) { line[   i  *xstride] = qnew[i]; }
+      }
+    }
+    else {
+      // weak filtering
+
+      int delta = (9*(q0-p0) - 3*(q1-p1) + 8)>>4;
+
+      if (abs_value(delta) < tc*10) {
+
+        delta = Clip3(-tc,tc,delta);
+
+        if (filterP) { line[-xstride] = Clip_BitDepth(p0+delta, bitDepth); }
+        if (filterQ) { line[ 0      ] = Clip_BitDepth(q0-delta, bitDepth); }
+
+        if (dEp==1 && filterP) {
+          int delta_p = Clip3(-(tc>>1), tc>>1, (((p2+p0+1)>>1)-p1+delta)>>1);
+          line[-2*xstride] = Clip_BitDepth(p1+delta_p, bitDepth);
+        }
+
+        if (dEq==1 && filterQ) {
+          int delta_q = Clip3(-(tc>>1), tc>>1, (((q2+q0+1)>>1)-q1-delta)>>1);
+          line[ xstride] = Clip_BitDepth(q1+delta_q, bitDepth);
+        }
+      }
+    }
+  }
+}
+
+
+// 8.7.2.4.5
+
+template <class pixel_t>
+static void deblock_chroma_fallback(pixel_t* ptr, ptrdiff_t xstride, ptrdiff_t ystride,
+                                    int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  for (int k=0;k<4;k++) {
+    pixel_t* line = ptr + k*ystride;
+
+    int p0 = line[-xstride];
+    int p1 = line[-2*xstride];
+    int q0 = line[0];
+    int q1 = line[xstride];
+
+    int delta = Clip3(-tc,tc, ((((q0-p0)*4)+p1-q1+4)>>3)); // standard says <<2 in eq. (8-356), but the value can also be negative
+    if (filterP) { line[-xstride] = Clip_BitDepth(p0+delta, bitDepth); }
+    if (filterQ) { line[ 0      ] = Clip_BitDepth(q0-delta, bitDepth); }
+  }
+}
+
+
+void deblock_luma_v_8_fallback(uint8_t *ptr, ptrdiff_t stride, int beta, int tc,
+                               bool filterP, bool filterQ)
+{
+  deblock_luma_fallback<uint8_t>(ptr, 1, stride, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_luma_h_8_fallback(uint8_t *ptr, ptrdiff_t stride, int beta, int tc,
+                               bool filterP, bool filterQ)
+{
+  deblock_luma_fallback<uint8_t>(ptr, stride, 1, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_chroma_v_8_fallback(uint8_t *ptr, ptrdiff_t stride, int tc,
+                                 bool filterP, bool filterQ)
+{
+  deblock_chroma_fallback<uint8_t>(ptr, 1, stride, tc, filterP, filterQ, 8);
+}
+
+void deblock_chroma_h_8_fallback(uint8_t *ptr, ptrdiff_t stride, int tc,
+                                 bool filterP, bool filterQ)
+{
+  deblock_chroma_fallback<uint8_t>(ptr, stride, 1, tc, filterP, filterQ, 8);
+}
+
+
+void deblock_luma_v_16_fallback(uint16_t *ptr, ptrdiff_t stride, int beta, int tc,
+                                bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_luma_fallback<uint16_t>(ptr, 1, stride, beta, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_luma_h_16_fallback(uint16_t *ptr, ptrdiff_t stride, int beta, int tc,
+                                bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_luma_fallback<uint16_t>(ptr, stride, 1, beta, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_chroma_v_16_fallback(uint16_t *ptr, ptrdiff_t stride, int tc,
+                                  bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_fallback<uint16_t>(ptr, 1, stride, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_chroma_h_16_fallback(uint16_t *ptr, ptrdiff_t stride, int tc,
+                                  bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_fallback<uint16_t>(ptr, stride, 1, tc, filterP, filterQ, bit_depth);
+}
@@ -0,0 +1,71 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fallback-intrapred.h"
+#include "intrapred.h"
+
+
+void intra_filter_border_8_fallback(uint8_t *border, int nT, bool strong)
+{
+  intra_prediction_filter_border<uint8_t>(border, nT, strong);
+}
+
+void intra_pred_planar_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT)
+{
+  intra_prediction_planar<uint8_t>(dst, dststride, nT, 0, (uint8_t*)border);
+}
+
+void intra_pred_dc_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx)
+{
+  intra_prediction_DC<uint8_t>(dst, dststride, nT, cIdx, (uint8_t*)border);
+}
+
+void intra_pred_angular_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx,
+                                   int intraPredMode, bool disableIntraBoundaryFilter)
+{
+  intra_prediction_angular<uint8_t>(dst, dststride, 8, disableIntraBoundaryFilter, 0,0,
+                                    (enum IntraPredMode)intraPredMode, nT, cIdx, (uint8_t*)border);
+}
+
+
+void intra_filter_border_16_fallback(uint16_t *border, int nT, bool strong, int bit_depth)
+{
+  intra_prediction_filter_border<uint16_t>(border, nT, strong);
+}
+
+void intra_pred_planar_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT,
+                                   int bit_depth)
+{
+  intra_prediction_planar<uint16_t>(dst, dststride, nT, 0, (uint16_t*)border);
+}
+
+void intra_pred_dc_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                               int bit_depth)
+{
+  intra_prediction_DC<uint16_t>(dst, dststride, nT, cIdx, (uint16_t*)border);
+}
+
+void intra_pred_angular_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                                    int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth)
+{
+  intra_prediction_angular<uint16_t>(dst, dststride, bit_depth, disableIntraBoundaryFilter, 0,0,
+                                     (enum IntraPredMode)intraPredMode, nT, cIdx, (uint16_t*)border);
+}
@@ -0,0 +1,32 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FALLBACK_NAL_H
+#define FALLBACK_NAL_H
+
+#include <stdint.h>
+
+
+// Returns the position of the first pair of zero bytes (data[p]==data[p+1]==0) in
+// data[0..len-1], or len-1 if there is none. 'len' has to be at least 1.
+
+int find_zero_byte_pair_fallback(const uint8_t* data, int len);
+
+#endif
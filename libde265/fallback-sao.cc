@@ -0,0 +1,101 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fallback-sao.h"
+#include "util.h"
+
+
+template <class pixel_t>
+static void sao_band_fallback(pixel_t *dst, ptrdiff_t dststride, const pixel_t *src, ptrdiff_t srcstride,
+                              int width, int height, int bandPosition, const int8_t offsets[4],
+                              int bitDepth)
+{
+  const int bandShift = bitDepth-5;
+  const int maxPixelValue = (1<<bitDepth)-1;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      // the input may exceed the valid range after decoding errors, limit it for the band index
+      int pixel = Clip3(0,maxPixelValue, src[x]);
+
+      int k = ((pixel>>bandShift) - bandPosition) & 31;
+      if (k<4) {
+        dst[x] = Clip3(0,maxPixelValue, src[x] + offsets[k]);
+      }
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+template <class pixel_t>
+static void sao_edge_fallback(pixel_t *dst, ptrdiff_t dststride, const pixel_t *src, ptrdiff_t srcstride,
+                              int width, int height, int eoClass, const int8_t offsets[5],
+                              int bitDepth)
+{
+  const int maxPixelValue = (1<<bitDepth)-1;
+
+  ptrdiff_t pos0,pos1;
+  switch (eoClass) {
+  default:
+  case 0: pos0 = -1;           pos1 =  1;           break;
+  case 1: pos0 = -srcstride;   pos1 =  srcstride;   break;
+  case 2: pos0 = -srcstride-1; pos1 =  srcstride+1; break;
+  case 3: pos0 = -srcstride+1; pos1 =  srcstride-1; break;
+  }
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      int edgeIdx = Sign(src[x] - src[x+pos0]) + Sign(src[x] - src[x+pos1]);
+      dst[x] = Clip3(0,maxPixelValue, src[x] + offsets[edgeIdx+2]);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void sao_band_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height, int bandPosition, const int8_t offsets[4])
+{
+  sao_band_fallback<uint8_t>(dst,dststride,src,srcstride,width,height,bandPosition,offsets, 8);
+}
+
+void sao_edge_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height, int eoClass, const int8_t offsets[5])
+{
+  sao_edge_fallback<uint8_t>(dst,dststride,src,srcstride,width,height,eoClass,offsets, 8);
+}
+
+void sao_band_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth)
+{
+  sao_band_fallback<uint16_t>(dst,dststride,src,srcstride,width,height,bandPosition,offsets, bit_depth);
+}
+
+void sao_edge_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int eoClass, const int8_t offsets[5], int bit_depth)
+{
+  sao_edge_fallback<uint16_t>(dst,dststride,src,srcstride,width,height,eoClass,offsets, bit_depth);
+}
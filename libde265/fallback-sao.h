@@ -0,0 +1,44 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FALLBACK_SAO_H
+#define FALLBACK_SAO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Band offset: samples in the four bands starting at 'bandPosition' get offsets[0..3] added.
+// Edge offset: 'offsets' is indexed with the sum of the two neighbor signs plus 2 (offsets[2] is 0).
+// All neighbors of the edge offset block have to be available.
+// 'dst' has to contain a copy of 'src', unmodified samples need not be written.
+
+void sao_band_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height, int bandPosition, const int8_t offsets[4]);
+void sao_edge_8_fallback(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height, int eoClass, const int8_t offsets[5]);
+
+void sao_band_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth);
+void sao_edge_16_fallback(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int eoClass, const int8_t offsets[5], int bit_depth);
+
+#endif
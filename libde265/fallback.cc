@@ -21,6 +21,10 @@
 #include "fallback.h"
 #include "fallback-motion.h"
 #include "fallback-dct.h"
+#include "fallback-deblock.h"
+#include "fallback-intrapred.h"
+#include "fallback-sao.h"
+#include "fallback-nal.h"
 
 
 void init_acceleration_functions_fallback(struct acceleration_functions* accel)
@@ -107,6 +111,8 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->rdpcm_h = rdpcm_h_fallback;
   accel->rdpcm_v = rdpcm_v_fallback;
   accel->transform_skip_residual = transform_skip_residual_fallback;
+  accel->cross_comp_pred = cross_comp_pred_fallback;
+  accel->scale_coefficients = scale_coefficients_fallback;
 
   accel->transform_idst_4x4   = transform_idst_4x4_fallback;
   accel->transform_idct_4x4   = transform_idct_4x4_fallback;
@@ -124,4 +130,31 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->hadamard_transform_8[1] = hadamard_8x8_8_fallback;
   accel->hadamard_transform_8[2] = hadamard_16x16_8_fallback;
   accel->hadamard_transform_8[3] = hadamard_32x32_8_fallback;
+
+  accel->deblock_luma_v_8   = deblock_luma_v_8_fallback;
+  accel->deblock_luma_h_8   = deblock_luma_h_8_fallback;
+  accel->deblock_chroma_v_8 = deblock_chroma_v_8_fallback;
+  accel->deblock_chroma_h_8 = deblock_chroma_h_8_fallback;
+
+  accel->deblock_luma_v_16   = deblock_luma_v_16_fallback;
+  accel->deblock_luma_h_16   = deblock_luma_h_16_fallback;
+  accel->deblock_chroma_v_16 = deblock_chroma_v_16_fallback;
+  accel->deblock_chroma_h_16 = deblock_chroma_h_16_fallback;
+
+  accel->sao_band_8  = sao_band_8_fallback;
+  accel->sao_edge_8  = sao_edge_8_fallback;
+  accel->sao_band_16 = sao_band_16_fallback;
+  accel->sao_edge_16 = sao_edge_16_fallback;
+
+  accel->intra_filter_border_8 = intra_filter_border_8_fallback;
+  accel->intra_pred_planar_8   = intra_pred_planar_8_fallback;
+  accel->intra_pred_dc_8       = intra_pred_dc_8_fallback;
+  accel->intra_pred_angular_8  = intra_pred_angular_8_fallback;
+
+  accel->intra_filter_border_16 = intra_filter_border_16_fallback;
+  accel->intra_pred_planar_16   = intra_pred_planar_16_fallback;
+  accel->intra_pred_dc_16       = intra_pred_dc_16_fallback;
+  accel->intra_pred_angular_16  = intra_pred_angular_16_fallback;
+
+  accel->find_zero_byte_pair = find_zero_byte_pair_fallback;
 }
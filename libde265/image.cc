@@ -105,40 +105,94 @@ LIBDE265_API void de265_free_image_plane(struct de265_image* img, int cIdx)
 }
 
 
+static uint8_t* alloc_image_plane(size_t size, int numa_node)
+{
+  if (numa_node < 0) {
+    return (uint8_t *)ALLOC_ALIGNED_16(size);
+  }
+
+  size_t pageSize = de265_memory_page_size();
+  size = (size + pageSize-1) / pageSize * pageSize;
+
+  uint8_t* p = (uint8_t *)ALLOC_ALIGNED(pageSize, size);
+  if (p) {
+    de265_bind_memory_to_numa_node(p, size, numa_node);
+  }
+
+  return p;
+}
+
+
 static int  de265_image_get_buffer(de265_decoder_context* ctx,
                                    de265_image_spec* spec, de265_image* img, void* userdata)
 {
   const int rawChromaWidth  = spec->width  / img->SubWidthC;
   const int rawChromaHeight = spec->height / img->SubHeightC;
 
+  // Pictures of the decoder get a border for motion compensation. The horizontal
+  // border is a multiple of the alignment, such that the plane origin stays aligned.
+
+  int luma_border_x = 0, luma_border_y = 0;
+  int chroma_border_x = 0, chroma_border_y = 0;
+
+  if (ctx) {
+    luma_border_x   = (IMAGE_BORDER + spec->alignment-1) / spec->alignment * spec->alignment;
+    luma_border_y   = IMAGE_BORDER;
+    chroma_border_x = (IMAGE_BORDER/img->SubWidthC + spec->alignment-1) / spec->alignment * spec->alignment;
+    chroma_border_y = IMAGE_BORDER/img->SubHeightC;
+  }
+
   int luma_stride   = (spec->width    + spec->alignment-1) / spec->alignment * spec->alignment;
   int chroma_stride = (rawChromaWidth + spec->alignment-1) / spec->alignment * spec->alignment;
 
+  luma_stride   += 2*luma_border_x;
+  chroma_stride += 2*chroma_border_x;
+
   assert(img->BitDepth_Y >= 8 && img->BitDepth_Y <= 16);
   assert(img->BitDepth_C >= 8 && img->BitDepth_C <= 16);
 
-  int luma_bpl   = luma_stride   * ((img->BitDepth_Y+7)/8);
-  int chroma_bpl = chroma_stride * ((img->BitDepth_C+7)/8);
+  int luma_bpp   = (img->BitDepth_Y+7)/8;
+  int chroma_bpp = (img->BitDepth_C+7)/8;
 
-  int luma_height   = spec->height;
-  int chroma_height = rawChromaHeight;
+  int luma_bpl   = luma_stride   * luma_bpp;
+  int chroma_bpl = chroma_stride * chroma_bpp;
+
+  int luma_height   = spec->height   + 2*luma_border_y;
+  int chroma_height = rawChromaHeight + 2*chroma_border_y;
 
   bool alloc_failed = false;
 
-  uint8_t* p[3] = { 0,0,0 };
-  p[0] = (uint8_t *)ALLOC_ALIGNED_16(luma_height   * luma_bpl   + MEMORY_PADDING);
-  if (p[0]==NULL) { alloc_failed=true; }
+  // When the worker threads are pinned to a NUMA node, place the planes on that node.
+  // The planes are then page-aligned so that they can be bound independently.
+
+  decoder_context* decctx = (decoder_context*)ctx;
+  int numa_node = (decctx ? decctx->get_numa_node() : -1);
 
-  if (img->get_chroma_format() != de265_chroma_mono) {
-    p[1] = (uint8_t *)ALLOC_ALIGNED_16(chroma_height * chroma_bpl + MEMORY_PADDING);
-    p[2] = (uint8_t *)ALLOC_ALIGNED_16(chroma_height * chroma_bpl + MEMORY_PADDING);
+  bool mono = (img->get_chroma_format() == de265_chroma_mono);
 
-    if (p[1]==NULL || p[2]==NULL) { alloc_failed=true; }
+  size_t size[3];
+  size[0] = luma_height * luma_bpl + MEMORY_PADDING;
+  size[1] = size[2] = (mono ? 0 : chroma_height * chroma_bpl + MEMORY_PADDING);
+
+  if (mono) {
+    chroma_stride = 0;
+  }
+
+  uint8_t* p[3] = { 0,0,0 };
+
+  if (decctx && decctx->image_pool.get(size, numa_node, p)) {
+    // reuse the memory of a released picture
   }
   else {
-    p[1] = NULL;
-    p[2] = NULL;
-    chroma_stride = 0;
+    p[0] = alloc_image_plane(size[0], numa_node);
+    if (p[0]==NULL) { alloc_failed=true; }
+
+    if (!mono) {
+      p[1] = alloc_image_plane(size[1], numa_node);
+      p[2] = alloc_image_plane(size[2], numa_node);
+
+      if (p[1]==NULL || p[2]==NULL) { alloc_failed=true; }
+    }
   }
 
   if (alloc_failed) {
@@ -150,9 +204,20 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
     return 0;
   }
 
-  img->set_image_plane(0, p[0], luma_stride, NULL);
-  img->set_image_plane(1, p[1], chroma_stride, NULL);
-  img->set_image_plane(2, p[2], chroma_stride, NULL);
+  img->set_image_plane(0, p[0] + luma_border_y*luma_bpl + luma_border_x*luma_bpp,
+                       luma_stride, NULL);
+  img->set_image_plane_border(0, luma_border_x, luma_border_y);
+
+  for (int c=1;c<=2;c++) {
+    if (p[c]) {
+      img->set_image_plane(c, p[c] + chroma_border_y*chroma_bpl + chroma_border_x*chroma_bpp,
+                           chroma_stride, NULL);
+      img->set_image_plane_border(c, chroma_border_x, chroma_border_y);
+    }
+    else {
+      img->set_image_plane(c, NULL, chroma_stride, NULL);
+    }
+  }
 
   img->fill_image(0,0,0);
 
@@ -162,15 +227,138 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
 static void de265_image_release_buffer(de265_decoder_context* ctx,
                                        de265_image* img, void* userdata)
 {
+  // same plane sizes as in de265_image_get_buffer()
+
+  uint8_t* p[3];
+  size_t size[3];
+
   for (int i=0;i<3;i++) {
-    uint8_t* p = (uint8_t*)img->get_image_plane(i);
-    if (p) {
-      FREE_ALIGNED(p);
+    p[i] = (uint8_t*)img->get_image_plane(i);
+    size[i] = 0;
+
+    if (p[i]) {
+      int bpp = ((i==0 ? img->BitDepth_Y : img->BitDepth_C)+7)/8;
+      int height = img->get_height(0) / (i==0 ? 1 : img->SubHeightC) + 2*img->get_border_y(i);
+
+      p[i] -= (img->get_border_y(i) * img->get_image_stride(i) + img->get_border_x(i)) * bpp;
+      size[i] = height * img->get_image_stride(i) * bpp + MEMORY_PADDING;
+    }
+  }
+
+  decoder_context* decctx = (decoder_context*)ctx;
+
+  if (decctx && decctx->image_pool.put(size, decctx->get_numa_node(), p)) {
+    return;
+  }
+
+  for (int i=0;i<3;i++) {
+    if (p[i]) {
+      FREE_ALIGNED(p[i]);
     }
   }
 }
 
 
+// --- image_buffer_pool ---
+
+// Enough for the pictures of a few image units decoded in parallel and their SAO buffers.
+#define IMAGE_BUFFER_POOL_SIZE 8
+
+image_buffer_pool::image_buffer_pool()
+{
+  de265_mutex_init(&mutex);
+}
+
+
+image_buffer_pool::~image_buffer_pool()
+{
+  free_all();
+  de265_mutex_destroy(&mutex);
+}
+
+
+void image_buffer_pool::free_buffer(buffer& b)
+{
+  for (int i=0;i<3;i++) {
+    if (b.planes[i]) {
+      FREE_ALIGNED(b.planes[i]);
+    }
+  }
+}
+
+
+bool image_buffer_pool::get(const size_t size[3], int numa_node, uint8_t* planes[3])
+{
+  de265_mutex_lock(&mutex);
+
+  bool found = false;
+
+  for (size_t i=0;i<free_buffers.size();i++) {
+    buffer& b = free_buffers[i];
+
+    if (b.numa_node == numa_node &&
+        memcmp(b.size, size, sizeof(b.size))==0) {
+      for (int c=0;c<3;c++) { planes[c] = b.planes[c]; }
+
+      free_buffers[i] = free_buffers.back();
+      free_buffers.pop_back();
+      found = true;
+      break;
+    }
+  }
+
+  // The stream switched to another picture format. The remaining buffers will not be used anymore.
+
+  if (!found) {
+    for (size_t i=0;i<free_buffers.size();i++) {
+      free_buffer(free_buffers[i]);
+    }
+    free_buffers.clear();
+  }
+
+  de265_mutex_unlock(&mutex);
+
+  return found;
+}
+
+
+bool image_buffer_pool::put(const size_t size[3], int numa_node, uint8_t* const planes[3])
+{
+  de265_mutex_lock(&mutex);
+
+  bool stored = false;
+
+  if (free_buffers.size() < IMAGE_BUFFER_POOL_SIZE) {
+    buffer b;
+    for (int c=0;c<3;c++) {
+      b.size[c]   = size[c];
+      b.planes[c] = planes[c];
+    }
+    b.numa_node = numa_node;
+
+    free_buffers.push_back(b);
+    stored = true;
+  }
+
+  de265_mutex_unlock(&mutex);
+
+  return stored;
+}
+
+
+void image_buffer_pool::free_all()
+{
+  de265_mutex_lock(&mutex);
+
+  for (size_t i=0;i<free_buffers.size();i++) {
+    free_buffer(free_buffers[i]);
+  }
+  free_buffers.clear();
+
+  de265_mutex_unlock(&mutex);
+}
+
+
 de265_image_allocation de265_image::default_image_allocation = {
   de265_image_get_buffer,
   de265_image_release_buffer
@@ -181,13 +369,22 @@ void de265_image::set_image_plane(int cIdx, uint8_t* mem, int stride, void *user
 {
   pixels[cIdx] = mem;
   plane_user_data[cIdx] = userdata;
+  border_x[cIdx] = 0;
+  border_y[cIdx] = 0;
 
   if (cIdx==0) { this->stride        = stride; }
   else         { this->chroma_stride = stride; }
 }
 
 
-uint32_t de265_image::s_next_image_ID = 0;
+void de265_image::set_image_plane_border(int cIdx, int bx, int by)
+{
+  border_x[cIdx] = bx;
+  border_y[cIdx] = by;
+}
+
+
+std::atomic<uint32_t> de265_image::s_next_image_ID(0);
 
 de265_image::de265_image()
 {
@@ -206,6 +403,7 @@ de265_image::de265_image()
     pixels[c] = NULL;
     pixels_confwin[c] = NULL;
     plane_user_data[c] = NULL;
+    border_x[c] = border_y[c] = 0;
   }
 
   width=height=0;
@@ -466,6 +664,11 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
         ctb_progress = new de265_progress_lock[ ctb_info.data_size ];
       }
 
+    /* There cannot be more slice segments than CTBs. Reserving the space in advance
+       ensures that the slice header list is not reallocated while worker threads
+       of a picture decoded in the background access it. */
+    slices.reserve(ctb_info.data_size);
+
 
     // check for memory shortage
 
@@ -516,6 +719,7 @@ void de265_image::release()
         {
           pixels[i] = NULL;
           pixels_confwin[i] = NULL;
+          border_x[i] = border_y[i] = 0;
         }
     }
 
@@ -668,12 +872,77 @@ void de265_image::copy_lines_from(const de265_image* src, int first, int end)
 }
 
 
+template <class pixel_t>
+static void pad_plane_lines(pixel_t* plane, int stride, int width, int height,
+                            int border_x, int border_y, int first, int end)
+{
+  // replicate the left and right edge samples
+
+  for (int y=first;y<end;y++) {
+    pixel_t* line = plane + y*stride;
+    pixel_t left  = line[0];
+    pixel_t right = line[width-1];
+
+    for (int x=-border_x;x<0;x++)              { line[x] = left;  }
+    for (int x=width;x<stride-border_x;x++)    { line[x] = right; }
+  }
+
+  // replicate the padded first and last line into the top and bottom border
+
+  if (first==0) {
+    for (int y=1;y<=border_y;y++) {
+      memcpy(plane - y*stride - border_x, plane - border_x, stride*sizeof(pixel_t));
+    }
+  }
+
+  if (end==height) {
+    const pixel_t* last = plane + (height-1)*stride - border_x;
+
+    for (int y=0;y<border_y;y++) {
+      memcpy(plane + (height+y)*stride - border_x, last, stride*sizeof(pixel_t));
+    }
+  }
+}
+
+
+// first, end: luma lines (end = last line + 1)
+void de265_image::pad_border_lines(int first, int end)
+{
+  if (!has_border()) {
+    return;
+  }
+
+  if (end > height) end=height;
+
+  int nPlanes = (chroma_format == de265_chroma_mono ? 1 : 3);
+
+  for (int c=0;c<nPlanes;c++) {
+    int f = first, e = end;
+    if (c>0) {
+      f /= SubHeightC;
+      e = (e==height ? chroma_height : e/SubHeightC);
+    }
+
+    if (get_bytes_per_pixel(c)==1) {
+      pad_plane_lines(pixels[c], get_image_stride(c), get_width(c), get_height(c),
+                      border_x[c], border_y[c], f, e);
+    }
+    else {
+      pad_plane_lines((uint16_t*)pixels[c], get_image_stride(c), get_width(c), get_height(c),
+                      border_x[c], border_y[c], f, e);
+    }
+  }
+}
+
+
 void de265_image::exchange_pixel_data_with(de265_image& b)
 {
   for (int i=0;i<3;i++) {
     std::swap(pixels[i], b.pixels[i]);
     std::swap(pixels_confwin[i], b.pixels_confwin[i]);
     std::swap(plane_user_data[i], b.plane_user_data[i]);
+    std::swap(border_x[i], b.border_x[i]);
+    std::swap(border_y[i], b.border_y[i]);
   }
 
   std::swap(stride, b.stride);
@@ -769,6 +1038,69 @@ void de265_image::wait_for_progress(thread_task* task, int ctbAddrRS, int progre
 }
 
 
+void de265_image::wait_for_CTB_row_progress(thread_task* task, int ctby, int progress)
+{
+  const int ctbW = sps->PicWidthInCtbsY;
+
+  for (int x=ctbW-1; x>=0; x--) {
+    wait_for_progress(task, x + ctbW*ctby, progress);
+  }
+}
+
+
+void de265_image::wait_for_reference_progress(thread_task* task, const de265_image* ref,
+                                              int firstCtbRow, int lastCtbRow, int progress)
+{
+  if (task==NULL) { return; }
+
+  const int ctbW = ref->sps->PicWidthInCtbsY;
+
+  if (firstCtbRow < 0) firstCtbRow = 0;
+  if (lastCtbRow >= ref->sps->PicHeightInCtbsY) lastCtbRow = ref->sps->PicHeightInCtbsY-1;
+
+  // The CTB rows are finished from top to bottom, hence we start checking at the bottom.
+
+  for (int y=lastCtbRow; y>=firstCtbRow; y--) {
+    de265_progress_lock* progresslock = &ref->ctb_progress[ctbW-1 + y*ctbW];
+
+    if (progresslock->get_progress() < progress) {
+      thread_blocks();
+      task->state = thread_task::Blocked;
+
+      progresslock->wait_for_progress(progress);
+
+      task->state = thread_task::Running;
+      thread_unblocks();
+    }
+  }
+}
+
+
+void de265_image::wait_for_reference_CTB_row_progress(thread_task* task, const de265_image* ref,
+                                                      int ctby, int progress)
+{
+  if (task==NULL) { return; }
+
+  const int ctbW = ref->sps->PicWidthInCtbsY;
+
+  if (ctby < 0 || ctby >= ref->sps->PicHeightInCtbsY) { return; }
+
+  for (int x=ctbW-1; x>=0; x--) {
+    de265_progress_lock* progresslock = &ref->ctb_progress[x + ctby*ctbW];
+
+    if (progresslock->get_progress() < progress) {
+      thread_blocks();
+      task->state = thread_task::Blocked;
+
+      progresslock->wait_for_progress(progress);
+
+      task->state = thread_task::Running;
+      thread_unblocks();
+    }
+  }
+}
+
+
 void de265_image::wait_for_completion()
 {
   de265_mutex_lock(&mutex);
@@ -778,6 +1110,15 @@ void de265_image::wait_for_completion()
   de265_mutex_unlock(&mutex);
 }
 
+bool de265_image::is_completed()
+{
+  de265_mutex_lock(&mutex);
+  bool completed = (nThreadsFinished==nThreadsTotal);
+  de265_mutex_unlock(&mutex);
+
+  return completed;
+}
+
 bool de265_image::debug_is_completed() const
 {
   return nThreadsFinished==nThreadsTotal;
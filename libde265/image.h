@@ -73,13 +73,54 @@ enum PictureState {
 
 
 #define CTB_PROGRESS_NONE      0
-#define CTB_PROGRESS_PREFILTER 1
-#define CTB_PROGRESS_DEBLK_V   2
-#define CTB_PROGRESS_DEBLK_H   3
-#define CTB_PROGRESS_SAO       4
+#define CTB_PROGRESS_PARSED    1  // only with pipelined reconstruction: syntax decoded, not reconstructed
+#define CTB_PROGRESS_PREFILTER 2
+#define CTB_PROGRESS_DEBLK_V   3
+#define CTB_PROGRESS_DEBLK_H   4
+#define CTB_PROGRESS_SAO       5
+
+/* Border around the luma plane of decoded pictures (in samples). It holds the
+   replicated edge samples, such that motion compensation can read a 64x64 block
+   plus the interpolation filter taps at any position without clipping.
+   The chroma borders are scaled by the chroma subsampling. */
+#define IMAGE_BORDER 80
 
 class decoder_context;
 
+
+/* Recycles the pixel memory of released pictures. The default image allocator
+   of the decoder takes its planes from here, such that steady-state decoding
+   does not allocate. The buffers are identified by their allocation size (and
+   NUMA node), which covers picture size, chroma format, bit depth and border.
+ */
+class image_buffer_pool
+{
+ public:
+  image_buffer_pool();
+  ~image_buffer_pool();
+
+  // Returns false if there is no free buffer with these plane sizes.
+  bool get(const size_t size[3], int numa_node, uint8_t* planes[3]);
+
+  // Takes ownership of the planes. Returns false if the pool is full.
+  bool put(const size_t size[3], int numa_node, uint8_t* const planes[3]);
+
+  void free_all();
+
+ private:
+  struct buffer {
+    size_t   size[3];
+    int      numa_node;
+    uint8_t* planes[3];
+  };
+
+  std::vector<buffer> free_buffers;
+  de265_mutex mutex;
+
+  static void free_buffer(buffer&);
+};
+
+
 template <class DataUnit> class MetaDataArray
 {
  public:
@@ -258,6 +299,18 @@ struct de265_image {
   const uint8_t* get_image_plane(int cIdx) const { return pixels[cIdx]; }
 
   void set_image_plane(int cIdx, uint8_t* mem, int stride, void *userdata);
+  void set_image_plane_border(int cIdx, int border_x, int border_y);
+
+  /* Size of the border around the plane that is filled by pad_border_lines()
+     (in samples). Zero if the plane was allocated without a border. */
+  int get_border_x(int cIdx) const { return border_x[cIdx]; }
+  int get_border_y(int cIdx) const { return border_y[cIdx]; }
+  bool has_border() const { return border_x[0] > 0; }
+
+  // Replicate the edge samples of the luma lines [first,end) (and the corresponding
+  // chroma lines) into the border. Also fills the top/bottom border at the picture edges.
+  void pad_border_lines(int first, int end);
+  void pad_border() { pad_border_lines(0, height); }
 
   uint8_t* get_image_plane_at_pos(int cIdx, int xpos,int ypos)
   {
@@ -346,7 +399,7 @@ struct de265_image {
 
 private:
   uint32_t ID;
-  static uint32_t s_next_image_ID;
+  static std::atomic<uint32_t> s_next_image_ID;  // decoders may run in different threads
 
   uint8_t* pixels[3];
   uint8_t  bpp_shift[3];  // 0 for 8 bit, 1 for 16 bit
@@ -357,6 +410,7 @@ private:
 
   int chroma_width, chroma_height;
   int stride, chroma_stride;
+  int border_x[3], border_y[3];
 
 public:
   uint8_t BitDepth_Y, BitDepth_C;
@@ -462,7 +516,24 @@ public:
   void wait_for_progress(thread_task* task, int ctbx,int ctby, int progress);
   void wait_for_progress(thread_task* task, int ctbAddrRS, int progress);
 
+  /* Block 'task' until all CTBs in row 'ctby' reached 'progress'. Needed when the
+     slices of the image are decoded concurrently and rows are not completed from left to right. */
+  void wait_for_CTB_row_progress(thread_task* task, int ctby, int progress);
+
+  /* Block 'task' (which works on this image) until the CTB rows firstCtbRow..lastCtbRow
+     of the reference image 'ref' reached 'progress'. Used when several images are
+     decoded in parallel. Rows outside of the image are ignored. */
+  void wait_for_reference_progress(thread_task* task, const de265_image* ref,
+                                   int firstCtbRow, int lastCtbRow, int progress);
+
+  /* Like wait_for_reference_progress(), but checks all CTBs of row 'ctby' of 'ref'.
+     This is needed for progress states that are not reached from left to right
+     (CTB_PROGRESS_PREFILTER when the slices of 'ref' are decoded concurrently). */
+  void wait_for_reference_CTB_row_progress(thread_task* task, const de265_image* ref,
+                                           int ctby, int progress);
+
   void wait_for_completion();  // block until image is decoded by background threads
+  bool is_completed();         // non-blocking check whether all background threads finished
   bool debug_is_completed() const;
   int  num_threads_active() const { return nThreadsRunning + nThreadsBlocked; } // for debug only
 
@@ -283,29 +283,35 @@ void decode_intra_prediction_internal(de265_image* img,
 
   fill_border_samples(img, xB0,yB0, nT, cIdx, border_pixels);
 
+  const acceleration_functions& accel = img->decctx->acceleration;
+  const int bit_depth = img->get_bit_depth(cIdx);
+
   if (img->get_sps().range_extension.intra_smoothing_disabled_flag == 0 &&
       (cIdx==0 || img->get_sps().ChromaArrayType==CHROMA_444))
     {
-      intra_prediction_sample_filtering(img->get_sps(), border_pixels, nT, cIdx, intraPredMode);
+      int filterType = intra_prediction_sample_filter_type(img->get_sps(), border_pixels,
+                                                           nT, cIdx, intraPredMode);
+      if (filterType) {
+        accel.intra_filter_border(border_pixels, nT, filterType==2, bit_depth);
+      }
     }
 
 
   switch (intraPredMode) {
   case INTRA_PLANAR:
-    intra_prediction_planar(dst,dstStride, nT,cIdx, border_pixels);
+    accel.intra_pred_planar(dst,dstStride, border_pixels, nT, bit_depth);
     break;
   case INTRA_DC:
-    intra_prediction_DC(dst,dstStride, nT,cIdx, border_pixels);
+    accel.intra_pred_dc(dst,dstStride, border_pixels, nT, cIdx, bit_depth);
     break;
   default:
     {
-      int bit_depth = img->get_bit_depth(cIdx);
       bool disableIntraBoundaryFilter =
         (img->get_sps().range_extension.implicit_rdpcm_enabled_flag &&
          img->get_cu_transquant_bypass(xB0,yB0));
 
-      intra_prediction_angular(dst,dstStride, bit_depth,disableIntraBoundaryFilter,
-                               xB0,yB0,intraPredMode,nT,cIdx, border_pixels);
+      accel.intra_pred_angular(dst,dstStride, border_pixels, nT, cIdx, intraPredMode,
+                               disableIntraBoundaryFilter, bit_depth);
     }
     break;
   }
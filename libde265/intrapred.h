@@ -182,11 +182,14 @@ void print_border(pixel_t* data, uint8_t* available, int nT)
 
 
 // (8.4.4.2.3)
+/* Decide how the reference samples are filtered before prediction.
+   Returns 0 (no filtering), 1 ([1 2 1] filter) or 2 (strong bi-linear interpolation).
+ */
 template <class pixel_t>
-void intra_prediction_sample_filtering(const seq_parameter_set& sps,
-                                       pixel_t* p,
-                                       int nT, int cIdx,
-                                       enum IntraPredMode intraPredMode)
+int intra_prediction_sample_filter_type(const seq_parameter_set& sps,
+                                        const pixel_t* p,
+                                        int nT, int cIdx,
+                                        enum IntraPredMode intraPredMode)
 {
   int filterFlag;
 
@@ -212,46 +215,64 @@ void intra_prediction_sample_filtering(const seq_parameter_set& sps,
     }
   }
 
+  if (!filterFlag) {
+    return 0;
+  }
 
-  if (filterFlag) {
-    int biIntFlag = (sps.strong_intra_smoothing_enable_flag &&
-                     cIdx==0 &&
-                     nT==32 &&
-                     abs_value(p[0]+p[ 64]-2*p[ 32]) < (1<<(sps.bit_depth_luma-5)) &&
-                     abs_value(p[0]+p[-64]-2*p[-32]) < (1<<(sps.bit_depth_luma-5)))
-      ? 1 : 0;
+  int biIntFlag = (sps.strong_intra_smoothing_enable_flag &&
+                   cIdx==0 &&
+                   nT==32 &&
+                   abs_value(p[0]+p[ 64]-2*p[ 32]) < (1<<(sps.bit_depth_luma-5)) &&
+                   abs_value(p[0]+p[-64]-2*p[-32]) < (1<<(sps.bit_depth_luma-5)))
+    ? 1 : 0;
 
-    pixel_t  pF_mem[4*32+1];
-    pixel_t* pF = &pF_mem[2*32];
+  return biIntFlag ? 2 : 1;
+}
 
-    if (biIntFlag) {
-      pF[-2*nT] = p[-2*nT];
-      pF[ 2*nT] = p[ 2*nT];
-      pF[    0] = p[    0];
 
-      for (int i=1;i<=63;i++) {
-        pF[-i] = p[0] + ((i*(p[-64]-p[0])+32)>>6);
-        pF[ i] = p[0] + ((i*(p[ 64]-p[0])+32)>>6);
-      }
-    } else {
-      pF[-2*nT] = p[-2*nT];
-      pF[ 2*nT] = p[ 2*nT];
+template <class pixel_t>
+void intra_prediction_filter_border(pixel_t* p, int nT, bool biIntFlag)
+{
+  pixel_t  pF_mem[4*32+1];
+  pixel_t* pF = &pF_mem[2*32];
 
-      for (int i=-(2*nT-1) ; i<=2*nT-1 ; i++)
-        {
-          pF[i] = (p[i+1] + 2*p[i] + p[i-1] + 2) >> 2;
-        }
+  if (biIntFlag) {
+    pF[-2*nT] = p[-2*nT];
+    pF[ 2*nT] = p[ 2*nT];
+    pF[    0] = p[    0];
+
+    for (int i=1;i<=63;i++) {
+      pF[-i] = p[0] + ((i*(p[-64]-p[0])+32)>>6);
+      pF[ i] = p[0] + ((i*(p[ 64]-p[0])+32)>>6);
     }
+  } else {
+    pF[-2*nT] = p[-2*nT];
+    pF[ 2*nT] = p[ 2*nT];
 
+    for (int i=-(2*nT-1) ; i<=2*nT-1 ; i++)
+      {
+        pF[i] = (p[i+1] + 2*p[i] + p[i-1] + 2) >> 2;
+      }
+  }
 
-    // copy back to original array
 
-    memcpy(p-2*nT, pF-2*nT, (4*nT+1) * sizeof(pixel_t));
-  }
-  else {
-    // do nothing ?
-  }
+  // copy back to original array
 
+  memcpy(p-2*nT, pF-2*nT, (4*nT+1) * sizeof(pixel_t));
+}
+
+
+template <class pixel_t>
+void intra_prediction_sample_filtering(const seq_parameter_set& sps,
+                                       pixel_t* p,
+                                       int nT, int cIdx,
+                                       enum IntraPredMode intraPredMode)
+{
+  int filterType = intra_prediction_sample_filter_type(sps, p, nT, cIdx, intraPredMode);
+
+  if (filterType) {
+    intra_prediction_filter_border(p, nT, filterType==2);
+  }
 
   logtrace(LogIntraPred,"post filtering: ");
   print_border(p,NULL,nT);
@@ -50,7 +50,7 @@ void mc_luma(const base_context* ctx,
              const seq_parameter_set* sps, int mv_x, int mv_y,
              int xP,int yP,
              int16_t* out, int out_stride,
-             const pixel_t* ref, int ref_stride,
+             const pixel_t* ref, int ref_stride, bool ref_has_border,
              int nPbW, int nPbH, int bitDepth_L)
 {
   int xFracL = mv_x & 3;
@@ -70,10 +70,20 @@ void mc_luma(const base_context* ctx,
 
   ALIGNED_16(int16_t) mcbuffer[MAX_CU_SIZE * (MAX_CU_SIZE+7)];
 
+  // In a reference picture with a padded border, all samples of a block that is further
+  // outside than its size plus the filter taps are replicated edge samples. Moving the
+  // block onto the border reads the same values, hence it can be read directly.
+
+  if (ref_has_border) {
+    xIntOffsL = Clip3(-(nPbW+4), w+3, xIntOffsL);
+    yIntOffsL = Clip3(-(nPbH+4), h+3, yIntOffsL);
+  }
+
   if (xFracL==0 && yFracL==0) {
 
-    if (xIntOffsL >= 0 && yIntOffsL >= 0 &&
-        nPbW+xIntOffsL <= w && nPbH+yIntOffsL <= h) {
+    if (ref_has_border ||
+        (xIntOffsL >= 0 && yIntOffsL >= 0 &&
+         nPbW+xIntOffsL <= w && nPbH+yIntOffsL <= h)) {
 
       ctx->acceleration.put_hevc_qpel(out, out_stride,
                                       &ref[yIntOffsL*ref_stride + xIntOffsL],
@@ -131,10 +141,11 @@ void mc_luma(const base_context* ctx,
     const pixel_t* src_ptr;
     int src_stride;
 
-    if (-extra_left + xIntOffsL >= 0 &&
-        -extra_top  + yIntOffsL >= 0 &&
-        nPbW+extra_right  + xIntOffsL < w &&
-        nPbH+extra_bottom + yIntOffsL < h) {
+    if (ref_has_border ||
+        (-extra_left + xIntOffsL >= 0 &&
+         -extra_top  + yIntOffsL >= 0 &&
+         nPbW+extra_right  + xIntOffsL < w &&
+         nPbH+extra_bottom + yIntOffsL < h)) {
       src_ptr = &ref[xIntOffsL + yIntOffsL*ref_stride];
       src_stride = ref_stride;
     }
@@ -176,7 +187,7 @@ void mc_chroma(const base_context* ctx,
                int mv_x, int mv_y,
                int xP,int yP,
                int16_t* out, int out_stride,
-               const pixel_t* ref, int ref_stride,
+               const pixel_t* ref, int ref_stride, bool ref_has_border,
                int nPbWC, int nPbHC, int bit_depth_C)
 {
   // chroma sample interpolation process (8.5.3.2.2.2)
@@ -199,9 +210,17 @@ void mc_chroma(const base_context* ctx,
 
   ALIGNED_32(int16_t mcbuffer[MAX_CU_SIZE*(MAX_CU_SIZE+7)]);
 
+  // see mc_luma()
+
+  if (ref_has_border) {
+    xIntOffsC = Clip3(-(nPbWC+2), wC+1, xIntOffsC);
+    yIntOffsC = Clip3(-(nPbHC+2), hC+1, yIntOffsC);
+  }
+
   if (xFracC == 0 && yFracC == 0) {
-    if (xIntOffsC>=0 && nPbWC+xIntOffsC<=wC &&
-        yIntOffsC>=0 && nPbHC+yIntOffsC<=hC) {
+    if (ref_has_border ||
+        (xIntOffsC>=0 && nPbWC+xIntOffsC<=wC &&
+         yIntOffsC>=0 && nPbHC+yIntOffsC<=hC)) {
       ctx->acceleration.put_hevc_epel(out, out_stride,
                                       &ref[xIntOffsC + yIntOffsC*ref_stride], ref_stride,
                                       nPbWC,nPbHC, 0,0, NULL, bit_depth_C);
@@ -229,8 +248,9 @@ void mc_chroma(const base_context* ctx,
     int extra_right  = 2;
     int extra_bottom = 2;
 
-    if (xIntOffsC>=1 && nPbWC+xIntOffsC<=wC-2 &&
-        yIntOffsC>=1 && nPbHC+yIntOffsC<=hC-2) {
+    if (ref_has_border ||
+        (xIntOffsC>=1 && nPbWC+xIntOffsC<=wC-2 &&
+         yIntOffsC>=1 && nPbHC+yIntOffsC<=hC-2)) {
       src_ptr = &ref[xIntOffsC + yIntOffsC*ref_stride];
       src_stride = ref_stride;
     }
@@ -281,7 +301,8 @@ void generate_inter_prediction_samples(base_context* ctx,
                                        int xC,int yC,
                                        int xB,int yB,
                                        int nCS, int nPbW,int nPbH,
-                                       const PBMotion* vi)
+                                       const PBMotion* vi,
+                                       thread_task* task)
 {
   int xP = xC+xB;
   int yP = yC+yB;
@@ -389,37 +410,53 @@ void generate_inter_prediction_samples(base_context* ctx,
                  l,vi->mv[l].x,vi->mv[l].y,refPic->PicOrderCntVal);
 
 
+        // If the reference picture is still being decoded in parallel, wait until the
+        // CTB rows covered by the motion vector (plus interpolation filter margin) are ready.
+        // The luma margin (3 above, 4 below) also covers the chroma filter taps.
+
+        if (task) {
+          const int yMax = sps->pic_height_in_luma_samples-1;
+          int yTop    = Clip3(0,yMax, yP + (vi->mv[l].y >> 2) - 3);
+          int yBottom = Clip3(0,yMax, yP + (vi->mv[l].y >> 2) + nPbH-1 + 4);
+
+          img->wait_for_reference_progress(task, refPic,
+                                           yTop    >> sps->Log2CtbSizeY,
+                                           yBottom >> sps->Log2CtbSizeY,
+                                           CTB_PROGRESS_SAO);
+        }
+
+
         // TODO: must predSamples stride really be nCS or can it be something smaller like nPbW?
 
         if (img->high_bit_depth(0)) {
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint16_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->has_border(), nPbW,nPbH, bit_depth_L);
         }
         else {
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint8_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->has_border(), nPbW,nPbH, bit_depth_L);
         }
 
         if (img->get_chroma_format() != de265_chroma_mono) {
           if (img->high_bit_depth(1)) {
             mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP, yP,
                       predSamplesC[0][l], nCS, (const uint16_t*) refPic->get_image_plane(1),
-                      refPic->get_chroma_stride(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
+                      refPic->get_chroma_stride(), refPic->has_border(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
             mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP, yP,
                       predSamplesC[1][l], nCS, (const uint16_t*) refPic->get_image_plane(2),
-                      refPic->get_chroma_stride(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
+                      refPic->get_chroma_stride(), refPic->has_border(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
           }
           else {
             mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP, yP,
                       predSamplesC[0][l], nCS, (const uint8_t*) refPic->get_image_plane(1),
-                      refPic->get_chroma_stride(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
+                      refPic->get_chroma_stride(), refPic->has_border(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
             mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP, yP,
                       predSamplesC[1][l], nCS, (const uint8_t*) refPic->get_image_plane(2),
-                      refPic->get_chroma_stride(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
+                      refPic->get_chroma_stride(), refPic->has_border(), nPbW / SubWidthC, nPbH / SubHeightC, bit_depth_C);
           }
         }
       }
@@ -2196,7 +2233,8 @@ void decode_prediction_unit(base_context* ctx,
                             const slice_segment_header* shdr,
                             de265_image* img,
                             const PBMotionCoding& motion,
-                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx)
+                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx,
+                            thread_task* task)
 {
   logtrace(LogMotion,"decode_prediction_unit POC=%d %d;%d %dx%d\n",
            img->PicOrderCntVal, xC+xB,yC+yB, nPbW,nPbH);
@@ -2211,7 +2249,7 @@ void decode_prediction_unit(base_context* ctx,
 
   // 2.
 
-  generate_inter_prediction_samples(ctx,shdr, img, xC,yC, xB,yB, nCS, nPbW,nPbH, &vi);
+  generate_inter_prediction_samples(ctx,shdr, img, xC,yC, xB,yB, nCS, nPbW,nPbH, &vi, task);
 
 
   img->set_mv_info(xC+xB,yC+yB,nPbW,nPbH, vi);
@@ -90,7 +90,8 @@ void generate_inter_prediction_samples(base_context* ctx,
                                        int xC,int yC,
                                        int xB,int yB,
                                        int nCS, int nPbW,int nPbH,
-                                       const PBMotion* vi);
+                                       const PBMotion* vi,
+                                       thread_task* task=NULL);
 
 
 /* Fill list (two entries) of motion-vector predictors for MVD coding.
@@ -104,9 +105,19 @@ void fill_luma_motion_vector_predictors(base_context* ctx,
                                         MotionVector out_mvpList[2]);
 
 
+// 8.5.3.1, derive the motion of a prediction block without predicting its samples
+void motion_vectors_and_ref_indices(base_context* ctx,
+                                    const slice_segment_header* shdr,
+                                    de265_image* img,
+                                    const PBMotionCoding& motion,
+                                    int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+                                    int partIdx,
+                                    PBMotion* out_vi);
+
 void decode_prediction_unit(base_context* ctx,const slice_segment_header* shdr,
                             de265_image* img, const PBMotionCoding& motion,
-                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx);
+                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx,
+                            thread_task* task=NULL);
 
 
 
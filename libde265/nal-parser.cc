@@ -19,6 +19,7 @@
  */
 
 #include "nal-parser.h"
+#include "fallback-nal.h"
 
 #include <string.h>
 #include <assert.h>
@@ -39,15 +40,22 @@ NAL_unit::NAL_unit()
   nal_data = NULL;
   data_size = 0;
   capacity = 0;
+
+  external_data = NULL;
+  external_release_func = NULL;
+  external_release_userdata = NULL;
 }
 
 NAL_unit::~NAL_unit()
 {
+  release_external_data();
   free(nal_data);
 }
 
 void NAL_unit::clear()
 {
+  release_external_data();
+
   header = nal_header();
   pts = 0;
   user_data = NULL;
@@ -97,6 +105,31 @@ bool LIBDE265_CHECK_RESULT NAL_unit::set_data(const unsigned char* in_data, int
   return true;
 }
 
+void NAL_unit::set_external_data(const unsigned char* in_data, int n,
+                                 de265_release_NAL_func release_func, void* release_userdata)
+{
+  release_external_data();
+
+  external_data = in_data;
+  external_release_func = release_func;
+  external_release_userdata = release_userdata;
+  data_size = n;
+}
+
+void NAL_unit::release_external_data()
+{
+  if (external_data) {
+    if (external_release_func) {
+      external_release_func(external_data, external_release_userdata);
+    }
+
+    external_data = NULL;
+    external_release_func = NULL;
+    external_release_userdata = NULL;
+    data_size = 0;
+  }
+}
+
 void NAL_unit::insert_skipped_byte(int pos)
 {
   skipped_bytes.push_back(pos);
@@ -159,6 +192,7 @@ NAL_Parser::NAL_Parser()
   input_push_state = 0;
   pending_input_NAL = NULL;
   nBytes_in_NAL_queue = 0;
+  acceleration = NULL;
 }
 
 
@@ -216,6 +250,10 @@ void NAL_Parser::free_NAL_unit(NAL_unit* nal)
     // Allow calling with NULL just like regular "free()"
     return;
   }
+
+  // give caller-owned data back right away, not only when the NAL object is reused
+  nal->release_external_data();
+
   if (NAL_free_list.size() < DE265_NAL_FREE_LIST_SIZE) {
     NAL_free_list.push_back(nal);
   }
@@ -269,7 +307,24 @@ de265_error NAL_Parser::push_data(const unsigned char* data, int len,
 
   unsigned char* out = nal->data() + nal->size();
 
+  int (*find_zero_byte_pair)(const uint8_t*, int) =
+    acceleration ? acceleration->find_zero_byte_pair : find_zero_byte_pair_fallback;
+
   for (int i=0;i<len;i++) {
+    /* Inside the NAL payload (state 5), bytes up to the next pair of zeros are copied
+       unchanged: a single zero followed by a non-zero byte is output as is by states 5/6.
+       The byte before the pair is non-zero, so the state machine continues in state 5.
+       The last input byte is always left to the state machine, such that a trailing zero
+       carries over to the next push_data() call as before. */
+
+    if (input_push_state==5 && len-i > 16) {
+      int n = find_zero_byte_pair(data, len-i);
+      memcpy(out, data, n);
+      out  += n;
+      data += n;
+      i    += n;
+    }
+
     /*
     printf("state=%d input=%02x (%p) (output size: %d)\n",ctx->input_push_state, *data, data,
            out - ctx->nal_data.data);
@@ -392,6 +447,31 @@ de265_error NAL_Parser::push_NAL(const unsigned char* data, int len,
 }
 
 
+de265_error NAL_Parser::push_NAL_zero_copy(const unsigned char* data, int len,
+                                           de265_PTS pts, void* user_data,
+                                           de265_release_NAL_func release_func,
+                                           void* release_userdata)
+{
+  // Cannot use byte-stream input and NAL input at the same time.
+  assert(pending_input_NAL == NULL);
+
+  end_of_frame = false;
+
+  NAL_unit* nal = alloc_NAL_unit(0);
+  if (nal == NULL) {
+    return DE265_ERROR_OUT_OF_MEMORY;
+  }
+
+  nal->set_external_data(data, len, release_func, release_userdata);
+  nal->pts = pts;
+  nal->user_data = user_data;
+
+  push_to_NAL_queue(nal);
+
+  return DE265_OK;
+}
+
+
 de265_error NAL_Parser::flush_data()
 {
   if (pending_input_NAL) {
@@ -25,6 +25,7 @@
 #include "libde265/pps.h"
 #include "libde265/nal.h"
 #include "libde265/util.h"
+#include "libde265/acceleration.h"
 
 #include <vector>
 #include <queue>
@@ -54,8 +55,20 @@ class NAL_unit {
 
   int size() const { return data_size; }
   void set_size(int s) { data_size=s; }
-  unsigned char* data() { return nal_data; }
-  const unsigned char* data() const { return nal_data; }
+  unsigned char* data() { return external_data ? (unsigned char*)external_data : nal_data; }
+  const unsigned char* data() const { return external_data ? external_data : nal_data; }
+
+
+  // --- caller-owned data (zero-copy input) ---
+
+  /* Reference the data instead of copying it. The emulation prevention bytes are
+     not removed, the readers skip them while decoding.
+     release_func is called when the NAL is freed. */
+  void set_external_data(const unsigned char* data, int n,
+                         de265_release_NAL_func release_func, void* release_userdata);
+  void release_external_data();
+
+  bool has_emulation_prevention_bytes() const { return external_data != NULL; }
 
 
   // --- skipped stuffing bytes ---
@@ -80,6 +93,10 @@ class NAL_unit {
   int data_size;
   int capacity;
 
+  const unsigned char* external_data;
+  de265_release_NAL_func external_release_func;
+  void* external_release_userdata;
+
   std::vector<int> skipped_bytes; // up to position[x], there were 'x' skipped bytes
 };
 
@@ -96,12 +113,19 @@ class NAL_Parser
   de265_error push_NAL(const unsigned char* data, int len,
                        de265_PTS pts, void* user_data = NULL);
 
+  de265_error push_NAL_zero_copy(const unsigned char* data, int len,
+                                 de265_PTS pts, void* user_data,
+                                 de265_release_NAL_func release_func, void* release_userdata);
+
   NAL_unit*   pop_from_NAL_queue();
   de265_error flush_data();
   void        mark_end_of_stream() { end_of_stream=true; }
   void        mark_end_of_frame() { end_of_frame=true; }
   void  remove_pending_input_data();
 
+  // Start-code scanning uses the given (non-owned) function table, scalar code if NULL.
+  void  set_acceleration_functions(const acceleration_functions* accel) { acceleration = accel; }
+
   int bytes_in_input_queue() const {
     int size = nBytes_in_NAL_queue;
     if (pending_input_NAL) { size += pending_input_NAL->size(); }
@@ -132,6 +156,8 @@ class NAL_Parser
   bool end_of_frame;  // data in pending_input_data is end of frame
   int  input_push_state;
 
+  const acceleration_functions* acceleration;
+
   NAL_unit* pending_input_NAL;
 
 
@@ -25,6 +25,48 @@
 #include <string.h>
 
 
+/* Check whether the samples of the CTB at (xCtb+dx;yCtb+dy) can be used as neighbors
+   for the edge offset classification in CTB (xCtb;yCtb). This covers the picture
+   boundaries as well as slice and tile boundaries that may not be filtered across.
+ */
+static bool sao_neighbor_ctb_available(const de265_image* img, int xCtb,int yCtb, int dx,int dy,
+                                       int ctbSliceAddrRS)
+{
+  const seq_parameter_set& sps = img->get_sps();
+  const pic_parameter_set& pps = img->get_pps();
+
+  const int xN = xCtb+dx;
+  const int yN = yCtb+dy;
+
+  if (xN<0 || yN<0 || xN>=sps.PicWidthInCtbsY || yN>=sps.PicHeightInCtbsY) {
+    return false;
+  }
+
+  const slice_segment_header* shdr   = img->get_SliceHeaderCtb(xCtb,yCtb);
+  const slice_segment_header* shdrNb = img->get_SliceHeaderCtb(xN,yN);
+  if (shdr==NULL || shdrNb==NULL) {
+    return false;
+  }
+
+  if (shdrNb->SliceAddrRS < ctbSliceAddrRS &&
+      shdr->slice_loop_filter_across_slices_enabled_flag==0) {
+    return false;
+  }
+
+  if (shdrNb->SliceAddrRS > ctbSliceAddrRS &&
+      shdrNb->slice_loop_filter_across_slices_enabled_flag==0) {
+    return false;
+  }
+
+  if (pps.loop_filter_across_tiles_enabled_flag==0 &&
+      pps.TileIdRS[xN + yN*sps.PicWidthInCtbsY] != pps.TileIdRS[xCtb + yCtb*sps.PicWidthInCtbsY]) {
+    return false;
+  }
+
+  return true;
+}
+
+
 template <class pixel_t>
 void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
                         const slice_segment_header* shdr, int cIdx, int nSW,int nSH,
@@ -100,6 +142,61 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
     saoOffsetVal[4] = saoinfo->saoOffsetVal[cIdx][4-1];
 
 
+    if (!extendedTests) {
+      /* Fast path: the availability of the neighbors only changes at the CTB border,
+         hence we decide once for each neighboring CTB whether we may access it.
+         Border rows/columns that would reach into unavailable CTBs are excluded from
+         the processed block, corner samples are restored afterwards. */
+
+      bool availLeft=true, availRight=true, availTop=true, availBottom=true;
+
+      if (SaoEoClass != 1) {
+        availLeft  = sao_neighbor_ctb_available(img, xCtb,yCtb, -1,0, ctbSliceAddrRS);
+        availRight = sao_neighbor_ctb_available(img, xCtb,yCtb,  1,0, ctbSliceAddrRS);
+      }
+
+      if (SaoEoClass != 0) {
+        availTop    = sao_neighbor_ctb_available(img, xCtb,yCtb, 0,-1, ctbSliceAddrRS);
+        availBottom = sao_neighbor_ctb_available(img, xCtb,yCtb, 0, 1, ctbSliceAddrRS);
+      }
+
+      const int x0 = availLeft   ? 0    : 1;
+      const int x1 = availRight  ? ctbW : ctbW-1;
+      const int y0 = availTop    ? 0    : 1;
+      const int y1 = availBottom ? ctbH : ctbH-1;
+
+      if (x1<=x0 || y1<=y0) {
+        return;
+      }
+
+      img->decctx->acceleration.sao_edge(&out_img[xC+x0+(yC+y0)*out_stride], out_stride,
+                                         &in_img [xC+x0+(yC+y0)*in_stride],  in_stride,
+                                         x1-x0, y1-y0, SaoEoClass, saoOffsetVal, bitDepth);
+
+      // diagonal classes also access the CTBs at the corners
+
+      int cornerX[2], cornerY[2], cornerDX[2], cornerDY[2];
+      int nCorners=0;
+
+      if (SaoEoClass==2) {
+        if (x0==0    && y0==0)    { cornerX[nCorners]=0;      cornerY[nCorners]=0;      cornerDX[nCorners]=-1; cornerDY[nCorners]=-1; nCorners++; }
+        if (x1==ctbW && y1==ctbH) { cornerX[nCorners]=ctbW-1; cornerY[nCorners]=ctbH-1; cornerDX[nCorners]= 1; cornerDY[nCorners]= 1; nCorners++; }
+      }
+      else if (SaoEoClass==3) {
+        if (x1==ctbW && y0==0)    { cornerX[nCorners]=ctbW-1; cornerY[nCorners]=0;      cornerDX[nCorners]= 1; cornerDY[nCorners]=-1; nCorners++; }
+        if (x0==0    && y1==ctbH) { cornerX[nCorners]=0;      cornerY[nCorners]=ctbH-1; cornerDX[nCorners]=-1; cornerDY[nCorners]= 1; nCorners++; }
+      }
+
+      for (int c=0;c<nCorners;c++) {
+        if (!sao_neighbor_ctb_available(img, xCtb,yCtb, cornerDX[c],cornerDY[c], ctbSliceAddrRS)) {
+          out_img[xC+cornerX[c]+(yC+cornerY[c])*out_stride] = in_img[xC+cornerX[c]+(yC+cornerY[c])*in_stride];
+        }
+      }
+
+      return;
+    }
+
+
     for (int j=0;j<ctbH;j++) {
       const pixel_t* in_ptr  = &in_img [xC+(yC+j)*in_stride];
       /* */ pixel_t* out_ptr = &out_img[xC+(yC+j)*out_stride];
@@ -240,36 +337,14 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
           }
         }
     }
-    else
-      {
-        // (B) simplified version (only works if no PCM and transquant_bypass is active)
+    else if (bandShift < 8) {
+      // (B) simplified version (only works if no PCM and transquant_bypass is active)
 
-        for (int j=0;j<ctbH;j++)
-          for (int i=0;i<ctbW;i++) {
-
-            // see above
-            int bandIdx;
-            if (bandShift >= 8) {
-              bandIdx = 0;
-            } else {
-              int pixel = in_img[xC+i+(yC+j)*in_stride];
-
-              // Note: the input pixel value should never exceed the valid range, but it seems that it still does,
-              // maybe when there was a decoding error and the pixels have not been filled in correctly.
-              // Thus, we have to limit the pixel range to ensure that we have no illegal table access.
-              pixel = Clip3(0,maxPixelValue, pixel);
-
-              bandIdx = bandTable[ pixel>>bandShift ];
-            }
-
-            if (bandIdx>0) {
-              int offset = saoinfo->saoOffsetVal[cIdx][bandIdx-1];
-
-              out_img[xC+i+(yC+j)*out_stride] = Clip3(0,maxPixelValue,
-                                                      in_img[xC+i+(yC+j)*in_stride] + offset);
-            }
-          }
-      }
+      img->decctx->acceleration.sao_band(&out_img[xC+yC*out_stride], out_stride,
+                                         &in_img [xC+yC*in_stride],  in_stride,
+                                         ctbW, ctbH, saoLeftClass,
+                                         saoinfo->saoOffsetVal[cIdx], bitDepth);
+    }
   }
 }
 
@@ -395,6 +470,42 @@ void apply_sample_adaptive_offset_sequential(de265_image* img)
 
 
 
+void apply_sample_adaptive_offset_CTBRow(de265_image* img, int ctb_y,
+                                         const de265_image* inputImg,
+                                         de265_image* outputImg)
+{
+  const seq_parameter_set& sps = img->get_sps();
+  const int ctbSize = (1<<sps.Log2CtbSizeY);
+
+  for (int xCtb=0; xCtb<sps.PicWidthInCtbsY; xCtb++)
+    {
+      const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,ctb_y);
+      if (shdr==NULL) {
+        break;
+      }
+
+      if (shdr->slice_sao_luma_flag) {
+        apply_sao(img, xCtb,ctb_y, shdr, 0, ctbSize, ctbSize,
+                  inputImg ->get_image_plane(0), inputImg ->get_image_stride(0),
+                  outputImg->get_image_plane(0), outputImg->get_image_stride(0));
+      }
+
+      if (shdr->slice_sao_chroma_flag) {
+        int nSW = ctbSize / sps.SubWidthC;
+        int nSH = ctbSize / sps.SubHeightC;
+
+        apply_sao(img, xCtb,ctb_y, shdr, 1, nSW,nSH,
+                  inputImg ->get_image_plane(1), inputImg ->get_image_stride(1),
+                  outputImg->get_image_plane(1), outputImg->get_image_stride(1));
+
+        apply_sao(img, xCtb,ctb_y, shdr, 2, nSW,nSH,
+                  inputImg ->get_image_plane(2), inputImg ->get_image_stride(2),
+                  outputImg->get_image_plane(2), outputImg->get_image_stride(2));
+      }
+    }
+}
+
+
 class thread_task_sao : public thread_task
 {
 public:
@@ -447,32 +558,7 @@ void thread_task_sao::work()
 
   // process SAO in the CTB-row
 
-  for (int xCtb=0; xCtb<sps.PicWidthInCtbsY; xCtb++)
-    {
-      const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,ctb_y);
-      if (shdr==NULL) {
-        break;
-      }
-
-      if (shdr->slice_sao_luma_flag) {
-        apply_sao(img, xCtb,ctb_y, shdr, 0, ctbSize, ctbSize,
-                  inputImg ->get_image_plane(0), inputImg ->get_image_stride(0),
-                  outputImg->get_image_plane(0), outputImg->get_image_stride(0));
-      }
-
-      if (shdr->slice_sao_chroma_flag) {
-        int nSW = ctbSize / sps.SubWidthC;
-        int nSH = ctbSize / sps.SubHeightC;
-
-        apply_sao(img, xCtb,ctb_y, shdr, 1, nSW,nSH,
-                  inputImg ->get_image_plane(1), inputImg ->get_image_stride(1),
-                  outputImg->get_image_plane(1), outputImg->get_image_stride(1));
-
-        apply_sao(img, xCtb,ctb_y, shdr, 2, nSW,nSH,
-                  inputImg ->get_image_plane(2), inputImg ->get_image_stride(2),
-                  outputImg->get_image_plane(2), outputImg->get_image_stride(2));
-      }
-    }
+  apply_sample_adaptive_offset_CTBRow(img, ctb_y, inputImg, outputImg);
 
 
   // mark SAO progress
@@ -488,7 +574,7 @@ void thread_task_sao::work()
 }
 
 
-bool add_sao_tasks(image_unit* imgunit, int saoInputProgress)
+bool add_sao_tasks(image_unit* imgunit, int saoInputProgress, int firstCtbRow, int endCtbRow)
 {
   de265_image* img = imgunit->img;
   const seq_parameter_set& sps = img->get_sps();
@@ -500,23 +586,26 @@ bool add_sao_tasks(image_unit* imgunit, int saoInputProgress)
 
   decoder_context* ctx = img->decctx;
 
-  de265_error err = imgunit->sao_output.alloc_image(img->get_width(), img->get_height(),
-                                                    img->get_chroma_format(),
-                                                    img->get_shared_sps(),
-                                                    false,
-                                                    img->decctx, //img->encctx,
-                                                    img->pts, img->user_data, true);
-  if (err != DE265_OK) {
-    img->decctx->add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
-    return false;
+  if (firstCtbRow==0) {
+    de265_error err = imgunit->sao_output.alloc_image(img->get_width(), img->get_height(),
+                                                      img->get_chroma_format(),
+                                                      img->get_shared_sps(),
+                                                      false,
+                                                      img->decctx, //img->encctx,
+                                                      img->pts, img->user_data, true);
+    if (err != DE265_OK) {
+      img->decctx->add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
+      return false;
+    }
   }
 
-  int nRows = sps.PicHeightInCtbsY;
+  if (endCtbRow <= firstCtbRow) {
+    return true;
+  }
 
-  int n=0;
-  img->thread_start(nRows);
+  img->thread_start(endCtbRow-firstCtbRow);
 
-  for (int y=0;y<nRows;y++)
+  for (int y=firstCtbRow;y<endCtbRow;y++)
     {
       thread_task_sao* task = new thread_task_sao;
 
@@ -525,17 +614,11 @@ bool add_sao_tasks(image_unit* imgunit, int saoInputProgress)
       task->img = img;
       task->ctb_y = y;
       task->inputProgress = saoInputProgress;
+      task->set_priority(img->get_ID(), thread_task::StageSAO, y);
 
       imgunit->tasks.push_back(task);
-      add_task(&ctx->thread_pool_, task);
-      n++;
+      ctx->add_task_to_thread_pool(task);
     }
 
-  /* Currently need barrier here because when are finished, we have to swap the pixel
-     data back into the main image. */
-  img->wait_for_completion();
-
-  img->exchange_pixel_data_with(imgunit->sao_output);
-
   return true;
 }
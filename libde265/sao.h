@@ -28,9 +28,18 @@ void apply_sample_adaptive_offset(de265_image* img);
 /* requires less memory than the function above */
 void apply_sample_adaptive_offset_sequential(de265_image* img);
 
-/* saoInputProgress - the CTB progress that SAO will wait for before beginning processing.
-   Returns 'true' if any tasks have been added.
+/* Add the SAO tasks for the CTB rows [firstCtbRow;endCtbRow). The output is written
+   into imgunit->sao_output (allocated when firstCtbRow==0), which has to be exchanged
+   with the image when all tasks are finished.
+   saoInputProgress - the CTB progress that SAO will wait for before beginning processing.
+   Returns 'false' if SAO is not applied to this picture.
  */
-bool add_sao_tasks(image_unit* imgunit, int saoInputProgress);
+bool add_sao_tasks(image_unit* imgunit, int saoInputProgress, int firstCtbRow, int endCtbRow);
+
+/* Apply SAO to a single CTB row. The CTB rows above and below have to be available
+   in 'inputImg'. 'outputImg' must already contain a copy of the input row. */
+void apply_sample_adaptive_offset_CTBRow(de265_image* img, int ctb_y,
+                                         const de265_image* inputImg,
+                                         de265_image* outputImg);
 
 #endif
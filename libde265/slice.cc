@@ -3440,6 +3440,16 @@ static void decode_TU(thread_context* tctx,
                       int xCUBase,int yCUBase,
                       int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
 {
+  // pipelined reconstruction: store the TU for the reconstruction stage
+
+  if (tctx->recon) {
+    if (cuPredMode == MODE_INTRA || cbf || (cIdx!=0 && tctx->ResScaleVal)) {
+      tctx->recon->add_transform_unit(tctx, x0,y0, xCUBase,yCUBase, nT, cIdx, cuPredMode, cbf);
+    }
+
+    return;
+  }
+
   de265_image* img = tctx->img;
   const seq_parameter_set& sps = img->get_sps();
 
@@ -4055,6 +4065,29 @@ void read_mvd_coding(thread_context* tctx,
 }
 
 
+/* Derive the motion of the PU and predict its samples. With pipelined reconstruction,
+   the prediction is stored for the reconstruction stage instead.
+ */
+static void process_prediction_unit(thread_context* tctx,
+                                    int xC,int yC, int xB,int yB, int nCS,
+                                    int nPbW,int nPbH, int partIdx)
+{
+  if (tctx->recon == NULL) {
+    decode_prediction_unit(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
+                           xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx, tctx->task);
+    return;
+  }
+
+  PBMotion vi;
+  motion_vectors_and_ref_indices(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
+                                 xC,yC, xB,yB, nCS, nPbW,nPbH, partIdx, &vi);
+
+  tctx->img->set_mv_info(xC+xB,yC+yB,nPbW,nPbH, vi);
+
+  tctx->recon->add_prediction_unit(xC,yC, xB,yB, nCS, nPbW,nPbH, vi);
+}
+
+
 void read_prediction_unit_SKIP(thread_context* tctx,
                                int x0, int y0,
                                int nPbW, int nPbH)
@@ -4147,8 +4180,7 @@ void read_prediction_unit(thread_context* tctx,
 
 
 
-  decode_prediction_unit(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
-                         xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
+  process_prediction_unit(tctx, xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
 }
 
 
@@ -4208,6 +4240,9 @@ static void read_pcm_samples(thread_context* tctx, int x0, int y0, int log2CbSiz
   br.bytes_remaining = tctx->cabac_decoder.bitstream_end - tctx->cabac_decoder.bitstream_curr;
   br.nextbits = 0;
   br.nextbits_cnt = 0;
+  br.emulation_prevention = tctx->cabac_decoder.emulation_prevention;
+  br.zero_run = tctx->cabac_decoder.zero_run;
+  br.epb_mask = 0;
 
 
   if (tctx->img->high_bit_depth(0)) {
@@ -4228,6 +4263,7 @@ static void read_pcm_samples(thread_context* tctx, int x0, int y0, int log2CbSiz
 
   prepare_for_CABAC(&br);
   tctx->cabac_decoder.bitstream_curr = br.data;
+  tctx->cabac_decoder.zero_run = br.zero_run;
   init_CABAC_decoder_2(&tctx->cabac_decoder);
 }
 
@@ -4325,8 +4361,7 @@ void read_coding_unit(thread_context* tctx,
     // DECODE
 
     int nCS_L = 1<<log2CbSize;
-    decode_prediction_unit(tctx->decctx,tctx->shdr,tctx->img,tctx->motion,
-                           x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
+    process_prediction_unit(tctx, x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
   }
   else /* not skipped */ {
     if (shdr->slice_type != SLICE_TYPE_I) {
@@ -4692,30 +4727,78 @@ enum DecodeResult decode_substream(thread_context* tctx,
 
   const int startCtbY = tctx->CtbY;
 
+  // Substreams do not cross tile boundaries. With WPP, the CTB-row dependencies
+  // are limited to the CTB columns of the tile.
+
+  const int tileIdx    = pps.TileIdRS[tctx->CtbAddrInRS];
+  const int tileColumn = tileIdx % pps.num_tile_columns;
+  const int tileRow    = tileIdx / pps.num_tile_columns;
+  const int tileStartX = pps.colBd[tileColumn];
+  const int tileEndX   = pps.colBd[tileColumn+1];
+  const int tileStartY = pps.rowBd[tileRow];
+  const int tileEndY   = pps.rowBd[tileRow+1];
+
+  // The progress state of parsed CTBs. With pipelined reconstruction, they are not
+  // reconstructed yet. The CABAC models of the CTB rows above are available nevertheless.
+
+  const int parsedProgress = (tctx->imgunit->pipelined_reconstruction ?
+                              CTB_PROGRESS_PARSED : CTB_PROGRESS_PREFILTER);
+
   //printf("start decoding substream at %d;%d\n",tctx->CtbX,tctx->CtbY);
 
-  // in WPP mode: initialize CABAC model with stored model from row above
+  // When pictures are decoded in parallel, the collocated picture for temporal MV prediction
+  // may still be in the decoding process. We will wait for its motion data in each CTB row.
+
+  const de265_image* colImg = NULL;
+  const slice_segment_header* shdr = tctx->shdr;
+
+  if (tctx->task &&
+      shdr->slice_temporal_mvp_enabled_flag &&
+      shdr->slice_type != SLICE_TYPE_I) {
+    int colPic;
+    if (shdr->slice_type == SLICE_TYPE_B &&
+        shdr->collocated_from_l0_flag == 0) {
+      colPic = shdr->RefPicList[1][ shdr->collocated_ref_idx ];
+    }
+    else {
+      colPic = shdr->RefPicList[0][ shdr->collocated_ref_idx ];
+    }
+
+    if (tctx->decctx->has_image(colPic)) {
+      colImg = tctx->decctx->get_image(colPic);
+    }
+  }
+
+  int colImgCtbY = -1; // CTB row of colImg that we already waited for
+
+  // in WPP mode: initialize CABAC model with stored model from row above (in the same tile)
 
   if ((!first_independent_substream || tctx->CtbY != startCtbY) &&
       pps.entropy_coding_sync_enabled_flag &&
-      tctx->CtbY>=1 && tctx->CtbX==0)
+      tctx->CtbX==tileStartX)
     {
-      if (sps.PicWidthInCtbsY>1) {
-        if ((tctx->CtbY-1) >= tctx->imgunit->ctx_models.size()) {
+      if (tctx->CtbY == tileStartY) {
+        // first CTB in tile
+        initialize_CABAC_models(tctx);
+      }
+      else if (tileEndX-tileStartX > 1) {
+        const size_t modelIdx = (tctx->CtbY-1)*pps.num_tile_columns + tileColumn;
+
+        if (modelIdx >= tctx->imgunit->ctx_models.size()) {
           return Decode_Error;
         }
 
-        //printf("CTX wait on %d/%d\n",1,tctx->CtbY-1);
+        //printf("CTX wait on %d/%d\n",tileStartX+1,tctx->CtbY-1);
 
         // we have to wait until the context model data is there
-        tctx->img->wait_for_progress(tctx->task, 1,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        tctx->img->wait_for_progress(tctx->task, tileStartX+1,tctx->CtbY-1,parsedProgress);
 
         // copy CABAC model from previous CTB row
-        tctx->ctx_model = tctx->imgunit->ctx_models[(tctx->CtbY-1)];
-        tctx->imgunit->ctx_models[(tctx->CtbY-1)].release(); // not used anymore
+        tctx->ctx_model = tctx->imgunit->ctx_models[modelIdx];
+        tctx->imgunit->ctx_models[modelIdx].release(); // not used anymore
       }
       else {
-        tctx->img->wait_for_progress(tctx->task, 0,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        tctx->img->wait_for_progress(tctx->task, tileStartX,tctx->CtbY-1,parsedProgress);
         initialize_CABAC_models(tctx);
       }
     }
@@ -4734,15 +4817,21 @@ enum DecodeResult decode_substream(thread_context* tctx,
         return Decode_Error;
     }
 
-    if (block_wpp && ctby>0 && ctbx < ctbW-1) {
+    if (block_wpp && ctby>tileStartY && ctbx < tileEndX-1) {
 
-      // TODO: if we are in tiles mode and at the right border, do not wait for x+1,y-1
+      // The CTB above-right is in another tile at the right tile border, we do not depend on it.
 
       //printf("wait on %d/%d (%d)\n",ctbx+1,ctby-1, ctbx+1+(ctby-1)*sps->PicWidthInCtbsY);
 
       tctx->img->wait_for_progress(tctx->task, ctbx+1,ctby-1, CTB_PROGRESS_PREFILTER);
     }
 
+    if (colImg && ctby != colImgCtbY) {
+      tctx->img->wait_for_reference_CTB_row_progress(tctx->task, colImg, ctby,
+                                                     CTB_PROGRESS_PREFILTER);
+      colImgCtbY = ctby;
+    }
+
     //printf("%p: decode %d;%d\n", tctx, tctx->CtbX,tctx->CtbY);
 
 
@@ -4752,22 +4841,29 @@ enum DecodeResult decode_substream(thread_context* tctx,
       return Decode_Error;
     }
 
+    if (tctx->imgunit->pipelined_reconstruction) {
+      tctx->recon = &tctx->imgunit->reconstruction_data[ctbx+ctby*ctbW];
+      tctx->recon->shdr = tctx->shdr;
+    }
+
     read_coding_tree_unit(tctx);
 
 
-    // save CABAC-model for WPP (except in last CTB row)
+    // save CABAC-model for WPP (except in last CTB row of the tile)
 
     if (pps.entropy_coding_sync_enabled_flag &&
-        ctbx == 1 &&
-        ctby < sps.PicHeightInCtbsY-1)
+        ctbx == tileStartX+1 &&
+        ctby < tileEndY-1)
       {
+        const size_t modelIdx = ctby*pps.num_tile_columns + tileColumn;
+
         // no storage for context table has been allocated
-        if (tctx->imgunit->ctx_models.size() <= ctby) {
+        if (tctx->imgunit->ctx_models.size() <= modelIdx) {
           return Decode_Error;
         }
 
-        tctx->imgunit->ctx_models[ctby] = tctx->ctx_model;
-        tctx->imgunit->ctx_models[ctby].decouple(); // store an independent copy
+        tctx->imgunit->ctx_models[modelIdx] = tctx->ctx_model;
+        tctx->imgunit->ctx_models[modelIdx].decouple(); // store an independent copy
       }
 
 
@@ -4788,7 +4884,9 @@ enum DecodeResult decode_substream(thread_context* tctx,
       }
     }
 
-    tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(CTB_PROGRESS_PREFILTER);
+    tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(tctx->recon ?
+                                                         CTB_PROGRESS_PARSED :
+                                                         CTB_PROGRESS_PREFILTER);
 
     //printf("%p: decoded %d|%d\n",tctx, ctby,ctbx);
 
@@ -4860,12 +4958,6 @@ bool initialize_CABAC_at_slice_segment_start(thread_context* tctx)
   if (shdr->dependent_slice_segment_flag) {
     int prevCtb = pps.CtbAddrTStoRS[ pps.CtbAddrRStoTS[shdr->slice_segment_address] -1 ];
 
-    int sliceIdx = img->get_SliceHeaderIndex_atIndex(prevCtb);
-    if (sliceIdx >= img->slices.size()) {
-      return false;
-    }
-    slice_segment_header* prevCtbHdr = img->slices[ sliceIdx ];
-
     if (pps.is_tile_start_CTB(shdr->slice_segment_address % sps.PicWidthInCtbsY,
                               shdr->slice_segment_address / sps.PicWidthInCtbsY
                               )) {
@@ -4877,7 +4969,7 @@ bool initialize_CABAC_at_slice_segment_start(thread_context* tctx)
       //printf("wait for previous slice to finish decoding\n");
 
 
-      slice_unit* prevSliceSegment = tctx->imgunit->get_prev_slice_segment(tctx->sliceunit);
+      slice_unit* prevSliceSegment = tctx->sliceunit->prev_slice_segment;
       //assert(prevSliceSegment);
       if (prevSliceSegment==NULL) {
         return false;
@@ -4893,12 +4985,34 @@ bool initialize_CABAC_at_slice_segment_start(thread_context* tctx)
       tctx->img->wait_for_progress(tctx->task, prevCtb, CTB_PROGRESS_PREFILTER);
       */
 
+      int sliceIdx = img->get_SliceHeaderIndex_atIndex(prevCtb);
+      if (sliceIdx >= img->slices.size()) {
+        return false;
+      }
+      slice_segment_header* prevCtbHdr = img->slices[ sliceIdx ];
+
       if (!prevCtbHdr->ctx_model_storage_defined) {
         return false;
       }
 
       tctx->ctx_model = prevCtbHdr->ctx_model_storage;
       prevCtbHdr->ctx_model_storage.release();
+
+
+      // --- find QPY that was active at the end of the previous slice ---
+
+      int ctbX = prevCtb % sps.PicWidthInCtbsY;
+      int ctbY = prevCtb / sps.PicWidthInCtbsY;
+
+      // take the pixel at the bottom right corner (but consider that the image size might be smaller)
+
+      int x = ((ctbX+1) << sps.Log2CtbSizeY)-1;
+      int y = ((ctbY+1) << sps.Log2CtbSizeY)-1;
+
+      x = std::min(x,sps.pic_width_in_luma_samples-1);
+      y = std::min(y,sps.pic_height_in_luma_samples-1);
+
+      tctx->currentQPY = img->get_QPY(x,y);
     }
   }
   else {
@@ -4968,6 +5082,7 @@ void thread_task_ctb_row::work()
   de265_image* img = tctx->img;
 
   const seq_parameter_set& sps = img->get_sps();
+  const pic_parameter_set& pps = img->get_pps();
   int ctbW = sps.PicWidthInCtbsY;
 
   state = Running;
@@ -4978,13 +5093,19 @@ void thread_task_ctb_row::work()
   int ctby = tctx->CtbAddrInRS / ctbW;
   int myCtbRow = ctby;
 
+  // when tiles are enabled, the row only covers the CTB columns of its tile
+
+  const int tileColumn = pps.TileIdRS[tctx->CtbAddrInRS] % pps.num_tile_columns;
+  const int tileStartX = pps.colBd[tileColumn];
+  const int tileEndX   = pps.colBd[tileColumn+1];
+
   //printf("start CTB-row decoding at row %d\n", ctby);
 
   if (data->firstSliceSubstream) {
     bool success = initialize_CABAC_at_slice_segment_start(tctx);
     if (!success) {
       // could not decode this row, mark whole row as finished
-      for (int x=0;x<ctbW;x++) {
+      for (int x=tileStartX;x<tileEndX;x++) {
         img->ctb_progress[myCtbRow*ctbW + x].set_progress(CTB_PROGRESS_PREFILTER);
       }
 
@@ -5001,16 +5122,21 @@ void thread_task_ctb_row::work()
   bool firstIndependentSubstream =
     data->firstSliceSubstream && !tctx->shdr->dependent_slice_segment_flag;
 
-  /*enum DecodeResult result =*/
-  decode_substream(tctx, true, firstIndependentSubstream);
+  enum DecodeResult result =
+    decode_substream(tctx, true, firstIndependentSubstream);
 
   // mark progress on remaining CTBs in row (in case of decoder error and early termination)
 
-  // TODO: what about slices that end properly in the middle of a CTB row?
+  // When the slice segment ends properly in the middle of its last CTB row, the remaining
+  // CTBs belong to the next slice segment and must not be marked as decoded.
 
-  if (tctx->CtbY == myCtbRow) {
-    int lastCtbX = sps.PicWidthInCtbsY; // assume no tiles when WPP is on
-    for (int x = tctx->CtbX; x<lastCtbX ; x++) {
+  bool properSliceEnd = (result == Decode_EndOfSliceSegment &&
+                         data->lastSliceSubstream);
+
+  if (tctx->CtbY == myCtbRow &&
+      tctx->CtbX >= tileStartX && tctx->CtbX < tileEndX &&
+      !properSliceEnd) {
+    for (int x = tctx->CtbX; x<tileEndX ; x++) {
 
       if (x        < sps.PicWidthInCtbsY &&
           myCtbRow < sps.PicHeightInCtbsY) {
@@ -5025,6 +5151,141 @@ void thread_task_ctb_row::work()
 }
 
 
+std::string thread_task_reconstruct_CTB_row::name() const {
+  char buf[100];
+  sprintf(buf,"reconstruct-CTB-row-%d",ctb_row);
+  return buf;
+}
+
+
+static void reconstruct_CTB(thread_context* tctx, const ctb_reconstruction_data& data)
+{
+  tctx->shdr = data.shdr;
+
+  // motion compensation
+
+  for (size_t i=0;i<data.prediction_units.size();i++) {
+    const ctb_reconstruction_data::prediction_unit& pu = data.prediction_units[i];
+
+    generate_inter_prediction_samples(tctx->decctx, data.shdr, tctx->img,
+                                      pu.xC,pu.yC, pu.xB,pu.yB, pu.nCS, pu.nPbW,pu.nPbH,
+                                      &pu.motion, tctx->task);
+  }
+
+  // intra prediction and residuals
+
+  for (size_t i=0;i<data.transform_units.size();i++) {
+    const ctb_reconstruction_data::transform_unit& tu = data.transform_units[i];
+    const int cIdx = tu.cIdx;
+
+    tctx->qPYPrime  = tu.qP;
+    tctx->qPCbPrime = tu.qP;
+    tctx->qPCrPrime = tu.qP;
+
+    tctx->cu_transquant_bypass_flag = tu.cu_transquant_bypass_flag;
+    tctx->transform_skip_flag[cIdx] = tu.transform_skip_flag;
+    tctx->explicit_rdpcm_flag = tu.explicit_rdpcm_flag;
+    tctx->explicit_rdpcm_dir  = tu.explicit_rdpcm_dir;
+    tctx->ResScaleVal = tu.ResScaleVal;
+
+    tctx->nCoeff[cIdx] = tu.nCoeff;
+    if (tu.nCoeff) {
+      memcpy(tctx->coeffList[cIdx], &data.coeffValue[tu.firstCoeff], tu.nCoeff*sizeof(int16_t));
+      memcpy(tctx->coeffPos[cIdx],  &data.coeffPos  [tu.firstCoeff], tu.nCoeff*sizeof(int16_t));
+    }
+
+    decode_TU(tctx, tu.x0,tu.y0, tu.xCUBase,tu.yCUBase, tu.nT, cIdx,
+              (enum PredMode)tu.cuPredMode, tu.cbf);
+  }
+}
+
+
+void thread_task_reconstruct_CTB_row::work()
+{
+  de265_image* img = imgunit->img;
+  const int ctbW = img->get_sps().PicWidthInCtbsY;
+
+  state = Running;
+  img->thread_run(this);
+
+  // scratch context for the reconstruction (tctx.recon is NULL)
+
+  thread_context tctx;
+  tctx.decctx  = img->decctx;
+  tctx.img     = img;
+  tctx.imgunit = imgunit;
+  tctx.task    = this;
+
+  for (int x=0;x<ctbW;x++) {
+    // intra prediction needs the reconstructed CTBs above and above-right
+
+    if (ctb_row>0) {
+      img->wait_for_progress(this, std::min(x+1,ctbW-1), ctb_row-1, CTB_PROGRESS_PREFILTER);
+    }
+
+    img->wait_for_progress(this, x, ctb_row, CTB_PROGRESS_PARSED);
+
+    de265_progress_lock& progress = img->ctb_progress[x + ctb_row*ctbW];
+
+    // CTBs that are missing in the bitstream are marked as PREFILTER directly
+
+    if (progress.get_progress() >= CTB_PROGRESS_PREFILTER) {
+      continue;
+    }
+
+    ctb_reconstruction_data& data = imgunit->reconstruction_data[x + ctb_row*ctbW];
+
+    reconstruct_CTB(&tctx, data);
+    data.release();
+
+    progress.set_progress(CTB_PROGRESS_PREFILTER);
+  }
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
+std::string thread_task_slice_segment_data::name() const {
+  char buf[100];
+  sprintf(buf,"slice-segment-data-%d",tctx->shdr->slice_segment_address);
+  return buf;
+}
+
+
+void thread_task_slice_segment_data::work()
+{
+  de265_image* img = tctx->img;
+
+  state = Running;
+  img->thread_run(this);
+
+  /* Independent slice segments start with freshly initialized CABAC models and they cannot
+     predict from other slices (available_zscan() checks the slice address). Hence, they
+     are decoded concurrently. Dependent slice segments continue the CABAC state of the
+     previous slice segment and have to wait until it is decoded. */
+
+  slice_unit* prevSliceSegment = tctx->sliceunit->prev_slice_segment;
+  if (prevSliceSegment && tctx->shdr->dependent_slice_segment_flag) {
+    img->thread_blocks();
+    state = Blocked;
+
+    prevSliceSegment->finished_threads.wait_for_progress(prevSliceSegment->nThreads);
+
+    state = Running;
+    img->thread_unblocks();
+  }
+
+  read_slice_segment_data(tctx);
+
+  tctx->imgunit->slice_decoding_finished();
+
+  state = Finished;
+  tctx->sliceunit->finished_threads.increase_progress(1);
+  img->thread_finishes(this);
+}
+
+
 de265_error read_slice_segment_data(thread_context* tctx)
 {
   setCtbAddrFromTS(tctx);
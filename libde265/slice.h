@@ -39,6 +39,7 @@
 
 class decoder_context;
 class thread_context;
+class image_unit;
 class error_queue;
 class seq_parameter_set;
 class pic_parameter_set;
@@ -288,6 +289,7 @@ class thread_task_ctb_row : public thread_task
 {
 public:
   bool   firstSliceSubstream;
+  bool   lastSliceSubstream;
   int    debug_startCtbRow;
   thread_context* tctx;
 
@@ -306,6 +308,31 @@ public:
   virtual std::string name() const;
 };
 
+/* Reconstructs the CTBs of one CTB row (intra prediction, motion compensation and
+   residuals) from the data that the slice decoding tasks stored during parsing.
+   Only used with pipelined reconstruction. */
+class thread_task_reconstruct_CTB_row : public thread_task
+{
+public:
+  image_unit* imgunit;
+  int    ctb_row;
+
+  virtual void work();
+  virtual std::string name() const;
+};
+
+/* Decodes a complete slice segment (all of its substreams) in a single task.
+   This is used for pictures that are decoded in parallel to other pictures.
+   Independent slice segments of the same picture are decoded concurrently. */
+class thread_task_slice_segment_data : public thread_task
+{
+public:
+  thread_context* tctx;
+
+  virtual void work();
+  virtual std::string name() const;
+};
+
 
 int check_CTB_available(const de265_image* img,
                         int xC,int yC, int xN,int yN);
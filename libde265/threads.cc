@@ -21,6 +21,8 @@
 #include "threads.h"
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
+#include <thread>
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
 # include <malloc.h>
@@ -37,6 +39,15 @@
 #define THREAD_CALLING_CONVENTION
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#endif
 
 int  de265_thread_create(de265_thread* t, void *(*start_routine) (void *), void *arg) { return pthread_create(t,NULL,start_routine,arg); }
 void de265_thread_join(de265_thread t) { pthread_join(t,NULL); }
@@ -50,6 +61,90 @@ void de265_cond_destroy(de265_cond* c) { pthread_cond_destroy(c); }
 void de265_cond_broadcast(de265_cond* c,de265_mutex* m) { pthread_cond_broadcast(c); }
 void de265_cond_wait(de265_cond* c,de265_mutex* m) { pthread_cond_wait(c,m); }
 void de265_cond_signal(de265_cond* c) { pthread_cond_signal(c); }
+
+#if defined(__linux__)
+int  de265_thread_set_cpu_affinity(de265_thread t, const std::vector<int>& cpus)
+{
+  int nCPUs = (int)sysconf(_SC_NPROCESSORS_CONF);
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if (cpus.empty()) {
+    for (int i=0;i<nCPUs && i<CPU_SETSIZE;i++) {
+      CPU_SET(i, &set);
+    }
+  }
+  else {
+    for (int cpu : cpus) {
+      if (cpu<0 || cpu>=CPU_SETSIZE) {
+        return -1;
+      }
+      CPU_SET(cpu, &set);
+    }
+  }
+
+  return pthread_setaffinity_np(t, sizeof(set), &set);
+}
+
+int  de265_numa_node_of_cpus(const std::vector<int>& cpus)
+{
+  int node = -1;
+
+  for (int cpu : cpus) {
+    char path[100];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+      return -1;
+    }
+
+    int cpuNode = -1;
+    while (struct dirent* entry = readdir(dir)) {
+      if (strncmp(entry->d_name, "node", 4)==0 && isdigit(entry->d_name[4])) {
+        cpuNode = atoi(entry->d_name+4);
+        break;
+      }
+    }
+    closedir(dir);
+
+    if (cpuNode<0 || (node>=0 && cpuNode != node)) {
+      return -1;
+    }
+
+    node = cpuNode;
+  }
+
+  return node;
+}
+
+void de265_bind_memory_to_numa_node(void* mem, size_t size, int node)
+{
+#ifdef SYS_mbind
+  const int MPOL_PREFERRED_ = 1;
+  const unsigned int MPOL_MF_MOVE_ = (1<<1);
+
+  const int bitsPerLong = 8*sizeof(unsigned long);
+  if (node<0 || node >= 64*bitsPerLong) {
+    return;
+  }
+
+  unsigned long nodemask[64] = { 0 };
+  nodemask[node / bitsPerLong] = 1UL << (node % bitsPerLong);
+
+  // this is only a hint, errors (e.g. kernel without NUMA support) are ignored
+  syscall(SYS_mbind, mem, size, MPOL_PREFERRED_, nodemask,
+          (unsigned long)(64*bitsPerLong), MPOL_MF_MOVE_);
+#endif
+}
+#else
+int  de265_thread_set_cpu_affinity(de265_thread t, const std::vector<int>& cpus) { return cpus.empty() ? 0 : -1; }
+int  de265_numa_node_of_cpus(const std::vector<int>& cpus) { return -1; }
+void de265_bind_memory_to_numa_node(void* mem, size_t size, int node) { }
+#endif
+
+size_t de265_memory_page_size() { return (size_t)sysconf(_SC_PAGESIZE); }
 #else  // _WIN32
 
 #define THREAD_RESULT_TYPE    DWORD
@@ -80,6 +175,39 @@ void de265_cond_broadcast(de265_cond* c,de265_mutex* m)
 }
 void de265_cond_wait(de265_cond* c,de265_mutex* m) { win32_cond_wait(c,m); }
 void de265_cond_signal(de265_cond* c) { win32_cond_signal(c); }
+
+int  de265_thread_set_cpu_affinity(de265_thread t, const std::vector<int>& cpus)
+{
+  DWORD_PTR mask = 0;
+
+  if (cpus.empty()) {
+    DWORD_PTR systemMask;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask)) {
+      return -1;
+    }
+  }
+  else {
+    for (int cpu : cpus) {
+      if (cpu<0 || cpu >= (int)(8*sizeof(DWORD_PTR))) {
+        return -1;
+      }
+      mask |= ((DWORD_PTR)1) << cpu;
+    }
+  }
+
+  return SetThreadAffinityMask(t, mask) ? 0 : -1;
+}
+
+// NUMA placement would need VirtualAllocExNuma() for the image planes. Not supported yet.
+int  de265_numa_node_of_cpus(const std::vector<int>& cpus) { return -1; }
+void de265_bind_memory_to_numa_node(void* mem, size_t size, int node) { }
+
+size_t de265_memory_page_size()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
 #endif // _WIN32
 
 
@@ -88,6 +216,7 @@ void de265_cond_signal(de265_cond* c) { win32_cond_signal(c); }
 de265_progress_lock::de265_progress_lock()
 {
   mProgress = 0;
+  mNumWaiters = 0;
 
   de265_mutex_init(&mutex);
   de265_cond_init(&cond);
@@ -99,45 +228,124 @@ de265_progress_lock::~de265_progress_lock()
   de265_cond_destroy(&cond);
 }
 
+// thread pool bookkeeping of worker threads that wait inside a task (see below)
+static void current_thread_blocks();
+static void current_thread_unblocks();
+
+
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(_M_IX86) || defined(_M_X64)
+  _mm_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+  __asm__ __volatile__ ("yield");
+#endif
+}
+
+/* Most waits are short (e.g. for the CTB above-right in WPP decoding, which is
+   usually finished a few microseconds later). We therefore spin for a while
+   before parking the thread. The spin length adapts to how long successful
+   spins took in the past: it grows when spinning reaches the progress and
+   shrinks when we end up parking anyway.
+   On single-core machines, spinning cannot help and is disabled. */
+
+#define PROGRESS_SPIN_MIN      16
+#define PROGRESS_SPIN_MAX    4096
+
+static std::atomic<int> progress_spin_limit(256);
+
+static bool spinning_enabled()
+{
+  static const bool enabled = (std::thread::hardware_concurrency() != 1);
+  return enabled;
+}
+
 void de265_progress_lock::wait_for_progress(int progress)
 {
-  if (mProgress >= progress) {
+  if (mProgress.load(std::memory_order_acquire) >= progress) {
     return;
   }
 
+
+  // --- spin phase ---
+
+  if (spinning_enabled()) {
+    int limit = progress_spin_limit.load(std::memory_order_relaxed);
+
+    for (int i=0;i<limit;i++) {
+      cpu_relax();
+
+      if (mProgress.load(std::memory_order_acquire) >= progress) {
+        // move the limit towards twice the spin count that was needed
+
+        int target = std::min(2*(i+1) + PROGRESS_SPIN_MIN, PROGRESS_SPIN_MAX);
+        progress_spin_limit.store(limit + (target-limit)/8, std::memory_order_relaxed);
+        return;
+      }
+    }
+
+    int target = std::max(limit/2, PROGRESS_SPIN_MIN);
+    progress_spin_limit.store(target, std::memory_order_relaxed);
+  }
+
+
+  // --- park phase ---
+
+  current_thread_blocks();
+
   de265_mutex_lock(&mutex);
-  while (mProgress < progress) {
+
+  /* Register as waiter before checking the progress again. Together with the
+     sequentially consistent update in set_progress() / increase_progress(),
+     either we see the new progress here, or the writer sees our registration
+     and takes the mutex to wake us up. */
+  mNumWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+  while (mProgress.load(std::memory_order_seq_cst) < progress) {
     de265_cond_wait(&cond, &mutex);
   }
+
+  mNumWaiters.fetch_sub(1, std::memory_order_relaxed);
+
   de265_mutex_unlock(&mutex);
+
+  current_thread_unblocks();
 }
 
-void de265_progress_lock::set_progress(int progress)
+void de265_progress_lock::wake_waiters()
 {
-  de265_mutex_lock(&mutex);
-
-  if (progress>mProgress) {
-    mProgress = progress;
-
+  if (mNumWaiters.load(std::memory_order_seq_cst) > 0) {
+    de265_mutex_lock(&mutex);
     de265_cond_broadcast(&cond, &mutex);
+    de265_mutex_unlock(&mutex);
   }
+}
 
-  de265_mutex_unlock(&mutex);
+void de265_progress_lock::set_progress(int progress)
+{
+  int current = mProgress.load(std::memory_order_relaxed);
+
+  do {
+    if (progress <= current) {
+      return;
+    }
+  } while (!mProgress.compare_exchange_weak(current, progress, std::memory_order_seq_cst));
+
+  wake_waiters();
 }
 
 void de265_progress_lock::increase_progress(int progress)
 {
-  de265_mutex_lock(&mutex);
+  mProgress.fetch_add(progress, std::memory_order_seq_cst);
 
-  mProgress += progress;
-  de265_cond_broadcast(&cond, &mutex);
-
-  de265_mutex_unlock(&mutex);
+  wake_waiters();
 }
 
 int  de265_progress_lock::get_progress() const
 {
-  return mProgress;
+  return mProgress.load(std::memory_order_acquire);
 }
 
 
@@ -186,101 +394,423 @@ void printblks(const thread_pool* pool)
 #endif
 
 
-static THREAD_RESULT_TYPE THREAD_CALLING_CONVENTION worker_thread(THREAD_PARAM_TYPE pool_ptr)
+// the worker the current thread is running, NULL if this is not a worker thread
+static thread_local thread_pool_worker* current_worker = NULL;
+
+// the pool of the current thread, also set for spare threads
+static thread_local thread_pool* current_pool = NULL;
+
+
+typedef thread_pool_worker::queued_task queued_task;
+
+
+static bool runs_before(const queued_task& a, const queued_task& b)
 {
-  thread_pool* pool = (thread_pool*)pool_ptr;
+  const thread_task* ta = a.task;
+  const thread_task* tb = b.task;
 
+  // picture IDs may wrap around
+  int32_t pictureDiff = (int32_t)(ta->priority_picture - tb->priority_picture);
+  if (pictureDiff != 0) {
+    return pictureDiff < 0;
+  }
 
-  de265_mutex_lock(&pool->mutex);
+  if (ta->priority_stage != tb->priority_stage) {
+    return ta->priority_stage < tb->priority_stage;
+  }
 
-  while(true) {
+  if (ta->priority_ctb_row != tb->priority_ctb_row) {
+    return ta->priority_ctb_row < tb->priority_ctb_row;
+  }
 
-    // wait until we can pick a task or until the pool has been stopped
+  return a.sequence_number < b.sequence_number;
+}
 
-    for (;;) {
-      // end waiting if thread-pool has been stopped or we have a task to execute
 
-      if (pool->stopped || pool->tasks.size()>0) {
-        break;
-      }
+static void insert_sorted(std::deque<queued_task>& tasks, const queued_task& qtask)
+{
+  // Tasks are usually added in priority order. Hence, search from the back.
+
+  std::deque<queued_task>::iterator pos = tasks.end();
+  while (pos != tasks.begin() && runs_before(qtask, *(pos-1))) {
+    --pos;
+  }
+
+  tasks.insert(pos, qtask);
+}
 
-      //printf("going idle\n");
-      de265_cond_wait(&pool->cond_var, &pool->mutex);
+
+static void push_task(thread_pool_worker* worker, thread_task* task)
+{
+  thread_pool* pool = worker->pool;
+
+  de265_mutex_lock(&worker->mutex);
+
+  queued_task qtask;
+  qtask.task = task;
+  qtask.sequence_number = pool->next_sequence_number++;
+
+  insert_sorted(worker->tasks, qtask);
+
+  de265_mutex_unlock(&worker->mutex);
+}
+
+
+static thread_task* pop_task(thread_pool_worker* worker)
+{
+  thread_task* task = NULL;
+
+  de265_mutex_lock(&worker->mutex);
+  if (!worker->tasks.empty()) {
+    task = worker->tasks.front().task;
+    worker->tasks.pop_front();
+  }
+  de265_mutex_unlock(&worker->mutex);
+
+  return task;
+}
+
+
+/* Remove the most urgent task from the queues of all workers except 'self'.
+   Returns false if there was nothing to take.
+ */
+static bool take_most_urgent_task(thread_pool* pool, const thread_pool_worker* self,
+                                  queued_task* out_task)
+{
+  // find the queue with the most urgent task
+
+  thread_pool_worker* victim = NULL;
+  queued_task best;
+
+  for (int i=0;i<pool->num_threads;i++) {
+    thread_pool_worker* w = pool->worker[i];
+    if (w == self) {
+      continue;
+    }
+
+    de265_mutex_lock(&w->mutex);
+    if (!w->tasks.empty() &&
+        (victim==NULL || runs_before(w->tasks.front(), best))) {
+      victim = w;
+      best = w->tasks.front();
     }
+    de265_mutex_unlock(&w->mutex);
+  }
+
+  if (victim==NULL) {
+    return false;
+  }
+
+
+  // take it (or whatever is now at the front of that queue)
+
+  de265_mutex_lock(&victim->mutex);
+  if (victim->tasks.empty()) {
+    de265_mutex_unlock(&victim->mutex);
+    return false;
+  }
+
+  *out_task = victim->tasks.front();
+  victim->tasks.pop_front();
+  de265_mutex_unlock(&victim->mutex);
+
+  return true;
+}
+
+
+/* Move the most urgent task of the other workers into our own queue.
+   Returns false if there was nothing to steal.
+ */
+static bool steal_task(thread_pool_worker* worker)
+{
+  queued_task qtask;
+  if (!take_most_urgent_task(worker->pool, worker, &qtask)) {
+    return false;
+  }
+
+  // Insert the task sorted into our queue. Some other thread might have added
+  // more urgent tasks to it in the meantime.
+
+  de265_mutex_lock(&worker->mutex);
+  insert_sorted(worker->tasks, qtask);
+  de265_mutex_unlock(&worker->mutex);
+
+  return true;
+}
+
+
+static THREAD_RESULT_TYPE THREAD_CALLING_CONVENTION worker_thread(THREAD_PARAM_TYPE worker_ptr)
+{
+  thread_pool_worker* worker = (thread_pool_worker*)worker_ptr;
+  thread_pool* pool = worker->pool;
+
+  current_worker = worker;
+  current_pool   = pool;
+
+  while(true) {
 
     // if the pool was shut down, end the execution
 
     if (pool->stopped) {
-      de265_mutex_unlock(&pool->mutex);
       return (THREAD_RESULT_TYPE)0;
     }
 
 
-    // get a task
+    // get a task, from our own queue if possible
 
-    thread_task* task = pool->tasks.front();
-    pool->tasks.pop_front();
+    thread_task* task = pop_task(worker);
+    if (task == NULL && steal_task(worker)) {
+      task = pop_task(worker);
+    }
+
+
+    // wait until there is a new task or until the pool has been stopped
+
+    if (task == NULL) {
+      de265_mutex_lock(&pool->mutex);
+
+      pool->num_threads_idle++;
 
+      while (!pool->stopped && pool->num_tasks_queued <= 0) {
+        de265_cond_wait(&pool->cond_var, &pool->mutex);
+      }
+
+      pool->num_threads_idle--;
+
+      de265_mutex_unlock(&pool->mutex);
+      continue;
+    }
+
+    pool->num_tasks_queued--;
     pool->num_threads_working++;
 
     //printblks(pool);
 
-    de265_mutex_unlock(&pool->mutex);
-
 
     // execute the task
 
     task->work();
 
-    // end processing and check if this was the last task to be processed
+    pool->num_threads_working--;
+  }
+
+  return (THREAD_RESULT_TYPE)0;
+}
+
+
+static THREAD_RESULT_TYPE THREAD_CALLING_CONVENTION spare_thread(THREAD_PARAM_TYPE pool_ptr);
+
+static bool all_threads_blocked(const thread_pool* pool)
+{
+  return pool->num_threads_blocked >= pool->num_threads + pool->num_spare_threads_active;
+}
+
+
+/* If all threads are blocked but there are still tasks queued, activate a spare thread.
+   Must be called with the pool mutex held. */
+static void activate_spare_thread_if_needed(thread_pool* pool)
+{
+  if (pool->stopped || pool->num_tasks_queued <= 0 || !all_threads_blocked(pool)) {
+    return;
+  }
+
+  pool->num_spare_threads_active++;
 
+  if (pool->num_spare_threads_parked > pool->num_spare_thread_wakeups) {
+    pool->num_spare_thread_wakeups++;
+    de265_cond_broadcast(&pool->spare_cond_var, &pool->mutex);
+  }
+  else {
+    de265_thread thread;
+    if (de265_thread_create(&thread, spare_thread, pool) == 0) {
+      if (!pool->cpu_affinity.empty()) {
+        de265_thread_set_cpu_affinity(thread, pool->cpu_affinity);
+      }
+
+      pool->spare_thread.push_back(thread);
+    }
+    else {
+      pool->num_spare_threads_active--;
+    }
+  }
+}
+
+
+static void current_thread_blocks()
+{
+  thread_pool* pool = current_pool;
+  if (pool == NULL) {
+    return;
+  }
+
+  pool->num_threads_blocked++;
+
+  if (all_threads_blocked(pool)) {
     de265_mutex_lock(&pool->mutex);
+    activate_spare_thread_if_needed(pool);
+    de265_mutex_unlock(&pool->mutex);
+  }
+}
 
-    pool->num_threads_working--;
+
+static void current_thread_unblocks()
+{
+  thread_pool* pool = current_pool;
+  if (pool == NULL) {
+    return;
   }
-  de265_mutex_unlock(&pool->mutex);
 
-  return (THREAD_RESULT_TYPE)0;
+  pool->num_threads_blocked--;
 }
 
 
-de265_error start_thread_pool(thread_pool* pool, int num_threads)
+static THREAD_RESULT_TYPE THREAD_CALLING_CONVENTION spare_thread(THREAD_PARAM_TYPE pool_ptr)
 {
-  de265_error err = DE265_OK;
+  thread_pool* pool = (thread_pool*)pool_ptr;
 
-  // limit number of threads to maximum
+  current_pool = pool;
 
-  if (num_threads > MAX_THREADS) {
-    num_threads = MAX_THREADS;
-    err = DE265_WARNING_NUMBER_OF_THREADS_LIMITED_TO_MAXIMUM;
+  for (;;) {
+
+    // run tasks as long as all other threads are blocked
+
+    while (!pool->stopped) {
+      queued_task qtask;
+      if (!take_most_urgent_task(pool, NULL, &qtask)) {
+        break;
+      }
+
+      pool->num_tasks_queued--;
+      pool->num_threads_working++;
+
+      qtask.task->work();
+
+      pool->num_threads_working--;
+
+      if (pool->num_threads_blocked < pool->num_threads + pool->num_spare_threads_active - 1) {
+        break;
+      }
+    }
+
+
+    // park until we are needed again
+
+    de265_mutex_lock(&pool->mutex);
+
+    pool->num_spare_threads_active--;
+    pool->num_spare_threads_parked++;
+
+    // some thread may have blocked in the meantime, still seeing us as active
+    activate_spare_thread_if_needed(pool);
+
+    while (!pool->stopped && pool->num_spare_thread_wakeups==0) {
+      de265_cond_wait(&pool->spare_cond_var, &pool->mutex);
+    }
+
+    pool->num_spare_threads_parked--;
+
+    if (pool->stopped) {
+      de265_mutex_unlock(&pool->mutex);
+      return (THREAD_RESULT_TYPE)0;
+    }
+
+    pool->num_spare_thread_wakeups--;
+
+    de265_mutex_unlock(&pool->mutex);
   }
+}
+
+
+de265_error start_thread_pool(thread_pool* pool, int num_threads,
+                              const std::vector<int>& cpu_affinity)
+{
+  de265_error err = DE265_OK;
 
   pool->num_threads = 0; // will be increased below
 
   de265_mutex_init(&pool->mutex);
   de265_cond_init(&pool->cond_var);
+  de265_cond_init(&pool->spare_cond_var);
 
-  de265_mutex_lock(&pool->mutex);
   pool->num_threads_working = 0;
+  pool->num_threads_blocked = 0;
+  pool->num_threads_idle = 0;
+  pool->num_tasks_queued = 0;
+  pool->next_sequence_number = 0;
+  pool->next_worker = 0;
+  pool->num_spare_threads_active = 0;
+  pool->num_spare_threads_parked = 0;
+  pool->num_spare_thread_wakeups = 0;
   pool->stopped = false;
-  de265_mutex_unlock(&pool->mutex);
+  pool->cpu_affinity = cpu_affinity;
+  pool->numa_node = de265_numa_node_of_cpus(cpu_affinity);
+
+  // limit number of threads to maximum
+
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+    err = DE265_WARNING_NUMBER_OF_THREADS_LIMITED_TO_MAXIMUM;
+  }
+
+  pool->worker.resize(num_threads);
+
+  for (int i=0; i<num_threads; i++) {
+    thread_pool_worker* worker = new thread_pool_worker;
+
+    worker->pool  = pool;
+    de265_mutex_init(&worker->mutex);
+
+    pool->worker[i] = worker;
+  }
 
   // start worker threads
 
   for (int i=0; i<num_threads; i++) {
-    int ret = de265_thread_create(&pool->thread[i], worker_thread, pool);
+    int ret = de265_thread_create(&pool->worker[i]->thread, worker_thread, pool->worker[i]);
     if (ret != 0) {
       // cerr << "pthread_create() failed: " << ret << endl;
       return DE265_ERROR_CANNOT_START_THREADPOOL;
     }
 
     pool->num_threads++;
+
+    if (!cpu_affinity.empty() &&
+        de265_thread_set_cpu_affinity(pool->worker[i]->thread, cpu_affinity) != 0) {
+      err = DE265_ERROR_CANNOT_SET_CPU_AFFINITY;
+    }
   }
 
   return err;
 }
 
 
+de265_error set_thread_pool_cpu_affinity(thread_pool* pool, const std::vector<int>& cpus)
+{
+  de265_error err = DE265_OK;
+
+  de265_mutex_lock(&pool->mutex);
+
+  pool->cpu_affinity = cpus;
+  pool->numa_node = de265_numa_node_of_cpus(cpus);
+
+  for (int i=0;i<pool->num_threads;i++) {
+    if (de265_thread_set_cpu_affinity(pool->worker[i]->thread, cpus) != 0) {
+      err = DE265_ERROR_CANNOT_SET_CPU_AFFINITY;
+    }
+  }
+
+  for (size_t i=0;i<pool->spare_thread.size();i++) {
+    if (de265_thread_set_cpu_affinity(pool->spare_thread[i], cpus) != 0) {
+      err = DE265_ERROR_CANNOT_SET_CPU_AFFINITY;
+    }
+  }
+
+  de265_mutex_unlock(&pool->mutex);
+
+  return err;
+}
+
+
 void stop_thread_pool(thread_pool* pool)
 {
   de265_mutex_lock(&pool->mutex);
@@ -288,27 +818,63 @@ void stop_thread_pool(thread_pool* pool)
   de265_mutex_unlock(&pool->mutex);
 
   de265_cond_broadcast(&pool->cond_var, &pool->mutex);
+  de265_cond_broadcast(&pool->spare_cond_var, &pool->mutex);
 
   for (int i=0;i<pool->num_threads;i++) {
-    de265_thread_join(pool->thread[i]);
-    de265_thread_destroy(&pool->thread[i]);
+    de265_thread_join(pool->worker[i]->thread);
+    de265_thread_destroy(&pool->worker[i]->thread);
+  }
+
+  // no more spare threads can be started now that the pool is stopped
+
+  for (size_t i=0;i<pool->spare_thread.size();i++) {
+    de265_thread_join(pool->spare_thread[i]);
+    de265_thread_destroy(&pool->spare_thread[i]);
+  }
+  pool->spare_thread.clear();
+
+  for (size_t i=0;i<pool->worker.size();i++) {
+    de265_mutex_destroy(&pool->worker[i]->mutex);
+    delete pool->worker[i];
   }
+  pool->worker.clear();
+  pool->num_threads = 0;
 
   de265_mutex_destroy(&pool->mutex);
   de265_cond_destroy(&pool->cond_var);
+  de265_cond_destroy(&pool->spare_cond_var);
 }
 
 
 void   add_task(thread_pool* pool, thread_task* task)
 {
-  de265_mutex_lock(&pool->mutex);
-  if (!pool->stopped) {
+  if (pool->stopped || pool->num_threads==0) {
+    return;
+  }
 
-    pool->tasks.push_back(task);
+  // Tasks added by a worker thread stay in its queue. They will probably work
+  // on data that is still in the cache of this worker.
 
-    // wake up one thread
+  thread_pool_worker* worker = current_worker;
+  if (worker == NULL || worker->pool != pool) {
+    worker = pool->worker[ (unsigned int)(pool->next_worker++) % pool->num_threads ];
+  }
 
+  push_task(worker, task);
+
+  pool->num_tasks_queued++;
+
+  // Wake up one thread. Idle workers increase 'num_threads_idle' before checking
+  // 'num_tasks_queued', hence either they see the new task or we see them.
+
+  if (pool->num_threads_idle > 0) {
+    de265_mutex_lock(&pool->mutex);
     de265_cond_signal(&pool->cond_var);
+    de265_mutex_unlock(&pool->mutex);
+  }
+  else if (all_threads_blocked(pool)) {
+    de265_mutex_lock(&pool->mutex);
+    activate_spare_thread_if_needed(pool);
+    de265_mutex_unlock(&pool->mutex);
   }
-  de265_mutex_unlock(&pool->mutex);
 }
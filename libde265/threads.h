@@ -28,6 +28,7 @@
 #endif
 
 #include <deque>
+#include <vector>
 #include <string>
 #include <atomic>
 
@@ -70,6 +71,17 @@ void de265_cond_broadcast(de265_cond* c, de265_mutex* m);
 void de265_cond_wait(de265_cond* c,de265_mutex* m);
 void de265_cond_signal(de265_cond* c);
 
+// Restrict the thread to the given CPUs (empty: all CPUs). Returns 0 on success.
+int  de265_thread_set_cpu_affinity(de265_thread t, const std::vector<int>& cpus);
+
+// NUMA node of the CPUs, -1 if unknown or if the CPUs span several nodes.
+int  de265_numa_node_of_cpus(const std::vector<int>& cpus);
+
+/* Ask the OS to place the memory on the NUMA node. 'mem' and 'size' must be
+   multiples of de265_memory_page_size(). Without NUMA support, this does nothing. */
+void de265_bind_memory_to_numa_node(void* mem, size_t size, int node);
+size_t de265_memory_page_size();
+
 
 class de265_progress_lock
 {
@@ -81,15 +93,21 @@ public:
   void set_progress(int progress);
   void increase_progress(int progress);
   int  get_progress() const;
-  void reset(int value=0) { mProgress=value; }
+  void reset(int value=0) { mProgress.store(value, std::memory_order_relaxed); }
 
 private:
-  int mProgress;
+  /* The progress value is read and written without holding the mutex.
+     The mutex/cond pair is only used to park threads that have to wait
+     for longer, and it is only signalled when there are parked waiters. */
+  std::atomic<int> mProgress;
+  std::atomic<int> mNumWaiters;
 
   // private data
 
   de265_mutex mutex;
   de265_cond  cond;
+
+  void wake_waiters();
 };
 
 
@@ -97,48 +115,116 @@ private:
 class thread_task
 {
 public:
-  thread_task() : state(Queued) { }
+  thread_task() : state(Queued), priority_picture(0), priority_stage(0), priority_ctb_row(0) { }
   virtual ~thread_task() { }
 
   enum { Queued, Running, Blocked, Finished } state;
 
+  // pipeline stages, in the order in which they are applied to a picture
+  enum Stage { StageDecode, StageReconstruct, StageDeblockVertical, StageDeblockHorizontal, StageSAO };
+
+  /* Tasks of pictures that started decoding earlier are preferred, within a picture
+     tasks of earlier pipeline stages, and within a stage tasks of lower CTB rows.
+     A task may only wait for tasks that have been added before it and that have a
+     higher priority. */
+  void set_priority(uint32_t picture_ID, enum Stage stage, int ctb_row) {
+    priority_picture = picture_ID;
+    priority_stage   = stage;
+    priority_ctb_row = ctb_row;
+  }
+
+  uint32_t priority_picture;
+  int      priority_stage;
+  int      priority_ctb_row;
+
   virtual void work() = 0;
 
   virtual std::string name() const { return "noname"; }
 };
 
 
-#define MAX_THREADS 32
+// Upper limit for the worker threads of one pool. Workers are allocated dynamically,
+// the limit only protects against absurd requests.
+#define MAX_THREADS 256
+
+class thread_pool;
+
+/* Each worker thread has its own task queue. Tasks that are added from within a worker
+   thread go into its own queue, tasks added from outside are distributed over all workers.
+   A worker whose queue runs empty steals the most urgent task from the other queues.
 
-/* TODO NOTE: When unblocking a task, we have to check first
-   if there are threads waiting because of the run-count limit.
-   If there are higher-priority tasks, those should be run instead
-   of the just unblocked task.
+   Each queue is sorted by task priority (see thread_task::set_priority()), tasks with
+   the same priority are run in the order in which they were added. Tasks may block
+   while waiting for tasks of higher priority. A worker always runs the first task of
+   its own queue, and stolen tasks are first sorted into the own queue. Hence, the
+   highest-priority unfinished task can always run and no deadlock can occur.
  */
+struct thread_pool_worker
+{
+  struct queued_task {
+    thread_task* task;  // we are not the owner
+    uint64_t     sequence_number;
+  };
+
+  thread_pool* pool;
+
+  de265_thread thread;
 
+  std::deque<queued_task> tasks;
+  de265_mutex  mutex;  // protects 'tasks'
+};
+
+
+/* A thread pool may be shared by several decoders. Since the tasks of different
+   decoders do not wait for each other, the priority order alone cannot prevent that
+   all workers are blocked by one decoder while another decoder has tasks queued.
+   When this happens, a spare thread is activated that runs queued tasks until one
+   of the other threads continues. Spare threads are kept parked for later reuse.
+ */
 class thread_pool
 {
  public:
-  bool stopped;
-
-  std::deque<thread_task*> tasks;  // we are not the owner
+  std::atomic<bool> stopped;
 
-  de265_thread thread[MAX_THREADS];
+  std::vector<thread_pool_worker*> worker;
   int num_threads;
 
-  int num_threads_working;
+  std::atomic<int> num_threads_working;
+  std::atomic<int> num_threads_blocked;  // including spare threads
+  std::atomic<int> num_tasks_queued;
+
+  std::atomic<uint64_t> next_sequence_number;
+  std::atomic<int>      next_worker; // worker queue for the next task added from outside
 
-  int ctbx[MAX_THREADS]; // the CTB the thread is working on
-  int ctby[MAX_THREADS];
+  // idle workers wait for new tasks
 
+  std::atomic<int> num_threads_idle;
   de265_mutex  mutex;
   de265_cond   cond_var;
+
+  // spare threads (protected by 'mutex')
+
+  std::vector<de265_thread> spare_thread;
+  std::atomic<int> num_spare_threads_active;
+  int          num_spare_threads_parked;
+  int          num_spare_thread_wakeups;
+  de265_cond   spare_cond_var;
+
+  // CPU placement (protected by 'mutex')
+
+  std::vector<int> cpu_affinity;  // empty: threads may run on all CPUs
+  std::atomic<int> numa_node;     // node of 'cpu_affinity' or -1 if unknown
 };
 
 
-de265_error start_thread_pool(thread_pool* pool, int num_threads);
+de265_error start_thread_pool(thread_pool* pool, int num_threads,
+                              const std::vector<int>& cpu_affinity = std::vector<int>());
 void        stop_thread_pool(thread_pool* pool); // do not process remaining tasks
 
+/* Pin all threads of the pool (including spare threads started later) to the CPUs.
+   Pictures decoded by this pool are allocated on the NUMA node of these CPUs. */
+de265_error set_thread_pool_cpu_affinity(thread_pool* pool, const std::vector<int>& cpus);
+
 void        add_task(thread_pool* pool, thread_task* task); // TOCO: can make thread_task const
 
 #endif
@@ -243,23 +243,12 @@ void transform_coefficients(acceleration_functions* acceleration,
 }
 
 
-// TODO: make this an accelerated function
 void cross_comp_pred(const thread_context* tctx, int32_t* residual, int nT)
 {
-  const int BitDepthC = tctx->img->get_sps().BitDepth_C;
-  const int BitDepthY = tctx->img->get_sps().BitDepth_Y;
+  const seq_parameter_set& sps = tctx->img->get_sps();
 
-  for (int y=0;y<nT;y++)
-    for (int x=0;x<nT;x++) {
-      /* TODO: the most usual case is definitely BitDepthY == BitDepthC, in which case
-         we could just omit two shifts. The second most common case is probably
-         BitDepthY>BitDepthC, for which we could also eliminate one shift. The remaining
-         case is also one shift only.
-      */
-
-      residual[y*nT+x] += (tctx->ResScaleVal *
-                           ((tctx->residual_luma[y*nT+x] << BitDepthC ) >> BitDepthY ) ) >> 3;
-    }
+  tctx->decctx->acceleration.cross_comp_pred(residual, tctx->residual_luma, nT,
+                                             tctx->ResScaleVal, sps.BitDepth_Y, sps.BitDepth_C);
 }
 
 
@@ -461,35 +450,23 @@ void scale_coefficients_internal(thread_context* tctx,
 
     // --- inverse quantization ---
 
-    if (sps.scaling_list_enable_flag==0) {
-
-      //const int m_x_y = 16;
-      const int m_x_y = 1;
-      bdShift -= 4;  // this is equivalent to having a m_x_y of 16 and we can use 32bit integers
-
-      const int offset = (1<<(bdShift-1));
-      const int fact = m_x_y * levelScale[qP%6] << (qP/6);
+    // Expand the coefficient list into the block and determine the region
+    // that contains all coded coefficients, rounded up to whole 4x4 sub-blocks.
 
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
+    const int log2nT = Log2(nT);
+    int xMax=0, yMax=0;
 
-        // usually, this needs to be 64bit, but because we modify the shift above, we can use 16 bit
-        int32_t currCoeff  = tctx->coeffList[cIdx][i];
-
-        //logtrace(LogTransform,"coefficient[%d] = %d\n",tctx->coeffPos[cIdx][i],
-        //tctx->coeffList[cIdx][i]);
-
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
-
-        //logtrace(LogTransform," -> %d\n",currCoeff);
+    for (int i=0;i<tctx->nCoeff[cIdx];i++) {
+      int pos = tctx->coeffPos[cIdx][i];
+      tctx->coeffBuf[pos] = tctx->coeffList[cIdx][i];
 
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
-      }
+      xMax  = libde265_max(xMax, pos & (nT-1));
+      yMax  = libde265_max(yMax, pos >> log2nT);
     }
-    else {
-      const int offset = (1<<(bdShift-1));
 
-      const uint8_t* sclist;
+    const uint8_t* sclist = NULL;
+
+    if (sps.scaling_list_enable_flag) {
       int matrixID = cIdx;
       if (!intra) {
         if (nT<32) { matrixID += 3; }
@@ -503,22 +480,11 @@ void scale_coefficients_internal(thread_context* tctx,
       case 32: sclist = &pps.scaling_list.ScalingFactor_Size3[matrixID][0][0]; break;
       default: assert(0);
       }
-
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
-        int pos = tctx->coeffPos[cIdx][i];
-
-        const int m_x_y = sclist[pos];
-        const int fact = m_x_y * levelScale[qP%6] << (qP/6);
-
-        int64_t currCoeff  = tctx->coeffList[cIdx][i];
-
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
-
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
-      }
     }
 
+    tctx->decctx->acceleration.scale_coefficients(coeff, nT, (xMax|3)+1, (yMax|3)+1,
+                                                  sclist, levelScale[qP%6], qP/6, bdShift);
+
 
     // --- do transform or skip ---
 
@@ -0,0 +1,1119 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "avx2-dct.h"
+#include "libde265/util.h"
+#include "libde265/fallback-dct.h"
+
+
+/* The inverse transforms are computed exactly like the fallback functions:
+   a vertical pass with a fixed 7 bit shift and 16 bit clipping, followed by a
+   horizontal pass with a shift of 20-BitDepth (12 for the 8 bit functions).
+
+   The vertical pass works on 16 (or 8) columns in parallel and uses the
+   symmetry of the DCT basis functions to compute two output rows at once.
+   The horizontal pass computes 8 output samples per register, multiplying
+   pairs of intermediate values with interleaved pairs of matrix coefficients.
+   Rows and columns beyond the last non-zero coefficient are skipped. */
+
+static const int8_t mat_dst[4][4] = {
+  { 29, 55, 74, 84 },
+  { 74, 74,  0,-74 },
+  { 84,-29,-74, 55 },
+  { 55,-84, 74,-29 }
+};
+
+static const int8_t mat_dct[32][32] = {
+  { 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64},
+  { 90, 90, 88, 85, 82, 78, 73, 67, 61, 54, 46, 38, 31, 22, 13,  4,      -4,-13,-22,-31,-38,-46,-54,-61,-67,-73,-78,-82,-85,-88,-90,-90},
+  { 90, 87, 80, 70, 57, 43, 25,  9, -9,-25,-43,-57,-70,-80,-87,-90,     -90,-87,-80,-70,-57,-43,-25, -9,  9, 25, 43, 57, 70, 80, 87, 90},
+  { 90, 82, 67, 46, 22, -4,-31,-54,-73,-85,-90,-88,-78,-61,-38,-13,      13, 38, 61, 78, 88, 90, 85, 73, 54, 31,  4,-22,-46,-67,-82,-90},
+  { 89, 75, 50, 18,-18,-50,-75,-89,-89,-75,-50,-18, 18, 50, 75, 89,      89, 75, 50, 18,-18,-50,-75,-89,-89,-75,-50,-18, 18, 50, 75, 89},
+  { 88, 67, 31,-13,-54,-82,-90,-78,-46, -4, 38, 73, 90, 85, 61, 22,     -22,-61,-85,-90,-73,-38,  4, 46, 78, 90, 82, 54, 13,-31,-67,-88},
+  { 87, 57,  9,-43,-80,-90,-70,-25, 25, 70, 90, 80, 43, -9,-57,-87,     -87,-57, -9, 43, 80, 90, 70, 25,-25,-70,-90,-80,-43,  9, 57, 87},
+  { 85, 46,-13,-67,-90,-73,-22, 38, 82, 88, 54, -4,-61,-90,-78,-31,      31, 78, 90, 61,  4,-54,-88,-82,-38, 22, 73, 90, 67, 13,-46,-85},
+  { 83, 36,-36,-83,-83,-36, 36, 83, 83, 36,-36,-83,-83,-36, 36, 83,      83, 36,-36,-83,-83,-36, 36, 83, 83, 36,-36,-83,-83,-36, 36, 83},
+  { 82, 22,-54,-90,-61, 13, 78, 85, 31,-46,-90,-67,  4, 73, 88, 38,     -38,-88,-73, -4, 67, 90, 46,-31,-85,-78,-13, 61, 90, 54,-22,-82},
+  { 80,  9,-70,-87,-25, 57, 90, 43,-43,-90,-57, 25, 87, 70, -9,-80,     -80, -9, 70, 87, 25,-57,-90,-43, 43, 90, 57,-25,-87,-70,  9, 80},
+  { 78, -4,-82,-73, 13, 85, 67,-22,-88,-61, 31, 90, 54,-38,-90,-46,      46, 90, 38,-54,-90,-31, 61, 88, 22,-67,-85,-13, 73, 82,  4,-78},
+  { 75,-18,-89,-50, 50, 89, 18,-75,-75, 18, 89, 50,-50,-89,-18, 75,      75,-18,-89,-50, 50, 89, 18,-75,-75, 18, 89, 50,-50,-89,-18, 75},
+  { 73,-31,-90,-22, 78, 67,-38,-90,-13, 82, 61,-46,-88, -4, 85, 54,     -54,-85,  4, 88, 46,-61,-82, 13, 90, 38,-67,-78, 22, 90, 31,-73},
+  { 70,-43,-87,  9, 90, 25,-80,-57, 57, 80,-25,-90, -9, 87, 43,-70,     -70, 43, 87, -9,-90,-25, 80, 57,-57,-80, 25, 90,  9,-87,-43, 70},
+  { 67,-54,-78, 38, 85,-22,-90,  4, 90, 13,-88,-31, 82, 46,-73,-61,      61, 73,-46,-82, 31, 88,-13,-90, -4, 90, 22,-85,-38, 78, 54,-67},
+  { 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64,      64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64},
+  { 61,-73,-46, 82, 31,-88,-13, 90, -4,-90, 22, 85,-38,-78, 54, 67,     -67,-54, 78, 38,-85,-22, 90,  4,-90, 13, 88,-31,-82, 46, 73,-61},
+  { 57,-80,-25, 90, -9,-87, 43, 70,-70,-43, 87,  9,-90, 25, 80,-57,     -57, 80, 25,-90,  9, 87,-43,-70, 70, 43,-87, -9, 90,-25,-80, 57},
+  { 54,-85, -4, 88,-46,-61, 82, 13,-90, 38, 67,-78,-22, 90,-31,-73,      73, 31,-90, 22, 78,-67,-38, 90,-13,-82, 61, 46,-88,  4, 85,-54},
+  { 50,-89, 18, 75,-75,-18, 89,-50,-50, 89,-18,-75, 75, 18,-89, 50,      50,-89, 18, 75,-75,-18, 89,-50,-50, 89,-18,-75, 75, 18,-89, 50},
+  { 46,-90, 38, 54,-90, 31, 61,-88, 22, 67,-85, 13, 73,-82,  4, 78,     -78, -4, 82,-73,-13, 85,-67,-22, 88,-61,-31, 90,-54,-38, 90,-46},
+  { 43,-90, 57, 25,-87, 70,  9,-80, 80, -9,-70, 87,-25,-57, 90,-43,     -43, 90,-57,-25, 87,-70, -9, 80,-80,  9, 70,-87, 25, 57,-90, 43},
+  { 38,-88, 73, -4,-67, 90,-46,-31, 85,-78, 13, 61,-90, 54, 22,-82,      82,-22,-54, 90,-61,-13, 78,-85, 31, 46,-90, 67,  4,-73, 88,-38},
+  { 36,-83, 83,-36,-36, 83,-83, 36, 36,-83, 83,-36,-36, 83,-83, 36,      36,-83, 83,-36,-36, 83,-83, 36, 36,-83, 83,-36,-36, 83,-83, 36},
+  { 31,-78, 90,-61,  4, 54,-88, 82,-38,-22, 73,-90, 67,-13,-46, 85,     -85, 46, 13,-67, 90,-73, 22, 38,-82, 88,-54, -4, 61,-90, 78,-31},
+  { 25,-70, 90,-80, 43,  9,-57, 87,-87, 57, -9,-43, 80,-90, 70,-25,     -25, 70,-90, 80,-43, -9, 57,-87, 87,-57,  9, 43,-80, 90,-70, 25},
+  { 22,-61, 85,-90, 73,-38, -4, 46,-78, 90,-82, 54,-13,-31, 67,-88,      88,-67, 31, 13,-54, 82,-90, 78,-46,  4, 38,-73, 90,-85, 61,-22},
+  { 18,-50, 75,-89, 89,-75, 50,-18,-18, 50,-75, 89,-89, 75,-50, 18,      18,-50, 75,-89, 89,-75, 50,-18,-18, 50,-75, 89,-89, 75,-50, 18},
+  { 13,-38, 61,-78, 88,-90, 85,-73, 54,-31,  4, 22,-46, 67,-82, 90,     -90, 82,-67, 46,-22, -4, 31,-54, 73,-85, 90,-88, 78,-61, 38,-13},
+  {  9,-25, 43,-57, 70,-80, 87,-90, 90,-87, 80,-70, 57,-43, 25, -9,      -9, 25,-43, 57,-70, 80,-87, 90,-90, 87,-80, 70,-57, 43,-25,  9},
+  {  4,-13, 22,-31, 38,-46, 54,-61, 67,-73, 78,-82, 85,-88, 90,-90,      90,-90, 88,-85, 82,-78, 73,-67, 61,-54, 46,-38, 31,-22, 13, -4}
+};
+
+
+static inline int32_t coeff_pair(int a, int b)
+{
+  return (int32_t)((uint16_t)a | ((uint32_t)(uint16_t)b << 16));
+}
+
+
+/* Matrix coefficients rearranged for PMADDWD. Index [log2nT-2] selects the DCT size.
+
+   col_even/col_odd: for vertical output row i < nT/2, the pairs (M[j][i],M[j+2][i])
+   for j=0,4,8,... (even) and j=1,5,9,... (odd). Row nT-1-i is even-odd instead of
+   even+odd.
+
+   row: for each pair of input columns (2p,2p+1) the pairs (M[2p][i],M[2p+1][i])
+   for all output samples i.
+
+   The 4x4 transforms (DST and DCT) do not use the symmetry and have their own
+   tables, indexed with 0 for the DST and 1 for the DCT. */
+
+struct idct_tables
+{
+  int32_t col_even[4][16][8];
+  int32_t col_odd [4][16][8];
+  ALIGNED_32(int16_t row[4][16][64]);
+
+  int32_t col_4x4[2][4][2];
+  ALIGNED_16(int16_t row_4x4[2][2][8]);
+
+  idct_tables();
+};
+
+idct_tables::idct_tables()
+{
+  for (int log2nT=3; log2nT<=5; log2nT++) {
+    int nT = 1<<log2nT;
+    int fact = 1<<(5-log2nT);
+
+    for (int i=0;i<nT/2;i++)
+      for (int k=0;k<nT/4;k++) {
+        col_even[log2nT-2][i][k] = coeff_pair(mat_dct[fact*(4*k  )][i], mat_dct[fact*(4*k+2)][i]);
+        col_odd [log2nT-2][i][k] = coeff_pair(mat_dct[fact*(4*k+1)][i], mat_dct[fact*(4*k+3)][i]);
+      }
+
+    for (int p=0;p<nT/2;p++)
+      for (int i=0;i<nT;i++) {
+        row[log2nT-2][p][2*i  ] = mat_dct[fact*(2*p  )][i];
+        row[log2nT-2][p][2*i+1] = mat_dct[fact*(2*p+1)][i];
+      }
+  }
+
+  for (int t=0;t<2;t++)
+    for (int i=0;i<4;i++) {
+      int m[4];
+      for (int j=0;j<4;j++) {
+        m[j] = (t==0 ? mat_dst[j][i] : mat_dct[8*j][i]);
+      }
+
+      col_4x4[t][i][0] = coeff_pair(m[0],m[1]);
+      col_4x4[t][i][1] = coeff_pair(m[2],m[3]);
+
+      row_4x4[t][0][2*i] = m[0];  row_4x4[t][0][2*i+1] = m[1];
+      row_4x4[t][1][2*i] = m[2];  row_4x4[t][1][2*i+1] = m[3];
+    }
+}
+
+static const idct_tables tables;
+
+
+static inline int highest_bit(uint32_t v)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanReverse(&idx, v);
+  return idx;
+#else
+  return 31 - __builtin_clz(v);
+#endif
+}
+
+static inline int32_t load32(const uint8_t* p)
+{
+  int32_t v;
+  memcpy(&v,p,4);
+  return v;
+}
+
+static inline void store32(uint8_t* p, int32_t v)
+{
+  memcpy(p,&v,4);
+}
+
+
+// --- 4x4 ---
+
+/* Computes the 4x4 transform t (0: DST, 1: DCT). Each output register holds one
+   row of four 32 bit samples, rounded and shifted by 'shift'. */
+static inline void transform_4x4(__m128i out[4], const int16_t* coeffs, int t,
+                                 __m128i rnd2, __m128i shift)
+{
+  const __m128i rnd1 = _mm_set1_epi32(1<<6);
+
+  __m128i c0 = _mm_loadl_epi64((const __m128i*)(coeffs+ 0));
+  __m128i c1 = _mm_loadl_epi64((const __m128i*)(coeffs+ 4));
+  __m128i c2 = _mm_loadl_epi64((const __m128i*)(coeffs+ 8));
+  __m128i c3 = _mm_loadl_epi64((const __m128i*)(coeffs+12));
+
+  __m128i c01 = _mm_unpacklo_epi16(c0,c1);
+  __m128i c23 = _mm_unpacklo_epi16(c2,c3);
+
+  __m128i g[4];
+  for (int i=0;i<4;i++) {
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(c01, _mm_set1_epi32(tables.col_4x4[t][i][0])),
+                                _mm_madd_epi16(c23, _mm_set1_epi32(tables.col_4x4[t][i][1])));
+    g[i] = _mm_srai_epi32(_mm_add_epi32(sum, rnd1), 7);
+  }
+
+  // clip to 16 bit, two rows per register
+  __m128i g01 = _mm_packs_epi32(g[0],g[1]);
+  __m128i g23 = _mm_packs_epi32(g[2],g[3]);
+
+  __m128i m01 = _mm_load_si128((const __m128i*)tables.row_4x4[t][0]);
+  __m128i m23 = _mm_load_si128((const __m128i*)tables.row_4x4[t][1]);
+
+#define ROW_4x4(y, G, sel01, sel23)                                     \
+  out[y] = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi32(G, sel01), m01), \
+                         _mm_madd_epi16(_mm_shuffle_epi32(G, sel23), m23)); \
+  out[y] = _mm_sra_epi32(_mm_add_epi32(out[y], rnd2), shift);
+
+  ROW_4x4(0, g01, 0x00, 0x55);
+  ROW_4x4(1, g01, 0xAA, 0xFF);
+  ROW_4x4(2, g23, 0x00, 0x55);
+  ROW_4x4(3, g23, 0xAA, 0xFF);
+
+#undef ROW_4x4
+}
+
+
+static inline void transform_4x4_add_8(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int t)
+{
+  __m128i r[4];
+  transform_4x4(r, coeffs, t, _mm_set1_epi32(1<<11), _mm_cvtsi32_si128(12));
+
+  __m128i r01 = _mm_packs_epi32(r[0],r[1]);
+  __m128i r23 = _mm_packs_epi32(r[2],r[3]);
+
+  __m128i d01 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(load32(dst         )),
+                                   _mm_cvtsi32_si128(load32(dst+  stride)));
+  __m128i d23 = _mm_unpacklo_epi32(_mm_cvtsi32_si128(load32(dst+2*stride)),
+                                   _mm_cvtsi32_si128(load32(dst+3*stride)));
+
+  d01 = _mm_adds_epi16(_mm_cvtepu8_epi16(d01), r01);
+  d23 = _mm_adds_epi16(_mm_cvtepu8_epi16(d23), r23);
+
+  __m128i v = _mm_packus_epi16(d01,d23);
+  store32(dst         , _mm_cvtsi128_si32(v));
+  store32(dst+  stride, _mm_extract_epi32(v,1));
+  store32(dst+2*stride, _mm_extract_epi32(v,2));
+  store32(dst+3*stride, _mm_extract_epi32(v,3));
+}
+
+
+static inline void transform_4x4_add_16(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                        int t, int bit_depth)
+{
+  __m128i r[4];
+  transform_4x4(r, coeffs, t, _mm_set1_epi32(1<<(19-bit_depth)), _mm_cvtsi32_si128(20-bit_depth));
+
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+  __m128i d01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(dst         )),
+                                   _mm_loadl_epi64((const __m128i*)(dst+  stride)));
+  __m128i d23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(dst+2*stride)),
+                                   _mm_loadl_epi64((const __m128i*)(dst+3*stride)));
+
+  d01 = _mm_adds_epi16(d01, _mm_packs_epi32(r[0],r[1]));
+  d23 = _mm_adds_epi16(d23, _mm_packs_epi32(r[2],r[3]));
+
+  d01 = _mm_min_epi16(_mm_max_epi16(d01,zero), maxval);
+  d23 = _mm_min_epi16(_mm_max_epi16(d23,zero), maxval);
+
+  _mm_storel_epi64((__m128i*)(dst         ), d01);
+  _mm_storel_epi64((__m128i*)(dst+  stride), _mm_srli_si128(d01,8));
+  _mm_storel_epi64((__m128i*)(dst+2*stride), d23);
+  _mm_storel_epi64((__m128i*)(dst+3*stride), _mm_srli_si128(d23,8));
+}
+
+
+static inline void transform_4x4_int32(int32_t *dst, const int16_t *coeffs, int bdShift, int t)
+{
+  __m128i r[4];
+  transform_4x4(r, coeffs, t, _mm_set1_epi32(1<<(bdShift-1)), _mm_cvtsi32_si128(bdShift));
+
+  for (int y=0;y<4;y++) {
+    _mm_storeu_si128((__m128i*)(dst+4*y), r[y]);
+  }
+}
+
+
+// --- 8x8 to 32x32 ---
+
+/* Finds the last row and column that contain a non-zero coefficient.
+   Returns false if all coefficients are zero. */
+template <int N>
+static inline bool find_nonzero_extent(const int16_t* coeffs, int* lastRow, int* lastCol)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i colOr0 = zero;
+  __m256i colOr1 = zero;
+
+  *lastRow = -1;
+
+  for (int y=0;y<N;y++) {
+    __m256i r0 = _mm256_loadu_si256((const __m256i*)(coeffs+y*N));
+    __m256i r1 = (N==32 ? _mm256_loadu_si256((const __m256i*)(coeffs+y*N+16)) : zero);
+    __m256i rowOr = _mm256_or_si256(r0,r1);
+
+    if (!_mm256_testz_si256(rowOr,rowOr)) {
+      *lastRow = y;
+    }
+
+    colOr0 = _mm256_or_si256(colOr0, r0);
+    colOr1 = _mm256_or_si256(colOr1, r1);
+  }
+
+  if (*lastRow < 0) {
+    return false;
+  }
+
+  // two mask bits per 16 bit column
+  uint32_t nonzero1 = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(colOr1, zero));
+  uint32_t nonzero0 = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(colOr0, zero));
+
+  if (nonzero1) { *lastCol = 16 + highest_bit(nonzero1)/2; }
+  else          { *lastCol =      highest_bit(nonzero0)/2; }
+
+  return true;
+}
+
+template <>
+inline bool find_nonzero_extent<8>(const int16_t* coeffs, int* lastRow, int* lastCol)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i colOr = zero;
+
+  *lastRow = -1;
+
+  for (int y=0;y<8;y++) {
+    __m128i r = _mm_loadu_si128((const __m128i*)(coeffs+y*8));
+
+    if (!_mm_testz_si128(r,r)) {
+      *lastRow = y;
+    }
+
+    colOr = _mm_or_si128(colOr, r);
+  }
+
+  if (*lastRow < 0) {
+    return false;
+  }
+
+  uint32_t nonzero = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(colOr, zero)) & 0xFFFF;
+  *lastCol = highest_bit(nonzero)/2;
+
+  return true;
+}
+
+
+/* Vertical pass. Writes the 16 bit intermediate values of all columns up to (at least)
+   lastCol into g[]. Columns beyond lastCol are not written, they are zero and never read. */
+template <int N>
+static inline void idct_columns(int16_t* g, const int16_t* coeffs, int lastRow, int lastCol)
+{
+  const int L = (N==16 ? 2 : 3);
+  const int nEven = std::min(lastRow/4 + 1, N/4);
+  const int nOdd  = (lastRow>=1 ? std::min((lastRow-1)/4 + 1, N/4) : 0);
+
+  const __m256i rnd1 = _mm256_set1_epi32(1<<6);
+
+  for (int c0=0; c0<=lastCol; c0+=16) {
+    __m256i even_lo[N/4], even_hi[N/4];
+    __m256i odd_lo [N/4], odd_hi [N/4];
+
+    for (int k=0;k<nEven;k++) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(coeffs + (4*k  )*N + c0));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(coeffs + (4*k+2)*N + c0));
+      even_lo[k] = _mm256_unpacklo_epi16(a,b);
+      even_hi[k] = _mm256_unpackhi_epi16(a,b);
+    }
+
+    for (int k=0;k<nOdd;k++) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(coeffs + (4*k+1)*N + c0));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(coeffs + (4*k+3)*N + c0));
+      odd_lo[k] = _mm256_unpacklo_epi16(a,b);
+      odd_hi[k] = _mm256_unpackhi_epi16(a,b);
+    }
+
+    for (int i=0;i<N/2;i++) {
+      __m256i e_lo = _mm256_setzero_si256(), e_hi = _mm256_setzero_si256();
+      __m256i o_lo = _mm256_setzero_si256(), o_hi = _mm256_setzero_si256();
+
+      for (int k=0;k<nEven;k++) {
+        __m256i m = _mm256_set1_epi32(tables.col_even[L][i][k]);
+        e_lo = _mm256_add_epi32(e_lo, _mm256_madd_epi16(even_lo[k], m));
+        e_hi = _mm256_add_epi32(e_hi, _mm256_madd_epi16(even_hi[k], m));
+      }
+
+      for (int k=0;k<nOdd;k++) {
+        __m256i m = _mm256_set1_epi32(tables.col_odd[L][i][k]);
+        o_lo = _mm256_add_epi32(o_lo, _mm256_madd_epi16(odd_lo[k], m));
+        o_hi = _mm256_add_epi32(o_hi, _mm256_madd_epi16(odd_hi[k], m));
+      }
+
+      e_lo = _mm256_add_epi32(e_lo, rnd1);
+      e_hi = _mm256_add_epi32(e_hi, rnd1);
+
+      __m256i top = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_add_epi32(e_lo,o_lo), 7),
+                                       _mm256_srai_epi32(_mm256_add_epi32(e_hi,o_hi), 7));
+      __m256i bot = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_sub_epi32(e_lo,o_lo), 7),
+                                       _mm256_srai_epi32(_mm256_sub_epi32(e_hi,o_hi), 7));
+
+      _mm256_storeu_si256((__m256i*)(g +      i *N + c0), top);
+      _mm256_storeu_si256((__m256i*)(g + (N-1-i)*N + c0), bot);
+    }
+  }
+}
+
+template <>
+inline void idct_columns<8>(int16_t* g, const int16_t* coeffs, int lastRow, int lastCol)
+{
+  const int nEven = std::min(lastRow/4 + 1, 2);
+  const int nOdd  = (lastRow>=1 ? std::min((lastRow-1)/4 + 1, 2) : 0);
+
+  const __m128i rnd1 = _mm_set1_epi32(1<<6);
+
+  __m128i even_lo[2], even_hi[2];
+  __m128i odd_lo [2], odd_hi [2];
+
+  for (int k=0;k<nEven;k++) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(coeffs + (4*k  )*8));
+    __m128i b = _mm_loadu_si128((const __m128i*)(coeffs + (4*k+2)*8));
+    even_lo[k] = _mm_unpacklo_epi16(a,b);
+    even_hi[k] = _mm_unpackhi_epi16(a,b);
+  }
+
+  for (int k=0;k<nOdd;k++) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(coeffs + (4*k+1)*8));
+    __m128i b = _mm_loadu_si128((const __m128i*)(coeffs + (4*k+3)*8));
+    odd_lo[k] = _mm_unpacklo_epi16(a,b);
+    odd_hi[k] = _mm_unpackhi_epi16(a,b);
+  }
+
+  for (int i=0;i<4;i++) {
+    __m128i e_lo = _mm_setzero_si128(), e_hi = _mm_setzero_si128();
+    __m128i o_lo = _mm_setzero_si128(), o_hi = _mm_setzero_si128();
+
+    for (int k=0;k<nEven;k++) {
+      __m128i m = _mm_set1_epi32(tables.col_even[1][i][k]);
+      e_lo = _mm_add_epi32(e_lo, _mm_madd_epi16(even_lo[k], m));
+      e_hi = _mm_add_epi32(e_hi, _mm_madd_epi16(even_hi[k], m));
+    }
+
+    for (int k=0;k<nOdd;k++) {
+      __m128i m = _mm_set1_epi32(tables.col_odd[1][i][k]);
+      o_lo = _mm_add_epi32(o_lo, _mm_madd_epi16(odd_lo[k], m));
+      o_hi = _mm_add_epi32(o_hi, _mm_madd_epi16(odd_hi[k], m));
+    }
+
+    e_lo = _mm_add_epi32(e_lo, rnd1);
+    e_hi = _mm_add_epi32(e_hi, rnd1);
+
+    __m128i top = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(e_lo,o_lo), 7),
+                                  _mm_srai_epi32(_mm_add_epi32(e_hi,o_hi), 7));
+    __m128i bot = _mm_packs_epi32(_mm_srai_epi32(_mm_sub_epi32(e_lo,o_lo), 7),
+                                  _mm_srai_epi32(_mm_sub_epi32(e_hi,o_hi), 7));
+
+    _mm_storeu_si128((__m128i*)(g +    i *8), top);
+    _mm_storeu_si128((__m128i*)(g + (7-i)*8), bot);
+  }
+}
+
+
+/* Horizontal pass for one row of intermediate values. acc[q] receives the unscaled
+   output samples 8q..8q+7. */
+template <int N>
+static inline void idct_row(__m256i acc[N/8], const int16_t* grow, int nPairs)
+{
+  const int L = (N==8 ? 1 : N==16 ? 2 : 3);
+
+  for (int q=0;q<N/8;q++) {
+    acc[q] = _mm256_setzero_si256();
+  }
+
+  for (int p=0;p<nPairs;p++) {
+    int32_t pair;
+    memcpy(&pair, grow+2*p, 4);
+    __m256i in = _mm256_set1_epi32(pair);
+
+    for (int q=0;q<N/8;q++) {
+      __m256i m = _mm256_load_si256((const __m256i*)(tables.row[L][p] + 16*q));
+      acc[q] = _mm256_add_epi32(acc[q], _mm256_madd_epi16(in, m));
+    }
+  }
+}
+
+
+/* Adds one row of N residuals (in 8 32 bit values per register) to the image. All values
+   that saturate in the 16 bit additions are clipped to the pixel range anyway. */
+template <int N>
+static inline void add_row(uint8_t* dst, const __m256i r[N/8], __m256i maxval)
+{
+  for (int q=0;q<N/8;q+=2) {
+    __m256i s = _mm256_permute4x64_epi64(_mm256_packs_epi32(r[q],r[q+1]), 0xD8);
+    __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(dst+8*q)));
+    d = _mm256_adds_epi16(d,s);
+    d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d,d), 0xD8);
+    _mm_storeu_si128((__m128i*)(dst+8*q), _mm256_castsi256_si128(d));
+  }
+}
+
+template <>
+inline void add_row<8>(uint8_t* dst, const __m256i r[1], __m256i maxval)
+{
+  __m128i s = _mm_packs_epi32(_mm256_castsi256_si128(r[0]), _mm256_extracti128_si256(r[0],1));
+  __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)dst));
+  d = _mm_adds_epi16(d,s);
+  _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(d,d));
+}
+
+template <int N>
+static inline void add_row(uint16_t* dst, const __m256i r[N/8], __m256i maxval)
+{
+  for (int q=0;q<N/8;q+=2) {
+    __m256i s = _mm256_permute4x64_epi64(_mm256_packs_epi32(r[q],r[q+1]), 0xD8);
+    __m256i d = _mm256_loadu_si256((const __m256i*)(dst+8*q));
+    d = _mm256_adds_epi16(d,s);
+    d = _mm256_min_epi16(_mm256_max_epi16(d, _mm256_setzero_si256()), maxval);
+    _mm256_storeu_si256((__m256i*)(dst+8*q), d);
+  }
+}
+
+template <>
+inline void add_row<8>(uint16_t* dst, const __m256i r[1], __m256i maxval)
+{
+  __m128i s = _mm_packs_epi32(_mm256_castsi256_si128(r[0]), _mm256_extracti128_si256(r[0],1));
+  __m128i d = _mm_loadu_si128((const __m128i*)dst);
+  d = _mm_adds_epi16(d,s);
+  d = _mm_min_epi16(_mm_max_epi16(d, _mm_setzero_si128()), _mm256_castsi256_si128(maxval));
+  _mm_storeu_si128((__m128i*)dst, d);
+}
+
+
+/* The 8 bit and high bit depth variants only differ in the final shift (20-BitDepth)
+   and in how the residual is added to the prediction. */
+template <int N, class pixel_t>
+static inline void transform_idct_add(pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                      int bit_depth)
+{
+  int lastRow, lastCol;
+  if (!find_nonzero_extent<N>(coeffs, &lastRow, &lastCol)) {
+    return;
+  }
+
+  const int postShift = 20-bit_depth;
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  if (lastRow==0 && lastCol==0) {
+    int g = (64*coeffs[0] + (1<<6)) >> 7;
+    __m256i r[N/8];
+    for (int q=0;q<N/8;q++) {
+      r[q] = _mm256_set1_epi32((64*g + (1<<(postShift-1))) >> postShift);
+    }
+
+    for (int y=0;y<N;y++) {
+      add_row<N>(dst+y*stride, r, maxval);
+    }
+    return;
+  }
+
+  ALIGNED_32(int16_t g[N*N]);
+  idct_columns<N>(g, coeffs, lastRow, lastCol);
+
+  const int nPairs = lastCol/2 + 1;
+  const __m256i rnd2 = _mm256_set1_epi32(1<<(postShift-1));
+  const __m128i shift = _mm_cvtsi32_si128(postShift);
+
+  for (int y=0;y<N;y++) {
+    __m256i r[N/8];
+    idct_row<N>(r, g+y*N, nPairs);
+
+    for (int q=0;q<N/8;q++) {
+      r[q] = _mm256_sra_epi32(_mm256_add_epi32(r[q], rnd2), shift);
+    }
+
+    add_row<N>(dst+y*stride, r, maxval);
+  }
+}
+
+
+template <int N>
+static inline void transform_idct_int32(int32_t *dst, const int16_t *coeffs, int bdShift)
+{
+  int lastRow, lastCol;
+  if (!find_nonzero_extent<N>(coeffs, &lastRow, &lastCol)) {
+    memset(dst, 0, N*N*sizeof(int32_t));
+    return;
+  }
+
+  if (lastRow==0 && lastCol==0) {
+    int g = (64*coeffs[0] + (1<<6)) >> 7;
+    __m256i v = _mm256_set1_epi32((64*g + (1<<(bdShift-1))) >> bdShift);
+
+    for (int i=0;i<N*N;i+=8) {
+      _mm256_storeu_si256((__m256i*)(dst+i), v);
+    }
+    return;
+  }
+
+  ALIGNED_32(int16_t g[N*N]);
+  idct_columns<N>(g, coeffs, lastRow, lastCol);
+
+  const int nPairs = lastCol/2 + 1;
+  const __m256i rnd2 = _mm256_set1_epi32(1<<(bdShift-1));
+  const __m128i shift = _mm_cvtsi32_si128(bdShift);
+
+  for (int y=0;y<N;y++) {
+    __m256i r[N/8];
+    idct_row<N>(r, g+y*N, nPairs);
+
+    for (int q=0;q<N/8;q++) {
+      r[q] = _mm256_sra_epi32(_mm256_add_epi32(r[q], rnd2), shift);
+      _mm256_storeu_si256((__m256i*)(dst+y*N+8*q), r[q]);
+    }
+  }
+}
+
+
+// --- exported functions ---
+
+void transform_4x4_luma_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_4x4_add_8(dst, coeffs, stride, 0);
+}
+
+void transform_4x4_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_4x4_add_8(dst, coeffs, stride, 1);
+}
+
+void transform_8x8_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_idct_add<8>(dst, coeffs, stride, 8);
+}
+
+void transform_16x16_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_idct_add<16>(dst, coeffs, stride, 8);
+}
+
+void transform_32x32_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_idct_add<32>(dst, coeffs, stride, 8);
+}
+
+
+/* High bit depth. Bit depths above 12 (beyond Main12) are left to the fallback functions. */
+
+void transform_4x4_luma_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                    int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_4x4_luma_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_4x4_add_16(dst, coeffs, stride, 0, bit_depth);
+}
+
+void transform_4x4_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_4x4_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_4x4_add_16(dst, coeffs, stride, 1, bit_depth);
+}
+
+void transform_8x8_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_8x8_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_idct_add<8>(dst, coeffs, stride, bit_depth);
+}
+
+void transform_16x16_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_16x16_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_idct_add<16>(dst, coeffs, stride, bit_depth);
+}
+
+void transform_32x32_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_32x32_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_idct_add<32>(dst, coeffs, stride, bit_depth);
+}
+
+
+/* The intermediate values are clipped to 16 bit by saturating packs. Other ranges
+   (extended_precision_processing) are left to the fallback functions. */
+
+void transform_idst_4x4_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idst_4x4_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  transform_4x4_int32(dst, coeffs, bdShift, 0);
+}
+
+void transform_idct_4x4_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idct_4x4_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  transform_4x4_int32(dst, coeffs, bdShift, 1);
+}
+
+void transform_idct_8x8_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idct_8x8_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  transform_idct_int32<8>(dst, coeffs, bdShift);
+}
+
+void transform_idct_16x16_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idct_16x16_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  transform_idct_int32<16>(dst, coeffs, bdShift);
+}
+
+void transform_idct_32x32_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idct_32x32_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  transform_idct_int32<32>(dst, coeffs, bdShift);
+}
+
+
+void add_residual_8_avx2(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (nT==4) {
+    for (int y=0;y<4;y+=2) {
+      __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+ y   *4)),
+                                  _mm_loadu_si128((const __m128i*)(r+(y+1)*4)));
+      __m128i d = _mm_unpacklo_epi32(_mm_cvtsi32_si128(load32(dst+ y   *stride)),
+                                     _mm_cvtsi32_si128(load32(dst+(y+1)*stride)));
+      d = _mm_adds_epi16(_mm_cvtepu8_epi16(d), s);
+      d = _mm_packus_epi16(d,d);
+      store32(dst+ y   *stride, _mm_cvtsi128_si32(d));
+      store32(dst+(y+1)*stride, _mm_extract_epi32(d,1));
+    }
+  }
+  else if (nT==8) {
+    for (int y=0;y<8;y++) {
+      __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+y*8  )),
+                                  _mm_loadu_si128((const __m128i*)(r+y*8+4)));
+      __m128i d = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(dst+y*stride)));
+      d = _mm_adds_epi16(d,s);
+      _mm_storel_epi64((__m128i*)(dst+y*stride), _mm_packus_epi16(d,d));
+    }
+  }
+  else {
+    for (int y=0;y<nT;y++) {
+      for (int x=0;x<nT;x+=16) {
+        __m256i s = _mm256_packs_epi32(_mm256_loadu_si256((const __m256i*)(r+y*nT+x  )),
+                                       _mm256_loadu_si256((const __m256i*)(r+y*nT+x+8)));
+        s = _mm256_permute4x64_epi64(s, 0xD8);
+
+        __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(dst+y*stride+x)));
+        d = _mm256_adds_epi16(d,s);
+        d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d,d), 0xD8);
+        _mm_storeu_si128((__m128i*)(dst+y*stride+x), _mm256_castsi256_si128(d));
+      }
+    }
+  }
+}
+
+
+void add_residual_16_avx2(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (bit_depth > 12) {
+    add_residual_fallback<uint16_t>(dst, stride, r, nT, bit_depth);
+    return;
+  }
+
+  const __m256i zero   = _mm256_setzero_si256();
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  if (nT==4) {
+    for (int y=0;y<4;y+=2) {
+      __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+ y   *4)),
+                                  _mm_loadu_si128((const __m128i*)(r+(y+1)*4)));
+      __m128i d = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(dst+ y   *stride)),
+                                     _mm_loadl_epi64((const __m128i*)(dst+(y+1)*stride)));
+      d = _mm_adds_epi16(d,s);
+      d = _mm_min_epi16(_mm_max_epi16(d, _mm256_castsi256_si128(zero)),
+                        _mm256_castsi256_si128(maxval));
+      _mm_storel_epi64((__m128i*)(dst+ y   *stride), d);
+      _mm_storel_epi64((__m128i*)(dst+(y+1)*stride), _mm_srli_si128(d,8));
+    }
+  }
+  else if (nT==8) {
+    for (int y=0;y<8;y++) {
+      __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+y*8  )),
+                                  _mm_loadu_si128((const __m128i*)(r+y*8+4)));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst+y*stride));
+      d = _mm_adds_epi16(d,s);
+      d = _mm_min_epi16(_mm_max_epi16(d, _mm256_castsi256_si128(zero)),
+                        _mm256_castsi256_si128(maxval));
+      _mm_storeu_si128((__m128i*)(dst+y*stride), d);
+    }
+  }
+  else {
+    for (int y=0;y<nT;y++) {
+      for (int x=0;x<nT;x+=16) {
+        __m256i s = _mm256_packs_epi32(_mm256_loadu_si256((const __m256i*)(r+y*nT+x  )),
+                                       _mm256_loadu_si256((const __m256i*)(r+y*nT+x+8)));
+        s = _mm256_permute4x64_epi64(s, 0xD8);
+
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst+y*stride+x));
+        d = _mm256_adds_epi16(d,s);
+        d = _mm256_min_epi16(_mm256_max_epi16(d, zero), maxval);
+        _mm256_storeu_si256((__m256i*)(dst+y*stride+x), d);
+      }
+    }
+  }
+}
+
+
+/* Inverse quantization, computed like scale_coefficients_fallback(). The scale factor
+   m*levelScale fits into a signed 16 bit value, hence the exact 32 bit products can be
+   assembled from the low and high halves of 16x16 bit multiplications. The final
+   clipping to 16 bit is done by the saturating pack. */
+
+static inline __m256i scale_16_coeffs(__m256i c, __m256i f, int shift)
+{
+  __m256i lo = _mm256_mullo_epi16(c,f);
+  __m256i hi = _mm256_mulhi_epi16(c,f);
+
+  __m256i p0 = _mm256_unpacklo_epi16(lo,hi);
+  __m256i p1 = _mm256_unpackhi_epi16(lo,hi);
+
+  if (shift>0) {
+    const __m256i rnd = _mm256_set1_epi32(1<<(shift-1));
+    const __m128i s   = _mm_cvtsi32_si128(shift);
+
+    p0 = _mm256_sra_epi32(_mm256_add_epi32(p0,rnd), s);
+    p1 = _mm256_sra_epi32(_mm256_add_epi32(p1,rnd), s);
+  }
+  else {
+    const __m256i minval = _mm256_set1_epi32(-32768);
+    const __m256i maxval = _mm256_set1_epi32( 32767);
+    const __m128i s = _mm_cvtsi32_si128(-shift);
+
+    p0 = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(p0,minval),maxval), s);
+    p1 = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(p1,minval),maxval), s);
+  }
+
+  return _mm256_packs_epi32(p0,p1);
+}
+
+
+static inline __m256i load_scaling_factors_16(const uint8_t* m, __m256i levelScale)
+{
+  return _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)m)), levelScale);
+}
+
+static inline __m256i load_scaling_factors_4x4(const uint8_t* m, int nT, __m256i levelScale)
+{
+  int32_t r[4];
+  for (int y=0;y<4;y++) { memcpy(&r[y], m+y*nT, 4); }
+
+  __m128i v = _mm_setr_epi32(r[0],r[1],r[2],r[3]);
+  return _mm256_mullo_epi16(_mm256_cvtepu8_epi16(v), levelScale);
+}
+
+
+void scale_coefficients_avx2(int16_t *coeff, int nT, int width, int height,
+                             const uint8_t* scalingFactor, int levelScale, int qPper, int bdShift)
+{
+  const int shift = bdShift - qPper;
+  const __m256i ls = _mm256_set1_epi16(levelScale);
+  const __m256i flat = _mm256_set1_epi16(16*levelScale);
+
+  if (nT==4) {
+    // the whole block fits into one register
+
+    __m256i c = _mm256_loadu_si256((const __m256i*)coeff);
+    __m256i f = (scalingFactor ? load_scaling_factors_4x4(scalingFactor,4,ls) : flat);
+
+    _mm256_storeu_si256((__m256i*)coeff, scale_16_coeffs(c,f,shift));
+    return;
+  }
+
+  // Process the coded region in 4x4 sub-blocks, four of them side by side if possible.
+
+  for (int y=0;y<height;y+=4)
+    for (int x=0;x<width; ) {
+      if (x+16<=width) {
+        for (int k=0;k<4;k++) {
+          int16_t* p = coeff + (y+k)*nT + x;
+          __m256i c = _mm256_loadu_si256((const __m256i*)p);
+          __m256i f = (scalingFactor ? load_scaling_factors_16(scalingFactor + (y+k)*nT + x, ls) : flat);
+
+          _mm256_storeu_si256((__m256i*)p, scale_16_coeffs(c,f,shift));
+        }
+
+        x+=16;
+      }
+      else {
+        // single 4x4 sub-block, gathered from four rows into one register
+
+        int16_t* p = coeff + y*nT + x;
+
+        __m128i r01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p)),
+                                         _mm_loadl_epi64((const __m128i*)(p+nT)));
+        __m128i r23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p+2*nT)),
+                                         _mm_loadl_epi64((const __m128i*)(p+3*nT)));
+
+        __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(r01), r23, 1);
+        __m256i f = (scalingFactor ? load_scaling_factors_4x4(scalingFactor + y*nT + x, nT, ls) : flat);
+
+        c = scale_16_coeffs(c,f,shift);
+
+        r01 = _mm256_castsi256_si128(c);
+        r23 = _mm256_extracti128_si256(c,1);
+
+        _mm_storel_epi64((__m128i*)(p),      r01);
+        _mm_storel_epi64((__m128i*)(p+nT),   _mm_srli_si128(r01,8));
+        _mm_storel_epi64((__m128i*)(p+2*nT), r23);
+        _mm_storel_epi64((__m128i*)(p+3*nT), _mm_srli_si128(r23,8));
+
+        x+=4;
+      }
+    }
+}
+
+
+/* Residuals for the range extension tools, see sse-residual.cc. The scaling functors
+   also provide 128 bit versions for the columns of 4x4 blocks. */
+
+namespace {
+
+struct ts_scale
+{
+  __m256i rnd;
+  __m128i tsShift, bdShift;
+
+  ts_scale(int ts, int bd)
+    : rnd(_mm256_set1_epi32(1<<(bd-1))), tsShift(_mm_cvtsi32_si128(ts)), bdShift(_mm_cvtsi32_si128(bd)) { }
+
+  __m256i operator()(__m256i c) const {
+    return _mm256_sra_epi32(_mm256_add_epi32(_mm256_sll_epi32(c, tsShift), rnd), bdShift);
+  }
+
+  __m128i operator()(__m128i c) const {
+    return _mm_sra_epi32(_mm_add_epi32(_mm_sll_epi32(c, tsShift), _mm256_castsi256_si128(rnd)), bdShift);
+  }
+};
+
+struct no_scale
+{
+  __m256i operator()(__m256i c) const { return c; }
+  __m128i operator()(__m128i c) const { return c; }
+};
+
+} // namespace
+
+
+static inline __m256i load_coeffs8(const int16_t* p)
+{
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)p));
+}
+
+
+template <class Scale>
+static inline void residual_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  for (int i=0;i<nT*nT;i+=8) {
+    _mm256_storeu_si256((__m256i*)(residual+i), scale(load_coeffs8(coeffs+i)));
+  }
+}
+
+
+template <class Scale>
+static inline void rdpcm_v_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  if (nT==4) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int y=0;y<4;y++) {
+      __m128i c = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(coeffs+y*4)));
+      sum = _mm_add_epi32(sum, scale(c));
+      _mm_storeu_si128((__m128i*)(residual+y*4), sum);
+    }
+    return;
+  }
+
+  for (int x=0;x<nT;x+=8) {
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm256_add_epi32(sum, scale(load_coeffs8(coeffs+y*nT+x)));
+      _mm256_storeu_si256((__m256i*)(residual+y*nT+x), sum);
+    }
+  }
+}
+
+
+/* The shifted additions compute the prefix sums within each 128 bit lane. For 4x4
+   blocks, each lane holds one row and we are done. Otherwise, the sum of the lower
+   lane is added to the upper lane, and the last element is carried to the next group. */
+
+template <class Scale>
+static inline void rdpcm_h_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  if (nT==4) {
+    for (int i=0;i<16;i+=8) {
+      __m256i v = scale(load_coeffs8(coeffs+i));
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v,4));
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v,8));
+      _mm256_storeu_si256((__m256i*)(residual+i), v);
+    }
+    return;
+  }
+
+  const __m256i last = _mm256_set1_epi32(7);
+
+  for (int y=0;y<nT;y++) {
+    __m256i carry = _mm256_setzero_si256();
+
+    for (int x=0;x<nT;x+=8) {
+      __m256i v = scale(load_coeffs8(coeffs+y*nT+x));
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v,4));
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v,8));
+
+      __m256i lowsum = _mm256_shuffle_epi32(v, 0xFF);
+      v = _mm256_add_epi32(v, _mm256_permute2x128_si256(lowsum,lowsum, 0x08));
+      v = _mm256_add_epi32(v, carry);
+
+      _mm256_storeu_si256((__m256i*)(residual+y*nT+x), v);
+
+      carry = _mm256_permutevar8x32_epi32(v, last);
+    }
+  }
+}
+
+
+void transform_skip_residual_avx2(int32_t *residual, const int16_t *coeffs, int nT,
+                                  int tsShift, int bdShift)
+{
+  residual_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void transform_bypass_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  residual_block(residual, coeffs, nT, no_scale());
+}
+
+void rdpcm_v_avx2(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift)
+{
+  rdpcm_v_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void rdpcm_h_avx2(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift)
+{
+  rdpcm_h_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void transform_bypass_rdpcm_v_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  rdpcm_v_block(residual, coeffs, nT, no_scale());
+}
+
+void transform_bypass_rdpcm_h_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  rdpcm_h_block(residual, coeffs, nT, no_scale());
+}
+
+
+void cross_comp_pred_avx2(int32_t *residual, const int32_t *residual_luma, int nT,
+                          int ResScaleVal, int BitDepthY, int BitDepthC)
+{
+  const __m256i scale  = _mm256_set1_epi32(ResScaleVal);
+  const __m128i shiftC = _mm_cvtsi32_si128(BitDepthC);
+  const __m128i shiftY = _mm_cvtsi32_si128(BitDepthY);
+
+  for (int i=0;i<nT*nT;i+=8) {
+    __m256i l = _mm256_loadu_si256((const __m256i*)(residual_luma+i));
+    l = _mm256_sra_epi32(_mm256_sll_epi32(l, shiftC), shiftY);
+    l = _mm256_srai_epi32(_mm256_mullo_epi32(l, scale), 3);
+
+    __m256i r = _mm256_loadu_si256((const __m256i*)(residual+i));
+    _mm256_storeu_si256((__m256i*)(residual+i), _mm256_add_epi32(r, l));
+  }
+}
@@ -0,0 +1,919 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "avx2-motion.h"
+#include "libde265/util.h"
+#include "libde265/fallback-motion.h"
+
+
+/* Luma filters, starting at x-qpel_extra_before[frac]. The 7-tap filters are padded
+   with a zero coefficient at the end so that the horizontal filter can always process
+   coefficient pairs. The vertical filters only use the first qpel_taps coefficients. */
+
+static const int8_t qpel_filters[4][8] = {
+  {  0, 0,  0, 64,  0,  0,  0,  0 }, // unused
+  { -1, 4,-10, 58, 17, -5,  1,  0 },
+  { -1, 4,-11, 40, 40,-11,  4, -1 },
+  {  1,-5, 17, 58,-10,  4, -1,  0 }
+};
+
+static const int qpel_extra_before[4] = { 0,3,3,2 };
+static const int qpel_extra_after [4] = { 0,3,4,4 };
+
+#define QPEL_TAPS(frac) ((frac)==2 ? 8 : 7)
+
+
+// chroma filters, starting at x-1
+
+static const int8_t epel_filters[7][4] = {
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+static const int epel_extra_before = 1;
+static const int epel_extra_after  = 2;
+
+
+// row stride of the intermediate buffer between the horizontal and vertical pass
+#define MAX_PB_SIZE 64
+
+
+/* Byte shuffles for the horizontal filter. For each output sample i, shuffle k selects the
+   input pair (i+2k, i+2k+1), which is then multiplied with the coefficient pair (2k, 2k+1).
+   Both 128-bit lanes use the same pattern. */
+
+ALIGNED_32(static const int8_t) hfilter_shuffle[4][32] = {
+  { 0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,     0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8 },
+  { 2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,    2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10 },
+  { 4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12, 4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12 },
+  { 6,7,7,8,8,9,9,10,10,11,11,12,12,13,13,14, 6,7,7,8,8,9,9,10,10,11,11,12,12,13,13,14 }
+};
+
+
+/* The filters below compute 16 (AVX2) or 8 (SSE) output samples at a time.
+   filter_block() runs them over a block and finishes widths that are not a multiple
+   of 16 with 8, 4, and 2 samples wide steps. Like the SSE code, the filters may read
+   a few input samples to the right of the block. */
+
+template <class Filter>
+static inline void filter_block(int16_t* dst, ptrdiff_t dststride,
+                                int width, int height, const Filter& filter)
+{
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+16<=width;x+=16) {
+      _mm256_storeu_si256((__m256i*)&dst[x], filter.filter16(y,x));
+    }
+
+    if (x+8<=width) {
+      _mm_storeu_si128((__m128i*)&dst[x], filter.filter8(y,x));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      _mm_storel_epi64((__m128i*)&dst[x], filter.filter8(y,x));
+      x+=4;
+    }
+
+    if (x<width) {
+      int32_t v = _mm_cvtsi128_si32(filter.filter8(y,x));
+      memcpy(&dst[x], &v, 4);
+    }
+
+    dst += dststride;
+  }
+}
+
+
+// full-sample position: scale to 14 bit
+
+struct pixels_filter
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+
+  pixels_filter(const uint8_t* s, ptrdiff_t st) : src(s), stride(st) { }
+
+  __m256i filter16(int y,int x) const {
+    __m128i p = _mm_loadu_si128((const __m128i*)&src[y*stride+x]);
+    return _mm256_slli_epi16(_mm256_cvtepu8_epi16(p), 6);
+  }
+
+  __m128i filter8(int y,int x) const {
+    __m128i p = _mm_loadl_epi64((const __m128i*)&src[y*stride+x]);
+    return _mm_slli_epi16(_mm_cvtepu8_epi16(p), 6);
+  }
+};
+
+
+/* Horizontal filter on 8-bit samples with 2*nPairs taps. With 8-bit input, all partial
+   sums fit into 16 bit, hence we can use PMADDUBSW. */
+
+template <int nPairs>
+struct hfilter_8bit
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m256i coeff[nPairs];
+
+  hfilter_8bit(const uint8_t* s, ptrdiff_t st, const int8_t* filter) : src(s), stride(st) {
+    for (int k=0;k<nPairs;k++) {
+      coeff[k] = _mm256_set1_epi16((int16_t)((uint8_t)filter[2*k] | ((uint8_t)filter[2*k+1] << 8)));
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const uint8_t* p = &src[y*stride+x];
+
+    // lane 0 gets the input for output samples 0-7, lane 1 for output samples 8-15
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                                         _mm_loadu_si128((const __m128i*)(p+8)), 1);
+
+    __m256i sum = _mm256_maddubs_epi16(_mm256_shuffle_epi8(in, *(const __m256i*)hfilter_shuffle[0]),
+                                       coeff[0]);
+    for (int k=1;k<nPairs;k++) {
+      __m256i pairs = _mm256_shuffle_epi8(in, *(const __m256i*)hfilter_shuffle[k]);
+      sum = _mm256_add_epi16(sum, _mm256_maddubs_epi16(pairs, coeff[k]));
+    }
+
+    return sum;
+  }
+
+  __m128i filter8(int y,int x) const {
+    __m128i in = _mm_loadu_si128((const __m128i*)&src[y*stride+x]);
+
+    __m128i sum = _mm_maddubs_epi16(_mm_shuffle_epi8(in, *(const __m128i*)hfilter_shuffle[0]),
+                                    _mm256_castsi256_si128(coeff[0]));
+    for (int k=1;k<nPairs;k++) {
+      __m128i pairs = _mm_shuffle_epi8(in, *(const __m128i*)hfilter_shuffle[k]);
+      sum = _mm_add_epi16(sum, _mm_maddubs_epi16(pairs, _mm256_castsi256_si128(coeff[k])));
+    }
+
+    return sum;
+  }
+};
+
+
+// Vertical filter on 8-bit samples. All partial sums fit into 16 bit.
+
+template <int nTaps>
+struct vfilter_8bit
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m256i coeff[nTaps];
+
+  vfilter_8bit(const uint8_t* s, ptrdiff_t st, const int8_t* filter) : src(s), stride(st) {
+    for (int k=0;k<nTaps;k++) {
+      coeff[k] = _mm256_set1_epi16(filter[k]);
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const uint8_t* p = &src[y*stride+x];
+
+    __m256i sum = _mm256_setzero_si256();
+    for (int k=0;k<nTaps;k++) {
+      __m256i in = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + k*stride)));
+      sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(in, coeff[k]));
+    }
+
+    return sum;
+  }
+
+  __m128i filter8(int y,int x) const {
+    const uint8_t* p = &src[y*stride+x];
+
+    __m128i sum = _mm_setzero_si128();
+    for (int k=0;k<nTaps;k++) {
+      __m128i in = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(p + k*stride)));
+      sum = _mm_add_epi16(sum, _mm_mullo_epi16(in, _mm256_castsi256_si128(coeff[k])));
+    }
+
+    return sum;
+  }
+};
+
+
+/* Vertical filter on 16-bit input (the output of the horizontal pass, or high bit depth
+   samples). The sums need 32 bit, rows are interleaved in pairs and multiplied with PMADDWD.
+   Like the fallback, the result is truncated to 16 bit (it can exceed the 16 bit range
+   for extreme input). */
+
+static inline __m256i pack_truncate_epi32(__m256i lo, __m256i hi)
+{
+  const __m256i mask = _mm256_set1_epi32(0xFFFF);
+  return _mm256_packus_epi32(_mm256_and_si256(lo,mask), _mm256_and_si256(hi,mask));
+}
+
+static inline __m128i pack_truncate_epi32(__m128i lo, __m128i hi)
+{
+  const __m128i mask = _mm_set1_epi32(0xFFFF);
+  return _mm_packus_epi32(_mm_and_si128(lo,mask), _mm_and_si128(hi,mask));
+}
+
+template <int nTaps>
+struct vfilter_16bit
+{
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i coeff[(nTaps+1)/2];
+
+  vfilter_16bit(const int16_t* s, ptrdiff_t st, const int8_t* filter, int shft)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shft)) {
+    for (int k=0;k<nTaps;k+=2) {
+      int c0 = filter[k];
+      int c1 = (k+1<nTaps ? filter[k+1] : 0);
+      coeff[k/2] = _mm256_set1_epi32((int32_t)((uint16_t)c0 | ((uint32_t)(uint16_t)c1 << 16)));
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const int16_t* p = &src[y*stride+x];
+
+    __m256i lo = _mm256_setzero_si256();
+    __m256i hi = _mm256_setzero_si256();
+
+    for (int k=0;k<nTaps;k+=2) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(p + k*stride));
+      __m256i b = (k+1<nTaps ?
+                   _mm256_loadu_si256((const __m256i*)(p + (k+1)*stride)) :
+                   _mm256_setzero_si256());
+
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a,b), coeff[k/2]));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a,b), coeff[k/2]));
+    }
+
+    // unpack and pack both work within lanes, hence the sample order is preserved
+    return pack_truncate_epi32(_mm256_sra_epi32(lo,shift), _mm256_sra_epi32(hi,shift));
+  }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = &src[y*stride+x];
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    for (int k=0;k<nTaps;k+=2) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + k*stride));
+      __m128i b = (k+1<nTaps ?
+                   _mm_loadu_si128((const __m128i*)(p + (k+1)*stride)) :
+                   _mm_setzero_si128());
+
+      __m128i c = _mm256_castsi256_si128(coeff[k/2]);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), c));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), c));
+    }
+
+    return pack_truncate_epi32(_mm_sra_epi32(lo,shift), _mm_sra_epi32(hi,shift));
+  }
+};
+
+
+// full-sample position for high bit depths: scale to 14 bit
+
+struct pixels_filter_16
+{
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+
+  pixels_filter_16(const uint16_t* s, ptrdiff_t st, int bit_depth)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(14-bit_depth)) { }
+
+  __m256i filter16(int y,int x) const {
+    return _mm256_sll_epi16(_mm256_loadu_si256((const __m256i*)&src[y*stride+x]), shift);
+  }
+
+  __m128i filter8(int y,int x) const {
+    return _mm_sll_epi16(_mm_loadu_si128((const __m128i*)&src[y*stride+x]), shift);
+  }
+};
+
+
+/* Horizontal filter on high bit depth samples with 2*nPairs taps. The sums need 32 bit.
+   Inputs shifted by one sample are interleaved and multiplied with coefficient pairs
+   using PMADDWD. With at most 12 bits per sample, the shifted result fits into 16 bit. */
+
+template <int nPairs>
+struct hfilter_16bit
+{
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i coeff[nPairs];
+
+  hfilter_16bit(const uint16_t* s, ptrdiff_t st, const int8_t* filter, int shft)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shft)) {
+    for (int k=0;k<nPairs;k++) {
+      coeff[k] = _mm256_set1_epi32((int32_t)((uint16_t)filter[2*k] |
+                                             ((uint32_t)(uint16_t)filter[2*k+1] << 16)));
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const uint16_t* p = &src[y*stride+x];
+
+    __m256i lo = _mm256_setzero_si256();
+    __m256i hi = _mm256_setzero_si256();
+
+    for (int k=0;k<nPairs;k++) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(p+2*k));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(p+2*k+1));
+
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a,b), coeff[k]));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a,b), coeff[k]));
+    }
+
+    return _mm256_packs_epi32(_mm256_sra_epi32(lo,shift), _mm256_sra_epi32(hi,shift));
+  }
+
+  __m128i filter8(int y,int x) const {
+    const uint16_t* p = &src[y*stride+x];
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    for (int k=0;k<nPairs;k++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p+2*k));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p+2*k+1));
+
+      __m128i c = _mm256_castsi256_si128(coeff[k]);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), c));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), c));
+    }
+
+    return _mm_packs_epi32(_mm_sra_epi32(lo,shift), _mm_sra_epi32(hi,shift));
+  }
+};
+
+
+// --- luma ---
+
+template <int xFrac, int yFrac>
+static inline void put_qpel_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                   const uint8_t *src, ptrdiff_t srcstride,
+                                   int width, int height, int16_t* mcbuffer)
+{
+  if (xFrac==0 && yFrac==0) {
+    filter_block(dst,dststride, width,height, pixels_filter(src,srcstride));
+  }
+  else if (yFrac==0) {
+    filter_block(dst,dststride, width,height,
+                 hfilter_8bit<4>(src - qpel_extra_before[xFrac], srcstride,
+                                 qpel_filters[xFrac]));
+  }
+  else if (xFrac==0) {
+    filter_block(dst,dststride, width,height,
+                 vfilter_8bit<QPEL_TAPS(yFrac)>(src - qpel_extra_before[yFrac]*srcstride, srcstride,
+                                                qpel_filters[yFrac]));
+  }
+  else {
+    int nRows = qpel_extra_before[yFrac] + height + qpel_extra_after[yFrac];
+
+    filter_block(mcbuffer,MAX_PB_SIZE, width,nRows,
+                 hfilter_8bit<4>(src - qpel_extra_before[yFrac]*srcstride - qpel_extra_before[xFrac],
+                                 srcstride, qpel_filters[xFrac]));
+
+    filter_block(dst,dststride, width,height,
+                 vfilter_16bit<QPEL_TAPS(yFrac)>(mcbuffer, MAX_PB_SIZE, qpel_filters[yFrac], 6));
+  }
+}
+
+
+#define QPEL_AVX2(x,y)                                                          \
+  void put_qpel_ ## x ## _ ## y ## _avx2(int16_t *dst, ptrdiff_t dststride,    \
+                                         const uint8_t *src, ptrdiff_t srcstride, \
+                                         int width, int height, int16_t* mcbuffer) \
+  { put_qpel_8_avx2<x,y>(dst,dststride, src,srcstride, width,height, mcbuffer); }
+
+QPEL_AVX2(0,0) QPEL_AVX2(0,1) QPEL_AVX2(0,2) QPEL_AVX2(0,3)
+QPEL_AVX2(1,0) QPEL_AVX2(1,1) QPEL_AVX2(1,2) QPEL_AVX2(1,3)
+QPEL_AVX2(2,0) QPEL_AVX2(2,1) QPEL_AVX2(2,2) QPEL_AVX2(2,3)
+QPEL_AVX2(3,0) QPEL_AVX2(3,1) QPEL_AVX2(3,2) QPEL_AVX2(3,3)
+
+
+/* High bit depth luma. The fallback is used for more than 12 bits, where the
+   intermediate values do not fit into 16 bit anymore. */
+
+template <int xFrac, int yFrac>
+static inline void put_qpel_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int16_t* mcbuffer, int bit_depth)
+{
+  const int shift1 = bit_depth-8;
+
+  if (xFrac==0 && yFrac==0) {
+    filter_block(dst,dststride, width,height, pixels_filter_16(src,srcstride,bit_depth));
+  }
+  else if (yFrac==0) {
+    filter_block(dst,dststride, width,height,
+                 hfilter_16bit<4>(src - qpel_extra_before[xFrac], srcstride,
+                                  qpel_filters[xFrac], shift1));
+  }
+  else if (xFrac==0) {
+    filter_block(dst,dststride, width,height,
+                 vfilter_16bit<QPEL_TAPS(yFrac)>((const int16_t*)(src - qpel_extra_before[yFrac]*srcstride),
+                                                 srcstride, qpel_filters[yFrac], shift1));
+  }
+  else {
+    int nRows = qpel_extra_before[yFrac] + height + qpel_extra_after[yFrac];
+
+    filter_block(mcbuffer,MAX_PB_SIZE, width,nRows,
+                 hfilter_16bit<4>(src - qpel_extra_before[yFrac]*srcstride - qpel_extra_before[xFrac],
+                                  srcstride, qpel_filters[xFrac], shift1));
+
+    filter_block(dst,dststride, width,height,
+                 vfilter_16bit<QPEL_TAPS(yFrac)>(mcbuffer, MAX_PB_SIZE, qpel_filters[yFrac], 6));
+  }
+}
+
+
+#define QPEL16_AVX2(x,y)                                                        \
+  void put_qpel_ ## x ## _ ## y ## _16_avx2(int16_t *dst, ptrdiff_t dststride, \
+                                            const uint16_t *src, ptrdiff_t srcstride, \
+                                            int width, int height, int16_t* mcbuffer, \
+                                            int bit_depth)                      \
+  {                                                                             \
+    if (bit_depth > 12) {                                                       \
+      put_qpel_ ## x ## _ ## y ## _fallback_16(dst,dststride, src,srcstride,    \
+                                               width,height, mcbuffer, bit_depth); \
+    }                                                                           \
+    else {                                                                      \
+      put_qpel_16_avx2<x,y>(dst,dststride, src,srcstride, width,height,         \
+                            mcbuffer, bit_depth);                               \
+    }                                                                           \
+  }
+
+QPEL16_AVX2(0,0) QPEL16_AVX2(0,1) QPEL16_AVX2(0,2) QPEL16_AVX2(0,3)
+QPEL16_AVX2(1,0) QPEL16_AVX2(1,1) QPEL16_AVX2(1,2) QPEL16_AVX2(1,3)
+QPEL16_AVX2(2,0) QPEL16_AVX2(2,1) QPEL16_AVX2(2,2) QPEL16_AVX2(2,3)
+QPEL16_AVX2(3,0) QPEL16_AVX2(3,1) QPEL16_AVX2(3,2) QPEL16_AVX2(3,3)
+
+
+// --- chroma ---
+
+void put_epel_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                     const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height,
+                     int mx, int my, int16_t* mcbuffer)
+{
+  filter_block(dst,dststride, width,height, pixels_filter(src,srcstride));
+}
+
+void put_epel_h_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               hfilter_8bit<2>(src - epel_extra_before, srcstride, epel_filters[mx-1]));
+}
+
+void put_epel_v_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               vfilter_8bit<4>(src - epel_extra_before*srcstride, srcstride, epel_filters[my-1]));
+}
+
+void put_epel_hv_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                        const uint8_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  int nRows = epel_extra_before + height + epel_extra_after;
+
+  filter_block(mcbuffer,MAX_PB_SIZE, width,nRows,
+               hfilter_8bit<2>(src - epel_extra_before*srcstride - epel_extra_before, srcstride,
+                               epel_filters[mx-1]));
+
+  filter_block(dst,dststride, width,height,
+               vfilter_16bit<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
+
+
+void put_epel_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                      const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height,
+                      int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block(dst,dststride, width,height, pixels_filter_16(src,srcstride,bit_depth));
+}
+
+void put_epel_h_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               hfilter_16bit<2>(src - epel_extra_before, srcstride, epel_filters[mx-1],
+                                bit_depth-8));
+}
+
+void put_epel_v_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               vfilter_16bit<4>((const int16_t*)(src - epel_extra_before*srcstride), srcstride,
+                                epel_filters[my-1], bit_depth-8));
+}
+
+void put_epel_hv_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                         const uint16_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  int nRows = epel_extra_before + height + epel_extra_after;
+
+  filter_block(mcbuffer,MAX_PB_SIZE, width,nRows,
+               hfilter_16bit<2>(src - epel_extra_before*srcstride - epel_extra_before, srcstride,
+                                epel_filters[mx-1], bit_depth-8));
+
+  filter_block(dst,dststride, width,height,
+               vfilter_16bit<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
+
+
+// --- prediction output ---
+
+/* Like filter_block(), but the operation output is clipped to 8 bit. The 16-bit
+   saturating adds are exact here, because all saturated values clip to 0 or 255 anyway. */
+
+template <class Op>
+static inline void pred_block(uint8_t* dst, ptrdiff_t dststride,
+                              int width, int height, const Op& op)
+{
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+32<=width;x+=32) {
+      __m256i r = _mm256_packus_epi16(op.pred16(y,x), op.pred16(y,x+16));
+      r = _mm256_permute4x64_epi64(r, 0xD8);
+      _mm256_storeu_si256((__m256i*)&dst[x], r);
+    }
+
+    if (x+16<=width) {
+      __m256i r = op.pred16(y,x);
+      _mm_storeu_si128((__m128i*)&dst[x], _mm_packus_epi16(_mm256_castsi256_si128(r),
+                                                           _mm256_extracti128_si256(r,1)));
+      x+=16;
+    }
+
+    if (x+8<=width) {
+      __m128i r = op.pred8(y,x);
+      _mm_storel_epi64((__m128i*)&dst[x], _mm_packus_epi16(r,r));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i r = op.pred8(y,x);
+      int32_t v = _mm_cvtsi128_si32(_mm_packus_epi16(r,r));
+      memcpy(&dst[x], &v, 4);
+      x+=4;
+    }
+
+    if (x<width) {
+      __m128i r = op.pred8(y,x);
+      uint16_t v = (uint16_t)_mm_cvtsi128_si32(_mm_packus_epi16(r,r));
+      memcpy(&dst[x], &v, 2);
+    }
+
+    dst += dststride;
+  }
+}
+
+
+struct unweighted_pred
+{
+  const int16_t* src;
+  ptrdiff_t stride;
+
+  unweighted_pred(const int16_t* s, ptrdiff_t st) : src(s), stride(st) { }
+
+  __m256i pred16(int y,int x) const {
+    __m256i in = _mm256_loadu_si256((const __m256i*)&src[y*stride+x]);
+    return _mm256_srai_epi16(_mm256_adds_epi16(in, _mm256_set1_epi16(32)), 6);
+  }
+
+  __m128i pred8(int y,int x) const {
+    __m128i in = _mm_loadu_si128((const __m128i*)&src[y*stride+x]);
+    return _mm_srai_epi16(_mm_adds_epi16(in, _mm_set1_epi16(32)), 6);
+  }
+};
+
+
+struct avg_pred
+{
+  const int16_t* src1;
+  const int16_t* src2;
+  ptrdiff_t stride;
+
+  avg_pred(const int16_t* s1, const int16_t* s2, ptrdiff_t st) : src1(s1), src2(s2), stride(st) { }
+
+  __m256i pred16(int y,int x) const {
+    __m256i in1 = _mm256_loadu_si256((const __m256i*)&src1[y*stride+x]);
+    __m256i in2 = _mm256_loadu_si256((const __m256i*)&src2[y*stride+x]);
+    __m256i sum = _mm256_adds_epi16(_mm256_adds_epi16(in1,in2), _mm256_set1_epi16(64));
+    return _mm256_srai_epi16(sum, 7);
+  }
+
+  __m128i pred8(int y,int x) const {
+    __m128i in1 = _mm_loadu_si128((const __m128i*)&src1[y*stride+x]);
+    __m128i in2 = _mm_loadu_si128((const __m128i*)&src2[y*stride+x]);
+    __m128i sum = _mm_adds_epi16(_mm_adds_epi16(in1,in2), _mm_set1_epi16(64));
+    return _mm_srai_epi16(sum, 7);
+  }
+};
+
+
+void put_unweighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                const int16_t *src, ptrdiff_t srcstride,
+                                int width, int height)
+{
+  pred_block(dst,dststride, width,height, unweighted_pred(src,srcstride));
+}
+
+void put_weighted_pred_avg_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                  const int16_t *src1, const int16_t *src2,
+                                  ptrdiff_t srcstride, int width, int height)
+{
+  pred_block(dst,dststride, width,height, avg_pred(src1,src2,srcstride));
+}
+
+
+// --- high bit depth prediction output ---
+
+/* The operations return 16 bit values that are clipped to [0;(1<<bit_depth)-1] here.
+   Where the operations saturate, the saturated values clip to the same result. */
+
+template <class Op>
+static inline void pred_block_16(uint16_t* dst, ptrdiff_t dststride,
+                                 int width, int height, int bit_depth, const Op& op)
+{
+  const __m256i zero   = _mm256_setzero_si256();
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+16<=width;x+=16) {
+      __m256i r = _mm256_min_epi16(_mm256_max_epi16(op.pred16(y,x), zero), maxval);
+      _mm256_storeu_si256((__m256i*)&dst[x], r);
+    }
+
+    if (x<width) {
+      __m128i r = _mm_min_epi16(_mm_max_epi16(op.pred8(y,x), _mm256_castsi256_si128(zero)),
+                                _mm256_castsi256_si128(maxval));
+
+      if (x+8<=width) {
+        _mm_storeu_si128((__m128i*)&dst[x], r);
+        x+=8;
+        if (x<width) {
+          r = _mm_min_epi16(_mm_max_epi16(op.pred8(y,x), _mm256_castsi256_si128(zero)),
+                            _mm256_castsi256_si128(maxval));
+        }
+      }
+
+      if (x+4<=width) {
+        _mm_storel_epi64((__m128i*)&dst[x], r);
+        r = _mm_srli_si128(r,8);
+        x+=4;
+      }
+
+      if (x<width) {
+        int32_t v = _mm_cvtsi128_si32(r);
+        memcpy(&dst[x], &v, 4);
+      }
+    }
+
+    dst += dststride;
+  }
+}
+
+
+struct unweighted_pred_16
+{
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i offset;
+
+  unweighted_pred_16(const int16_t* s, ptrdiff_t st, int bit_depth)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(14-bit_depth)),
+      offset(_mm256_set1_epi16((1<<(14-bit_depth))>>1)) { }
+
+  __m256i pred16(int y,int x) const {
+    __m256i in = _mm256_loadu_si256((const __m256i*)&src[y*stride+x]);
+    return _mm256_sra_epi16(_mm256_adds_epi16(in, offset), shift);
+  }
+
+  __m128i pred8(int y,int x) const {
+    __m128i in = _mm_loadu_si128((const __m128i*)&src[y*stride+x]);
+    return _mm_sra_epi16(_mm_adds_epi16(in, _mm256_castsi256_si128(offset)), shift);
+  }
+};
+
+
+struct avg_pred_16
+{
+  const int16_t* src1;
+  const int16_t* src2;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i offset;
+
+  avg_pred_16(const int16_t* s1, const int16_t* s2, ptrdiff_t st, int bit_depth)
+    : src1(s1), src2(s2), stride(st), shift(_mm_cvtsi32_si128(15-bit_depth)),
+      offset(_mm256_set1_epi16(1<<(14-bit_depth))) { }
+
+  __m256i pred16(int y,int x) const {
+    __m256i in1 = _mm256_loadu_si256((const __m256i*)&src1[y*stride+x]);
+    __m256i in2 = _mm256_loadu_si256((const __m256i*)&src2[y*stride+x]);
+    return _mm256_sra_epi16(_mm256_adds_epi16(_mm256_adds_epi16(in1,in2), offset), shift);
+  }
+
+  __m128i pred8(int y,int x) const {
+    __m128i in1 = _mm_loadu_si128((const __m128i*)&src1[y*stride+x]);
+    __m128i in2 = _mm_loadu_si128((const __m128i*)&src2[y*stride+x]);
+    return _mm_sra_epi16(_mm_adds_epi16(_mm_adds_epi16(in1,in2),
+                                        _mm256_castsi256_si128(offset)), shift);
+  }
+};
+
+
+/* Explicit weighted prediction. The sums need 32 bit. The two inputs (or the input and
+   a constant one for the rounding term) are interleaved and multiplied with the weight
+   pair using PMADDWD. */
+
+struct weighted_pred_op
+{
+  const int16_t* src1;
+  const int16_t* src2;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i weights;
+  __m256i offset;
+
+  // uni-prediction: ((in*w + rnd) >> log2WD) + o
+  weighted_pred_op(const int16_t* s, ptrdiff_t st, int w, int o, int log2WD)
+    : src1(s), src2(NULL), stride(st), shift(_mm_cvtsi32_si128(log2WD)),
+      weights(_mm256_set1_epi32((int32_t)((uint16_t)w | ((uint32_t)(1<<(log2WD-1)) << 16)))),
+      offset(_mm256_set1_epi32(o)) { }
+
+  // bi-prediction: (in1*w1 + in2*w2 + ((o1+o2+1) << log2WD)) >> (log2WD+1)
+  weighted_pred_op(const int16_t* s1, const int16_t* s2, ptrdiff_t st,
+                   int w1, int o1, int w2, int o2, int log2WD)
+    : src1(s1), src2(s2), stride(st), shift(_mm_cvtsi32_si128(log2WD+1)),
+      weights(_mm256_set1_epi32((int32_t)((uint16_t)w1 | ((uint32_t)(uint16_t)w2 << 16)))),
+      offset(_mm256_set1_epi32((o1+o2+1) << log2WD)) { }
+
+  __m256i pred16(int y,int x) const {
+    __m256i a = _mm256_loadu_si256((const __m256i*)&src1[y*stride+x]);
+    __m256i b = (src2 ? _mm256_loadu_si256((const __m256i*)&src2[y*stride+x]) :
+                 _mm256_set1_epi16(1));
+
+    __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a,b), weights);
+    __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a,b), weights);
+
+    if (src2) {
+      lo = _mm256_sra_epi32(_mm256_add_epi32(lo,offset), shift);
+      hi = _mm256_sra_epi32(_mm256_add_epi32(hi,offset), shift);
+    }
+    else {
+      lo = _mm256_add_epi32(_mm256_sra_epi32(lo,shift), offset);
+      hi = _mm256_add_epi32(_mm256_sra_epi32(hi,shift), offset);
+    }
+
+    return _mm256_packs_epi32(lo,hi);
+  }
+
+  __m128i pred8(int y,int x) const {
+    __m128i a = _mm_loadu_si128((const __m128i*)&src1[y*stride+x]);
+    __m128i b = (src2 ? _mm_loadu_si128((const __m128i*)&src2[y*stride+x]) :
+                 _mm_set1_epi16(1));
+
+    __m128i w = _mm256_castsi256_si128(weights);
+    __m128i o = _mm256_castsi256_si128(offset);
+
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a,b), w);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a,b), w);
+
+    if (src2) {
+      lo = _mm_sra_epi32(_mm_add_epi32(lo,o), shift);
+      hi = _mm_sra_epi32(_mm_add_epi32(hi,o), shift);
+    }
+    else {
+      lo = _mm_add_epi32(_mm_sra_epi32(lo,shift), o);
+      hi = _mm_add_epi32(_mm_sra_epi32(hi,shift), o);
+    }
+
+    return _mm_packs_epi32(lo,hi);
+  }
+};
+
+
+void put_weighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                              const int16_t *src, ptrdiff_t srcstride,
+                              int width, int height,
+                              int w,int o,int log2WD)
+{
+  pred_block(dst,dststride, width,height, weighted_pred_op(src,srcstride, w,o,log2WD));
+}
+
+void put_weighted_bipred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                int width, int height,
+                                int w1,int o1, int w2,int o2, int log2WD)
+{
+  pred_block(dst,dststride, width,height,
+             weighted_pred_op(src1,src2,srcstride, w1,o1,w2,o2,log2WD));
+}
+
+
+void put_unweighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src, ptrdiff_t srcstride,
+                                 int width, int height, int bit_depth)
+{
+  pred_block_16(dst,dststride, width,height, bit_depth,
+                unweighted_pred_16(src,srcstride,bit_depth));
+}
+
+void put_weighted_pred_avg_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                   const int16_t *src1, const int16_t *src2,
+                                   ptrdiff_t srcstride, int width, int height, int bit_depth)
+{
+  pred_block_16(dst,dststride, width,height, bit_depth,
+                avg_pred_16(src1,src2,srcstride,bit_depth));
+}
+
+void put_weighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                               const int16_t *src, ptrdiff_t srcstride,
+                               int width, int height,
+                               int w,int o,int log2WD, int bit_depth)
+{
+  pred_block_16(dst,dststride, width,height, bit_depth,
+                weighted_pred_op(src,srcstride, w,o,log2WD));
+}
+
+void put_weighted_bipred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                 int width, int height,
+                                 int w1,int o1, int w2,int o2, int log2WD, int bit_depth)
+{
+  pred_block_16(dst,dststride, width,height, bit_depth,
+                weighted_pred_op(src1,src2,srcstride, w1,o1,w2,o2,log2WD));
+}
@@ -0,0 +1,63 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "avx2-nal.h"
+#include "libde265/fallback-nal.h"
+
+
+static inline int lowest_bit(uint32_t v)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward(&idx, v);
+  return idx;
+#else
+  return __builtin_ctz(v);
+#endif
+}
+
+/* Same scheme as the SSE2 version with 32 positions per iteration. */
+
+int find_zero_byte_pair_avx2(const uint8_t* data, int len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+
+  int p=0;
+  for (;p+32<len;p+=32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(data+p));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(data+p+1));
+
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_or_si256(a,b), zero));
+    if (mask) {
+      return p + lowest_bit(mask);
+    }
+  }
+
+  return p + find_zero_byte_pair_fallback(data+p, len-p);
+}
@@ -0,0 +1,238 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <immintrin.h>
+
+#include "avx2-sao.h"
+#include "libde265/util.h"
+#include "libde265/fallback-sao.h"
+
+
+/* The kernels process 32 (8 bit) or 16 (16 bit) samples per iteration. Columns that
+   do not fill a complete register are passed to the scalar code. */
+
+
+// Add signed offsets with clipping to [0;255], split into a saturating add and subtract.
+
+static inline __m256i add_offset_8(__m256i v, __m256i off)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i pos = _mm256_max_epi8(off, zero);
+  __m256i neg = _mm256_max_epi8(_mm256_sub_epi8(zero,off), zero);
+  return _mm256_subs_epu8(_mm256_adds_epu8(v,pos),neg);
+}
+
+static inline __m256i add_offset_16(__m256i v, __m256i off, __m256i maxval)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i pos = _mm256_max_epi16(off, zero);
+  __m256i neg = _mm256_max_epi16(_mm256_sub_epi16(zero,off), zero);
+  return _mm256_min_epu16(_mm256_subs_epu16(_mm256_adds_epu16(v,pos),neg), maxval);
+}
+
+
+// -1/0/1 for a<b, a==b, a>b
+
+static inline __m256i sign_8(__m256i a, __m256i b)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  return _mm256_sub_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(a,b), zero),
+                         _mm256_cmpeq_epi8(_mm256_subs_epu8(b,a), zero));
+}
+
+static inline __m256i sign_16(__m256i a, __m256i b)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  return _mm256_sub_epi16(_mm256_cmpeq_epi16(_mm256_subs_epu16(a,b), zero),
+                          _mm256_cmpeq_epi16(_mm256_subs_epu16(b,a), zero));
+}
+
+
+// Convert 16 bit table indices into byte indices for _mm256_shuffle_epi8().
+
+static inline __m256i word_index(__m256i idx)
+{
+  return _mm256_add_epi16(_mm256_mullo_epi16(idx, _mm256_set1_epi16(0x0202)),
+                          _mm256_set1_epi16(0x0100));
+}
+
+
+static inline void edge_neighbors(int eoClass, ptrdiff_t stride, ptrdiff_t& pos0, ptrdiff_t& pos1)
+{
+  switch (eoClass) {
+  default:
+  case 0: pos0 = -1;        pos1 =  1;        break;
+  case 1: pos0 = -stride;   pos1 =  stride;   break;
+  case 2: pos0 = -stride-1; pos1 =  stride+1; break;
+  case 3: pos0 = -stride+1; pos1 =  stride-1; break;
+  }
+}
+
+
+void sao_band_8_avx2(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int bandPosition, const int8_t offsets[4])
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    const __m256i table = _mm256_setr_epi8(offsets[0],offsets[1],offsets[2],offsets[3],
+                                           0,0,0,0, 0,0,0,0, 0,0,0,0,
+                                           offsets[0],offsets[1],offsets[2],offsets[3],
+                                           0,0,0,0, 0,0,0,0, 0,0,0,0);
+    const __m256i pos   = _mm256_set1_epi8(bandPosition);
+    const __m256i mask  = _mm256_set1_epi8(31);
+    const __m256i four  = _mm256_set1_epi8(4);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<w32;x+=32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + y*srcstride + x));
+
+        // band index relative to the first band, offsets only for k<4
+
+        __m256i band = _mm256_and_si256(_mm256_srli_epi16(v,3), mask);
+        __m256i k    = _mm256_and_si256(_mm256_sub_epi8(band,pos), mask);
+        __m256i off  = _mm256_and_si256(_mm256_shuffle_epi8(table,k), _mm256_cmpgt_epi8(four,k));
+
+        _mm256_storeu_si256((__m256i*)(dst + y*dststride + x), add_offset_8(v,off));
+      }
+    }
+  }
+
+  if (w32 < width) {
+    sao_band_8_fallback(dst+w32,dststride, src+w32,srcstride, width-w32,height, bandPosition,offsets);
+  }
+}
+
+
+void sao_edge_8_avx2(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int eoClass, const int8_t offsets[5])
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    ptrdiff_t pos0,pos1;
+    edge_neighbors(eoClass, srcstride, pos0,pos1);
+
+    const __m256i table = _mm256_setr_epi8(offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],
+                                           0,0,0, 0,0,0,0, 0,0,0,0,
+                                           offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],
+                                           0,0,0, 0,0,0,0, 0,0,0,0);
+    const __m256i two = _mm256_set1_epi8(2);
+
+    for (int y=0;y<height;y++) {
+      const uint8_t* in = src + y*srcstride;
+
+      for (int x=0;x<w32;x+=32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + x));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(in + x + pos0));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(in + x + pos1));
+
+        __m256i edgeIdx = _mm256_add_epi8(_mm256_add_epi8(sign_8(c,a), sign_8(c,b)), two);
+        __m256i off = _mm256_shuffle_epi8(table, edgeIdx);
+
+        _mm256_storeu_si256((__m256i*)(dst + y*dststride + x), add_offset_8(c,off));
+      }
+    }
+  }
+
+  if (w32 < width) {
+    sao_edge_8_fallback(dst+w32,dststride, src+w32,srcstride, width-w32,height, eoClass,offsets);
+  }
+}
+
+
+void sao_band_16_avx2(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth)
+{
+  const int w16 = width & ~15;
+
+  if (w16) {
+    const __m256i table  = _mm256_setr_epi16(offsets[0],offsets[1],offsets[2],offsets[3], 0,0,0,0,
+                                             offsets[0],offsets[1],offsets[2],offsets[3], 0,0,0,0);
+    const __m256i pos    = _mm256_set1_epi16(bandPosition);
+    const __m256i mask   = _mm256_set1_epi16(31);
+    const __m256i four   = _mm256_set1_epi16(4);
+    const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+    const __m128i shift  = _mm_cvtsi32_si128(bit_depth-5);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<w16;x+=16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + y*srcstride + x));
+
+        // the input may exceed the valid range after decoding errors, limit it for the band index
+
+        __m256i band = _mm256_srl_epi16(_mm256_min_epu16(v,maxval), shift);
+        __m256i k    = _mm256_and_si256(_mm256_sub_epi16(band,pos), mask);
+        __m256i inBand = _mm256_cmpgt_epi16(four,k);
+        __m256i off  = _mm256_shuffle_epi8(table, word_index(k));
+
+        __m256i r = _mm256_blendv_epi8(v, add_offset_16(v,off,maxval), inBand);
+        _mm256_storeu_si256((__m256i*)(dst + y*dststride + x), r);
+      }
+    }
+  }
+
+  if (w16 < width) {
+    sao_band_16_fallback(dst+w16,dststride, src+w16,srcstride, width-w16,height, bandPosition,offsets,
+                         bit_depth);
+  }
+}
+
+
+void sao_edge_16_avx2(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int eoClass, const int8_t offsets[5], int bit_depth)
+{
+  const int w16 = width & ~15;
+
+  if (w16) {
+    ptrdiff_t pos0,pos1;
+    edge_neighbors(eoClass, srcstride, pos0,pos1);
+
+    const __m256i table  = _mm256_setr_epi16(offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],0,0,0,
+                                             offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],0,0,0);
+    const __m256i two    = _mm256_set1_epi16(2);
+    const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+    for (int y=0;y<height;y++) {
+      const uint16_t* in = src + y*srcstride;
+
+      for (int x=0;x<w16;x+=16) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + x));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(in + x + pos0));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(in + x + pos1));
+
+        __m256i edgeIdx = _mm256_add_epi16(_mm256_add_epi16(sign_16(c,a), sign_16(c,b)), two);
+        __m256i off = _mm256_shuffle_epi8(table, word_index(edgeIdx));
+
+        _mm256_storeu_si256((__m256i*)(dst + y*dststride + x), add_offset_16(c,off,maxval));
+      }
+    }
+  }
+
+  if (w16 < width) {
+    sao_edge_16_fallback(dst+w16,dststride, src+w16,srcstride, width-w16,height, eoClass,offsets,
+                         bit_depth);
+  }
+}
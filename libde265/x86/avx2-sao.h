@@ -0,0 +1,39 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef AVX2_SAO_H
+#define AVX2_SAO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+void sao_band_8_avx2(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int bandPosition, const int8_t offsets[4]);
+void sao_edge_8_avx2(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int eoClass, const int8_t offsets[5]);
+
+void sao_band_16_avx2(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth);
+void sao_edge_16_avx2(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int eoClass, const int8_t offsets[5], int bit_depth);
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "avx512-dct.h"
+#include "libde265/util.h"
+#include "libde265/fallback-dct.h"
+
+
+/* The unmasked AVX-512 intrinsics merge into an undefined vector, which GCC reports as
+   uninitialized (-Wmaybe-uninitialized). We use the zero-masking variants with all lanes
+   enabled instead. They compile to the same instructions. */
+
+static const __mmask8  all8  = 0xFF;
+static const __mmask16 all16 = 0xFFFF;
+static const __mmask32 all32 = 0xFFFFFFFF;
+
+
+/* 32x32 inverse DCT, computed like the AVX2 version in avx2-dct.cc: a vertical pass
+   with a fixed 7 bit shift and 16 bit clipping, followed by a horizontal pass with a
+   shift of 20-BitDepth. A whole row of 32 coefficients fits into one 512 bit register,
+   hence the vertical pass processes all columns at once, and the horizontal pass
+   computes a row of output samples in two registers. */
+
+static const int8_t mat_dct[32][32] = {
+  { 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64},
+  { 90, 90, 88, 85, 82, 78, 73, 67, 61, 54, 46, 38, 31, 22, 13,  4,      -4,-13,-22,-31,-38,-46,-54,-61,-67,-73,-78,-82,-85,-88,-90,-90},
+  { 90, 87, 80, 70, 57, 43, 25,  9, -9,-25,-43,-57,-70,-80,-87,-90,     -90,-87,-80,-70,-57,-43,-25, -9,  9, 25, 43, 57, 70, 80, 87, 90},
+  { 90, 82, 67, 46, 22, -4,-31,-54,-73,-85,-90,-88,-78,-61,-38,-13,      13, 38, 61, 78, 88, 90, 85, 73, 54, 31,  4,-22,-46,-67,-82,-90},
+  { 89, 75, 50, 18,-18,-50,-75,-89,-89,-75,-50,-18, 18, 50, 75, 89,      89, 75, 50, 18,-18,-50,-75,-89,-89,-75,-50,-18, 18, 50, 75, 89},
+  { 88, 67, 31,-13,-54,-82,-90,-78,-46, -4, 38, 73, 90, 85, 61, 22,     -22,-61,-85,-90,-73,-38,  4, 46, 78, 90, 82, 54, 13,-31,-67,-88},
+  { 87, 57,  9,-43,-80,-90,-70,-25, 25, 70, 90, 80, 43, -9,-57,-87,     -87,-57, -9, 43, 80, 90, 70, 25,-25,-70,-90,-80,-43,  9, 57, 87},
+  { 85, 46,-13,-67,-90,-73,-22, 38, 82, 88, 54, -4,-61,-90,-78,-31,      31, 78, 90, 61,  4,-54,-88,-82,-38, 22, 73, 90, 67, 13,-46,-85},
+  { 83, 36,-36,-83,-83,-36, 36, 83, 83, 36,-36,-83,-83,-36, 36, 83,      83, 36,-36,-83,-83,-36, 36, 83, 83, 36,-36,-83,-83,-36, 36, 83},
+  { 82, 22,-54,-90,-61, 13, 78, 85, 31,-46,-90,-67,  4, 73, 88, 38,     -38,-88,-73, -4, 67, 90, 46,-31,-85,-78,-13, 61, 90, 54,-22,-82},
+  { 80,  9,-70,-87,-25, 57, 90, 43,-43,-90,-57, 25, 87, 70, -9,-80,     -80, -9, 70, 87, 25,-57,-90,-43, 43, 90, 57,-25,-87,-70,  9, 80},
+  { 78, -4,-82,-73, 13, 85, 67,-22,-88,-61, 31, 90, 54,-38,-90,-46,      46, 90, 38,-54,-90,-31, 61, 88, 22,-67,-85,-13, 73, 82,  4,-78},
+  { 75,-18,-89,-50, 50, 89, 18,-75,-75, 18, 89, 50,-50,-89,-18, 75,      75,-18,-89,-50, 50, 89, 18,-75,-75, 18, 89, 50,-50,-89,-18, 75},
+  { 73,-31,-90,-22, 78, 67,-38,-90,-13, 82, 61,-46,-88, -4, 85, 54,     -54,-85,  4, 88, 46,-61,-82, 13, 90, 38,-67,-78, 22, 90, 31,-73},
+  { 70,-43,-87,  9, 90, 25,-80,-57, 57, 80,-25,-90, -9, 87, 43,-70,     -70, 43, 87, -9,-90,-25, 80, 57,-57,-80, 25, 90,  9,-87,-43, 70},
+  { 67,-54,-78, 38, 85,-22,-90,  4, 90, 13,-88,-31, 82, 46,-73,-61,      61, 73,-46,-82, 31, 88,-13,-90, -4, 90, 22,-85,-38, 78, 54,-67},
+  { 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64,      64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64, 64,-64,-64, 64},
+  { 61,-73,-46, 82, 31,-88,-13, 90, -4,-90, 22, 85,-38,-78, 54, 67,     -67,-54, 78, 38,-85,-22, 90,  4,-90, 13, 88,-31,-82, 46, 73,-61},
+  { 57,-80,-25, 90, -9,-87, 43, 70,-70,-43, 87,  9,-90, 25, 80,-57,     -57, 80, 25,-90,  9, 87,-43,-70, 70, 43,-87, -9, 90,-25,-80, 57},
+  { 54,-85, -4, 88,-46,-61, 82, 13,-90, 38, 67,-78,-22, 90,-31,-73,      73, 31,-90, 22, 78,-67,-38, 90,-13,-82, 61, 46,-88,  4, 85,-54},
+  { 50,-89, 18, 75,-75,-18, 89,-50,-50, 89,-18,-75, 75, 18,-89, 50,      50,-89, 18, 75,-75,-18, 89,-50,-50, 89,-18,-75, 75, 18,-89, 50},
+  { 46,-90, 38, 54,-90, 31, 61,-88, 22, 67,-85, 13, 73,-82,  4, 78,     -78, -4, 82,-73,-13, 85,-67,-22, 88,-61,-31, 90,-54,-38, 90,-46},
+  { 43,-90, 57, 25,-87, 70,  9,-80, 80, -9,-70, 87,-25,-57, 90,-43,     -43, 90,-57,-25, 87,-70, -9, 80,-80,  9, 70,-87, 25, 57,-90, 43},
+  { 38,-88, 73, -4,-67, 90,-46,-31, 85,-78, 13, 61,-90, 54, 22,-82,      82,-22,-54, 90,-61,-13, 78,-85, 31, 46,-90, 67,  4,-73, 88,-38},
+  { 36,-83, 83,-36,-36, 83,-83, 36, 36,-83, 83,-36,-36, 83,-83, 36,      36,-83, 83,-36,-36, 83,-83, 36, 36,-83, 83,-36,-36, 83,-83, 36},
+  { 31,-78, 90,-61,  4, 54,-88, 82,-38,-22, 73,-90, 67,-13,-46, 85,     -85, 46, 13,-67, 90,-73, 22, 38,-82, 88,-54, -4, 61,-90, 78,-31},
+  { 25,-70, 90,-80, 43,  9,-57, 87,-87, 57, -9,-43, 80,-90, 70,-25,     -25, 70,-90, 80,-43, -9, 57,-87, 87,-57,  9, 43,-80, 90,-70, 25},
+  { 22,-61, 85,-90, 73,-38, -4, 46,-78, 90,-82, 54,-13,-31, 67,-88,      88,-67, 31, 13,-54, 82,-90, 78,-46,  4, 38,-73, 90,-85, 61,-22},
+  { 18,-50, 75,-89, 89,-75, 50,-18,-18, 50,-75, 89,-89, 75,-50, 18,      18,-50, 75,-89, 89,-75, 50,-18,-18, 50,-75, 89,-89, 75,-50, 18},
+  { 13,-38, 61,-78, 88,-90, 85,-73, 54,-31,  4, 22,-46, 67,-82, 90,     -90, 82,-67, 46,-22, -4, 31,-54, 73,-85, 90,-88, 78,-61, 38,-13},
+  {  9,-25, 43,-57, 70,-80, 87,-90, 90,-87, 80,-70, 57,-43, 25, -9,      -9, 25,-43, 57,-70, 80,-87, 90,-90, 87,-80, 70,-57, 43,-25,  9},
+  {  4,-13, 22,-31, 38,-46, 54,-61, 67,-73, 78,-82, 85,-88, 90,-90,      90,-90, 88,-85, 82,-78, 73,-67, 61,-54, 46,-38, 31,-22, 13, -4}
+};
+
+
+static inline int32_t coeff_pair(int a, int b)
+{
+  return (int32_t)((uint16_t)a | ((uint32_t)(uint16_t)b << 16));
+}
+
+
+/* Matrix coefficients rearranged for PMADDWD, see idct_tables in avx2-dct.cc.
+
+   col_even/col_odd: for vertical output row i < 16, the pairs (M[j][i],M[j+2][i])
+   for j=0,4,8,... (even) and j=1,5,9,... (odd). Row 31-i is even-odd instead of
+   even+odd.
+
+   row: for each pair of input columns (2p,2p+1) the pairs (M[2p][i],M[2p+1][i])
+   for all output samples i. */
+
+struct idct32_tables
+{
+  int32_t col_even[16][8];
+  int32_t col_odd [16][8];
+  ALIGNED_32(int16_t row[16][64]);
+
+  idct32_tables();
+};
+
+idct32_tables::idct32_tables()
+{
+  for (int i=0;i<16;i++)
+    for (int k=0;k<8;k++) {
+      col_even[i][k] = coeff_pair(mat_dct[4*k  ][i], mat_dct[4*k+2][i]);
+      col_odd [i][k] = coeff_pair(mat_dct[4*k+1][i], mat_dct[4*k+3][i]);
+    }
+
+  for (int p=0;p<16;p++)
+    for (int i=0;i<32;i++) {
+      row[p][2*i  ] = mat_dct[2*p  ][i];
+      row[p][2*i+1] = mat_dct[2*p+1][i];
+    }
+}
+
+static const idct32_tables tables;
+
+
+static inline int highest_bit(uint32_t v)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanReverse(&idx, v);
+  return idx;
+#else
+  return 31 - __builtin_clz(v);
+#endif
+}
+
+
+/* Finds the last row and column that contain a non-zero coefficient.
+   Returns false if all coefficients are zero. */
+static inline bool find_nonzero_extent(const int16_t* coeffs, int* lastRow, int* lastCol)
+{
+  __m512i colOr = _mm512_setzero_si512();
+
+  *lastRow = -1;
+
+  for (int y=0;y<32;y++) {
+    __m512i r = _mm512_loadu_si512(coeffs+y*32);
+
+    if (_mm512_test_epi16_mask(r,r)) {
+      *lastRow = y;
+    }
+
+    colOr = _mm512_or_si512(colOr, r);
+  }
+
+  if (*lastRow < 0) {
+    return false;
+  }
+
+  *lastCol = highest_bit(_mm512_test_epi16_mask(colOr,colOr));
+  return true;
+}
+
+
+// Vertical pass. Writes the 16 bit intermediate values of all columns into g[].
+static inline void idct_columns(int16_t* g, const int16_t* coeffs, int lastRow)
+{
+  const int nEven = std::min(lastRow/4 + 1, 8);
+  const int nOdd  = (lastRow>=1 ? std::min((lastRow-1)/4 + 1, 8) : 0);
+
+  const __m512i rnd1 = _mm512_set1_epi32(1<<6);
+
+  __m512i even_lo[8], even_hi[8];
+  __m512i odd_lo [8], odd_hi [8];
+
+  for (int k=0;k<nEven;k++) {
+    __m512i a = _mm512_loadu_si512(coeffs + (4*k  )*32);
+    __m512i b = _mm512_loadu_si512(coeffs + (4*k+2)*32);
+    even_lo[k] = _mm512_unpacklo_epi16(a,b);
+    even_hi[k] = _mm512_unpackhi_epi16(a,b);
+  }
+
+  for (int k=0;k<nOdd;k++) {
+    __m512i a = _mm512_loadu_si512(coeffs + (4*k+1)*32);
+    __m512i b = _mm512_loadu_si512(coeffs + (4*k+3)*32);
+    odd_lo[k] = _mm512_unpacklo_epi16(a,b);
+    odd_hi[k] = _mm512_unpackhi_epi16(a,b);
+  }
+
+  for (int i=0;i<16;i++) {
+    __m512i e_lo = _mm512_setzero_si512(), e_hi = _mm512_setzero_si512();
+    __m512i o_lo = _mm512_setzero_si512(), o_hi = _mm512_setzero_si512();
+
+    for (int k=0;k<nEven;k++) {
+      __m512i m = _mm512_set1_epi32(tables.col_even[i][k]);
+      e_lo = _mm512_add_epi32(e_lo, _mm512_madd_epi16(even_lo[k], m));
+      e_hi = _mm512_add_epi32(e_hi, _mm512_madd_epi16(even_hi[k], m));
+    }
+
+    for (int k=0;k<nOdd;k++) {
+      __m512i m = _mm512_set1_epi32(tables.col_odd[i][k]);
+      o_lo = _mm512_add_epi32(o_lo, _mm512_madd_epi16(odd_lo[k], m));
+      o_hi = _mm512_add_epi32(o_hi, _mm512_madd_epi16(odd_hi[k], m));
+    }
+
+    e_lo = _mm512_add_epi32(e_lo, rnd1);
+    e_hi = _mm512_add_epi32(e_hi, rnd1);
+
+    // unpack and pack both work within lanes, hence the column order is preserved
+    __m512i top = _mm512_packs_epi32(_mm512_maskz_srai_epi32(all16, _mm512_add_epi32(e_lo,o_lo), 7),
+                                     _mm512_maskz_srai_epi32(all16, _mm512_add_epi32(e_hi,o_hi), 7));
+    __m512i bot = _mm512_packs_epi32(_mm512_maskz_srai_epi32(all16, _mm512_sub_epi32(e_lo,o_lo), 7),
+                                     _mm512_maskz_srai_epi32(all16, _mm512_sub_epi32(e_hi,o_hi), 7));
+
+    _mm512_storeu_si512(g +     i *32, top);
+    _mm512_storeu_si512(g + (31-i)*32, bot);
+  }
+}
+
+
+/* Horizontal pass for one row of intermediate values. acc[q] receives the unscaled
+   output samples 16q..16q+15. */
+static inline void idct_row(__m512i acc[2], const int16_t* grow, int nPairs)
+{
+  acc[0] = _mm512_setzero_si512();
+  acc[1] = _mm512_setzero_si512();
+
+  for (int p=0;p<nPairs;p++) {
+    int32_t pair;
+    memcpy(&pair, grow+2*p, 4);
+    __m512i in = _mm512_set1_epi32(pair);
+
+    acc[0] = _mm512_add_epi32(acc[0], _mm512_madd_epi16(in, _mm512_loadu_si512(tables.row[p]   )));
+    acc[1] = _mm512_add_epi32(acc[1], _mm512_madd_epi16(in, _mm512_loadu_si512(tables.row[p]+32)));
+  }
+}
+
+
+// saturate a row of 32 residuals to 16 bit
+static inline __m512i pack_row(const __m512i r[2])
+{
+  return _mm512_maskz_inserti64x4(all8, _mm512_castsi256_si512(_mm512_maskz_cvtsepi32_epi16(all16, r[0])),
+                                  _mm512_maskz_cvtsepi32_epi16(all16, r[1]), 1);
+}
+
+/* Adds one row of 32 residuals to the image. All values that saturate in the 16 bit
+   additions are clipped to the pixel range anyway. */
+static inline void add_row(uint8_t* dst, const __m512i r[2], __m512i maxval)
+{
+  __m512i d = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)dst));
+  d = _mm512_max_epi16(_mm512_adds_epi16(d, pack_row(r)), _mm512_setzero_si512());
+  _mm256_storeu_si256((__m256i*)dst, _mm512_maskz_cvtusepi16_epi8(all32, d));
+}
+
+static inline void add_row(uint16_t* dst, const __m512i r[2], __m512i maxval)
+{
+  __m512i d = _mm512_loadu_si512(dst);
+  d = _mm512_adds_epi16(d, pack_row(r));
+  d = _mm512_min_epi16(_mm512_max_epi16(d, _mm512_setzero_si512()), maxval);
+  _mm512_storeu_si512(dst, d);
+}
+
+
+template <class pixel_t>
+static inline void transform_idct_add(pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                      int bit_depth)
+{
+  int lastRow, lastCol;
+  if (!find_nonzero_extent(coeffs, &lastRow, &lastCol)) {
+    return;
+  }
+
+  const int postShift = 20-bit_depth;
+  const __m512i maxval = _mm512_set1_epi16((1<<bit_depth)-1);
+
+  if (lastRow==0 && lastCol==0) {
+    int g = (64*coeffs[0] + (1<<6)) >> 7;
+    __m512i r[2];
+    r[0] = r[1] = _mm512_set1_epi32((64*g + (1<<(postShift-1))) >> postShift);
+
+    for (int y=0;y<32;y++) {
+      add_row(dst+y*stride, r, maxval);
+    }
+    return;
+  }
+
+  ALIGNED_32(int16_t g[32*32]);
+  idct_columns(g, coeffs, lastRow);
+
+  const int nPairs = lastCol/2 + 1;
+  const __m512i rnd2 = _mm512_set1_epi32(1<<(postShift-1));
+  const __m128i shift = _mm_cvtsi32_si128(postShift);
+
+  for (int y=0;y<32;y++) {
+    __m512i r[2];
+    idct_row(r, g+y*32, nPairs);
+
+    r[0] = _mm512_maskz_sra_epi32(all16, _mm512_add_epi32(r[0], rnd2), shift);
+    r[1] = _mm512_maskz_sra_epi32(all16, _mm512_add_epi32(r[1], rnd2), shift);
+
+    add_row(dst+y*stride, r, maxval);
+  }
+}
+
+
+void transform_32x32_add_8_avx512(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_idct_add(dst, coeffs, stride, 8);
+}
+
+void transform_32x32_add_16_avx512(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  if (bit_depth > 12) {
+    transform_32x32_add_16_fallback(dst, coeffs, stride, bit_depth);
+    return;
+  }
+
+  transform_idct_add(dst, coeffs, stride, bit_depth);
+}
+
+void transform_idct_32x32_avx512(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  if (max_coeff_bits != 15) {
+    transform_idct_32x32_fallback(dst, coeffs, bdShift, max_coeff_bits);
+    return;
+  }
+
+  int lastRow, lastCol;
+  if (!find_nonzero_extent(coeffs, &lastRow, &lastCol)) {
+    memset(dst, 0, 32*32*sizeof(int32_t));
+    return;
+  }
+
+  ALIGNED_32(int16_t g[32*32]);
+  idct_columns(g, coeffs, lastRow);
+
+  const int nPairs = lastCol/2 + 1;
+  const __m512i rnd2 = _mm512_set1_epi32(1<<(bdShift-1));
+  const __m128i shift = _mm_cvtsi32_si128(bdShift);
+
+  for (int y=0;y<32;y++) {
+    __m512i r[2];
+    idct_row(r, g+y*32, nPairs);
+
+    _mm512_storeu_si512(dst+y*32,    _mm512_maskz_sra_epi32(all16, _mm512_add_epi32(r[0], rnd2), shift));
+    _mm512_storeu_si512(dst+y*32+16, _mm512_maskz_sra_epi32(all16, _mm512_add_epi32(r[1], rnd2), shift));
+  }
+}
@@ -0,0 +1,366 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "avx512-motion.h"
+#include "avx2-motion.h"
+#include "libde265/util.h"
+
+
+// Filter definitions, see avx2-motion.cc.
+
+static const int8_t qpel_filters[4][8] = {
+  {  0, 0,  0, 64,  0,  0,  0,  0 }, // unused
+  { -1, 4,-10, 58, 17, -5,  1,  0 },
+  { -1, 4,-11, 40, 40,-11,  4, -1 },
+  {  1,-5, 17, 58,-10,  4, -1,  0 }
+};
+
+static const int qpel_extra_before[4] = { 0,3,3,2 };
+static const int qpel_extra_after [4] = { 0,3,4,4 };
+
+#define QPEL_TAPS(frac) ((frac)==2 ? 8 : 7)
+
+static const int8_t epel_filters[7][4] = {
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+static const int epel_extra_before = 1;
+static const int epel_extra_after  = 2;
+
+#define MAX_PB_SIZE 64
+
+// zero-masking with all lanes enabled, see avx512-dct.cc
+static const __mmask8  all8  = 0xFF;
+static const __mmask16 all16 = 0xFFFF;
+
+
+/* Byte shuffles for the horizontal filter, applied to each 128-bit lane. Shuffle k
+   selects the input pairs (i+2k, i+2k+1) for the output samples i of that lane. */
+
+ALIGNED_16(static const int8_t) hfilter_shuffle[4][16] = {
+  { 0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8 },
+  { 2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10 },
+  { 4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12 },
+  { 6,7,7,8,8,9,9,10,10,11,11,12,12,13,13,14 }
+};
+
+
+// The filter classes are kept local, avx2-motion.cc defines classes with the same names.
+
+namespace {
+
+/* The filters compute 32 output samples at a time. filter_block_32() only processes
+   widths that are a multiple of 32. The remaining columns (the right part of a 48 wide
+   AMP partition) and all narrower blocks are passed on to the AVX2 functions, since
+   they would not fill a 512 bit register. */
+
+template <class Filter>
+static inline void filter_block_32(int16_t* dst, ptrdiff_t dststride,
+                                   int width, int height, const Filter& filter)
+{
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x+=32) {
+      _mm512_storeu_si512(&dst[x], filter.filter32(y,x));
+    }
+
+    dst += dststride;
+  }
+}
+
+
+// full-sample position: scale to 14 bit
+
+struct pixels_filter
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+
+  pixels_filter(const uint8_t* s, ptrdiff_t st) : src(s), stride(st) { }
+
+  __m512i filter32(int y,int x) const {
+    __m256i p = _mm256_loadu_si256((const __m256i*)&src[y*stride+x]);
+    return _mm512_slli_epi16(_mm512_cvtepu8_epi16(p), 6);
+  }
+};
+
+
+// horizontal filter on 8-bit samples with 2*nPairs taps (PMADDUBSW, 16 bit sums)
+
+template <int nPairs>
+struct hfilter_8bit
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m512i coeff[nPairs];
+  __m512i shuffle[nPairs];
+
+  hfilter_8bit(const uint8_t* s, ptrdiff_t st, const int8_t* filter) : src(s), stride(st) {
+    for (int k=0;k<nPairs;k++) {
+      coeff[k] = _mm512_set1_epi16((int16_t)((uint8_t)filter[2*k] | ((uint8_t)filter[2*k+1] << 8)));
+      shuffle[k] = _mm512_maskz_broadcast_i32x4(all16, _mm_load_si128((const __m128i*)hfilter_shuffle[k]));
+    }
+  }
+
+  __m512i filter32(int y,int x) const {
+    const uint8_t* p = &src[y*stride+x];
+
+    // lane j gets the input for the output samples 8j..8j+7
+    __m256i lo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                                         _mm_loadu_si128((const __m128i*)(p+8)), 1);
+    __m256i hi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p+16))),
+                                         _mm_loadu_si128((const __m128i*)(p+24)), 1);
+    __m512i in = _mm512_maskz_inserti64x4(all8, _mm512_castsi256_si512(lo), hi, 1);
+
+    __m512i sum = _mm512_maddubs_epi16(_mm512_shuffle_epi8(in, shuffle[0]), coeff[0]);
+    for (int k=1;k<nPairs;k++) {
+      sum = _mm512_add_epi16(sum, _mm512_maddubs_epi16(_mm512_shuffle_epi8(in, shuffle[k]), coeff[k]));
+    }
+
+    return sum;
+  }
+};
+
+
+// vertical filter on 8-bit samples (16 bit sums)
+
+template <int nTaps>
+struct vfilter_8bit
+{
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m512i coeff[nTaps];
+
+  vfilter_8bit(const uint8_t* s, ptrdiff_t st, const int8_t* filter) : src(s), stride(st) {
+    for (int k=0;k<nTaps;k++) {
+      coeff[k] = _mm512_set1_epi16(filter[k]);
+    }
+  }
+
+  __m512i filter32(int y,int x) const {
+    const uint8_t* p = &src[y*stride+x];
+
+    __m512i sum = _mm512_setzero_si512();
+    for (int k=0;k<nTaps;k++) {
+      __m512i in = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(p + k*stride)));
+      sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(in, coeff[k]));
+    }
+
+    return sum;
+  }
+};
+
+
+/* Vertical filter on the 16-bit output of the horizontal pass. Rows are interleaved
+   in pairs and multiplied with PMADDWD, the result is truncated to 16 bit. */
+
+template <int nTaps>
+struct vfilter_16bit
+{
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m512i coeff[(nTaps+1)/2];
+
+  vfilter_16bit(const int16_t* s, ptrdiff_t st, const int8_t* filter, int shft)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shft)) {
+    for (int k=0;k<nTaps;k+=2) {
+      int c0 = filter[k];
+      int c1 = (k+1<nTaps ? filter[k+1] : 0);
+      coeff[k/2] = _mm512_set1_epi32((int32_t)((uint16_t)c0 | ((uint32_t)(uint16_t)c1 << 16)));
+    }
+  }
+
+  __m512i filter32(int y,int x) const {
+    const int16_t* p = &src[y*stride+x];
+
+    __m512i lo = _mm512_setzero_si512();
+    __m512i hi = _mm512_setzero_si512();
+
+    for (int k=0;k<nTaps;k+=2) {
+      __m512i a = _mm512_loadu_si512(p + k*stride);
+      __m512i b = (k+1<nTaps ? _mm512_loadu_si512(p + (k+1)*stride) : _mm512_setzero_si512());
+
+      lo = _mm512_add_epi32(lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a,b), coeff[k/2]));
+      hi = _mm512_add_epi32(hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a,b), coeff[k/2]));
+    }
+
+    const __m512i mask = _mm512_set1_epi32(0xFFFF);
+    lo = _mm512_and_si512(_mm512_maskz_sra_epi32(all16, lo,shift), mask);
+    hi = _mm512_and_si512(_mm512_maskz_sra_epi32(all16, hi,shift), mask);
+
+    // unpack and pack both work within lanes, hence the sample order is preserved
+    return _mm512_packus_epi32(lo,hi);
+  }
+};
+
+} // namespace
+
+
+// --- luma ---
+
+typedef void (*qpel_func)(int16_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src, ptrdiff_t srcstride,
+                          int width, int height, int16_t* mcbuffer);
+
+template <int xFrac, int yFrac>
+static inline void put_qpel_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                                     const uint8_t *src, ptrdiff_t srcstride,
+                                     int width, int height, int16_t* mcbuffer,
+                                     qpel_func narrow)
+{
+  const int w32 = width & ~31;
+
+  if (w32==0) {
+    // too narrow for the 512 bit filters
+  }
+  else if (xFrac==0 && yFrac==0) {
+    filter_block_32(dst,dststride, w32,height, pixels_filter(src,srcstride));
+  }
+  else if (yFrac==0) {
+    filter_block_32(dst,dststride, w32,height,
+                    hfilter_8bit<4>(src - qpel_extra_before[xFrac], srcstride,
+                                    qpel_filters[xFrac]));
+  }
+  else if (xFrac==0) {
+    filter_block_32(dst,dststride, w32,height,
+                    vfilter_8bit<QPEL_TAPS(yFrac)>(src - qpel_extra_before[yFrac]*srcstride, srcstride,
+                                                   qpel_filters[yFrac]));
+  }
+  else {
+    int nRows = qpel_extra_before[yFrac] + height + qpel_extra_after[yFrac];
+
+    filter_block_32(mcbuffer,MAX_PB_SIZE, w32,nRows,
+                    hfilter_8bit<4>(src - qpel_extra_before[yFrac]*srcstride - qpel_extra_before[xFrac],
+                                    srcstride, qpel_filters[xFrac]));
+
+    filter_block_32(dst,dststride, w32,height,
+                    vfilter_16bit<QPEL_TAPS(yFrac)>(mcbuffer, MAX_PB_SIZE, qpel_filters[yFrac], 6));
+  }
+
+  if (width > w32) {
+    narrow(dst+w32,dststride, src+w32,srcstride, width-w32,height, mcbuffer);
+  }
+}
+
+
+#define QPEL_AVX512(x,y)                                                        \
+  void put_qpel_ ## x ## _ ## y ## _avx512(int16_t *dst, ptrdiff_t dststride,  \
+                                           const uint8_t *src, ptrdiff_t srcstride, \
+                                           int width, int height, int16_t* mcbuffer) \
+  { put_qpel_8_avx512<x,y>(dst,dststride, src,srcstride, width,height, mcbuffer, \
+                           put_qpel_ ## x ## _ ## y ## _avx2); }
+
+QPEL_AVX512(0,0) QPEL_AVX512(0,1) QPEL_AVX512(0,2) QPEL_AVX512(0,3)
+QPEL_AVX512(1,0) QPEL_AVX512(1,1) QPEL_AVX512(1,2) QPEL_AVX512(1,3)
+QPEL_AVX512(2,0) QPEL_AVX512(2,1) QPEL_AVX512(2,2) QPEL_AVX512(2,3)
+QPEL_AVX512(3,0) QPEL_AVX512(3,1) QPEL_AVX512(3,2) QPEL_AVX512(3,3)
+
+
+// --- chroma ---
+
+void put_epel_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       int mx, int my, int16_t* mcbuffer)
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    filter_block_32(dst,dststride, w32,height, pixels_filter(src,srcstride));
+  }
+
+  if (width > w32) {
+    put_epel_8_avx2(dst+w32,dststride, src+w32,srcstride, width-w32,height, mx,my, mcbuffer);
+  }
+}
+
+void put_epel_h_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                         const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    filter_block_32(dst,dststride, w32,height,
+                    hfilter_8bit<2>(src - epel_extra_before, srcstride, epel_filters[mx-1]));
+  }
+
+  if (width > w32) {
+    put_epel_h_8_avx2(dst+w32,dststride, src+w32,srcstride, width-w32,height,
+                      mx,my, mcbuffer, bit_depth);
+  }
+}
+
+void put_epel_v_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                         const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    filter_block_32(dst,dststride, w32,height,
+                    vfilter_8bit<4>(src - epel_extra_before*srcstride, srcstride, epel_filters[my-1]));
+  }
+
+  if (width > w32) {
+    put_epel_v_8_avx2(dst+w32,dststride, src+w32,srcstride, width-w32,height,
+                      mx,my, mcbuffer, bit_depth);
+  }
+}
+
+void put_epel_hv_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src, ptrdiff_t srcstride,
+                          int width, int height,
+                          int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  const int w32 = width & ~31;
+
+  if (w32) {
+    int nRows = epel_extra_before + height + epel_extra_after;
+
+    filter_block_32(mcbuffer,MAX_PB_SIZE, w32,nRows,
+                    hfilter_8bit<2>(src - epel_extra_before*srcstride - epel_extra_before, srcstride,
+                                    epel_filters[mx-1]));
+
+    filter_block_32(dst,dststride, w32,height,
+                    vfilter_16bit<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+  }
+
+  if (width > w32) {
+    put_epel_hv_8_avx2(dst+w32,dststride, src+w32,srcstride, width-w32,height,
+                       mx,my, mcbuffer, bit_depth);
+  }
+}
@@ -0,0 +1,58 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef AVX512_MOTION_H
+#define AVX512_MOTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+void put_epel_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                       const uint8_t *src, ptrdiff_t srcstride,
+                       int width, int height,
+                       int mx, int my, int16_t* mcbuffer);
+void put_epel_h_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                         const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth);
+void put_epel_v_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                         const uint8_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth);
+void put_epel_hv_8_avx512(int16_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src, ptrdiff_t srcstride,
+                          int width, int height,
+                          int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+#define DECLARE_QPEL_AVX512(x,y)                                                \
+  void put_qpel_ ## x ## _ ## y ## _avx512(int16_t *dst, ptrdiff_t dststride,  \
+                                           const uint8_t *src, ptrdiff_t srcstride, \
+                                           int width, int height, int16_t* mcbuffer);
+
+DECLARE_QPEL_AVX512(0,0) DECLARE_QPEL_AVX512(0,1) DECLARE_QPEL_AVX512(0,2) DECLARE_QPEL_AVX512(0,3)
+DECLARE_QPEL_AVX512(1,0) DECLARE_QPEL_AVX512(1,1) DECLARE_QPEL_AVX512(1,2) DECLARE_QPEL_AVX512(1,3)
+DECLARE_QPEL_AVX512(2,0) DECLARE_QPEL_AVX512(2,1) DECLARE_QPEL_AVX512(2,2) DECLARE_QPEL_AVX512(2,3)
+DECLARE_QPEL_AVX512(3,0) DECLARE_QPEL_AVX512(3,1) DECLARE_QPEL_AVX512(3,2) DECLARE_QPEL_AVX512(3,3)
+
+#undef DECLARE_QPEL_AVX512
+
+#endif
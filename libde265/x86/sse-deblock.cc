@@ -0,0 +1,399 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "x86/sse-deblock.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+#include <smmintrin.h> // SSE4.1
+
+
+/* All four lines of an edge segment are filtered in parallel. Every sample position
+   across the edge (p3..p0, q0..q3) is held in one register with 32 bit lanes, lane k
+   holding line k. This keeps all intermediate values exact for any bit depth, so the
+   8 and 16 bit versions only differ in how the samples are loaded and stored.
+ */
+
+enum { P3=0, P2=1, P1=2, P0=3, Q0=4, Q1=5, Q2=6, Q3=7 };
+
+
+// --- load / store one line of 8 samples across a vertical edge, as 8x16 bit ---
+
+static inline __m128i load_line(const uint8_t* p)
+{
+  return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p));
+}
+
+static inline __m128i load_line(const uint16_t* p)
+{
+  return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void store_line(uint8_t* p, __m128i v)
+{
+  _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v,v));
+}
+
+static inline void store_line(uint16_t* p, __m128i v)
+{
+  _mm_storeu_si128((__m128i*)p, v);
+}
+
+
+// --- load / store one row of 4 samples along a horizontal edge, as 4x32 bit ---
+
+static inline __m128i load_row(const uint8_t* p)
+{
+  int32_t v;
+  memcpy(&v,p,4);
+  return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v));
+}
+
+static inline __m128i load_row(const uint16_t* p)
+{
+  return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+
+static inline void store_row(uint8_t* p, __m128i v)
+{
+  v = _mm_packus_epi32(v,v);
+  int32_t r = _mm_cvtsi128_si32(_mm_packus_epi16(v,v));
+  memcpy(p,&r,4);
+}
+
+static inline void store_row(uint16_t* p, __m128i v)
+{
+  _mm_storel_epi64((__m128i*)p, _mm_packus_epi32(v,v));
+}
+
+
+/* Load the 4x8 samples around the edge into s[P3..Q3].
+   'ptr' points to the first Q sample.
+ */
+template <class pixel_t>
+static inline void load_segment(const pixel_t* ptr, ptrdiff_t stride, bool vertical, __m128i s[8])
+{
+  if (vertical) {
+    __m128i l0 = load_line(ptr-4);
+    __m128i l1 = load_line(ptr-4+  stride);
+    __m128i l2 = load_line(ptr-4+2*stride);
+    __m128i l3 = load_line(ptr-4+3*stride);
+
+    // transpose 4 lines x 8 samples -> 8 sample positions x 4 lines
+
+    __m128i a = _mm_unpacklo_epi16(l0,l1);
+    __m128i b = _mm_unpacklo_epi16(l2,l3);
+    __m128i c = _mm_unpackhi_epi16(l0,l1);
+    __m128i d = _mm_unpackhi_epi16(l2,l3);
+
+    __m128i s01 = _mm_unpacklo_epi32(a,b);
+    __m128i s23 = _mm_unpackhi_epi32(a,b);
+    __m128i s45 = _mm_unpacklo_epi32(c,d);
+    __m128i s67 = _mm_unpackhi_epi32(c,d);
+
+    s[0] = _mm_cvtepu16_epi32(s01);
+    s[1] = _mm_cvtepu16_epi32(_mm_srli_si128(s01,8));
+    s[2] = _mm_cvtepu16_epi32(s23);
+    s[3] = _mm_cvtepu16_epi32(_mm_srli_si128(s23,8));
+    s[4] = _mm_cvtepu16_epi32(s45);
+    s[5] = _mm_cvtepu16_epi32(_mm_srli_si128(s45,8));
+    s[6] = _mm_cvtepu16_epi32(s67);
+    s[7] = _mm_cvtepu16_epi32(_mm_srli_si128(s67,8));
+  }
+  else {
+    for (int i=0;i<8;i++) {
+      s[i] = load_row(ptr + (i-4)*stride);
+    }
+  }
+}
+
+
+/* Write back the sample positions [first;last] of s[].
+   For vertical edges, always complete lines of 8 samples are written.
+ */
+template <class pixel_t>
+static inline void store_segment(pixel_t* ptr, ptrdiff_t stride, bool vertical, const __m128i s[8],
+                                 int first, int last)
+{
+  if (vertical) {
+    __m128i s01 = _mm_packus_epi32(s[0],s[1]);
+    __m128i s23 = _mm_packus_epi32(s[2],s[3]);
+    __m128i s45 = _mm_packus_epi32(s[4],s[5]);
+    __m128i s67 = _mm_packus_epi32(s[6],s[7]);
+
+    // inverse of the transpose in load_segment()
+
+    __m128i t0 = _mm_unpacklo_epi32(s01,s23);
+    __m128i t1 = _mm_unpackhi_epi32(s01,s23);
+    __m128i t2 = _mm_unpacklo_epi32(s45,s67);
+    __m128i t3 = _mm_unpackhi_epi32(s45,s67);
+
+    __m128i a = _mm_unpacklo_epi32(t0,t1);
+    __m128i b = _mm_unpackhi_epi32(t0,t1);
+    __m128i c = _mm_unpacklo_epi32(t2,t3);
+    __m128i d = _mm_unpackhi_epi32(t2,t3);
+
+    const __m128i deinterleave = _mm_setr_epi8(0,1,4,5,8,9,12,13, 2,3,6,7,10,11,14,15);
+    a = _mm_shuffle_epi8(a, deinterleave);
+    b = _mm_shuffle_epi8(b, deinterleave);
+    c = _mm_shuffle_epi8(c, deinterleave);
+    d = _mm_shuffle_epi8(d, deinterleave);
+
+    store_line(ptr-4,         _mm_unpacklo_epi64(a,c));
+    store_line(ptr-4+  stride,_mm_unpackhi_epi64(a,c));
+    store_line(ptr-4+2*stride,_mm_unpacklo_epi64(b,d));
+    store_line(ptr-4+3*stride,_mm_unpackhi_epi64(b,d));
+  }
+  else {
+    for (int i=first;i<=last;i++) {
+      store_row(ptr + (i-4)*stride, s[i]);
+    }
+  }
+}
+
+
+static inline __m128i clip3(__m128i lo, __m128i hi, __m128i v)
+{
+  return _mm_min_epi32(_mm_max_epi32(v,lo),hi);
+}
+
+
+template <class pixel_t>
+static void deblock_luma_sse4(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                              int beta, int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  __m128i s[8];
+  load_segment(ptr, stride, vertical, s);
+
+
+  // --- decisions, only based on lines 0 and 3 ---
+
+  __m128i dp  = _mm_abs_epi32(_mm_sub_epi32(_mm_add_epi32(s[P2],s[P0]), _mm_slli_epi32(s[P1],1)));
+  __m128i dq  = _mm_abs_epi32(_mm_sub_epi32(_mm_add_epi32(s[Q2],s[Q0]), _mm_slli_epi32(s[Q1],1)));
+  __m128i dpq = _mm_add_epi32(dp,dq);
+
+  int dpq0 = _mm_cvtsi128_si32(dpq);
+  int dpq3 = _mm_extract_epi32(dpq,3);
+
+  if (dpq0+dpq3 >= beta) {
+    return;
+  }
+
+  int dE;
+
+  if (2*dpq0 < (beta>>2) && 2*dpq3 < (beta>>2)) {
+    __m128i flat = _mm_add_epi32(_mm_abs_epi32(_mm_sub_epi32(s[P3],s[P0])),
+                                 _mm_abs_epi32(_mm_sub_epi32(s[Q0],s[Q3])));
+    __m128i step = _mm_abs_epi32(_mm_sub_epi32(s[P0],s[Q0]));
+
+    int tcLimit = (5*tc+1)>>1;
+
+    bool dSam0 = (_mm_cvtsi128_si32(flat)   < (beta>>3) && _mm_cvtsi128_si32(step)   < tcLimit);
+    bool dSam3 = (_mm_extract_epi32(flat,3) < (beta>>3) && _mm_extract_epi32(step,3) < tcLimit);
+
+    dE = (dSam0 && dSam3) ? 2 : 1;
+  }
+  else {
+    dE = 1;
+  }
+
+
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi32((1<<bitDepth)-1);
+
+  __m128i r[8];
+  for (int i=0;i<8;i++) r[i]=s[i];
+
+  if (dE==2) {
+    // strong filtering
+
+    const __m128i tc2  = _mm_set1_epi32(2*tc);
+    const __m128i four = _mm_set1_epi32(4);
+    const __m128i two  = _mm_set1_epi32(2);
+
+    __m128i p0q0    = _mm_add_epi32(s[P0],s[Q0]);
+    __m128i p1p0q0  = _mm_add_epi32(s[P1],p0q0);
+    __m128i p0q0q1  = _mm_add_epi32(p0q0,s[Q1]);
+
+    // p2 + 2*p1 + 2*p0 + 2*q0 + q1
+    __m128i sumP0 = _mm_add_epi32(_mm_add_epi32(s[P2],s[Q1]), _mm_slli_epi32(p1p0q0,1));
+    // p2 + p1 + p0 + q0
+    __m128i sumP1 = _mm_add_epi32(s[P2],p1p0q0);
+    // 2*p3 + 3*p2 + p1 + p0 + q0
+    __m128i sumP2 = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(s[P3],s[P2]),1),
+                                  _mm_add_epi32(s[P2],p1p0q0));
+
+    __m128i sumQ0 = _mm_add_epi32(_mm_add_epi32(s[Q2],s[P1]), _mm_slli_epi32(p0q0q1,1));
+    __m128i sumQ1 = _mm_add_epi32(s[Q2],p0q0q1);
+    __m128i sumQ2 = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(s[Q3],s[Q2]),1),
+                                  _mm_add_epi32(s[Q2],p0q0q1));
+
+    r[P0] = _mm_srai_epi32(_mm_add_epi32(sumP0,four),3);
+    r[P1] = _mm_srai_epi32(_mm_add_epi32(sumP1,two ),2);
+    r[P2] = _mm_srai_epi32(_mm_add_epi32(sumP2,four),3);
+    r[Q0] = _mm_srai_epi32(_mm_add_epi32(sumQ0,four),3);
+    r[Q1] = _mm_srai_epi32(_mm_add_epi32(sumQ1,two ),2);
+    r[Q2] = _mm_srai_epi32(_mm_add_epi32(sumQ2,four),3);
+
+    for (int i=P2;i<=Q2;i++) {
+      r[i] = clip3(_mm_sub_epi32(s[i],tc2), _mm_add_epi32(s[i],tc2), r[i]);
+    }
+  }
+  else {
+    // weak filtering
+
+    int dp_sum = _mm_cvtsi128_si32(dp) + _mm_extract_epi32(dp,3);
+    int dq_sum = _mm_cvtsi128_si32(dq) + _mm_extract_epi32(dq,3);
+    int sideLimit = (beta + (beta>>1))>>3;
+
+    bool dEp = (dp_sum < sideLimit);
+    bool dEq = (dq_sum < sideLimit);
+
+    const __m128i vtc = _mm_set1_epi32(tc);
+    const __m128i mtc = _mm_set1_epi32(-tc);
+
+    // delta = (9*(q0-p0) - 3*(q1-p1) + 8)>>4
+
+    __m128i d0 = _mm_sub_epi32(s[Q0],s[P0]);
+    __m128i d1 = _mm_sub_epi32(s[Q1],s[P1]);
+    __m128i delta = _mm_sub_epi32(_mm_add_epi32(_mm_slli_epi32(d0,3),d0),
+                                  _mm_add_epi32(_mm_slli_epi32(d1,1),d1));
+    delta = _mm_srai_epi32(_mm_add_epi32(delta,_mm_set1_epi32(8)),4);
+
+    // lines with |delta| >= 10*tc are not filtered
+
+    __m128i active = _mm_cmplt_epi32(_mm_abs_epi32(delta), _mm_set1_epi32(10*tc));
+    if (_mm_movemask_epi8(active)==0) {
+      return;
+    }
+
+    delta = clip3(mtc,vtc,delta);
+
+    r[P0] = clip3(zero,maxval, _mm_add_epi32(s[P0],delta));
+    r[Q0] = clip3(zero,maxval, _mm_sub_epi32(s[Q0],delta));
+
+    const __m128i one  = _mm_set1_epi32(1);
+    const __m128i vtc2 = _mm_set1_epi32(tc>>1);
+    const __m128i mtc2 = _mm_set1_epi32(-(tc>>1));
+
+    if (dEp) {
+      // (((p2+p0+1)>>1)-p1+delta)>>1
+      __m128i avg = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(s[P2],s[P0]),one),1);
+      __m128i delta_p = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(avg,s[P1]),delta),1);
+      delta_p = clip3(mtc2,vtc2,delta_p);
+      r[P1] = clip3(zero,maxval, _mm_add_epi32(s[P1],delta_p));
+    }
+
+    if (dEq) {
+      // (((q2+q0+1)>>1)-q1-delta)>>1
+      __m128i avg = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(s[Q2],s[Q0]),one),1);
+      __m128i delta_q = _mm_srai_epi32(_mm_sub_epi32(_mm_sub_epi32(avg,s[Q1]),delta),1);
+      delta_q = clip3(mtc2,vtc2,delta_q);
+      r[Q1] = clip3(zero,maxval, _mm_add_epi32(s[Q1],delta_q));
+    }
+
+    for (int i=P1;i<=Q1;i++) {
+      r[i] = _mm_blendv_epi8(s[i],r[i],active);
+    }
+  }
+
+  if (!filterP) { r[P2]=s[P2]; r[P1]=s[P1]; r[P0]=s[P0]; }
+  if (!filterQ) { r[Q0]=s[Q0]; r[Q1]=s[Q1]; r[Q2]=s[Q2]; }
+
+  int first = filterP ? (dE==2 ? P2 : P1) : Q0;
+  int last  = filterQ ? (dE==2 ? Q2 : Q1) : P0;
+
+  store_segment(ptr, stride, vertical, r, first, last);
+}
+
+
+template <class pixel_t>
+static void deblock_chroma_sse4(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                                int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  __m128i s[8];
+  load_segment(ptr, stride, vertical, s);
+
+  // delta = Clip3(-tc,tc, ((((q0-p0)*4)+p1-q1+4)>>3))
+
+  __m128i delta = _mm_slli_epi32(_mm_sub_epi32(s[Q0],s[P0]),2);
+  delta = _mm_add_epi32(delta, _mm_sub_epi32(s[P1],s[Q1]));
+  delta = _mm_srai_epi32(_mm_add_epi32(delta,_mm_set1_epi32(4)),3);
+  delta = clip3(_mm_set1_epi32(-tc), _mm_set1_epi32(tc), delta);
+
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi32((1<<bitDepth)-1);
+
+  if (filterP) s[P0] = clip3(zero,maxval, _mm_add_epi32(s[P0],delta));
+  if (filterQ) s[Q0] = clip3(zero,maxval, _mm_sub_epi32(s[Q0],delta));
+
+  store_segment(ptr, stride, vertical, s, filterP ? P0 : Q0, filterQ ? Q0 : P0);
+}
+
+
+
+void deblock_luma_v_8_sse4(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ)
+{
+  deblock_luma_sse4<uint8_t>(ptr, stride, true, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_luma_h_8_sse4(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ)
+{
+  deblock_luma_sse4<uint8_t>(ptr, stride, false, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_chroma_v_8_sse4(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ)
+{
+  deblock_chroma_sse4<uint8_t>(ptr, stride, true, tc, filterP, filterQ, 8);
+}
+
+void deblock_chroma_h_8_sse4(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ)
+{
+  deblock_chroma_sse4<uint8_t>(ptr, stride, false, tc, filterP, filterQ, 8);
+}
+
+
+void deblock_luma_v_16_sse4(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_luma_sse4<uint16_t>(ptr, stride, true, beta, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_luma_h_16_sse4(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_luma_sse4<uint16_t>(ptr, stride, false, beta, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_chroma_v_16_sse4(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_sse4<uint16_t>(ptr, stride, true, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_chroma_h_16_sse4(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_sse4<uint16_t>(ptr, stride, false, tc, filterP, filterQ, bit_depth);
+}
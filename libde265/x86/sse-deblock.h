@@ -0,0 +1,38 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SSE_DEBLOCK_H
+#define SSE_DEBLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void deblock_luma_v_8_sse4(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ);
+void deblock_luma_h_8_sse4(uint8_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ);
+void deblock_chroma_v_8_sse4(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ);
+void deblock_chroma_h_8_sse4(uint8_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ);
+
+void deblock_luma_v_16_sse4(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth);
+void deblock_luma_h_16_sse4(uint16_t *ptr, ptrdiff_t stride, int beta, int tc, bool filterP, bool filterQ, int bit_depth);
+void deblock_chroma_v_16_sse4(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth);
+void deblock_chroma_h_16_sse4(uint16_t *ptr, ptrdiff_t stride, int tc, bool filterP, bool filterQ, int bit_depth);
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "x86/sse-intrapred.h"
+#include "libde265/fallback-intrapred.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+#include <smmintrin.h> // SSE4.1
+
+
+extern const int intraPredAngle_table[1+34];
+extern const int invAngle_table[25-10];
+
+
+/* All kernels work on samples widened to 16 bit lanes (32 bit lanes where the
+   intermediate values need it), so the 8 and 16 bit versions share the same code
+   and only differ in the load/store helpers below. The 16 bit versions are exact
+   up to a bit depth of 12; deeper streams are passed to the fallback.
+ */
+
+static inline __m128i load8(const uint8_t* p)  { return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p)); }
+static inline __m128i load8(const uint16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+
+static inline __m128i load4_32(const uint8_t* p)
+{
+  int32_t v;
+  memcpy(&v, p, 4);
+  return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v));
+}
+
+static inline __m128i load4_32(const uint16_t* p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p)); }
+
+static inline void store8(uint8_t* p, __m128i v)  { _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v,v)); }
+static inline void store8(uint16_t* p, __m128i v) { _mm_storeu_si128((__m128i*)p, v); }
+
+static inline void store4(uint8_t* p, __m128i v)
+{
+  int32_t r = _mm_cvtsi128_si32(_mm_packus_epi16(v,v));
+  memcpy(p, &r, 4);
+}
+
+static inline void store4(uint16_t* p, __m128i v) { _mm_storel_epi64((__m128i*)p, v); }
+
+
+// store one row of nT samples held in 16 bit lanes (nT>=4)
+template <class pixel_t>
+static inline void store_row(pixel_t* dst, const __m128i* v, int nT)
+{
+  if (nT==4) {
+    store4(dst, v[0]);
+  }
+  else {
+    for (int i=0;i<nT/8;i++) {
+      store8(dst+8*i, v[i]);
+    }
+  }
+}
+
+
+// --- reference sample smoothing (8.4.4.2.3) ---
+
+template <class pixel_t>
+static void filter_border(pixel_t* p, int nT, bool strong)
+{
+  // 8 samples of slack at the end, since the last block of 8 can run past 2*nT
+  pixel_t  pF_mem[4*32+1+8];
+  pixel_t* pF = &pF_mem[2*32];
+
+  if (strong) {
+    // bi-linear interpolation between the three corner samples (nT==32)
+    const __m128i p0 = _mm_set1_epi32(p[0]);
+    const __m128i dTop  = _mm_set1_epi32(p[ 64]-p[0]);
+    const __m128i dLeft = _mm_set1_epi32(p[-64]-p[0]);
+    const __m128i rnd   = _mm_set1_epi32(32);
+    __m128i idx = _mm_setr_epi32(1,2,3,4);
+
+    for (int i=1;i<=64;i+=4) {
+      __m128i top  = _mm_add_epi32(p0, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(idx,dTop ),rnd),6));
+      __m128i left = _mm_add_epi32(p0, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(idx,dLeft),rnd),6));
+
+      // the left side is stored in descending order
+      left = _mm_shuffle_epi32(left, _MM_SHUFFLE(0,1,2,3));
+
+      store4(pF+i,     _mm_packus_epi32(top, top));
+      store4(pF-i-3,   _mm_packus_epi32(left,left));
+
+      idx = _mm_add_epi32(idx, _mm_set1_epi32(4));
+    }
+
+    pF[0] = p[0];
+  }
+  else {
+    const __m128i two = _mm_set1_epi16(2);
+
+    for (int i=-(2*nT-1) ; i<=2*nT-1 ; i+=8) {
+      __m128i a = load8(p+i-1);
+      __m128i b = load8(p+i);
+      __m128i c = load8(p+i+1);
+
+      __m128i sum = _mm_add_epi16(_mm_add_epi16(a,c), _mm_add_epi16(_mm_slli_epi16(b,1), two));
+      store8(pF+i, _mm_srli_epi16(sum,2));
+    }
+
+    pF[-2*nT] = p[-2*nT];
+    pF[ 2*nT] = p[ 2*nT];
+  }
+
+  memcpy(p-2*nT, pF-2*nT, (4*nT+1) * sizeof(pixel_t));
+}
+
+
+// --- planar prediction (8.4.4.2.4) ---
+
+template <class pixel_t>
+static void pred_planar(pixel_t* dst, ptrdiff_t dststride, const pixel_t* border, int nT)
+{
+  const int shift = Log2(nT)+1;
+  const int nVec  = nT/4;
+
+  /* For every column x, the terms that do not depend on y are collected in 'base',
+     which then advances by (bottom-left - top[x]) per row. Only the left sample
+     term has to be multiplied in each row. */
+
+  __m128i base[8], step[8], wLeft[8];
+
+  const __m128i TR = _mm_set1_epi32(border[ 1+nT]);
+  const __m128i BL = _mm_set1_epi32(border[-1-nT]);
+  const __m128i nTm1 = _mm_set1_epi32(nT-1);
+
+  for (int c=0;c<nVec;c++) {
+    __m128i x   = _mm_setr_epi32(4*c, 4*c+1, 4*c+2, 4*c+3);
+    __m128i top = load4_32(border+1+4*c);
+
+    base[c] = _mm_add_epi32(_mm_mullo_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), TR),
+                            _mm_mullo_epi32(nTm1, top));
+    base[c] = _mm_add_epi32(base[c], _mm_add_epi32(BL, _mm_set1_epi32(nT)));
+    step[c] = _mm_sub_epi32(BL, top);
+    wLeft[c] = _mm_sub_epi32(nTm1, x);
+  }
+
+  for (int y=0;y<nT;y++) {
+    const __m128i left = _mm_set1_epi32(border[-1-y]);
+    __m128i row[4];
+
+    for (int c=0;c<nVec;c++) {
+      __m128i v = _mm_add_epi32(base[c], _mm_mullo_epi32(wLeft[c], left));
+      v = _mm_srli_epi32(v, shift);
+
+      if (c&1) { row[c/2] = _mm_packus_epi32(row[c/2], v); }
+      else     { row[c/2] = v; }
+
+      base[c] = _mm_add_epi32(base[c], step[c]);
+    }
+
+    if (nT==4) {
+      row[0] = _mm_packus_epi32(row[0], row[0]);
+    }
+
+    store_row(dst+y*dststride, row, nT);
+  }
+}
+
+
+// --- DC prediction (8.4.4.2.5) ---
+
+template <class pixel_t>
+static void pred_dc(pixel_t* dst, ptrdiff_t dststride, const pixel_t* border, int nT, int cIdx)
+{
+  const int Log2_nT = Log2(nT);
+
+  int dcVal = 0;
+  for (int i=0;i<nT;i++) {
+    dcVal += border[ i+1];
+    dcVal += border[-i-1];
+  }
+
+  dcVal += nT;
+  dcVal >>= Log2_nT+1;
+
+  const __m128i dc = _mm_set1_epi16(dcVal);
+  __m128i row[4] = { dc,dc,dc,dc };
+
+  for (int y=0;y<nT;y++) {
+    store_row(dst+y*dststride, row, nT);
+  }
+
+  if (cIdx==0 && nT<32) {
+    dst[0] = (border[-1] + 2*dcVal + border[1] +2) >> 2;
+
+    for (int x=1;x<nT;x++) { dst[x]           = (border[ x+1] + 3*dcVal+2)>>2; }
+    for (int y=1;y<nT;y++) { dst[y*dststride] = (border[-y-1] + 3*dcVal+2)>>2; }
+  }
+}
+
+
+// --- angular prediction (8.4.4.2.6) ---
+
+static inline void transpose_8x8(const int16_t* src, int stride, __m128i out[8])
+{
+  __m128i r[8];
+  for (int i=0;i<8;i++) {
+    r[i] = _mm_loadu_si128((const __m128i*)(src+i*stride));
+  }
+
+  __m128i a0 = _mm_unpacklo_epi16(r[0],r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0],r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2],r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2],r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4],r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4],r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6],r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6],r[7]);
+
+  __m128i b0 = _mm_unpacklo_epi32(a0,a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0,a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1,a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1,a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4,a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4,a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5,a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5,a7);
+
+  out[0] = _mm_unpacklo_epi64(b0,b4);
+  out[1] = _mm_unpackhi_epi64(b0,b4);
+  out[2] = _mm_unpacklo_epi64(b1,b5);
+  out[3] = _mm_unpackhi_epi64(b1,b5);
+  out[4] = _mm_unpacklo_epi64(b2,b6);
+  out[5] = _mm_unpackhi_epi64(b2,b6);
+  out[6] = _mm_unpacklo_epi64(b3,b7);
+  out[7] = _mm_unpackhi_epi64(b3,b7);
+}
+
+
+static inline void transpose_4x4(const int16_t* src, int stride, __m128i out[4])
+{
+  __m128i r0 = _mm_loadl_epi64((const __m128i*)(src+0*stride));
+  __m128i r1 = _mm_loadl_epi64((const __m128i*)(src+1*stride));
+  __m128i r2 = _mm_loadl_epi64((const __m128i*)(src+2*stride));
+  __m128i r3 = _mm_loadl_epi64((const __m128i*)(src+3*stride));
+
+  __m128i a0 = _mm_unpacklo_epi16(r0,r1);
+  __m128i a1 = _mm_unpacklo_epi16(r2,r3);
+
+  __m128i b0 = _mm_unpacklo_epi32(a0,a1);
+  __m128i b1 = _mm_unpackhi_epi32(a0,a1);
+
+  out[0] = b0;
+  out[1] = _mm_srli_si128(b0,8);
+  out[2] = b1;
+  out[3] = _mm_srli_si128(b1,8);
+}
+
+
+template <class pixel_t>
+static void pred_angular(pixel_t* dst, ptrdiff_t dststride, const pixel_t* border, int nT, int cIdx,
+                         int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth)
+{
+  const bool vertical = (intraPredMode >= 18);
+
+  // pure horizontal prediction: each row is a copy of its left neighbor
+
+  if (intraPredMode==10) {
+    for (int y=0;y<nT;y++) {
+      __m128i v = _mm_set1_epi16(border[-1-y]);
+      __m128i row[4] = { v,v,v,v };
+      store_row(dst+y*dststride, row, nT);
+    }
+  }
+  else {
+    // Build the (projected) reference array in 16 bit. Vertical modes read the top
+    // border, horizontal modes the left border. Some slack is added at the end,
+    // because the rows are always processed in blocks of 8 samples.
+
+    int16_t  ref_mem[32 + 1 + 2*32 + 16];
+    int16_t* ref = &ref_mem[32];
+
+    const int sign = vertical ? 1 : -1;
+    const int intraPredAngle = intraPredAngle_table[intraPredMode];
+
+    for (int x=0;x<=nT;x++) {
+      ref[x] = border[sign*x];
+    }
+
+    if (intraPredAngle<0) {
+      int invAngle = invAngle_table[intraPredMode-11];
+
+      if ((nT*intraPredAngle)>>5 < -1) {
+        for (int x=(nT*intraPredAngle)>>5; x<=-1; x++) {
+          ref[x] = border[-sign*((x*invAngle+128)>>8)];
+        }
+      }
+    }
+    else {
+      for (int x=nT+1; x<=2*nT;x++) {
+        ref[x] = border[sign*x];
+      }
+    }
+
+    int refEnd = (intraPredAngle<0) ? nT : 2*nT;
+    memset(ref+refEnd+1, 0, 16*sizeof(int16_t));
+
+
+    /* Compute the prediction line by line along the prediction direction. For vertical
+       modes these are the output rows. For horizontal modes they are the output columns,
+       which are collected in a temporary block and transposed afterwards. */
+
+    int16_t tmp[32*32];
+    const int nVec = (nT+7)/8;
+
+    for (int y=0;y<nT;y++) {
+      const int iIdx = ((y+1)*intraPredAngle)>>5;
+      const int iFact= ((y+1)*intraPredAngle)&31;
+
+      const int16_t* r = ref+iIdx+1;
+      __m128i row[4];
+
+      if (iFact==0) {
+        for (int i=0;i<nVec;i++) {
+          row[i] = _mm_loadu_si128((const __m128i*)(r+8*i));
+        }
+      }
+      else if (sizeof(pixel_t)==1) {
+        // 8 bit: (32-f)*a + f*b fits into 16 bit lanes
+
+        const __m128i wA = _mm_set1_epi16(32-iFact);
+        const __m128i wB = _mm_set1_epi16(iFact);
+        const __m128i rnd = _mm_set1_epi16(16);
+
+        for (int i=0;i<nVec;i++) {
+          __m128i a = _mm_loadu_si128((const __m128i*)(r+8*i));
+          __m128i b = _mm_loadu_si128((const __m128i*)(r+8*i+1));
+
+          __m128i v = _mm_add_epi16(_mm_mullo_epi16(a,wA), _mm_mullo_epi16(b,wB));
+          row[i] = _mm_srli_epi16(_mm_add_epi16(v,rnd), 5);
+        }
+      }
+      else {
+        const __m128i w   = _mm_set1_epi32((iFact<<16) | (32-iFact));
+        const __m128i rnd = _mm_set1_epi32(16);
+
+        for (int i=0;i<nVec;i++) {
+          __m128i a = _mm_loadu_si128((const __m128i*)(r+8*i));
+          __m128i b = _mm_loadu_si128((const __m128i*)(r+8*i+1));
+
+          __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a,b), w);
+          __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a,b), w);
+
+          lo = _mm_srai_epi32(_mm_add_epi32(lo,rnd), 5);
+          hi = _mm_srai_epi32(_mm_add_epi32(hi,rnd), 5);
+
+          row[i] = _mm_packus_epi32(lo,hi);
+        }
+      }
+
+      if (vertical) {
+        store_row(dst+y*dststride, row, nT);
+      }
+      else {
+        for (int i=0;i<nVec;i++) {
+          if (nT==4) { _mm_storel_epi64((__m128i*)(tmp+y*32), row[i]); }
+          else       { _mm_storeu_si128((__m128i*)(tmp+y*32+8*i), row[i]); }
+        }
+      }
+    }
+
+    if (!vertical) {
+      if (nT==4) {
+        __m128i col[4];
+        transpose_4x4(tmp, 32, col);
+
+        for (int x=0;x<4;x++) {
+          store4(dst+x*dststride, col[x]);
+        }
+      }
+      else {
+        for (int by=0;by<nT;by+=8)
+          for (int bx=0;bx<nT;bx+=8) {
+            __m128i col[8];
+            transpose_8x8(tmp+by*32+bx, 32, col);
+
+            for (int x=0;x<8;x++) {
+              store8(dst+(bx+x)*dststride+by, col[x]);
+            }
+          }
+      }
+    }
+  }
+
+
+  // boundary smoothing of the pure vertical / horizontal modes
+
+  if (cIdx==0 && nT<32 && !disableIntraBoundaryFilter) {
+    if (intraPredMode==26) {
+      for (int y=0;y<nT;y++) {
+        dst[0+y*dststride] = Clip_BitDepth(border[1] + ((border[-1-y] - border[0])>>1), bit_depth);
+      }
+    }
+    else if (intraPredMode==10) {
+      for (int x=0;x<nT;x++) {
+        dst[x] = Clip_BitDepth(border[-1] + ((border[1+x] - border[0])>>1), bit_depth);
+      }
+    }
+  }
+}
+
+
+void intra_filter_border_8_sse4(uint8_t *border, int nT, bool strong)
+{
+  if (nT>32) { intra_filter_border_8_fallback(border,nT,strong); return; }
+
+  filter_border(border,nT,strong);
+}
+
+void intra_pred_planar_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT)
+{
+  if (nT>32) { intra_pred_planar_8_fallback(dst,dststride,border,nT); return; }
+
+  pred_planar(dst,dststride,border,nT);
+}
+
+void intra_pred_dc_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx)
+{
+  if (nT>32) { intra_pred_dc_8_fallback(dst,dststride,border,nT,cIdx); return; }
+
+  pred_dc(dst,dststride,border,nT,cIdx);
+}
+
+void intra_pred_angular_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx,
+                               int intraPredMode, bool disableIntraBoundaryFilter)
+{
+  if (nT>32) {
+    intra_pred_angular_8_fallback(dst,dststride,border,nT,cIdx,
+                                  intraPredMode,disableIntraBoundaryFilter);
+    return;
+  }
+
+  pred_angular(dst,dststride,border,nT,cIdx,intraPredMode,disableIntraBoundaryFilter,8);
+}
+
+
+void intra_filter_border_16_sse4(uint16_t *border, int nT, bool strong, int bit_depth)
+{
+  if (nT>32 || bit_depth>12) { intra_filter_border_16_fallback(border,nT,strong,bit_depth); return; }
+
+  filter_border(border,nT,strong);
+}
+
+void intra_pred_planar_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT,
+                               int bit_depth)
+{
+  if (nT>32 || bit_depth>12) { intra_pred_planar_16_fallback(dst,dststride,border,nT,bit_depth); return; }
+
+  pred_planar(dst,dststride,border,nT);
+}
+
+void intra_pred_dc_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                           int bit_depth)
+{
+  if (nT>32 || bit_depth>12) { intra_pred_dc_16_fallback(dst,dststride,border,nT,cIdx,bit_depth); return; }
+
+  pred_dc(dst,dststride,border,nT,cIdx);
+}
+
+void intra_pred_angular_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                                int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth)
+{
+  if (nT>32 || bit_depth>12) {
+    intra_pred_angular_16_fallback(dst,dststride,border,nT,cIdx,
+                                   intraPredMode,disableIntraBoundaryFilter,bit_depth);
+    return;
+  }
+
+  pred_angular(dst,dststride,border,nT,cIdx,intraPredMode,disableIntraBoundaryFilter,bit_depth);
+}
@@ -0,0 +1,41 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSE_INTRAPRED_H
+#define SSE_INTRAPRED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void intra_filter_border_8_sse4(uint8_t *border, int nT, bool strong);
+void intra_pred_planar_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT);
+void intra_pred_dc_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx);
+void intra_pred_angular_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx,
+                               int intraPredMode, bool disableIntraBoundaryFilter);
+
+void intra_filter_border_16_sse4(uint16_t *border, int nT, bool strong, int bit_depth);
+void intra_pred_planar_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT,
+                               int bit_depth);
+void intra_pred_dc_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                           int bit_depth);
+void intra_pred_angular_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx,
+                                int intraPredMode, bool disableIntraBoundaryFilter, int bit_depth);
+
+#endif
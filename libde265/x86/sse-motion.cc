@@ -24,6 +24,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <emmintrin.h>
 #include <tmmintrin.h> // SSSE3
 #if HAVE_SSE4_1
@@ -32,6 +33,7 @@
 
 #include "sse-motion.h"
 #include "libde265/util.h"
+#include "libde265/fallback-motion.h"
 
 
 ALIGNED_16(const int8_t) epel_filters[7][16] = {
@@ -4969,3 +4971,486 @@ void ff_hevc_put_hevc_qpel_h_3_v_3_sse(int16_t *dst, ptrdiff_t dststride,
         dst += dststride;
     }
 }
+
+
+// --- explicit weighted prediction ---
+
+/* The products and sums need 32 bit. The two inputs (or the input and a constant one,
+   which picks up the rounding term) are interleaved and multiplied with the weight pair
+   using PMADDWD. Eight output samples are computed per step; for narrow blocks, the
+   input rows are read beyond 'width', but only 'width' samples are written. */
+
+template <bool bipred>
+static inline __m128i weighted_pred_8_samples(const int16_t* in1, const int16_t* in2,
+                                              __m128i weights, __m128i offset, __m128i shift)
+{
+  __m128i a = _mm_loadu_si128((const __m128i*)in1);
+  __m128i b = (bipred ? _mm_loadu_si128((const __m128i*)in2) : _mm_set1_epi16(1));
+
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a,b), weights);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a,b), weights);
+
+  if (bipred) {
+    lo = _mm_sra_epi32(_mm_add_epi32(lo,offset), shift);
+    hi = _mm_sra_epi32(_mm_add_epi32(hi,offset), shift);
+  }
+  else {
+    lo = _mm_add_epi32(_mm_sra_epi32(lo,shift), offset);
+    hi = _mm_add_epi32(_mm_sra_epi32(hi,shift), offset);
+  }
+
+  return _mm_packs_epi32(lo,hi);
+}
+
+
+// store the first n (<=8) samples of r
+static inline void store_samples(uint8_t* dst, __m128i r, int n)
+{
+  r = _mm_packus_epi16(r,r);
+
+  if (n==8) {
+    _mm_storel_epi64((__m128i*)dst, r);
+    return;
+  }
+
+  if (n>=4) {
+    int32_t v = _mm_cvtsi128_si32(r);
+    memcpy(dst, &v, 4);
+    r = _mm_srli_si128(r,4);
+    dst+=4; n-=4;
+  }
+
+  if (n>=2) {
+    uint16_t v = (uint16_t)_mm_cvtsi128_si32(r);
+    memcpy(dst, &v, 2);
+    r = _mm_srli_si128(r,2);
+    dst+=2; n-=2;
+  }
+
+  if (n) {
+    *dst = (uint8_t)_mm_cvtsi128_si32(r);
+  }
+}
+
+static inline void store_samples(uint16_t* dst, __m128i r, int n)
+{
+  if (n==8) {
+    _mm_storeu_si128((__m128i*)dst, r);
+    return;
+  }
+
+  if (n>=4) {
+    _mm_storel_epi64((__m128i*)dst, r);
+    r = _mm_srli_si128(r,8);
+    dst+=4; n-=4;
+  }
+
+  if (n>=2) {
+    int32_t v = _mm_cvtsi128_si32(r);
+    memcpy(dst, &v, 4);
+    r = _mm_srli_si128(r,4);
+    dst+=2; n-=2;
+  }
+
+  if (n) {
+    *dst = (uint16_t)_mm_cvtsi128_si32(r);
+  }
+}
+
+
+template <bool bipred, class pixel_t>
+static void weighted_pred_block(pixel_t* dst, ptrdiff_t dststride,
+                                const int16_t* src1, const int16_t* src2, ptrdiff_t srcstride,
+                                int width, int height,
+                                __m128i weights, __m128i offset, __m128i shift, int bit_depth)
+{
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x+=8) {
+      __m128i r = weighted_pred_8_samples<bipred>(src1+x, src2+x, weights, offset, shift);
+
+      // 8 bit output is clipped by the final unsigned pack
+      if (sizeof(pixel_t)==2) {
+        r = _mm_min_epi16(_mm_max_epi16(r, zero), maxval);
+      }
+
+      store_samples(dst+x, r, libde265_min(8, width-x));
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+// uni-prediction: ((in*w + rnd) >> log2WD) + o
+
+template <class pixel_t>
+static void weighted_pred(pixel_t *dst, ptrdiff_t dststride,
+                          const int16_t *src, ptrdiff_t srcstride,
+                          int width, int height,
+                          int w,int o,int log2WD, int bit_depth)
+{
+  __m128i weights = _mm_set1_epi32((int32_t)((uint16_t)w | ((uint32_t)(1<<(log2WD-1)) << 16)));
+
+  weighted_pred_block<false>(dst,dststride, src,src,srcstride, width,height,
+                             weights, _mm_set1_epi32(o), _mm_cvtsi32_si128(log2WD), bit_depth);
+}
+
+
+// bi-prediction: (in1*w1 + in2*w2 + ((o1+o2+1) << log2WD)) >> (log2WD+1)
+
+template <class pixel_t>
+static void weighted_bipred(pixel_t *dst, ptrdiff_t dststride,
+                            const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                            int width, int height,
+                            int w1,int o1, int w2,int o2, int log2WD, int bit_depth)
+{
+  __m128i weights = _mm_set1_epi32((int32_t)((uint16_t)w1 | ((uint32_t)(uint16_t)w2 << 16)));
+
+  weighted_pred_block<true>(dst,dststride, src1,src2,srcstride, width,height,
+                            weights, _mm_set1_epi32((o1+o2+1) << log2WD),
+                            _mm_cvtsi32_si128(log2WD+1), bit_depth);
+}
+
+
+void put_weighted_pred_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                              const int16_t *src, ptrdiff_t srcstride,
+                              int width, int height,
+                              int w,int o,int log2WD)
+{
+  weighted_pred(dst,dststride, src,srcstride, width,height, w,o,log2WD, 8);
+}
+
+void put_weighted_bipred_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                                const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                int width, int height,
+                                int w1,int o1, int w2,int o2, int log2WD)
+{
+  weighted_bipred(dst,dststride, src1,src2,srcstride, width,height, w1,o1,w2,o2,log2WD, 8);
+}
+
+void put_weighted_pred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                               const int16_t *src, ptrdiff_t srcstride,
+                               int width, int height,
+                               int w,int o,int log2WD, int bit_depth)
+{
+  weighted_pred(dst,dststride, src,srcstride, width,height, w,o,log2WD, bit_depth);
+}
+
+void put_weighted_bipred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                 int width, int height,
+                                 int w1,int o1, int w2,int o2, int log2WD, int bit_depth)
+{
+  weighted_bipred(dst,dststride, src1,src2,srcstride, width,height, w1,o1,w2,o2,log2WD, bit_depth);
+}
+
+
+// --- high bit depth prediction output ---
+
+/* Like weighted_pred_block(), the input rows are read in steps of eight samples. The 16-bit
+   saturating adds are exact, because the saturated values clip to the same result. */
+
+void put_unweighted_pred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src, ptrdiff_t srcstride,
+                                 int width, int height, int bit_depth)
+{
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+  const __m128i offset = _mm_set1_epi16((1<<(14-bit_depth))>>1);
+  const __m128i shift  = _mm_cvtsi32_si128(14-bit_depth);
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x+=8) {
+      __m128i r = _mm_loadu_si128((const __m128i*)(src+x));
+      r = _mm_sra_epi16(_mm_adds_epi16(r, offset), shift);
+      r = _mm_min_epi16(_mm_max_epi16(r, zero), maxval);
+
+      store_samples(dst+x, r, libde265_min(8, width-x));
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+void put_weighted_pred_avg_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                   const int16_t *src1, const int16_t *src2,
+                                   ptrdiff_t srcstride, int width, int height, int bit_depth)
+{
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+  const __m128i offset = _mm_set1_epi16(1<<(14-bit_depth));
+  const __m128i shift  = _mm_cvtsi32_si128(15-bit_depth);
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x+=8) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(src1+x));
+      __m128i b = _mm_loadu_si128((const __m128i*)(src2+x));
+      __m128i r = _mm_sra_epi16(_mm_adds_epi16(_mm_adds_epi16(a,b), offset), shift);
+      r = _mm_min_epi16(_mm_max_epi16(r, zero), maxval);
+
+      store_samples(dst+x, r, libde265_min(8, width-x));
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+// --- high bit depth motion compensation ---
+
+/* SSE4 versions of the high bit depth filters in avx2-motion.cc, computing eight output
+   samples per step. Like there, the filters may read a few input samples to the right of
+   the block, and more than 12 bits are passed to the fallback, because the intermediate
+   values do not fit into 16 bit anymore. */
+
+static const int8_t qpel_filters[4][8] = {
+  {  0, 0,  0, 64,  0,  0,  0,  0 }, // unused
+  { -1, 4,-10, 58, 17, -5,  1,  0 },
+  { -1, 4,-11, 40, 40,-11,  4, -1 },
+  {  1,-5, 17, 58,-10,  4, -1,  0 }
+};
+
+#define QPEL_TAPS(frac) ((frac)==2 ? 8 : 7)
+
+static inline __m128i filter_coeff_pair(int c0, int c1)
+{
+  return _mm_set1_epi32((int32_t)((uint16_t)c0 | ((uint32_t)(uint16_t)c1 << 16)));
+}
+
+namespace {
+
+template <class Filter>
+inline void filter_block_16(int16_t* dst, ptrdiff_t dststride,
+                            int width, int height, const Filter& filter)
+{
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x+=8) {
+      store_samples((uint16_t*)dst+x, filter.filter8(y,x), libde265_min(8, width-x));
+    }
+
+    dst += dststride;
+  }
+}
+
+
+// full-sample position: scale to 14 bit
+
+struct pixels_filter_16
+{
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+
+  pixels_filter_16(const uint16_t* s, ptrdiff_t st, int bit_depth)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(14-bit_depth)) { }
+
+  __m128i filter8(int y,int x) const {
+    return _mm_sll_epi16(_mm_loadu_si128((const __m128i*)&src[y*stride+x]), shift);
+  }
+};
+
+
+// horizontal filter with 2*nPairs taps, inputs shifted by one sample are interleaved
+
+template <int nPairs>
+struct hfilter_16bit
+{
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m128i coeff[nPairs];
+
+  hfilter_16bit(const uint16_t* s, ptrdiff_t st, const int8_t* filter, int shft)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shft)) {
+    for (int k=0;k<nPairs;k++) {
+      coeff[k] = filter_coeff_pair(filter[2*k], filter[2*k+1]);
+    }
+  }
+
+  __m128i filter8(int y,int x) const {
+    const uint16_t* p = &src[y*stride+x];
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    for (int k=0;k<nPairs;k++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p+2*k));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p+2*k+1));
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), coeff[k]));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), coeff[k]));
+    }
+
+    return _mm_packs_epi32(_mm_sra_epi32(lo,shift), _mm_sra_epi32(hi,shift));
+  }
+};
+
+
+/* Vertical filter on 16-bit input (high bit depth samples or the output of the horizontal
+   pass), rows are interleaved in pairs. Like the fallback, the result is truncated to 16 bit. */
+
+template <int nTaps>
+struct vfilter_16bit
+{
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m128i coeff[(nTaps+1)/2];
+
+  vfilter_16bit(const int16_t* s, ptrdiff_t st, const int8_t* filter, int shft)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shft)) {
+    for (int k=0;k<nTaps;k+=2) {
+      coeff[k/2] = filter_coeff_pair(filter[k], k+1<nTaps ? filter[k+1] : 0);
+    }
+  }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = &src[y*stride+x];
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+
+    for (int k=0;k<nTaps;k+=2) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + k*stride));
+      __m128i b = (k+1<nTaps ?
+                   _mm_loadu_si128((const __m128i*)(p + (k+1)*stride)) :
+                   _mm_setzero_si128());
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), coeff[k/2]));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), coeff[k/2]));
+    }
+
+    const __m128i mask = _mm_set1_epi32(0xFFFF);
+    return _mm_packus_epi32(_mm_and_si128(_mm_sra_epi32(lo,shift), mask),
+                            _mm_and_si128(_mm_sra_epi32(hi,shift), mask));
+  }
+};
+
+}
+
+
+template <int xFrac, int yFrac>
+static inline void put_qpel_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height, int16_t* mcbuffer, int bit_depth)
+{
+  const int shift1 = bit_depth-8;
+
+  if (xFrac==0 && yFrac==0) {
+    filter_block_16(dst,dststride, width,height, pixels_filter_16(src,srcstride,bit_depth));
+  }
+  else if (yFrac==0) {
+    filter_block_16(dst,dststride, width,height,
+                    hfilter_16bit<4>(src - qpel_extra_before[xFrac], srcstride,
+                                     qpel_filters[xFrac], shift1));
+  }
+  else if (xFrac==0) {
+    filter_block_16(dst,dststride, width,height,
+                    vfilter_16bit<QPEL_TAPS(yFrac)>((const int16_t*)(src - qpel_extra_before[yFrac]*srcstride),
+                                                    srcstride, qpel_filters[yFrac], shift1));
+  }
+  else {
+    int nRows = qpel_extra_before[yFrac] + height + qpel_extra_after[yFrac];
+
+    filter_block_16(mcbuffer,MAX_PB_SIZE, width,nRows,
+                    hfilter_16bit<4>(src - qpel_extra_before[yFrac]*srcstride - qpel_extra_before[xFrac],
+                                     srcstride, qpel_filters[xFrac], shift1));
+
+    filter_block_16(dst,dststride, width,height,
+                    vfilter_16bit<QPEL_TAPS(yFrac)>(mcbuffer, MAX_PB_SIZE, qpel_filters[yFrac], 6));
+  }
+}
+
+
+#define QPEL16_SSE4(x,y)                                                        \
+  void put_qpel_ ## x ## _ ## y ## _16_sse4(int16_t *dst, ptrdiff_t dststride, \
+                                            const uint16_t *src, ptrdiff_t srcstride, \
+                                            int width, int height, int16_t* mcbuffer, \
+                                            int bit_depth)                      \
+  {                                                                             \
+    if (bit_depth > 12) {                                                       \
+      put_qpel_ ## x ## _ ## y ## _fallback_16(dst,dststride, src,srcstride,    \
+                                               width,height, mcbuffer, bit_depth); \
+    }                                                                           \
+    else {                                                                      \
+      put_qpel_16_sse4<x,y>(dst,dststride, src,srcstride, width,height,         \
+                            mcbuffer, bit_depth);                               \
+    }                                                                           \
+  }
+
+QPEL16_SSE4(0,0) QPEL16_SSE4(0,1) QPEL16_SSE4(0,2) QPEL16_SSE4(0,3)
+QPEL16_SSE4(1,0) QPEL16_SSE4(1,1) QPEL16_SSE4(1,2) QPEL16_SSE4(1,3)
+QPEL16_SSE4(2,0) QPEL16_SSE4(2,1) QPEL16_SSE4(2,2) QPEL16_SSE4(2,3)
+QPEL16_SSE4(3,0) QPEL16_SSE4(3,1) QPEL16_SSE4(3,2) QPEL16_SSE4(3,3)
+
+
+// chroma, epel_filters[] starts with the four filter taps
+
+void put_epel_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                      const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height,
+                      int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block_16(dst,dststride, width,height, pixels_filter_16(src,srcstride,bit_depth));
+}
+
+void put_epel_h_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block_16(dst,dststride, width,height,
+                  hfilter_16bit<2>(src - epel_extra_before, srcstride, epel_filters[mx-1],
+                                   bit_depth-8));
+}
+
+void put_epel_v_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block_16(dst,dststride, width,height,
+                  vfilter_16bit<4>((const int16_t*)(src - epel_extra_before*srcstride), srcstride,
+                                   epel_filters[my-1], bit_depth-8));
+}
+
+void put_epel_hv_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                         const uint16_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > 12) {
+    put_epel_hv_fallback<uint16_t>(dst,dststride, src,srcstride, width,height,
+                                   mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  int nRows = epel_extra_before + height + epel_extra_after;
+
+  filter_block_16(mcbuffer,MAX_PB_SIZE, width,nRows,
+                  hfilter_16bit<2>(src - epel_extra_before*srcstride - epel_extra_before, srcstride,
+                                   epel_filters[mx-1], bit_depth-8));
+
+  filter_block_16(dst,dststride, width,height,
+                  vfilter_16bit<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
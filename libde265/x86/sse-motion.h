@@ -35,6 +35,24 @@ void ff_hevc_put_weighted_pred_avg_8_sse(uint8_t *_dst, ptrdiff_t dststride,
                                          ptrdiff_t srcstride, int width,
                                          int height);
 
+void put_weighted_pred_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                              const int16_t *src, ptrdiff_t srcstride,
+                              int width, int height,
+                              int w,int o,int log2WD);
+void put_weighted_bipred_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                                const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                int width, int height,
+                                int w1,int o1, int w2,int o2, int log2WD);
+
+void put_weighted_pred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                               const int16_t *src, ptrdiff_t srcstride,
+                               int width, int height,
+                               int w,int o,int log2WD, int bit_depth);
+void put_weighted_bipred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                                 int width, int height,
+                                 int w1,int o1, int w2,int o2, int log2WD, int bit_depth);
+
 void ff_hevc_put_hevc_epel_pixels_8_sse(int16_t *dst, ptrdiff_t dststride,
                                         const uint8_t *_src, ptrdiff_t srcstride,
                                         int width, int height,
@@ -101,4 +119,42 @@ void ff_hevc_put_hevc_qpel_h_3_v_3_sse(int16_t *dst, ptrdiff_t dststride,
                                        const uint8_t *src, ptrdiff_t srcstride,
                                        int width, int height, int16_t* mcbuffer);
 
+
+void put_unweighted_pred_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                 const int16_t *src, ptrdiff_t srcstride,
+                                 int width, int height, int bit_depth);
+void put_weighted_pred_avg_16_sse4(uint16_t *dst, ptrdiff_t dststride,
+                                   const int16_t *src1, const int16_t *src2,
+                                   ptrdiff_t srcstride, int width, int height, int bit_depth);
+
+void put_epel_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                      const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height,
+                      int mx, int my, int16_t* mcbuffer, int bit_depth);
+void put_epel_h_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth);
+void put_epel_v_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                        const uint16_t *src, ptrdiff_t srcstride,
+                        int width, int height,
+                        int mx, int my, int16_t* mcbuffer, int bit_depth);
+void put_epel_hv_16_sse4(int16_t *dst, ptrdiff_t dststride,
+                         const uint16_t *src, ptrdiff_t srcstride,
+                         int width, int height,
+                         int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+#define DECLARE_QPEL16_SSE4(x,y)                                                   \
+  void put_qpel_ ## x ## _ ## y ## _16_sse4(int16_t *dst, ptrdiff_t dststride, \
+                                            const uint16_t *src, ptrdiff_t srcstride, \
+                                            int width, int height, int16_t* mcbuffer, \
+                                            int bit_depth);
+
+DECLARE_QPEL16_SSE4(0,0) DECLARE_QPEL16_SSE4(0,1) DECLARE_QPEL16_SSE4(0,2) DECLARE_QPEL16_SSE4(0,3)
+DECLARE_QPEL16_SSE4(1,0) DECLARE_QPEL16_SSE4(1,1) DECLARE_QPEL16_SSE4(1,2) DECLARE_QPEL16_SSE4(1,3)
+DECLARE_QPEL16_SSE4(2,0) DECLARE_QPEL16_SSE4(2,1) DECLARE_QPEL16_SSE4(2,2) DECLARE_QPEL16_SSE4(2,3)
+DECLARE_QPEL16_SSE4(3,0) DECLARE_QPEL16_SSE4(3,1) DECLARE_QPEL16_SSE4(3,2) DECLARE_QPEL16_SSE4(3,3)
+
+#undef DECLARE_QPEL16_SSE4
+
 #endif
@@ -0,0 +1,64 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "sse-nal.h"
+#include "libde265/fallback-nal.h"
+
+
+static inline int lowest_bit(uint32_t v)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward(&idx, v);
+  return idx;
+#else
+  return __builtin_ctz(v);
+#endif
+}
+
+/* Compare 16 positions at a time: a pair starts at p when (data[p] | data[p+1]) is zero.
+   Both loads stay within data[0..len-1], the remaining positions are scanned scalar. */
+
+int find_zero_byte_pair_sse2(const uint8_t* data, int len)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  int p=0;
+  for (;p+16<len;p+=16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(data+p));
+    __m128i b = _mm_loadu_si128((const __m128i*)(data+p+1));
+
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(a,b), zero));
+    if (mask) {
+      return p + lowest_bit(mask);
+    }
+  }
+
+  return p + find_zero_byte_pair_fallback(data+p, len-p);
+}
@@ -0,0 +1,205 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "x86/sse-residual.h"
+#include "libde265/util.h"
+#include "libde265/fallback-dct.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <emmintrin.h> // SSE2
+#include <smmintrin.h> // SSE4.1
+
+
+/* Residual generation for the range extension tools. The residuals are 32 bit
+   values, independent of the bit depth of the image, hence there are no separate
+   8 and 16 bit versions. All block sizes are multiples of 4, so each group of four
+   residuals is handled in one register. */
+
+static inline __m128i load_coeffs4(const int16_t* p)
+{
+  return _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)p));
+}
+
+
+namespace {
+
+// transform skip scaling: (c << tsShift + rnd) >> bdShift
+
+struct ts_scale
+{
+  __m128i rnd;
+  __m128i tsShift, bdShift;
+
+  ts_scale(int ts, int bd)
+    : rnd(_mm_set1_epi32(1<<(bd-1))), tsShift(_mm_cvtsi32_si128(ts)), bdShift(_mm_cvtsi32_si128(bd)) { }
+
+  __m128i operator()(__m128i c) const {
+    return _mm_sra_epi32(_mm_add_epi32(_mm_sll_epi32(c, tsShift), rnd), bdShift);
+  }
+};
+
+// transquant bypass: coefficients are used unchanged
+
+struct no_scale
+{
+  __m128i operator()(__m128i c) const { return c; }
+};
+
+} // namespace
+
+
+template <class Scale>
+static inline void residual_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  for (int i=0;i<nT*nT;i+=4) {
+    _mm_storeu_si128((__m128i*)(residual+i), scale(load_coeffs4(coeffs+i)));
+  }
+}
+
+
+// vertical RDPCM: running sum down each column, four columns at a time
+
+template <class Scale>
+static inline void rdpcm_v_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  for (int x=0;x<nT;x+=4) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm_add_epi32(sum, scale(load_coeffs4(coeffs+y*nT+x)));
+      _mm_storeu_si128((__m128i*)(residual+y*nT+x), sum);
+    }
+  }
+}
+
+
+/* horizontal RDPCM: prefix sum along each row. Within a register, the prefix sum is
+   computed with two shifted additions, the last element is carried to the next group. */
+
+template <class Scale>
+static inline void rdpcm_h_block(int32_t *residual, const int16_t *coeffs, int nT, const Scale& scale)
+{
+  for (int y=0;y<nT;y++) {
+    __m128i carry = _mm_setzero_si128();
+
+    for (int x=0;x<nT;x+=4) {
+      __m128i v = scale(load_coeffs4(coeffs+y*nT+x));
+      v = _mm_add_epi32(v, _mm_slli_si128(v,4));
+      v = _mm_add_epi32(v, _mm_slli_si128(v,8));
+      v = _mm_add_epi32(v, carry);
+
+      _mm_storeu_si128((__m128i*)(residual+y*nT+x), v);
+
+      carry = _mm_shuffle_epi32(v, 0xFF);
+    }
+  }
+}
+
+
+void transform_skip_residual_sse4(int32_t *residual, const int16_t *coeffs, int nT,
+                                  int tsShift, int bdShift)
+{
+  residual_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void transform_bypass_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  residual_block(residual, coeffs, nT, no_scale());
+}
+
+void rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift)
+{
+  rdpcm_v_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift)
+{
+  rdpcm_h_block(residual, coeffs, nT, ts_scale(tsShift,bdShift));
+}
+
+void transform_bypass_rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  rdpcm_v_block(residual, coeffs, nT, no_scale());
+}
+
+void transform_bypass_rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  rdpcm_h_block(residual, coeffs, nT, no_scale());
+}
+
+
+void cross_comp_pred_sse4(int32_t *residual, const int32_t *residual_luma, int nT,
+                          int ResScaleVal, int BitDepthY, int BitDepthC)
+{
+  const __m128i scale  = _mm_set1_epi32(ResScaleVal);
+  const __m128i shiftC = _mm_cvtsi32_si128(BitDepthC);
+  const __m128i shiftY = _mm_cvtsi32_si128(BitDepthY);
+
+  for (int i=0;i<nT*nT;i+=4) {
+    __m128i l = _mm_loadu_si128((const __m128i*)(residual_luma+i));
+    l = _mm_sra_epi32(_mm_sll_epi32(l, shiftC), shiftY);
+    l = _mm_srai_epi32(_mm_mullo_epi32(l, scale), 3);
+
+    __m128i r = _mm_loadu_si128((const __m128i*)(residual+i));
+    _mm_storeu_si128((__m128i*)(residual+i), _mm_add_epi32(r, l));
+  }
+}
+
+
+/* Adds the residual to high bit depth samples. The saturating pack and add are exact,
+   because the saturated values clip to the same result. */
+
+void add_residual_16_sse4(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (bit_depth > 12) {
+    add_residual_fallback<uint16_t>(dst, stride, r, nT, bit_depth);
+    return;
+  }
+
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+  if (nT==4) {
+    for (int y=0;y<4;y+=2) {
+      __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+ y   *4)),
+                                  _mm_loadu_si128((const __m128i*)(r+(y+1)*4)));
+      __m128i d = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(dst+ y   *stride)),
+                                     _mm_loadl_epi64((const __m128i*)(dst+(y+1)*stride)));
+      d = _mm_min_epi16(_mm_max_epi16(_mm_adds_epi16(d,s), zero), maxval);
+      _mm_storel_epi64((__m128i*)(dst+ y   *stride), d);
+      _mm_storel_epi64((__m128i*)(dst+(y+1)*stride), _mm_srli_si128(d,8));
+    }
+  }
+  else {
+    for (int y=0;y<nT;y++) {
+      for (int x=0;x<nT;x+=8) {
+        __m128i s = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+y*nT+x  )),
+                                    _mm_loadu_si128((const __m128i*)(r+y*nT+x+4)));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst+y*stride+x));
+        d = _mm_min_epi16(_mm_max_epi16(_mm_adds_epi16(d,s), zero), maxval);
+        _mm_storeu_si128((__m128i*)(dst+y*stride+x), d);
+      }
+    }
+  }
+}
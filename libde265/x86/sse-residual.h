@@ -0,0 +1,42 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SSE_RESIDUAL_H
+#define SSE_RESIDUAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void transform_skip_residual_sse4(int32_t *residual, const int16_t *coeffs, int nT,
+                                  int tsShift, int bdShift);
+void transform_bypass_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+
+void rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift);
+void rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift);
+void transform_bypass_rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+void transform_bypass_rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+
+void cross_comp_pred_sse4(int32_t *residual, const int32_t *residual_luma, int nT,
+                          int ResScaleVal, int BitDepthY, int BitDepthC);
+
+void add_residual_16_sse4(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
+
+#endif
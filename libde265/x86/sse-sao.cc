@@ -0,0 +1,234 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+#include <smmintrin.h> // SSE4.1
+
+#include "sse-sao.h"
+#include "libde265/util.h"
+#include "libde265/fallback-sao.h"
+
+
+/* SSE4 versions of the kernels in avx2-sao.cc, processing 16 (8 bit) or 8 (16 bit) samples
+   per iteration. Columns that do not fill a complete register are passed to the scalar code. */
+
+
+// Add signed offsets with clipping to [0;255], split into a saturating add and subtract.
+
+static inline __m128i add_offset_8(__m128i v, __m128i off)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i pos = _mm_max_epi8(off, zero);
+  __m128i neg = _mm_max_epi8(_mm_sub_epi8(zero,off), zero);
+  return _mm_subs_epu8(_mm_adds_epu8(v,pos),neg);
+}
+
+static inline __m128i add_offset_16(__m128i v, __m128i off, __m128i maxval)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i pos = _mm_max_epi16(off, zero);
+  __m128i neg = _mm_max_epi16(_mm_sub_epi16(zero,off), zero);
+  return _mm_min_epu16(_mm_subs_epu16(_mm_adds_epu16(v,pos),neg), maxval);
+}
+
+
+// -1/0/1 for a<b, a==b, a>b
+
+static inline __m128i sign_8(__m128i a, __m128i b)
+{
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_sub_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(a,b), zero),
+                      _mm_cmpeq_epi8(_mm_subs_epu8(b,a), zero));
+}
+
+static inline __m128i sign_16(__m128i a, __m128i b)
+{
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_sub_epi16(_mm_cmpeq_epi16(_mm_subs_epu16(a,b), zero),
+                       _mm_cmpeq_epi16(_mm_subs_epu16(b,a), zero));
+}
+
+
+// Convert 16 bit table indices into byte indices for _mm_shuffle_epi8().
+
+static inline __m128i word_index(__m128i idx)
+{
+  return _mm_add_epi16(_mm_mullo_epi16(idx, _mm_set1_epi16(0x0202)),
+                       _mm_set1_epi16(0x0100));
+}
+
+
+static inline void edge_neighbors(int eoClass, ptrdiff_t stride, ptrdiff_t& pos0, ptrdiff_t& pos1)
+{
+  switch (eoClass) {
+  default:
+  case 0: pos0 = -1;        pos1 =  1;        break;
+  case 1: pos0 = -stride;   pos1 =  stride;   break;
+  case 2: pos0 = -stride-1; pos1 =  stride+1; break;
+  case 3: pos0 = -stride+1; pos1 =  stride-1; break;
+  }
+}
+
+
+void sao_band_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int bandPosition, const int8_t offsets[4])
+{
+  const int w16 = width & ~15;
+
+  if (w16) {
+    const __m128i table = _mm_setr_epi8(offsets[0],offsets[1],offsets[2],offsets[3],
+                                        0,0,0,0, 0,0,0,0, 0,0,0,0);
+    const __m128i pos   = _mm_set1_epi8(bandPosition);
+    const __m128i mask  = _mm_set1_epi8(31);
+    const __m128i four  = _mm_set1_epi8(4);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<w16;x+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + y*srcstride + x));
+
+        // band index relative to the first band, offsets only for k<4
+
+        __m128i band = _mm_and_si128(_mm_srli_epi16(v,3), mask);
+        __m128i k    = _mm_and_si128(_mm_sub_epi8(band,pos), mask);
+        __m128i off  = _mm_and_si128(_mm_shuffle_epi8(table,k), _mm_cmpgt_epi8(four,k));
+
+        _mm_storeu_si128((__m128i*)(dst + y*dststride + x), add_offset_8(v,off));
+      }
+    }
+  }
+
+  if (w16 < width) {
+    sao_band_8_fallback(dst+w16,dststride, src+w16,srcstride, width-w16,height, bandPosition,offsets);
+  }
+}
+
+
+void sao_edge_8_sse4(uint8_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride,
+                     int width, int height, int eoClass, const int8_t offsets[5])
+{
+  const int w16 = width & ~15;
+
+  if (w16) {
+    ptrdiff_t pos0,pos1;
+    edge_neighbors(eoClass, srcstride, pos0,pos1);
+
+    const __m128i table = _mm_setr_epi8(offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],
+                                        0,0,0, 0,0,0,0, 0,0,0,0);
+    const __m128i two = _mm_set1_epi8(2);
+
+    for (int y=0;y<height;y++) {
+      const uint8_t* in = src + y*srcstride;
+
+      for (int x=0;x<w16;x+=16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + x));
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + x + pos0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + x + pos1));
+
+        __m128i edgeIdx = _mm_add_epi8(_mm_add_epi8(sign_8(c,a), sign_8(c,b)), two);
+        __m128i off = _mm_shuffle_epi8(table, edgeIdx);
+
+        _mm_storeu_si128((__m128i*)(dst + y*dststride + x), add_offset_8(c,off));
+      }
+    }
+  }
+
+  if (w16 < width) {
+    sao_edge_8_fallback(dst+w16,dststride, src+w16,srcstride, width-w16,height, eoClass,offsets);
+  }
+}
+
+
+void sao_band_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int bandPosition, const int8_t offsets[4], int bit_depth)
+{
+  const int w8 = width & ~7;
+
+  if (w8) {
+    const __m128i table  = _mm_setr_epi16(offsets[0],offsets[1],offsets[2],offsets[3], 0,0,0,0);
+    const __m128i pos    = _mm_set1_epi16(bandPosition);
+    const __m128i mask   = _mm_set1_epi16(31);
+    const __m128i four   = _mm_set1_epi16(4);
+    const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+    const __m128i shift  = _mm_cvtsi32_si128(bit_depth-5);
+
+    for (int y=0;y<height;y++) {
+      for (int x=0;x<w8;x+=8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + y*srcstride + x));
+
+        // the input may exceed the valid range after decoding errors, limit it for the band index
+
+        __m128i band   = _mm_srl_epi16(_mm_min_epu16(v,maxval), shift);
+        __m128i k      = _mm_and_si128(_mm_sub_epi16(band,pos), mask);
+        __m128i inBand = _mm_cmpgt_epi16(four,k);
+        __m128i off    = _mm_shuffle_epi8(table, word_index(k));
+
+        __m128i r = _mm_blendv_epi8(v, add_offset_16(v,off,maxval), inBand);
+        _mm_storeu_si128((__m128i*)(dst + y*dststride + x), r);
+      }
+    }
+  }
+
+  if (w8 < width) {
+    sao_band_16_fallback(dst+w8,dststride, src+w8,srcstride, width-w8,height, bandPosition,offsets,
+                         bit_depth);
+  }
+}
+
+
+void sao_edge_16_sse4(uint16_t *dst, ptrdiff_t dststride, const uint16_t *src, ptrdiff_t srcstride,
+                      int width, int height, int eoClass, const int8_t offsets[5], int bit_depth)
+{
+  const int w8 = width & ~7;
+
+  if (w8) {
+    ptrdiff_t pos0,pos1;
+    edge_neighbors(eoClass, srcstride, pos0,pos1);
+
+    const __m128i table  = _mm_setr_epi16(offsets[0],offsets[1],offsets[2],offsets[3],offsets[4],0,0,0);
+    const __m128i two    = _mm_set1_epi16(2);
+    const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+    for (int y=0;y<height;y++) {
+      const uint16_t* in = src + y*srcstride;
+
+      for (int x=0;x<w8;x+=8) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + x));
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + x + pos0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + x + pos1));
+
+        __m128i edgeIdx = _mm_add_epi16(_mm_add_epi16(sign_16(c,a), sign_16(c,b)), two);
+        __m128i off = _mm_shuffle_epi8(table, word_index(edgeIdx));
+
+        _mm_storeu_si128((__m128i*)(dst + y*dststride + x), add_offset_16(c,off,maxval));
+      }
+    }
+  }
+
+  if (w8 < width) {
+    sao_edge_16_fallback(dst+w8,dststride, src+w8,srcstride, width-w8,height, eoClass,offsets,
+                         bit_depth);
+  }
+}
@@ -18,6 +18,10 @@
  * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
@@ -25,11 +29,24 @@
 #include "x86/sse.h"
 #include "x86/sse-motion.h"
 #include "x86/sse-dct.h"
-
-#ifdef HAVE_CONFIG_H
-#include "config.h"
+#include "x86/sse-deblock.h"
+#include "x86/sse-intrapred.h"
+#include "x86/sse-residual.h"
+#include "x86/sse-sao.h"
+#include "x86/sse-nal.h"
+#if HAVE_AVX2
+#include "x86/avx2-motion.h"
+#include "x86/avx2-dct.h"
+#include "x86/avx2-sao.h"
+#include "x86/avx2-nal.h"
+#endif
+#if HAVE_AVX512
+#include "x86/avx512-motion.h"
+#include "x86/avx512-dct.h"
 #endif
 
+#include <string.h>
+
 #ifdef __GNUC__
 #include <cpuid.h>
 #endif
@@ -66,6 +83,12 @@ void init_acceleration_functions_sse(struct acceleration_functions* accel)
   if (have_SSE4_1) {
     accel->put_unweighted_pred_8   = ff_hevc_put_unweighted_pred_8_sse;
     accel->put_weighted_pred_avg_8 = ff_hevc_put_weighted_pred_avg_8_sse;
+    accel->put_weighted_pred_8     = put_weighted_pred_8_sse4;
+    accel->put_weighted_bipred_8   = put_weighted_bipred_8_sse4;
+    accel->put_unweighted_pred_16   = put_unweighted_pred_16_sse4;
+    accel->put_weighted_pred_avg_16 = put_weighted_pred_avg_16_sse4;
+    accel->put_weighted_pred_16     = put_weighted_pred_16_sse4;
+    accel->put_weighted_bipred_16   = put_weighted_bipred_16_sse4;
 
     accel->put_hevc_epel_8    = ff_hevc_put_hevc_epel_pixels_8_sse;
     accel->put_hevc_epel_h_8  = ff_hevc_put_hevc_epel_h_8_sse;
@@ -89,6 +112,28 @@ void init_acceleration_functions_sse(struct acceleration_functions* accel)
     accel->put_hevc_qpel_8[3][2] = ff_hevc_put_hevc_qpel_h_3_v_2_sse;
     accel->put_hevc_qpel_8[3][3] = ff_hevc_put_hevc_qpel_h_3_v_3_sse;
 
+    accel->put_hevc_epel_16    = put_epel_16_sse4;
+    accel->put_hevc_epel_h_16  = put_epel_h_16_sse4;
+    accel->put_hevc_epel_v_16  = put_epel_v_16_sse4;
+    accel->put_hevc_epel_hv_16 = put_epel_hv_16_sse4;
+
+    accel->put_hevc_qpel_16[0][0] = put_qpel_0_0_16_sse4;
+    accel->put_hevc_qpel_16[0][1] = put_qpel_0_1_16_sse4;
+    accel->put_hevc_qpel_16[0][2] = put_qpel_0_2_16_sse4;
+    accel->put_hevc_qpel_16[0][3] = put_qpel_0_3_16_sse4;
+    accel->put_hevc_qpel_16[1][0] = put_qpel_1_0_16_sse4;
+    accel->put_hevc_qpel_16[1][1] = put_qpel_1_1_16_sse4;
+    accel->put_hevc_qpel_16[1][2] = put_qpel_1_2_16_sse4;
+    accel->put_hevc_qpel_16[1][3] = put_qpel_1_3_16_sse4;
+    accel->put_hevc_qpel_16[2][0] = put_qpel_2_0_16_sse4;
+    accel->put_hevc_qpel_16[2][1] = put_qpel_2_1_16_sse4;
+    accel->put_hevc_qpel_16[2][2] = put_qpel_2_2_16_sse4;
+    accel->put_hevc_qpel_16[2][3] = put_qpel_2_3_16_sse4;
+    accel->put_hevc_qpel_16[3][0] = put_qpel_3_0_16_sse4;
+    accel->put_hevc_qpel_16[3][1] = put_qpel_3_1_16_sse4;
+    accel->put_hevc_qpel_16[3][2] = put_qpel_3_2_16_sse4;
+    accel->put_hevc_qpel_16[3][3] = put_qpel_3_3_16_sse4;
+
     accel->transform_skip_8 = ff_hevc_transform_skip_8_sse;
 
     // actually, for these two functions, the scalar fallback seems to be faster than the SSE code
@@ -98,7 +143,306 @@ void init_acceleration_functions_sse(struct acceleration_functions* accel)
     accel->transform_add_8[1] = ff_hevc_transform_8x8_add_8_sse4;
     accel->transform_add_8[2] = ff_hevc_transform_16x16_add_8_sse4;
     accel->transform_add_8[3] = ff_hevc_transform_32x32_add_8_sse4;
+
+    accel->deblock_luma_v_8   = deblock_luma_v_8_sse4;
+    accel->deblock_luma_h_8   = deblock_luma_h_8_sse4;
+    accel->deblock_chroma_v_8 = deblock_chroma_v_8_sse4;
+    accel->deblock_chroma_h_8 = deblock_chroma_h_8_sse4;
+
+    accel->deblock_luma_v_16   = deblock_luma_v_16_sse4;
+    accel->deblock_luma_h_16   = deblock_luma_h_16_sse4;
+    accel->deblock_chroma_v_16 = deblock_chroma_v_16_sse4;
+    accel->deblock_chroma_h_16 = deblock_chroma_h_16_sse4;
+
+    accel->intra_filter_border_8 = intra_filter_border_8_sse4;
+    accel->intra_pred_planar_8   = intra_pred_planar_8_sse4;
+    accel->intra_pred_dc_8       = intra_pred_dc_8_sse4;
+    accel->intra_pred_angular_8  = intra_pred_angular_8_sse4;
+
+    accel->intra_filter_border_16 = intra_filter_border_16_sse4;
+    accel->intra_pred_planar_16   = intra_pred_planar_16_sse4;
+    accel->intra_pred_dc_16       = intra_pred_dc_16_sse4;
+    accel->intra_pred_angular_16  = intra_pred_angular_16_sse4;
+
+    accel->transform_skip_residual  = transform_skip_residual_sse4;
+    accel->transform_bypass         = transform_bypass_sse4;
+    accel->rdpcm_v                  = rdpcm_v_sse4;
+    accel->rdpcm_h                  = rdpcm_h_sse4;
+    accel->transform_bypass_rdpcm_v = transform_bypass_rdpcm_v_sse4;
+    accel->transform_bypass_rdpcm_h = transform_bypass_rdpcm_h_sse4;
+    accel->cross_comp_pred          = cross_comp_pred_sse4;
+
+    // The SSE inverse transforms above only write 8-bit samples,
+    // transform_add_16 is only implemented with AVX2.
+    accel->add_residual_16 = add_residual_16_sse4;
+
+    accel->sao_band_8  = sao_band_8_sse4;
+    accel->sao_edge_8  = sao_edge_8_sse4;
+    accel->sao_band_16 = sao_band_16_sse4;
+    accel->sao_edge_16 = sao_edge_16_sse4;
+
+    accel->find_zero_byte_pair = find_zero_byte_pair_sse2;
+  }
+#endif
+}
+
+
+
+#if HAVE_AVX2
+static bool cpu_supports_avx2()
+{
+  uint32_t regs[4];  // EAX, EBX, ECX, EDX
+
+#ifdef _MSC_VER
+  __cpuid((int *)regs, 1);
+#else
+  if (!__get_cpuid(1, &regs[0],&regs[1],&regs[2],&regs[3])) {
+    return false;
   }
 #endif
+
+  // the OS has to save the YMM registers (OSXSAVE and XCR0 bits 1,2)
+
+  bool have_OSXSAVE = !!(regs[2] & (1<<27));
+  bool have_AVX     = !!(regs[2] & (1<<28));
+  if (!have_OSXSAVE || !have_AVX) {
+    return false;
+  }
+
+#ifdef _MSC_VER
+  uint64_t xcr0 = _xgetbv(0);
+#else
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  uint64_t xcr0 = ((uint64_t)xcr0_hi << 32) | xcr0_lo;
+#endif
+
+  if ((xcr0 & 6) != 6) {
+    return false;
+  }
+
+#ifdef _MSC_VER
+  __cpuidex((int *)regs, 7, 0);
+#else
+  if (!__get_cpuid_count(7, 0, &regs[0],&regs[1],&regs[2],&regs[3])) {
+    return false;
+  }
+#endif
+
+  return !!(regs[1] & (1<<5));
 }
+#endif
+
+
+void init_acceleration_functions_avx2(struct acceleration_functions* accel)
+{
+#if HAVE_AVX2
+  if (!cpu_supports_avx2()) {
+    return;
+  }
+
+  accel->put_unweighted_pred_8   = put_unweighted_pred_8_avx2;
+  accel->put_weighted_pred_avg_8 = put_weighted_pred_avg_8_avx2;
+  accel->put_weighted_pred_8     = put_weighted_pred_8_avx2;
+  accel->put_weighted_bipred_8   = put_weighted_bipred_8_avx2;
+
+  accel->put_hevc_epel_8    = put_epel_8_avx2;
+  accel->put_hevc_epel_h_8  = put_epel_h_8_avx2;
+  accel->put_hevc_epel_v_8  = put_epel_v_8_avx2;
+  accel->put_hevc_epel_hv_8 = put_epel_hv_8_avx2;
+
+  accel->put_hevc_qpel_8[0][0] = put_qpel_0_0_avx2;
+  accel->put_hevc_qpel_8[0][1] = put_qpel_0_1_avx2;
+  accel->put_hevc_qpel_8[0][2] = put_qpel_0_2_avx2;
+  accel->put_hevc_qpel_8[0][3] = put_qpel_0_3_avx2;
+  accel->put_hevc_qpel_8[1][0] = put_qpel_1_0_avx2;
+  accel->put_hevc_qpel_8[1][1] = put_qpel_1_1_avx2;
+  accel->put_hevc_qpel_8[1][2] = put_qpel_1_2_avx2;
+  accel->put_hevc_qpel_8[1][3] = put_qpel_1_3_avx2;
+  accel->put_hevc_qpel_8[2][0] = put_qpel_2_0_avx2;
+  accel->put_hevc_qpel_8[2][1] = put_qpel_2_1_avx2;
+  accel->put_hevc_qpel_8[2][2] = put_qpel_2_2_avx2;
+  accel->put_hevc_qpel_8[2][3] = put_qpel_2_3_avx2;
+  accel->put_hevc_qpel_8[3][0] = put_qpel_3_0_avx2;
+  accel->put_hevc_qpel_8[3][1] = put_qpel_3_1_avx2;
+  accel->put_hevc_qpel_8[3][2] = put_qpel_3_2_avx2;
+  accel->put_hevc_qpel_8[3][3] = put_qpel_3_3_avx2;
+
+  accel->put_unweighted_pred_16   = put_unweighted_pred_16_avx2;
+  accel->put_weighted_pred_avg_16 = put_weighted_pred_avg_16_avx2;
+  accel->put_weighted_pred_16     = put_weighted_pred_16_avx2;
+  accel->put_weighted_bipred_16   = put_weighted_bipred_16_avx2;
+
+  accel->put_hevc_epel_16    = put_epel_16_avx2;
+  accel->put_hevc_epel_h_16  = put_epel_h_16_avx2;
+  accel->put_hevc_epel_v_16  = put_epel_v_16_avx2;
+  accel->put_hevc_epel_hv_16 = put_epel_hv_16_avx2;
+
+  accel->put_hevc_qpel_16[0][0] = put_qpel_0_0_16_avx2;
+  accel->put_hevc_qpel_16[0][1] = put_qpel_0_1_16_avx2;
+  accel->put_hevc_qpel_16[0][2] = put_qpel_0_2_16_avx2;
+  accel->put_hevc_qpel_16[0][3] = put_qpel_0_3_16_avx2;
+  accel->put_hevc_qpel_16[1][0] = put_qpel_1_0_16_avx2;
+  accel->put_hevc_qpel_16[1][1] = put_qpel_1_1_16_avx2;
+  accel->put_hevc_qpel_16[1][2] = put_qpel_1_2_16_avx2;
+  accel->put_hevc_qpel_16[1][3] = put_qpel_1_3_16_avx2;
+  accel->put_hevc_qpel_16[2][0] = put_qpel_2_0_16_avx2;
+  accel->put_hevc_qpel_16[2][1] = put_qpel_2_1_16_avx2;
+  accel->put_hevc_qpel_16[2][2] = put_qpel_2_2_16_avx2;
+  accel->put_hevc_qpel_16[2][3] = put_qpel_2_3_16_avx2;
+  accel->put_hevc_qpel_16[3][0] = put_qpel_3_0_16_avx2;
+  accel->put_hevc_qpel_16[3][1] = put_qpel_3_1_16_avx2;
+  accel->put_hevc_qpel_16[3][2] = put_qpel_3_2_16_avx2;
+  accel->put_hevc_qpel_16[3][3] = put_qpel_3_3_16_avx2;
+
+  accel->transform_4x4_dst_add_8 = transform_4x4_luma_add_8_avx2;
+  accel->transform_add_8[0] = transform_4x4_add_8_avx2;
+  accel->transform_add_8[1] = transform_8x8_add_8_avx2;
+  accel->transform_add_8[2] = transform_16x16_add_8_avx2;
+  accel->transform_add_8[3] = transform_32x32_add_8_avx2;
+
+  accel->transform_idst_4x4   = transform_idst_4x4_avx2;
+  accel->transform_idct_4x4   = transform_idct_4x4_avx2;
+  accel->transform_idct_8x8   = transform_idct_8x8_avx2;
+  accel->transform_idct_16x16 = transform_idct_16x16_avx2;
+  accel->transform_idct_32x32 = transform_idct_32x32_avx2;
+
+  accel->transform_4x4_dst_add_16 = transform_4x4_luma_add_16_avx2;
+  accel->transform_add_16[0] = transform_4x4_add_16_avx2;
+  accel->transform_add_16[1] = transform_8x8_add_16_avx2;
+  accel->transform_add_16[2] = transform_16x16_add_16_avx2;
+  accel->transform_add_16[3] = transform_32x32_add_16_avx2;
 
+  accel->add_residual_8  = add_residual_8_avx2;
+  accel->add_residual_16 = add_residual_16_avx2;
+
+  accel->scale_coefficients = scale_coefficients_avx2;
+
+  accel->transform_skip_residual  = transform_skip_residual_avx2;
+  accel->transform_bypass         = transform_bypass_avx2;
+  accel->rdpcm_v                  = rdpcm_v_avx2;
+  accel->rdpcm_h                  = rdpcm_h_avx2;
+  accel->transform_bypass_rdpcm_v = transform_bypass_rdpcm_v_avx2;
+  accel->transform_bypass_rdpcm_h = transform_bypass_rdpcm_h_avx2;
+  accel->cross_comp_pred          = cross_comp_pred_avx2;
+
+  accel->sao_band_8  = sao_band_8_avx2;
+  accel->sao_edge_8  = sao_edge_8_avx2;
+  accel->sao_band_16 = sao_band_16_avx2;
+  accel->sao_edge_16 = sao_edge_16_avx2;
+
+  accel->find_zero_byte_pair = find_zero_byte_pair_avx2;
+#endif
+}
+
+
+#if HAVE_AVX512
+static bool cpu_supports_avx512()
+{
+  uint32_t regs[4];  // EAX, EBX, ECX, EDX
+
+#ifdef _MSC_VER
+  __cpuid((int *)regs, 1);
+#else
+  if (!__get_cpuid(1, &regs[0],&regs[1],&regs[2],&regs[3])) {
+    return false;
+  }
+#endif
+
+  if (!(regs[2] & (1<<27))) {  // OSXSAVE
+    return false;
+  }
+
+  // the OS has to save the YMM, ZMM and opmask registers (XCR0 bits 1,2,5,6,7)
+
+#ifdef _MSC_VER
+  uint64_t xcr0 = _xgetbv(0);
+#else
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  uint64_t xcr0 = ((uint64_t)xcr0_hi << 32) | xcr0_lo;
+#endif
+
+  if ((xcr0 & 0xE6) != 0xE6) {
+    return false;
+  }
+
+#ifdef _MSC_VER
+  __cpuidex((int *)regs, 7, 0);
+#else
+  if (!__get_cpuid_count(7, 0, &regs[0],&regs[1],&regs[2],&regs[3])) {
+    return false;
+  }
+#endif
+
+  bool have_AVX512F  = !!(regs[1] & (1<<16));
+  bool have_AVX512BW = !!(regs[1] & (1u<<30));
+  return have_AVX512F && have_AVX512BW;
+}
+#endif
+
+
+void init_acceleration_functions_avx512(struct acceleration_functions* accel)
+{
+#if HAVE_AVX512
+  if (!cpu_supports_avx512()) {
+    return;
+  }
+
+  accel->put_hevc_epel_8    = put_epel_8_avx512;
+  accel->put_hevc_epel_h_8  = put_epel_h_8_avx512;
+  accel->put_hevc_epel_v_8  = put_epel_v_8_avx512;
+  accel->put_hevc_epel_hv_8 = put_epel_hv_8_avx512;
+
+  accel->put_hevc_qpel_8[0][0] = put_qpel_0_0_avx512;
+  accel->put_hevc_qpel_8[0][1] = put_qpel_0_1_avx512;
+  accel->put_hevc_qpel_8[0][2] = put_qpel_0_2_avx512;
+  accel->put_hevc_qpel_8[0][3] = put_qpel_0_3_avx512;
+  accel->put_hevc_qpel_8[1][0] = put_qpel_1_0_avx512;
+  accel->put_hevc_qpel_8[1][1] = put_qpel_1_1_avx512;
+  accel->put_hevc_qpel_8[1][2] = put_qpel_1_2_avx512;
+  accel->put_hevc_qpel_8[1][3] = put_qpel_1_3_avx512;
+  accel->put_hevc_qpel_8[2][0] = put_qpel_2_0_avx512;
+  accel->put_hevc_qpel_8[2][1] = put_qpel_2_1_avx512;
+  accel->put_hevc_qpel_8[2][2] = put_qpel_2_2_avx512;
+  accel->put_hevc_qpel_8[2][3] = put_qpel_2_3_avx512;
+  accel->put_hevc_qpel_8[3][0] = put_qpel_3_0_avx512;
+  accel->put_hevc_qpel_8[3][1] = put_qpel_3_1_avx512;
+  accel->put_hevc_qpel_8[3][2] = put_qpel_3_2_avx512;
+  accel->put_hevc_qpel_8[3][3] = put_qpel_3_3_avx512;
+
+  accel->transform_add_8[3]   = transform_32x32_add_8_avx512;
+  accel->transform_add_16[3]  = transform_32x32_add_16_avx512;
+  accel->transform_idct_32x32 = transform_idct_32x32_avx512;
+#endif
+}
+
+
+void get_cpu_brand_string(char brand[49])
+{
+  uint32_t regs[4];  // EAX, EBX, ECX, EDX
+
+#ifdef _MSC_VER
+  __cpuid((int *)regs, 0x80000000);
+#else
+  if (!__get_cpuid(0x80000000, &regs[0],&regs[1],&regs[2],&regs[3])) {
+    regs[0] = 0;
+  }
+#endif
+
+  if (regs[0] < 0x80000004) {
+    strcpy(brand, "unknown");
+    return;
+  }
+
+  for (int i=0;i<3;i++) {
+#ifdef _MSC_VER
+    __cpuid((int *)regs, 0x80000002+i);
+#else
+    __get_cpuid(0x80000002+i, &regs[0],&regs[1],&regs[2],&regs[3]);
+#endif
+    memcpy(brand+16*i, regs, 16);
+  }
+
+  brand[48] = 0;
+}
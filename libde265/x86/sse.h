@@ -25,4 +25,13 @@
 
 void init_acceleration_functions_sse(struct acceleration_functions* accel);
 
+// Installs the AVX2 functions if the CPU supports them. Call after init_acceleration_functions_sse().
+void init_acceleration_functions_avx2(struct acceleration_functions* accel);
+
+// Installs the AVX-512 functions if the CPU supports them. Call after init_acceleration_functions_avx2().
+void init_acceleration_functions_avx512(struct acceleration_functions* accel);
+
+// CPU model name from CPUID (at most 48 characters), or "unknown".
+void get_cpu_brand_string(char brand[49]);
+
 #endif
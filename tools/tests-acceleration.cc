@@ -0,0 +1,1362 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tests.h"
+
+#include "libde265/acceleration.h"
+#include "libde265/decctx.h"
+#include "libde265/util.h"
+
+#include <stdarg.h>
+#include <map>
+#include <string>
+
+
+/* The SIMD kernels in acceleration_functions have to be bit-exact to the scalar
+   fallback code. For each acceleration level that is compiled in and supported by
+   this CPU, every function that differs from the scalar one is called with the same
+   random and edge-case inputs as the scalar function, and the outputs are compared.
+   Outputs are compared including the samples around the block, to also catch writes
+   outside of it. */
+
+static const struct {
+  const char* name;
+  enum de265_acceleration level;
+} simd_levels[] = {
+  { "sse4",   de265_acceleration_SSE4 },
+  { "avx2",   de265_acceleration_AVX2 },
+  { "avx512", de265_acceleration_AVX512 },
+  { "arm",    de265_acceleration_ARM }
+};
+
+static const int nSimdLevels = sizeof(simd_levels)/sizeof(simd_levels[0]);
+
+
+// deterministic pseudo random numbers in [0;range[ (range <= 65536)
+static uint32_t rnd_seed;
+
+static int rnd(int range)
+{
+  rnd_seed = rnd_seed*1103515245 + 12345;
+  return (rnd_seed>>16) % range;
+}
+
+// random number in [lo;hi]
+static int rnd(int lo, int hi)
+{
+  return lo + rnd(hi-lo+1);
+}
+
+
+// --- comparison of outputs ---
+
+class KernelCheck
+{
+public:
+  KernelCheck(const char* level) : mLevel(level) { }
+
+  // Compares the 'size' bytes of the two outputs.
+  bool compare(const char* func, const void* ref, const void* out, size_t size,
+               const char* paramsFmt, ...);
+
+  // Compares a w x h block of elements of 'elemSize' bytes with the given stride (in elements).
+  bool compare_block(const char* func, const void* ref, const void* out, ptrdiff_t stride,
+                     int w, int h, int elemSize, const char* paramsFmt, ...);
+
+  bool passed() const { return mFailures.empty(); }
+
+private:
+  const char* mLevel;
+  std::map<std::string,int> mFailures;
+
+  bool mismatch(const char* func, const char* paramsFmt, va_list args);
+};
+
+
+bool KernelCheck::compare(const char* func, const void* ref, const void* out, size_t size,
+                          const char* paramsFmt, ...)
+{
+  if (memcmp(ref,out,size)==0) {
+    return true;
+  }
+
+  va_list args;
+  va_start(args, paramsFmt);
+  mismatch(func, paramsFmt, args);
+  va_end(args);
+
+  return false;
+}
+
+
+bool KernelCheck::compare_block(const char* func, const void* ref, const void* out, ptrdiff_t stride,
+                                int w, int h, int elemSize, const char* paramsFmt, ...)
+{
+  for (int y=0;y<h;y++) {
+    if (memcmp((const uint8_t*)ref + y*stride*elemSize,
+               (const uint8_t*)out + y*stride*elemSize, w*elemSize) != 0) {
+      va_list args;
+      va_start(args, paramsFmt);
+      mismatch(func, paramsFmt, args);
+      va_end(args);
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// Only the first mismatch of each function is shown.
+bool KernelCheck::mismatch(const char* func, const char* paramsFmt, va_list args)
+{
+  if (mFailures[func]++ == 0) {
+    char params[200];
+    vsnprintf(params, sizeof(params), paramsFmt, args);
+
+    printf("  %s (%s) differs from the scalar code for %s\n", func, mLevel, params);
+  }
+
+  return false;
+}
+
+
+typedef void (*kernel_test)(const acceleration_functions& ref, const acceleration_functions& simd,
+                            KernelCheck& check);
+
+/* Runs the test for all acceleration levels. A level is skipped if it has the same
+   functions as the level below, i.e. if it is not compiled in or not supported by the CPU. */
+static bool test_all_levels(kernel_test test, bool quiet)
+{
+  acceleration_functions ref, prev;
+  init_acceleration_functions(&ref, de265_acceleration_SCALAR);
+  prev = ref;
+
+  bool passed = true;
+
+  for (int l=0;l<nSimdLevels;l++) {
+    acceleration_functions simd;
+    init_acceleration_functions(&simd, simd_levels[l].level);
+
+    if (memcmp(&simd, &prev, sizeof(simd))==0) {
+      if (!quiet) { printf("%s: not available\n", simd_levels[l].name); }
+      continue;
+    }
+
+    prev = simd;
+
+    rnd_seed = 12345;
+
+    KernelCheck check(simd_levels[l].name);
+    test(ref, simd, check);
+
+    if (!quiet) { printf("%s: %s\n", simd_levels[l].name, check.passed() ? "ok" : "FAILED"); }
+
+    passed &= check.passed();
+  }
+
+  return passed;
+}
+
+
+// --- test data ---
+
+#define IMG_STRIDE 192
+#define IMG_ORIGIN (64*IMG_STRIDE+64)  // block origin, with 64 samples margin on all sides
+
+static ALIGNED_32(uint8_t  src8 [IMG_STRIDE*IMG_STRIDE]);
+static ALIGNED_32(uint8_t  ref8 [IMG_STRIDE*IMG_STRIDE]);
+static ALIGNED_32(uint8_t  out8 [IMG_STRIDE*IMG_STRIDE]);
+static ALIGNED_32(uint16_t src16[IMG_STRIDE*IMG_STRIDE]);
+static ALIGNED_32(uint16_t ref16[IMG_STRIDE*IMG_STRIDE]);
+static ALIGNED_32(uint16_t out16[IMG_STRIDE*IMG_STRIDE]);
+
+#define PRED_STRIDE 64  // MAX_CU_SIZE, the stride of the MC prediction buffers in the decoder
+
+static ALIGNED_32(int16_t pred1 [PRED_STRIDE*64]);
+static ALIGNED_32(int16_t pred2 [PRED_STRIDE*64]);
+static ALIGNED_32(int16_t mc_ref[PRED_STRIDE*64]);
+static ALIGNED_32(int16_t mc_out[PRED_STRIDE*64]);
+static ALIGNED_32(int16_t mcbuffer[64*(64+7)]);
+
+static ALIGNED_32(int16_t coeffs    [32*32]);
+static ALIGNED_32(int16_t coeffs_ref[32*32]);
+static ALIGNED_32(int16_t coeffs_out[32*32]);
+static ALIGNED_32(int32_t res_luma  [32*32]);
+static ALIGNED_32(int32_t res_ref   [32*32]);
+static ALIGNED_32(int32_t res_out   [32*32]);
+
+#define BORDER_SIZE (4*64+1)
+
+static ALIGNED_32(uint8_t  border8    [BORDER_SIZE]);
+static ALIGNED_32(uint8_t  border8_ref[BORDER_SIZE]);
+static ALIGNED_32(uint8_t  border8_out[BORDER_SIZE]);
+static ALIGNED_32(uint16_t border16    [BORDER_SIZE]);
+static ALIGNED_32(uint16_t border16_ref[BORDER_SIZE]);
+static ALIGNED_32(uint16_t border16_out[BORDER_SIZE]);
+
+
+enum fill_mode {
+  FILL_RANDOM,
+  FILL_ZERO,
+  FILL_MAX,
+  FILL_CHECKERBOARD,  // alternating 0 and max, maximizes the filter overshoot
+  FILL_SMOOTH,        // a ramp with little noise
+  nFillModes
+};
+
+static const char* fill_mode_names[nFillModes] = {
+  "random", "zero", "max", "checkerboard", "smooth"
+};
+
+template <class pixel_t>
+static void fill_image(pixel_t* img, int bit_depth, fill_mode mode)
+{
+  const int maxval = (1<<bit_depth)-1;
+  const int base = rnd(1<<bit_depth);
+
+  for (int y=0;y<IMG_STRIDE;y++)
+    for (int x=0;x<IMG_STRIDE;x++) {
+      int v;
+      switch (mode) {
+      case FILL_RANDOM:       v = rnd(maxval+1); break;
+      case FILL_ZERO:         v = 0; break;
+      case FILL_MAX:          v = maxval; break;
+      case FILL_CHECKERBOARD: v = ((x+y)&1) ? maxval : 0; break;
+      case FILL_SMOOTH:       v = Clip3(0,maxval, base + ((x+y)<<(bit_depth-8)) + rnd(4)); break;
+      default: v=0; break;
+      }
+
+      img[y*IMG_STRIDE+x] = v;
+    }
+}
+
+template <class pixel_t>
+static void fill_border(pixel_t* border, int bit_depth, fill_mode mode)
+{
+  const int maxval = (1<<bit_depth)-1;
+  const int base = rnd(1<<bit_depth);
+
+  for (int i=0;i<BORDER_SIZE;i++) {
+    int v;
+    switch (mode) {
+    case FILL_RANDOM:       v = rnd(maxval+1); break;
+    case FILL_ZERO:         v = 0; break;
+    case FILL_MAX:          v = maxval; break;
+    case FILL_CHECKERBOARD: v = (i&1) ? maxval : 0; break;
+    case FILL_SMOOTH:       v = Clip3(0,maxval, base + (i<<(bit_depth-8))/4 + rnd(4)); break;
+    default: v=0; break;
+    }
+
+    border[i] = v;
+  }
+}
+
+
+// Range of the 14 bit MC filter outputs, including the overshoot of the filters.
+#define PRED_MIN (-10240)
+#define PRED_MAX  26623
+
+static void fill_pred(int16_t* pred, fill_mode mode)
+{
+  for (int i=0;i<PRED_STRIDE*64;i++) {
+    switch (mode) {
+    case FILL_RANDOM:       pred[i] = rnd(PRED_MIN,PRED_MAX); break;
+    case FILL_ZERO:         pred[i] = PRED_MIN; break;
+    case FILL_MAX:          pred[i] = PRED_MAX; break;
+    case FILL_CHECKERBOARD: pred[i] = ((i ^ (i/PRED_STRIDE))&1) ? PRED_MAX : PRED_MIN; break;
+    case FILL_SMOOTH:       pred[i] = ((i%PRED_STRIDE + i/PRED_STRIDE)<<6) + rnd(-32,31); break;
+    default: break;
+    }
+  }
+}
+
+
+// --- motion compensation and weighted prediction ---
+
+static const int mc_widths[]  = { 2,4,6,8,12,16,24,32,48,64 };
+static const int mc_heights[] = { 2,4,8,12,64 };
+
+static const int nMCWidths  = sizeof(mc_widths)/sizeof(mc_widths[0]);
+static const int nMCHeights = sizeof(mc_heights)/sizeof(mc_heights[0]);
+
+
+template <class pixel_t>
+static void test_weighted_pred(const acceleration_functions& ref, const acceleration_functions& simd,
+                               KernelCheck& check, int bit_depth, fill_mode mode,
+                               pixel_t* ref_img, pixel_t* out_img, const pixel_t* init_img)
+{
+  const bool hbd = (sizeof(pixel_t)==2);
+
+  for (int wi=0;wi<nMCWidths;wi++)
+    for (int hi=0;hi<nMCHeights;hi++) {
+      const int w = mc_widths[wi];
+      const int h = mc_heights[hi];
+
+      // weights and offsets as derived in pred_weight_table() (7.4.7.3)
+
+      const int shift1 = 14-bit_depth;
+      const int log2WD = shift1 + rnd(8);
+      const int w1 = rnd(-128,127) + (1<<(log2WD-shift1));
+      const int w2 = rnd(-128,127) + (1<<(log2WD-shift1));
+      const int o1 = rnd(-128,127) << (bit_depth-8);
+      const int o2 = rnd(-128,127) << (bit_depth-8);
+
+      pixel_t* ref_dst = ref_img + IMG_ORIGIN + rnd(16);
+      pixel_t* out_dst = out_img + (ref_dst - ref_img);
+      const size_t imgSize = IMG_STRIDE*IMG_STRIDE*sizeof(pixel_t);
+
+#define WP_PARAMS "%dx%d, bit depth %d, %s input, w=%d/%d o=%d/%d log2WD=%d", \
+        w,h, bit_depth, fill_mode_names[mode], w1,w2,o1,o2,log2WD
+
+      if (!hbd && simd.put_weighted_pred_avg_8 != ref.put_weighted_pred_avg_8) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_pred_avg_8((uint8_t*)ref_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h);
+        simd.put_weighted_pred_avg_8((uint8_t*)out_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h);
+        check.compare("put_weighted_pred_avg_8", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (hbd && simd.put_weighted_pred_avg_16 != ref.put_weighted_pred_avg_16) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_pred_avg_16((uint16_t*)ref_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h, bit_depth);
+        simd.put_weighted_pred_avg_16((uint16_t*)out_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h, bit_depth);
+        check.compare("put_weighted_pred_avg_16", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (!hbd && simd.put_unweighted_pred_8 != ref.put_unweighted_pred_8) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_unweighted_pred_8((uint8_t*)ref_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h);
+        simd.put_unweighted_pred_8((uint8_t*)out_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h);
+        check.compare("put_unweighted_pred_8", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (hbd && simd.put_unweighted_pred_16 != ref.put_unweighted_pred_16) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_unweighted_pred_16((uint16_t*)ref_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, bit_depth);
+        simd.put_unweighted_pred_16((uint16_t*)out_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, bit_depth);
+        check.compare("put_unweighted_pred_16", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (!hbd && simd.put_weighted_pred_8 != ref.put_weighted_pred_8) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_pred_8((uint8_t*)ref_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, w1,o1,log2WD);
+        simd.put_weighted_pred_8((uint8_t*)out_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, w1,o1,log2WD);
+        check.compare("put_weighted_pred_8", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (hbd && simd.put_weighted_pred_16 != ref.put_weighted_pred_16) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_pred_16((uint16_t*)ref_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, w1,o1,log2WD, bit_depth);
+        simd.put_weighted_pred_16((uint16_t*)out_dst, IMG_STRIDE, pred1, PRED_STRIDE, w,h, w1,o1,log2WD, bit_depth);
+        check.compare("put_weighted_pred_16", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (!hbd && simd.put_weighted_bipred_8 != ref.put_weighted_bipred_8) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_bipred_8((uint8_t*)ref_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h,
+                                   w1,o1,w2,o2,log2WD);
+        simd.put_weighted_bipred_8((uint8_t*)out_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h,
+                                   w1,o1,w2,o2,log2WD);
+        check.compare("put_weighted_bipred_8", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+      if (hbd && simd.put_weighted_bipred_16 != ref.put_weighted_bipred_16) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        ref .put_weighted_bipred_16((uint16_t*)ref_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h,
+                                    w1,o1,w2,o2,log2WD, bit_depth);
+        simd.put_weighted_bipred_16((uint16_t*)out_dst, IMG_STRIDE, pred1,pred2, PRED_STRIDE, w,h,
+                                    w1,o1,w2,o2,log2WD, bit_depth);
+        check.compare("put_weighted_bipred_16", ref_img, out_img, imgSize, WP_PARAMS);
+      }
+
+#undef WP_PARAMS
+    }
+}
+
+
+static void test_mc_8(const acceleration_functions& ref, const acceleration_functions& simd,
+                      KernelCheck& check, fill_mode mode)
+{
+  for (int wi=0;wi<nMCWidths;wi++)
+    for (int hi=0;hi<nMCHeights;hi++) {
+      const int w = mc_widths[wi];
+      const int h = mc_heights[hi];
+
+      const uint8_t* src = src8 + IMG_ORIGIN + rnd(16) + rnd(16)*IMG_STRIDE;
+      const int mx = rnd(1,7);
+      const int my = rnd(1,7);
+
+#define MC_PARAMS "%dx%d, %s input, mx=%d my=%d", w,h, fill_mode_names[mode], mx,my
+
+      if (simd.put_hevc_epel_8 != ref.put_hevc_epel_8) {
+        ref .put_hevc_epel_8(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,0, mcbuffer);
+        simd.put_hevc_epel_8(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,0, mcbuffer);
+        check.compare_block("put_hevc_epel_8", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_h_8 != ref.put_hevc_epel_h_8) {
+        ref .put_hevc_epel_h_8(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,0, mcbuffer, 8);
+        simd.put_hevc_epel_h_8(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,0, mcbuffer, 8);
+        check.compare_block("put_hevc_epel_h_8", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_v_8 != ref.put_hevc_epel_v_8) {
+        ref .put_hevc_epel_v_8(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,my, mcbuffer, 8);
+        simd.put_hevc_epel_v_8(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,my, mcbuffer, 8);
+        check.compare_block("put_hevc_epel_v_8", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_hv_8 != ref.put_hevc_epel_hv_8) {
+        ref .put_hevc_epel_hv_8(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,my, mcbuffer, 8);
+        simd.put_hevc_epel_hv_8(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,my, mcbuffer, 8);
+        check.compare_block("put_hevc_epel_hv_8", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      // luma prediction blocks are multiples of 4 in both directions
+
+      for (int x=0;x<4;x++)
+        for (int y=0;y<4;y++) {
+          if ((w%4)==0 && (h%4)==0 &&
+              simd.put_hevc_qpel_8[x][y] != ref.put_hevc_qpel_8[x][y]) {
+            char name[50];
+            sprintf(name, "put_hevc_qpel_8[%d][%d]", x,y);
+
+            ref .put_hevc_qpel_8[x][y](mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mcbuffer);
+            simd.put_hevc_qpel_8[x][y](mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mcbuffer);
+            check.compare_block(name, mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+          }
+        }
+
+#undef MC_PARAMS
+    }
+}
+
+
+static void test_mc_16(const acceleration_functions& ref, const acceleration_functions& simd,
+                       KernelCheck& check, int bit_depth, fill_mode mode)
+{
+  for (int wi=0;wi<nMCWidths;wi++)
+    for (int hi=0;hi<nMCHeights;hi++) {
+      const int w = mc_widths[wi];
+      const int h = mc_heights[hi];
+
+      const uint16_t* src = src16 + IMG_ORIGIN + rnd(16) + rnd(16)*IMG_STRIDE;
+      const int mx = rnd(1,7);
+      const int my = rnd(1,7);
+
+#define MC_PARAMS "%dx%d, bit depth %d, %s input, mx=%d my=%d", w,h, bit_depth, fill_mode_names[mode], mx,my
+
+      if (simd.put_hevc_epel_16 != ref.put_hevc_epel_16) {
+        ref .put_hevc_epel_16(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,0, mcbuffer, bit_depth);
+        simd.put_hevc_epel_16(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,0, mcbuffer, bit_depth);
+        check.compare_block("put_hevc_epel_16", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_h_16 != ref.put_hevc_epel_h_16) {
+        ref .put_hevc_epel_h_16(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,0, mcbuffer, bit_depth);
+        simd.put_hevc_epel_h_16(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,0, mcbuffer, bit_depth);
+        check.compare_block("put_hevc_epel_h_16", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_v_16 != ref.put_hevc_epel_v_16) {
+        ref .put_hevc_epel_v_16(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,my, mcbuffer, bit_depth);
+        simd.put_hevc_epel_v_16(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, 0,my, mcbuffer, bit_depth);
+        check.compare_block("put_hevc_epel_v_16", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      if (simd.put_hevc_epel_hv_16 != ref.put_hevc_epel_hv_16) {
+        ref .put_hevc_epel_hv_16(mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,my, mcbuffer, bit_depth);
+        simd.put_hevc_epel_hv_16(mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mx,my, mcbuffer, bit_depth);
+        check.compare_block("put_hevc_epel_hv_16", mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+      }
+
+      for (int x=0;x<4;x++)
+        for (int y=0;y<4;y++) {
+          if ((w%4)==0 && (h%4)==0 &&
+              simd.put_hevc_qpel_16[x][y] != ref.put_hevc_qpel_16[x][y]) {
+            char name[50];
+            sprintf(name, "put_hevc_qpel_16[%d][%d]", x,y);
+
+            ref .put_hevc_qpel_16[x][y](mc_ref, PRED_STRIDE, src, IMG_STRIDE, w,h, mcbuffer, bit_depth);
+            simd.put_hevc_qpel_16[x][y](mc_out, PRED_STRIDE, src, IMG_STRIDE, w,h, mcbuffer, bit_depth);
+            check.compare_block(name, mc_ref, mc_out, PRED_STRIDE, w,h, 2, MC_PARAMS);
+          }
+        }
+
+#undef MC_PARAMS
+    }
+}
+
+
+static void test_prediction(const acceleration_functions& ref, const acceleration_functions& simd,
+                            KernelCheck& check)
+{
+  for (int m=0;m<nFillModes;m++) {
+    fill_mode mode = (fill_mode)m;
+
+    fill_pred(pred1, mode);
+    fill_pred(pred2, mode==FILL_CHECKERBOARD ? FILL_RANDOM : mode);
+
+    fill_image(src8, 8, FILL_RANDOM);
+    test_weighted_pred(ref, simd, check, 8, mode, ref8, out8, src8);
+
+    fill_image(src8, 8, mode);
+    test_mc_8(ref, simd, check, mode);
+
+    for (int bit_depth=9; bit_depth<=12; bit_depth++) {
+      fill_image(src16, bit_depth, FILL_RANDOM);
+      test_weighted_pred(ref, simd, check, bit_depth, mode, ref16, out16, src16);
+
+      fill_image(src16, bit_depth, mode);
+      test_mc_16(ref, simd, check, bit_depth, mode);
+    }
+  }
+}
+
+
+class AccelerationPredictionTest : public Test
+{
+public:
+  const char* getName() const { return "accel-prediction"; }
+  const char* getDescription() const { return "compare SIMD motion compensation and weighted prediction with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_prediction, quiet); }
+} accel_prediction_test;
+
+
+
+// --- transforms and residuals ---
+
+enum coeff_mode {
+  COEFF_RANDOM,   // full 16 bit range
+  COEFF_LOWFREQ,  // small values in the top-left quarter
+  COEFF_MAX,
+  COEFF_MIN,
+  COEFF_SINGLE,   // a single extreme value at a random position
+  nCoeffModes
+};
+
+static const char* coeff_mode_names[nCoeffModes] = {
+  "random", "low frequency", "max", "min", "single"
+};
+
+static void fill_coeffs(int16_t* c, int nT, coeff_mode mode)
+{
+  memset(c, 0, nT*nT*sizeof(int16_t));
+
+  switch (mode) {
+  case COEFF_RANDOM:
+    for (int i=0;i<nT*nT;i++) { c[i] = rnd(-32768,32767); }
+    break;
+  case COEFF_LOWFREQ:
+    for (int y=0;y<(nT+3)/4;y++)
+      for (int x=0;x<(nT+3)/4;x++) { c[y*nT+x] = rnd(-256,255); }
+    break;
+  case COEFF_MAX:
+    for (int i=0;i<nT*nT;i++) { c[i] = 32767; }
+    break;
+  case COEFF_MIN:
+    for (int i=0;i<nT*nT;i++) { c[i] = -32768; }
+    break;
+  case COEFF_SINGLE:
+    c[rnd(nT*nT)] = rnd(2) ? 32767 : -32768;
+    break;
+  default:
+    break;
+  }
+}
+
+static void fill_residual(int32_t* r, int nT, coeff_mode mode)
+{
+  for (int i=0;i<nT*nT;i++) {
+    switch (mode) {
+    case COEFF_RANDOM:  r[i] = rnd(-32768,32767); break;
+    case COEFF_LOWFREQ: r[i] = rnd(-256,255); break;
+    case COEFF_MAX:     r[i] = 32767; break;
+    case COEFF_MIN:     r[i] = -32768; break;
+    case COEFF_SINGLE:  r[i] = (i==nT*nT/2 ? 32767 : 0); break;
+    default: break;
+    }
+  }
+}
+
+
+template <class pixel_t>
+static void test_transform_add(const acceleration_functions& ref, const acceleration_functions& simd,
+                               KernelCheck& check, int bit_depth, int log2nT, coeff_mode mode,
+                               pixel_t* ref_img, pixel_t* out_img, const pixel_t* init_img)
+{
+  const bool hbd = (sizeof(pixel_t)==2);
+  const int nT = 1<<log2nT;
+  const size_t imgSize = IMG_STRIDE*IMG_STRIDE*sizeof(pixel_t);
+
+  // transform blocks are aligned to their size in the image
+  pixel_t* ref_dst = ref_img + IMG_ORIGIN + nT*rnd(2);
+  pixel_t* out_dst = out_img + (ref_dst - ref_img);
+
+  char name[50];
+
+#define TR_PARAMS "%dx%d, bit depth %d, %s coefficients", nT,nT, bit_depth, coeff_mode_names[mode]
+
+  if (!hbd && simd.transform_add_8[log2nT-2] != ref.transform_add_8[log2nT-2]) {
+    sprintf(name, "transform_add_8[%d]", log2nT-2);
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_add_8[log2nT-2]((uint8_t*)ref_dst, coeffs, IMG_STRIDE);
+    simd.transform_add_8[log2nT-2]((uint8_t*)out_dst, coeffs, IMG_STRIDE);
+    check.compare(name, ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  if (hbd && simd.transform_add_16[log2nT-2] != ref.transform_add_16[log2nT-2]) {
+    sprintf(name, "transform_add_16[%d]", log2nT-2);
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_add_16[log2nT-2]((uint16_t*)ref_dst, coeffs, IMG_STRIDE, bit_depth);
+    simd.transform_add_16[log2nT-2]((uint16_t*)out_dst, coeffs, IMG_STRIDE, bit_depth);
+    check.compare(name, ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  if (log2nT==2 && !hbd && simd.transform_4x4_dst_add_8 != ref.transform_4x4_dst_add_8) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_4x4_dst_add_8((uint8_t*)ref_dst, coeffs, IMG_STRIDE);
+    simd.transform_4x4_dst_add_8((uint8_t*)out_dst, coeffs, IMG_STRIDE);
+    check.compare("transform_4x4_dst_add_8", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  if (log2nT==2 && hbd && simd.transform_4x4_dst_add_16 != ref.transform_4x4_dst_add_16) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_4x4_dst_add_16((uint16_t*)ref_dst, coeffs, IMG_STRIDE, bit_depth);
+    simd.transform_4x4_dst_add_16((uint16_t*)out_dst, coeffs, IMG_STRIDE, bit_depth);
+    check.compare("transform_4x4_dst_add_16", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  // (transform_skip_8/16 are deprecated and not tested, the scalar versions assert)
+
+  if (!hbd && simd.transform_skip_rdpcm_v_8 != ref.transform_skip_rdpcm_v_8) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_skip_rdpcm_v_8((uint8_t*)ref_dst, coeffs, log2nT, IMG_STRIDE);
+    simd.transform_skip_rdpcm_v_8((uint8_t*)out_dst, coeffs, log2nT, IMG_STRIDE);
+    check.compare("transform_skip_rdpcm_v_8", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  if (!hbd && simd.transform_skip_rdpcm_h_8 != ref.transform_skip_rdpcm_h_8) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .transform_skip_rdpcm_h_8((uint8_t*)ref_dst, coeffs, log2nT, IMG_STRIDE);
+    simd.transform_skip_rdpcm_h_8((uint8_t*)out_dst, coeffs, log2nT, IMG_STRIDE);
+    check.compare("transform_skip_rdpcm_h_8", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  // residuals are added to the prediction in the 16 bit range
+
+  fill_residual(res_luma, nT, mode);
+
+  if (!hbd && simd.add_residual_8 != ref.add_residual_8) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .add_residual_8((uint8_t*)ref_dst, IMG_STRIDE, res_luma, nT, bit_depth);
+    simd.add_residual_8((uint8_t*)out_dst, IMG_STRIDE, res_luma, nT, bit_depth);
+    check.compare("add_residual_8", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+  if (hbd && simd.add_residual_16 != ref.add_residual_16) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .add_residual_16((uint16_t*)ref_dst, IMG_STRIDE, res_luma, nT, bit_depth);
+    simd.add_residual_16((uint16_t*)out_dst, IMG_STRIDE, res_luma, nT, bit_depth);
+    check.compare("add_residual_16", ref_img, out_img, imgSize, TR_PARAMS);
+  }
+
+#undef TR_PARAMS
+}
+
+
+static void test_residual(const acceleration_functions& ref, const acceleration_functions& simd,
+                          KernelCheck& check, int bit_depth, int log2nT, coeff_mode mode)
+{
+  const int nT = 1<<log2nT;
+  const size_t resSize = nT*nT*sizeof(int32_t);
+
+  // (8.6.2) and (8.6.4.2)
+  const int bdShift = 20-bit_depth;
+  const int tsShift = 5+log2nT;
+
+#define TR_PARAMS "%dx%d, bit depth %d, %s coefficients", nT,nT, bit_depth, coeff_mode_names[mode]
+
+  if (log2nT==2 && simd.transform_idst_4x4 != ref.transform_idst_4x4) {
+    ref .transform_idst_4x4(res_ref, coeffs, bdShift, 15);
+    simd.transform_idst_4x4(res_out, coeffs, bdShift, 15);
+    check.compare("transform_idst_4x4", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (log2nT==2 && simd.transform_idct_4x4 != ref.transform_idct_4x4) {
+    ref .transform_idct_4x4(res_ref, coeffs, bdShift, 15);
+    simd.transform_idct_4x4(res_out, coeffs, bdShift, 15);
+    check.compare("transform_idct_4x4", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (log2nT==3 && simd.transform_idct_8x8 != ref.transform_idct_8x8) {
+    ref .transform_idct_8x8(res_ref, coeffs, bdShift, 15);
+    simd.transform_idct_8x8(res_out, coeffs, bdShift, 15);
+    check.compare("transform_idct_8x8", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (log2nT==4 && simd.transform_idct_16x16 != ref.transform_idct_16x16) {
+    ref .transform_idct_16x16(res_ref, coeffs, bdShift, 15);
+    simd.transform_idct_16x16(res_out, coeffs, bdShift, 15);
+    check.compare("transform_idct_16x16", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (log2nT==5 && simd.transform_idct_32x32 != ref.transform_idct_32x32) {
+    ref .transform_idct_32x32(res_ref, coeffs, bdShift, 15);
+    simd.transform_idct_32x32(res_out, coeffs, bdShift, 15);
+    check.compare("transform_idct_32x32", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.transform_bypass != ref.transform_bypass) {
+    ref .transform_bypass(res_ref, coeffs, nT);
+    simd.transform_bypass(res_out, coeffs, nT);
+    check.compare("transform_bypass", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.transform_bypass_rdpcm_v != ref.transform_bypass_rdpcm_v) {
+    ref .transform_bypass_rdpcm_v(res_ref, coeffs, nT);
+    simd.transform_bypass_rdpcm_v(res_out, coeffs, nT);
+    check.compare("transform_bypass_rdpcm_v", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.transform_bypass_rdpcm_h != ref.transform_bypass_rdpcm_h) {
+    ref .transform_bypass_rdpcm_h(res_ref, coeffs, nT);
+    simd.transform_bypass_rdpcm_h(res_out, coeffs, nT);
+    check.compare("transform_bypass_rdpcm_h", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.transform_skip_residual != ref.transform_skip_residual) {
+    ref .transform_skip_residual(res_ref, coeffs, nT, tsShift, bdShift);
+    simd.transform_skip_residual(res_out, coeffs, nT, tsShift, bdShift);
+    check.compare("transform_skip_residual", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.rdpcm_v != ref.rdpcm_v) {
+    ref .rdpcm_v(res_ref, coeffs, nT, tsShift, bdShift);
+    simd.rdpcm_v(res_out, coeffs, nT, tsShift, bdShift);
+    check.compare("rdpcm_v", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.rdpcm_h != ref.rdpcm_h) {
+    ref .rdpcm_h(res_ref, coeffs, nT, tsShift, bdShift);
+    simd.rdpcm_h(res_out, coeffs, nT, tsShift, bdShift);
+    check.compare("rdpcm_h", res_ref, res_out, resSize, TR_PARAMS);
+  }
+
+  if (simd.rotate_coefficients != ref.rotate_coefficients) {
+    memcpy(coeffs_ref, coeffs, nT*nT*sizeof(int16_t));
+    memcpy(coeffs_out, coeffs, nT*nT*sizeof(int16_t));
+    ref .rotate_coefficients(coeffs_ref, nT);
+    simd.rotate_coefficients(coeffs_out, nT);
+    check.compare("rotate_coefficients", coeffs_ref, coeffs_out, nT*nT*sizeof(int16_t), TR_PARAMS);
+  }
+
+#undef TR_PARAMS
+
+  // (7.3.8.12), the chroma bit depth may differ from the luma bit depth
+
+  if (simd.cross_comp_pred != ref.cross_comp_pred) {
+    static const int resScaleVals[8] = { -8,-4,-2,-1,1,2,4,8 };
+    const int resScaleVal = resScaleVals[rnd(8)];
+    const int bitDepthC = rnd(8,12);
+
+    fill_residual(res_ref, nT, mode);
+    fill_residual(res_luma, nT, COEFF_RANDOM);
+    memcpy(res_out, res_ref, resSize);
+
+    ref .cross_comp_pred(res_ref, res_luma, nT, resScaleVal, bit_depth, bitDepthC);
+    simd.cross_comp_pred(res_out, res_luma, nT, resScaleVal, bit_depth, bitDepthC);
+    check.compare("cross_comp_pred", res_ref, res_out, resSize,
+                  "%dx%d, bit depths %d/%d, %s residual, ResScaleVal=%d",
+                  nT,nT, bit_depth, bitDepthC, coeff_mode_names[mode], resScaleVal);
+  }
+
+  // (8.6.3), only a region of whole 4x4 sub-blocks contains coefficients
+
+  if (simd.scale_coefficients != ref.scale_coefficients) {
+    static const int levelScale[6] = { 40,45,51,57,64,72 };
+
+    static uint8_t scalingFactor[32*32];
+    const bool useScalingList = rnd(2);
+    for (int i=0;i<nT*nT;i++) { scalingFactor[i] = rnd(1,255); }
+
+    const int width  = 4*rnd(1,nT/4);
+    const int height = 4*rnd(1,nT/4);
+    const int qP = rnd(0, 51 + 6*(bit_depth-8));
+    const int bdShift = bit_depth + log2nT - 5;
+
+    memset(coeffs_ref, 0, nT*nT*sizeof(int16_t));
+    for (int y=0;y<height;y++)
+      for (int x=0;x<width;x++) {
+        coeffs_ref[y*nT+x] = coeffs[y*nT+x];
+      }
+
+    memcpy(coeffs_out, coeffs_ref, nT*nT*sizeof(int16_t));
+
+    ref .scale_coefficients(coeffs_ref, nT, width,height, useScalingList ? scalingFactor : NULL,
+                            levelScale[qP%6], qP/6, bdShift);
+    simd.scale_coefficients(coeffs_out, nT, width,height, useScalingList ? scalingFactor : NULL,
+                            levelScale[qP%6], qP/6, bdShift);
+    check.compare("scale_coefficients", coeffs_ref, coeffs_out, nT*nT*sizeof(int16_t),
+                  "%dx%d (%dx%d coded), bit depth %d, %s coefficients, qP=%d%s",
+                  nT,nT, width,height, bit_depth, coeff_mode_names[mode], qP,
+                  useScalingList ? ", scaling list" : "");
+  }
+}
+
+
+// forward transforms of the encoder, 8 bit only
+static void test_forward_transforms(const acceleration_functions& ref, const acceleration_functions& simd,
+                                    KernelCheck& check, int log2nT, coeff_mode mode)
+{
+  const int nT = 1<<log2nT;
+
+  // prediction differences in [-255;255]
+
+  static int16_t diff[32*32];
+  for (int i=0;i<nT*nT;i++) {
+    switch (mode) {
+    case COEFF_MAX: diff[i] =  255; break;
+    case COEFF_MIN: diff[i] = -255; break;
+    default:        diff[i] = rnd(-255,255); break;
+    }
+  }
+
+  char name[50];
+
+#define FT_PARAMS "%dx%d, %s input", nT,nT, coeff_mode_names[mode]
+
+  if (log2nT==2 && simd.fwd_transform_4x4_dst_8 != ref.fwd_transform_4x4_dst_8) {
+    ref .fwd_transform_4x4_dst_8(coeffs_ref, diff, nT);
+    simd.fwd_transform_4x4_dst_8(coeffs_out, diff, nT);
+    check.compare("fwd_transform_4x4_dst_8", coeffs_ref, coeffs_out, nT*nT*sizeof(int16_t), FT_PARAMS);
+  }
+
+  if (simd.fwd_transform_8[log2nT-2] != ref.fwd_transform_8[log2nT-2]) {
+    sprintf(name, "fwd_transform_8[%d]", log2nT-2);
+    ref .fwd_transform_8[log2nT-2](coeffs_ref, diff, nT);
+    simd.fwd_transform_8[log2nT-2](coeffs_out, diff, nT);
+    check.compare(name, coeffs_ref, coeffs_out, nT*nT*sizeof(int16_t), FT_PARAMS);
+  }
+
+  if (simd.hadamard_transform_8[log2nT-2] != ref.hadamard_transform_8[log2nT-2]) {
+    sprintf(name, "hadamard_transform_8[%d]", log2nT-2);
+    ref .hadamard_transform_8[log2nT-2](coeffs_ref, diff, nT);
+    simd.hadamard_transform_8[log2nT-2](coeffs_out, diff, nT);
+    check.compare(name, coeffs_ref, coeffs_out, nT*nT*sizeof(int16_t), FT_PARAMS);
+  }
+
+#undef FT_PARAMS
+}
+
+
+static void test_transforms(const acceleration_functions& ref, const acceleration_functions& simd,
+                            KernelCheck& check)
+{
+  const int nRepetitions = 4;
+
+  for (int bit_depth=8; bit_depth<=12; bit_depth++)
+    for (int log2nT=2; log2nT<=5; log2nT++)
+      for (int m=0;m<nCoeffModes;m++)
+        for (int r=0;r<nRepetitions;r++) {
+          coeff_mode mode = (coeff_mode)m;
+          fill_coeffs(coeffs, 1<<log2nT, mode);
+
+          if (bit_depth==8) {
+            fill_image(src8, 8, FILL_RANDOM);
+            test_transform_add(ref, simd, check, 8, log2nT, mode, ref8, out8, src8);
+            test_forward_transforms(ref, simd, check, log2nT, mode);
+          }
+          else {
+            fill_image(src16, bit_depth, FILL_RANDOM);
+            test_transform_add(ref, simd, check, bit_depth, log2nT, mode, ref16, out16, src16);
+          }
+
+          test_residual(ref, simd, check, bit_depth, log2nT, mode);
+        }
+}
+
+
+class AccelerationTransformTest : public Test
+{
+public:
+  const char* getName() const { return "accel-transform"; }
+  const char* getDescription() const { return "compare SIMD transforms and residual functions with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_transforms, quiet); }
+} accel_transform_test;
+
+
+
+// --- deblocking ---
+
+/* Image content around an edge at the block origin: a ramp with noise on both sides
+   of the edge and a step between them. The parameters are chosen such that all
+   filter decisions (off, weak, strong) occur. */
+template <class pixel_t>
+static void fill_edge(pixel_t* img, bool vertical, int bit_depth)
+{
+  const int maxval = (1<<bit_depth)-1;
+  const int scale  = 1<<(bit_depth-8);
+
+  static const int amplitudes[5] = { 0,1,2,8,32 };
+
+  const int base  = rnd(maxval+1);
+  const int slope = rnd(-2,2) * scale;
+  const int noise = amplitudes[rnd(5)] * scale;
+  const int step  = rnd(-4,4) * amplitudes[rnd(5)] * scale;
+
+  for (int y=-8;y<8;y++)
+    for (int x=-8;x<8;x++) {
+      int i = (vertical ? x : y);
+      int v = base + slope*i + (i>=0 ? step : 0) + rnd(-noise,noise);
+
+      img[IMG_ORIGIN + y*IMG_STRIDE + x] = Clip3(0,maxval, v);
+    }
+}
+
+
+template <class pixel_t>
+static void test_deblock(const acceleration_functions& ref, const acceleration_functions& simd,
+                         KernelCheck& check, int bit_depth,
+                         pixel_t* ref_img, pixel_t* out_img, pixel_t* init_img)
+{
+  const bool hbd = (sizeof(pixel_t)==2);
+  const size_t imgSize = IMG_STRIDE*IMG_STRIDE*sizeof(pixel_t);
+  const int nIterations = 1000;
+
+  fill_image(init_img, bit_depth, FILL_RANDOM);
+
+  for (int i=0;i<nIterations;i++) {
+    const bool vertical = rnd(2);
+    fill_edge(init_img, vertical, bit_depth);
+
+    // (8.7.2.5.3), beta and tc scaled to the bit depth
+    const int beta = rnd(0,64) << (bit_depth-8);
+    const int tc   = rnd(0,24) << (bit_depth-8);
+    const bool filterP = rnd(4)!=0;
+    const bool filterQ = rnd(4)!=0;
+
+#define DB_PARAMS "bit depth %d, beta=%d tc=%d filterP=%d filterQ=%d", \
+      bit_depth, beta,tc, filterP,filterQ
+
+    typedef void (*luma_8) (uint8_t*, ptrdiff_t, int, int, bool, bool);
+    typedef void (*luma_16)(uint16_t*,ptrdiff_t, int, int, bool, bool, int);
+    typedef void (*chroma_8) (uint8_t*, ptrdiff_t, int, bool, bool);
+    typedef void (*chroma_16)(uint16_t*,ptrdiff_t, int, bool, bool, int);
+
+    const char* lumaName   = vertical ? (hbd ? "deblock_luma_v_16"   : "deblock_luma_v_8")
+                                      : (hbd ? "deblock_luma_h_16"   : "deblock_luma_h_8");
+    const char* chromaName = vertical ? (hbd ? "deblock_chroma_v_16" : "deblock_chroma_v_8")
+                                      : (hbd ? "deblock_chroma_h_16" : "deblock_chroma_h_8");
+
+    if (!hbd) {
+      luma_8   refLuma    = vertical ? ref.deblock_luma_v_8    : ref.deblock_luma_h_8;
+      luma_8   simdLuma   = vertical ? simd.deblock_luma_v_8   : simd.deblock_luma_h_8;
+      chroma_8 refChroma  = vertical ? ref.deblock_chroma_v_8  : ref.deblock_chroma_h_8;
+      chroma_8 simdChroma = vertical ? simd.deblock_chroma_v_8 : simd.deblock_chroma_h_8;
+
+      if (simdLuma != refLuma) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        refLuma ((uint8_t*)ref_img + IMG_ORIGIN, IMG_STRIDE, beta,tc, filterP,filterQ);
+        simdLuma((uint8_t*)out_img + IMG_ORIGIN, IMG_STRIDE, beta,tc, filterP,filterQ);
+        check.compare(lumaName, ref_img, out_img, imgSize, DB_PARAMS);
+      }
+
+      if (simdChroma != refChroma) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        refChroma ((uint8_t*)ref_img + IMG_ORIGIN, IMG_STRIDE, tc, filterP,filterQ);
+        simdChroma((uint8_t*)out_img + IMG_ORIGIN, IMG_STRIDE, tc, filterP,filterQ);
+        check.compare(chromaName, ref_img, out_img, imgSize, DB_PARAMS);
+      }
+    }
+    else {
+      luma_16   refLuma    = vertical ? ref.deblock_luma_v_16    : ref.deblock_luma_h_16;
+      luma_16   simdLuma   = vertical ? simd.deblock_luma_v_16   : simd.deblock_luma_h_16;
+      chroma_16 refChroma  = vertical ? ref.deblock_chroma_v_16  : ref.deblock_chroma_h_16;
+      chroma_16 simdChroma = vertical ? simd.deblock_chroma_v_16 : simd.deblock_chroma_h_16;
+
+      if (simdLuma != refLuma) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        refLuma ((uint16_t*)ref_img + IMG_ORIGIN, IMG_STRIDE, beta,tc, filterP,filterQ, bit_depth);
+        simdLuma((uint16_t*)out_img + IMG_ORIGIN, IMG_STRIDE, beta,tc, filterP,filterQ, bit_depth);
+        check.compare(lumaName, ref_img, out_img, imgSize, DB_PARAMS);
+      }
+
+      if (simdChroma != refChroma) {
+        memcpy(ref_img, init_img, imgSize);
+        memcpy(out_img, init_img, imgSize);
+        refChroma ((uint16_t*)ref_img + IMG_ORIGIN, IMG_STRIDE, tc, filterP,filterQ, bit_depth);
+        simdChroma((uint16_t*)out_img + IMG_ORIGIN, IMG_STRIDE, tc, filterP,filterQ, bit_depth);
+        check.compare(chromaName, ref_img, out_img, imgSize, DB_PARAMS);
+      }
+    }
+
+#undef DB_PARAMS
+  }
+}
+
+
+static void test_deblocking(const acceleration_functions& ref, const acceleration_functions& simd,
+                            KernelCheck& check)
+{
+  test_deblock(ref, simd, check, 8, ref8, out8, src8);
+
+  for (int bit_depth=9; bit_depth<=12; bit_depth++) {
+    test_deblock(ref, simd, check, bit_depth, ref16, out16, src16);
+  }
+}
+
+
+class AccelerationDeblockingTest : public Test
+{
+public:
+  const char* getName() const { return "accel-deblocking"; }
+  const char* getDescription() const { return "compare SIMD deblocking filters with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_deblocking, quiet); }
+} accel_deblocking_test;
+
+
+
+// --- SAO ---
+
+template <class pixel_t>
+static void test_sao_kernels(const acceleration_functions& ref, const acceleration_functions& simd,
+                             KernelCheck& check, int bit_depth, fill_mode mode,
+                             pixel_t* ref_img, pixel_t* out_img, const pixel_t* src_img)
+{
+  const bool hbd = (sizeof(pixel_t)==2);
+  const size_t imgSize = IMG_STRIDE*IMG_STRIDE*sizeof(pixel_t);
+  const int nIterations = 100;
+
+  // SaoOffsetVal range (7.4.9.3.2) with the largest log2_sao_offset_scale
+  const int maxOffset = ((1<<(libde265_min(bit_depth,10)-5))-1) << libde265_max(0, bit_depth-10);
+
+  for (int i=0;i<nIterations;i++) {
+
+    // whole CTBs, and arbitrary sizes at the picture borders and with excluded border samples
+
+    static const int ctb_sizes[4] = { 64,32,16,8 };
+    const int w = rnd(2) ? ctb_sizes[rnd(4)] : rnd(1,64);
+    const int h = rnd(2) ? ctb_sizes[rnd(4)] : rnd(1,64);
+
+    const ptrdiff_t pos = IMG_ORIGIN + rnd(-8,8) + rnd(-8,8)*IMG_STRIDE;
+
+    const int bandPosition = rnd(32);
+    const int eoClass = i%4;  // all four edge directions
+
+    int8_t bandOffsets[4];
+    for (int k=0;k<4;k++) { bandOffsets[k] = rnd(-maxOffset,maxOffset); }
+
+    // edge offset categories 1,2 have positive offsets, categories 3,4 negative ones
+    int8_t edgeOffsets[5];
+    edgeOffsets[0] =  rnd(0,maxOffset);
+    edgeOffsets[1] =  rnd(0,maxOffset);
+    edgeOffsets[2] =  0;
+    edgeOffsets[3] = -rnd(0,maxOffset);
+    edgeOffsets[4] = -rnd(0,maxOffset);
+
+#define SAO_PARAMS "%dx%d, bit depth %d, %s input, band position %d, edge class %d", \
+      w,h, bit_depth, fill_mode_names[mode], bandPosition, eoClass
+
+    if (!hbd && simd.sao_band_8 != ref.sao_band_8) {
+      memcpy(ref_img, src_img, imgSize);
+      memcpy(out_img, src_img, imgSize);
+      ref .sao_band_8((uint8_t*)ref_img+pos, IMG_STRIDE, (const uint8_t*)src_img+pos, IMG_STRIDE,
+                      w,h, bandPosition, bandOffsets);
+      simd.sao_band_8((uint8_t*)out_img+pos, IMG_STRIDE, (const uint8_t*)src_img+pos, IMG_STRIDE,
+                      w,h, bandPosition, bandOffsets);
+      check.compare("sao_band_8", ref_img, out_img, imgSize, SAO_PARAMS);
+    }
+
+    if (!hbd && simd.sao_edge_8 != ref.sao_edge_8) {
+      memcpy(ref_img, src_img, imgSize);
+      memcpy(out_img, src_img, imgSize);
+      ref .sao_edge_8((uint8_t*)ref_img+pos, IMG_STRIDE, (const uint8_t*)src_img+pos, IMG_STRIDE,
+                      w,h, eoClass, edgeOffsets);
+      simd.sao_edge_8((uint8_t*)out_img+pos, IMG_STRIDE, (const uint8_t*)src_img+pos, IMG_STRIDE,
+                      w,h, eoClass, edgeOffsets);
+      check.compare("sao_edge_8", ref_img, out_img, imgSize, SAO_PARAMS);
+    }
+
+    if (hbd && simd.sao_band_16 != ref.sao_band_16) {
+      memcpy(ref_img, src_img, imgSize);
+      memcpy(out_img, src_img, imgSize);
+      ref .sao_band_16((uint16_t*)ref_img+pos, IMG_STRIDE, (const uint16_t*)src_img+pos, IMG_STRIDE,
+                       w,h, bandPosition, bandOffsets, bit_depth);
+      simd.sao_band_16((uint16_t*)out_img+pos, IMG_STRIDE, (const uint16_t*)src_img+pos, IMG_STRIDE,
+                       w,h, bandPosition, bandOffsets, bit_depth);
+      check.compare("sao_band_16", ref_img, out_img, imgSize, SAO_PARAMS);
+    }
+
+    if (hbd && simd.sao_edge_16 != ref.sao_edge_16) {
+      memcpy(ref_img, src_img, imgSize);
+      memcpy(out_img, src_img, imgSize);
+      ref .sao_edge_16((uint16_t*)ref_img+pos, IMG_STRIDE, (const uint16_t*)src_img+pos, IMG_STRIDE,
+                       w,h, eoClass, edgeOffsets, bit_depth);
+      simd.sao_edge_16((uint16_t*)out_img+pos, IMG_STRIDE, (const uint16_t*)src_img+pos, IMG_STRIDE,
+                       w,h, eoClass, edgeOffsets, bit_depth);
+      check.compare("sao_edge_16", ref_img, out_img, imgSize, SAO_PARAMS);
+    }
+
+#undef SAO_PARAMS
+  }
+}
+
+
+static void test_sao(const acceleration_functions& ref, const acceleration_functions& simd,
+                     KernelCheck& check)
+{
+  for (int m=0;m<nFillModes;m++) {
+    fill_mode mode = (fill_mode)m;
+
+    fill_image(src8, 8, mode);
+    test_sao_kernels(ref, simd, check, 8, mode, ref8, out8, src8);
+
+    for (int bit_depth=9; bit_depth<=12; bit_depth++) {
+      fill_image(src16, bit_depth, mode);
+      test_sao_kernels(ref, simd, check, bit_depth, mode, ref16, out16, src16);
+    }
+  }
+}
+
+
+class AccelerationSAOTest : public Test
+{
+public:
+  const char* getName() const { return "accel-sao"; }
+  const char* getDescription() const { return "compare SIMD SAO band and edge offset with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_sao, quiet); }
+} accel_sao_test;
+
+
+
+// --- intra prediction ---
+
+template <class pixel_t>
+static void test_intra_kernels(const acceleration_functions& ref, const acceleration_functions& simd,
+                               KernelCheck& check, int bit_depth, int nT, fill_mode mode,
+                               const pixel_t* init_border, pixel_t* ref_border, pixel_t* out_border,
+                               pixel_t* ref_img, pixel_t* out_img, const pixel_t* init_img)
+{
+  const bool hbd = (sizeof(pixel_t)==2);
+  const size_t imgSize = IMG_STRIDE*IMG_STRIDE*sizeof(pixel_t);
+  const size_t borderSize = BORDER_SIZE*sizeof(pixel_t);
+
+  const pixel_t* border = init_border + 2*64;
+  const ptrdiff_t pos = IMG_ORIGIN + 4*rnd(4);
+
+#define IP_PARAMS "%dx%d, bit depth %d, %s border", nT,nT, bit_depth, fill_mode_names[mode]
+
+  // strong smoothing is only used for 32x32 luma blocks
+
+  for (int strong=0; strong<=(nT==32 ? 1 : 0); strong++) {
+    if (!hbd && simd.intra_filter_border_8 != ref.intra_filter_border_8) {
+      memcpy(ref_border, init_border, borderSize);
+      memcpy(out_border, init_border, borderSize);
+      ref .intra_filter_border_8((uint8_t*)ref_border + 2*64, nT, strong);
+      simd.intra_filter_border_8((uint8_t*)out_border + 2*64, nT, strong);
+      check.compare("intra_filter_border_8", ref_border, out_border, borderSize, IP_PARAMS);
+    }
+
+    if (hbd && simd.intra_filter_border_16 != ref.intra_filter_border_16) {
+      memcpy(ref_border, init_border, borderSize);
+      memcpy(out_border, init_border, borderSize);
+      ref .intra_filter_border_16((uint16_t*)ref_border + 2*64, nT, strong, bit_depth);
+      simd.intra_filter_border_16((uint16_t*)out_border + 2*64, nT, strong, bit_depth);
+      check.compare("intra_filter_border_16", ref_border, out_border, borderSize, IP_PARAMS);
+    }
+  }
+
+  if (!hbd && simd.intra_pred_planar_8 != ref.intra_pred_planar_8) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .intra_pred_planar_8((uint8_t*)ref_img+pos, IMG_STRIDE, (const uint8_t*)border, nT);
+    simd.intra_pred_planar_8((uint8_t*)out_img+pos, IMG_STRIDE, (const uint8_t*)border, nT);
+    check.compare("intra_pred_planar_8", ref_img, out_img, imgSize, IP_PARAMS);
+  }
+
+  if (hbd && simd.intra_pred_planar_16 != ref.intra_pred_planar_16) {
+    memcpy(ref_img, init_img, imgSize);
+    memcpy(out_img, init_img, imgSize);
+    ref .intra_pred_planar_16((uint16_t*)ref_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, bit_depth);
+    simd.intra_pred_planar_16((uint16_t*)out_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, bit_depth);
+    check.compare("intra_pred_planar_16", ref_img, out_img, imgSize, IP_PARAMS);
+  }
+
+#undef IP_PARAMS
+
+  for (int cIdx=0; cIdx<=1; cIdx++) {
+#define IP_PARAMS "%dx%d, bit depth %d, %s border, cIdx=%d", nT,nT, bit_depth, fill_mode_names[mode], cIdx
+
+    if (!hbd && simd.intra_pred_dc_8 != ref.intra_pred_dc_8) {
+      memcpy(ref_img, init_img, imgSize);
+      memcpy(out_img, init_img, imgSize);
+      ref .intra_pred_dc_8((uint8_t*)ref_img+pos, IMG_STRIDE, (const uint8_t*)border, nT, cIdx);
+      simd.intra_pred_dc_8((uint8_t*)out_img+pos, IMG_STRIDE, (const uint8_t*)border, nT, cIdx);
+      check.compare("intra_pred_dc_8", ref_img, out_img, imgSize, IP_PARAMS);
+    }
+
+    if (hbd && simd.intra_pred_dc_16 != ref.intra_pred_dc_16) {
+      memcpy(ref_img, init_img, imgSize);
+      memcpy(out_img, init_img, imgSize);
+      ref .intra_pred_dc_16((uint16_t*)ref_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, cIdx, bit_depth);
+      simd.intra_pred_dc_16((uint16_t*)out_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, cIdx, bit_depth);
+      check.compare("intra_pred_dc_16", ref_img, out_img, imgSize, IP_PARAMS);
+    }
+
+#undef IP_PARAMS
+
+    for (int intraPredMode=2; intraPredMode<=34; intraPredMode++)
+      for (int disableBoundaryFilter=0; disableBoundaryFilter<=1; disableBoundaryFilter++) {
+#define IP_PARAMS "%dx%d, bit depth %d, %s border, cIdx=%d, mode %d, boundary filter %s", \
+          nT,nT, bit_depth, fill_mode_names[mode], cIdx, intraPredMode, disableBoundaryFilter ? "off":"on"
+
+        if (!hbd && simd.intra_pred_angular_8 != ref.intra_pred_angular_8) {
+          memcpy(ref_img, init_img, imgSize);
+          memcpy(out_img, init_img, imgSize);
+          ref .intra_pred_angular_8((uint8_t*)ref_img+pos, IMG_STRIDE, (const uint8_t*)border, nT, cIdx,
+                                    intraPredMode, disableBoundaryFilter);
+          simd.intra_pred_angular_8((uint8_t*)out_img+pos, IMG_STRIDE, (const uint8_t*)border, nT, cIdx,
+                                    intraPredMode, disableBoundaryFilter);
+          check.compare("intra_pred_angular_8", ref_img, out_img, imgSize, IP_PARAMS);
+        }
+
+        if (hbd && simd.intra_pred_angular_16 != ref.intra_pred_angular_16) {
+          memcpy(ref_img, init_img, imgSize);
+          memcpy(out_img, init_img, imgSize);
+          ref .intra_pred_angular_16((uint16_t*)ref_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, cIdx,
+                                     intraPredMode, disableBoundaryFilter, bit_depth);
+          simd.intra_pred_angular_16((uint16_t*)out_img+pos, IMG_STRIDE, (const uint16_t*)border, nT, cIdx,
+                                     intraPredMode, disableBoundaryFilter, bit_depth);
+          check.compare("intra_pred_angular_16", ref_img, out_img, imgSize, IP_PARAMS);
+        }
+
+#undef IP_PARAMS
+      }
+  }
+}
+
+
+static void test_intra(const acceleration_functions& ref, const acceleration_functions& simd,
+                       KernelCheck& check)
+{
+  for (int m=0;m<nFillModes;m++)
+    for (int log2nT=2; log2nT<=5; log2nT++) {
+      fill_mode mode = (fill_mode)m;
+      const int nT = 1<<log2nT;
+
+      fill_border(border8, 8, mode);
+      fill_image(src8, 8, FILL_RANDOM);
+      test_intra_kernels(ref, simd, check, 8, nT, mode, border8, border8_ref, border8_out,
+                         ref8, out8, src8);
+
+      for (int bit_depth=9; bit_depth<=12; bit_depth++) {
+        fill_border(border16, bit_depth, mode);
+        fill_image(src16, bit_depth, FILL_RANDOM);
+        test_intra_kernels(ref, simd, check, bit_depth, nT, mode, border16, border16_ref, border16_out,
+                           ref16, out16, src16);
+      }
+    }
+}
+
+
+class AccelerationIntraTest : public Test
+{
+public:
+  const char* getName() const { return "accel-intra"; }
+  const char* getDescription() const { return "compare SIMD intra prediction with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_intra, quiet); }
+} accel_intra_test;
+
+
+
+// --- start code search ---
+
+static void test_zero_byte_pair_search(const acceleration_functions& ref, const acceleration_functions& simd,
+                                       KernelCheck& check)
+{
+  if (simd.find_zero_byte_pair == ref.find_zero_byte_pair) {
+    return;
+  }
+
+  static uint8_t data[2048+64];
+
+  // a single pair of zero bytes at every position, and a single zero byte at the end
+
+  for (int len=0; len<=140; len++) {
+    for (int pos=-1; pos<len; pos++) {
+      memset(data, 0x55, len);
+      if (pos>=0)    { data[pos]=0; }
+      if (pos+1<len) { data[pos+1]=0; }
+
+      int r = ref .find_zero_byte_pair(data, len);
+      int s = simd.find_zero_byte_pair(data, len);
+      check.compare("find_zero_byte_pair", &r, &s, sizeof(int), "length %d, zero bytes at %d", len, pos);
+    }
+  }
+
+  // random data with different densities of zero bytes, at all alignments
+
+  static const int zero_probability[5] = { 0, 1, 16, 128, 256 };  // in 1/256
+
+  for (int i=0;i<5000;i++) {
+    const int len = (rnd(4)==0 ? rnd(2048) : rnd(200));
+    const int offset = rnd(64);
+    const int p = zero_probability[rnd(5)];
+
+    for (int k=0;k<len;k++) {
+      data[offset+k] = (rnd(256) < p) ? 0 : rnd(1,255);
+    }
+
+    int r = ref .find_zero_byte_pair(data+offset, len);
+    int s = simd.find_zero_byte_pair(data+offset, len);
+    check.compare("find_zero_byte_pair", &r, &s, sizeof(int),
+                  "length %d, alignment %d, zero byte probability %d/256", len, offset, p);
+  }
+}
+
+
+class AccelerationNALTest : public Test
+{
+public:
+  const char* getName() const { return "accel-nal"; }
+  const char* getDescription() const { return "compare the SIMD start code search with the scalar code"; }
+  bool work(bool quiet) { return test_all_levels(test_zero_byte_pair_search, quiet); }
+} accel_nal_test;
@@ -18,52 +18,44 @@
  * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdio.h>
-#include <iostream>
-#include <string.h>
+#include "tests.h"
 
 
-class Test
+bool Test::runTest(const char* name)
 {
-public:
-  Test() { next=s_firstTest; s_firstTest=this; }
-  virtual ~Test() { }
-
-  virtual const char* getName() const { return "noname"; }
-  virtual const char* getDescription() const { return "no description"; }
-  virtual bool work(bool quiet=false) = 0;
-
-  static void runTest(const char* name) {
-    Test* t = s_firstTest;
-    while (t) {
-      if (strcmp(t->getName(), name)==0) {
-        t->work();
-        break;
-      }
-      t=t->next;
+  Test* t = s_firstTest;
+  while (t) {
+    if (strcmp(t->getName(), name)==0) {
+      return t->work();
     }
+    t=t->next;
   }
 
-  static void runAllTests() {
-    Test* t = s_firstTest;
-    while (t) {
-      printf("%s ... ",t->getName());
-      fflush(stdout);
-      if (t->work(true) == false) {
-        printf("*** FAILED ***\n");
-      }
-      else {
-        printf("passed\n");
-      }
+  fprintf(stderr,"unknown test '%s'\n",name);
+  return false;
+}
+
+bool Test::runAllTests()
+{
+  bool allPassed = true;
 
-      t=t->next;
+  Test* t = s_firstTest;
+  while (t) {
+    printf("%s ... ",t->getName());
+    fflush(stdout);
+    if (t->work(true) == false) {
+      printf("*** FAILED ***\n");
+      allPassed = false;
+    }
+    else {
+      printf("passed\n");
     }
+
+    t=t->next;
   }
 
-public:
-  Test* next;
-  static Test* s_firstTest;
-};
+  return allPassed;
+}
 
 Test* Test::s_firstTest = NULL;
 
@@ -89,12 +81,14 @@ public:
 
 int main(int argc,char** argv)
 {
+  bool passed;
+
   if (argc>=2) {
-    Test::runTest(argv[1]);
+    passed = Test::runTest(argv[1]);
   }
   else {
-    Test::runAllTests();
+    passed = Test::runAllTests();
   }
 
-  return 0;
+  return passed ? 0 : 1;
 }
@@ -0,0 +1,49 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_TESTS_H
+#define DE265_TESTS_H
+
+#include <stdio.h>
+#include <string.h>
+
+
+/* Tests register themselves by instantiating a static object of a Test subclass.
+   work() returns false if the test failed. */
+
+class Test
+{
+public:
+  Test() { next=s_firstTest; s_firstTest=this; }
+  virtual ~Test() { }
+
+  virtual const char* getName() const { return "noname"; }
+  virtual const char* getDescription() const { return "no description"; }
+  virtual bool work(bool quiet=false) = 0;
+
+  static bool runTest(const char* name);
+  static bool runAllTests();
+
+public:
+  Test* next;
+  static Test* s_firstTest;
+};
+
+#endif